@@ -0,0 +1,135 @@
+// Append throughput benchmark
+// Several threads append short lines to one shared log file, the case the
+// append endpoint is for. The baseline opens, appends and closes the file
+// for every line, as FileManager::appendFile did; AppendWriter keeps the
+// descriptor open and coalesces concurrent lines into one writev, with and
+// without a coalescing window. Afterwards every thread's lines are checked to
+// be complete and in the order that thread appended them.
+//
+// Usage: append_bench [root_dir] [threads] [appends_per_thread] [bytes]
+
+#include "../include/AppendWriter.h"
+#include "../include/BlobStore.h"
+#include "../include/FileIndex.h"
+#include "../include/MetadataCache.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct Mode {
+    const char* name;
+    bool writer;                 // AppendWriter rather than open/write/close
+    long long window_us;
+};
+
+// What FileManager::appendFile did for every append before AppendWriter
+static bool appendOnce(const string& path, const string& line) {
+    if (!BlobStore::detach(path).empty()) {
+        return false;
+    }
+    ScopedFd fd(Sandbox::openPath(path, O_WRONLY | O_CREAT | O_APPEND, 0644));
+    if (!fd.valid()) {
+        return false;
+    }
+    MetadataCache::invalidateTree(path);
+    FileIndex::update(path);
+    return ::write(fd.get(), line.data(), line.size()) == static_cast<ssize_t>(line.size());
+}
+
+// Every thread's lines present once and in order
+static bool verify(const filesystem::path& log, size_t threads, size_t appends) {
+    vector<size_t> next(threads, 0);
+    ifstream in(log);
+    string line;
+    while (getline(in, line)) {
+        size_t t = strtoull(line.c_str(), nullptr, 10);
+        size_t i = strtoull(line.c_str() + line.find(' ') + 1, nullptr, 10);
+        if (t >= threads || i != next[t]) {
+            return false;
+        }
+        next[t]++;
+    }
+    for (size_t count : next) {
+        if (count != appends) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string root = (argc > 1) ? argv[1] : "./append_bench_root";
+    size_t threads = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 8;
+    size_t appends = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 50000;
+    size_t bytes = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 64;
+
+    filesystem::create_directories(filesystem::path(root) / "bench");
+    if (!PathUtils::initializeVFSRoot(root)) {
+        cerr << "Error: Failed to open benchmark root: " << root << endl;
+        return 1;
+    }
+
+    const Mode modes[] = {
+        {"open/close", false, 0},
+        {"writer 0us", true, 0},
+        {"writer 50us", true, 50},
+    };
+    cout << threads << " threads x " << appends << " appends of " << bytes << " bytes" << endl;
+    cout << left << setw(14) << "mode" << setw(14) << "appends/s" << setw(12) << "batches" << "order" << endl;
+    for (const Mode& mode : modes) {
+        filesystem::path log = filesystem::path(root) / "bench" / "append.log";
+        filesystem::remove(log);
+        AppendWriter::setWindow(chrono::microseconds(mode.window_us));
+        AppendWriter::Stats before = AppendWriter::getStats();
+
+        vector<thread> workers;
+        vector<char> failed(threads, 0);
+        auto start = chrono::steady_clock::now();
+        for (size_t t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i = 0; i < appends; ++i) {
+                    string line = to_string(t) + " " + to_string(i) + " ";
+                    line.resize(max(bytes, line.size() + 1) - 1, 'x');
+                    line += '\n';
+                    bool ok = mode.writer ? AppendWriter::append("/bench/append.log", line.data(), line.size()).empty()
+                                          : appendOnce("/bench/append.log", line);
+                    if (!ok) {
+                        failed[t] = 1;
+                        return;
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        for (char f : failed) {
+            if (f) {
+                cerr << "Error: Append failed in mode " << mode.name << endl;
+                return 1;
+            }
+        }
+        uint64_t batches = AppendWriter::getStats().batches - before.batches;
+        cout << left << setw(14) << mode.name << setw(14) << fixed << setprecision(0)
+             << threads * appends / elapsed << setw(12) << (mode.writer ? to_string(batches) : "-")
+             << (verify(log, threads, appends) ? "ok" : "BROKEN") << endl;
+        AppendWriter::closeAll();
+    }
+
+    filesystem::remove_all(filesystem::path(root) / "bench");
+    return 0;
+}
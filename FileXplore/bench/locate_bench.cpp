@@ -0,0 +1,84 @@
+// Filename index benchmark
+// Creates a tree of empty files with word-like names, builds the FileIndex
+// over it and times locate queries of several lengths and selectivities.
+//
+// Usage: locate_bench [root_dir] [files] [queries_per_pattern]
+// Creating the tree dominates the run time; reuse root_dir to skip it.
+
+#include "../include/FileIndex.h"
+#include "../include/PathUtils.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const char* const WORDS[] = {
+    "report", "invoice", "photo", "backup", "draft", "notes", "budget", "summary", "archive", "config",
+    "design", "meeting", "project", "release", "test", "data", "image", "final", "old", "copy"
+};
+static const char* const EXTENSIONS[] = {".txt", ".pdf", ".jpg", ".cpp", ".md", ".json", ".log", ".zip"};
+
+// Directories d<0..99>/e<0..99>, files named word_word_<n>.ext
+static void createTree(const filesystem::path& dir, size_t files) {
+    mt19937 rng(7);
+    uniform_int_distribution<size_t> word(0, sizeof(WORDS) / sizeof(WORDS[0]) - 1);
+    uniform_int_distribution<size_t> extension(0, sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]) - 1);
+
+    for (size_t f = 0; f < files; ++f) {
+        filesystem::path sub = dir / ("d" + to_string(f % 100)) / ("e" + to_string((f / 100) % 100));
+        if (f < 10000) {
+            filesystem::create_directories(sub);
+        }
+        string name = string(WORDS[word(rng)]) + "_" + WORDS[word(rng)] + "_" + to_string(f) + EXTENSIONS[extension(rng)];
+        ofstream(sub / name);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    string root = (argc > 1) ? argv[1] : "./locate_bench_root";
+    size_t files = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 200000;
+    size_t rounds = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 200;
+
+    filesystem::path tree = filesystem::path(root) / "bench";
+    if (!filesystem::exists(tree)) {
+        cout << "Creating " << files << " files..." << endl;
+        createTree(tree, files);
+    }
+    if (!PathUtils::initializeVFSRoot(root)) {
+        cerr << "Error: Failed to open benchmark root: " << root << endl;
+        return 1;
+    }
+
+    // No persistence directory is set up, so this always builds from the tree
+    FileIndex::start();
+    while (!FileIndex::getStats().ready) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    FileIndex::Stats stats = FileIndex::getStats();
+    cout << "Indexed " << stats.entries << " paths in " << fixed << setprecision(0) << stats.last_build_ms << " ms, "
+         << stats.trigrams << " trigrams, ~" << stats.memory_bytes / (1024 * 1024) << " MiB" << endl;
+
+    const vector<string> queries = {"invoice_photo_1234", "_4242.", "budget", "REPORT_draft", ".md", "zz9", "e4"};
+    cout << left << setw(22) << "query" << setw(12) << "matches" << "us/query (top 50)" << endl;
+    for (const auto& query : queries) {
+        vector<FileIndex::Result> results;
+        size_t total = FileIndex::locate(query, 50, results);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < rounds; ++i) {
+            FileIndex::locate(query, 50, results);
+        }
+        double elapsed = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(22) << query << setw(12) << total << setprecision(1) << elapsed / rounds << endl;
+    }
+
+    FileIndex::stop();
+    return 0;
+}
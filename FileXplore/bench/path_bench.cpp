@@ -0,0 +1,105 @@
+// Path normalization microbenchmark
+// Compares the stringstream/vector normalizer PathUtils used to ship with
+// the current string_view implementation, in normalizations per second.
+//
+// Usage: path_bench [iterations]
+
+#include "../include/PathUtils.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// The previous implementation, kept here only as the baseline
+static vector<string> legacySplitPath(const string& path) {
+    vector<string> components;
+    stringstream ss(path);
+    string component;
+    while (getline(ss, component, '/')) {
+        if (!component.empty()) {
+            components.push_back(component);
+        }
+    }
+    return components;
+}
+
+static string legacyNormalizePath(const string& path) {
+    if (path.empty()) {
+        return "/";
+    }
+    vector<string> components = legacySplitPath(path);
+    vector<string> normalized;
+    for (const auto& component : components) {
+        if (component == "." || component.empty()) {
+            continue;
+        } else if (component == "..") {
+            if (!normalized.empty() && normalized.back() != "..") {
+                normalized.pop_back();
+            }
+        } else {
+            normalized.push_back(component);
+        }
+    }
+    string result = "/";
+    for (size_t i = 0; i < normalized.size(); ++i) {
+        if (i > 0) result += "/";
+        result += normalized[i];
+    }
+    return result;
+}
+
+template <typename Fn>
+static double run(const vector<string>& inputs, size_t iterations, Fn fn) {
+    size_t checksum = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        for (const auto& input : inputs) {
+            checksum += fn(input).size();
+        }
+    }
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (checksum == 0) {
+        cerr << "unexpected empty results" << endl;
+    }
+    return static_cast<double>(iterations * inputs.size()) / elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    size_t iterations = (argc > 1) ? strtoull(argv[1], nullptr, 10) : 200000;
+
+    // Mix of what the GUI sends: mostly canonical, some with dot segments
+    const vector<string> canonical = {
+        "/", "/home", "/home/user/documents/readme.txt", "/abc/hello/archive.zip",
+        "/var/log/filexplore/2024/10/16/server.log",
+    };
+    const vector<string> messy = {
+        "/home//user/./documents/../pictures/", "./a/b/../c", "/abc/hello1/../hello/abc.txt",
+        "//var///log/./x/..", "/a/b/c/d/e/f/g/h/../../../i/j/k/./l",
+    };
+
+    // Sanity check: both implementations must agree
+    for (const auto* set : {&canonical, &messy}) {
+        for (const auto& input : *set) {
+            if (legacyNormalizePath(input) != PathUtils::normalizePath(input)) {
+                cerr << "Mismatch for '" << input << "': " << legacyNormalizePath(input)
+                     << " vs " << PathUtils::normalizePath(input) << endl;
+                return 1;
+            }
+        }
+    }
+
+    cout << fixed << setprecision(0);
+    cout << left << setw(12) << "input" << setw(20) << "legacy (ops/s)" << setw(20) << "current (ops/s)" << "speedup" << endl;
+    for (const auto& entry : {make_pair("canonical", &canonical), make_pair("messy", &messy)}) {
+        double legacy = run(*entry.second, iterations, legacyNormalizePath);
+        double current = run(*entry.second, iterations, [](const string& p) { return PathUtils::normalizePath(p); });
+        cout << left << setw(12) << entry.first << setw(20) << legacy << setw(20) << current
+             << setprecision(2) << current / legacy << "x" << setprecision(0) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,107 @@
+// File write durability benchmark
+// Measures FileManager::writeFile throughput in each durability mode with
+// several concurrent writers (as the web server's worker threads would be),
+// and durable writes with the group commit disabled, i.e. one fsync per
+// file and per directory, as the baseline the group commit is measured against.
+//
+// Usage: write_bench [root_dir] [threads] [writes_per_thread] [bytes]
+// Run it on the filesystem you care about: on tmpfs fsync is free.
+
+#include "../include/FileManager.h"
+#include "../include/GroupCommit.h"
+#include "../include/PathUtils.h"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+struct Mode {
+    const char* name;
+    FileManager::Durability durability;
+    bool group_commit;
+    long long window_us;
+};
+
+// Writes per second across all threads; false if any write failed
+static bool run(const Mode& mode, size_t threads, size_t writes, const string& content, double& rate) {
+    GroupCommit::setEnabled(mode.group_commit);
+    GroupCommit::setWindow(chrono::microseconds(mode.window_us));
+    GroupCommit::resetStats();
+
+    vector<thread> workers;
+    vector<char> failed(threads, 0);
+    auto start = chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            // Each writer rewrites a small set of its own files, like repeated saves
+            for (size_t i = 0; i < writes; ++i) {
+                string path = "/bench/w" + to_string(t) + "_" + to_string(i % 16) + ".txt";
+                if (FileManager::writeFile(path, content, mode.durability).find("Error:") == 0) {
+                    failed[t] = 1;
+                    return;
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for (char f : failed) {
+        if (f) {
+            return false;
+        }
+    }
+    rate = static_cast<double>(threads * writes) / elapsed;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string root = (argc > 1) ? argv[1] : "./write_bench_root";
+    size_t threads = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 8;
+    size_t writes = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 200;
+    size_t bytes = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 4096;
+
+    filesystem::create_directories(filesystem::path(root) / "bench");
+    if (!PathUtils::initializeVFSRoot(root)) {
+        cerr << "Error: Failed to open benchmark root: " << root << endl;
+        return 1;
+    }
+    string content(bytes, 'x');
+
+    const vector<Mode> modes = {
+        {"none", FileManager::Durability::None, true, 0},
+        {"atomic", FileManager::Durability::Atomic, true, 0},
+        {"durable (fsync each)", FileManager::Durability::Durable, false, 0},
+        {"durable (group, 0us)", FileManager::Durability::Durable, true, 0},
+        {"durable (group, 500us)", FileManager::Durability::Durable, true, 500},
+    };
+
+    cout << threads << " threads x " << writes << " writes of " << bytes << " bytes" << endl;
+    cout << left << setw(26) << "mode" << setw(16) << "writes/s" << "syncs per flush" << endl;
+    for (const auto& mode : modes) {
+        double rate = 0;
+        if (!run(mode, threads, writes, content, rate)) {
+            cerr << "Error: writes failed in mode " << mode.name << endl;
+            return 1;
+        }
+        GroupCommit::Stats stats = GroupCommit::getStats();
+        cout << left << setw(26) << mode.name << setw(16) << fixed << setprecision(0) << rate;
+        if (stats.flushes > 0) {
+            cout << setprecision(2) << static_cast<double>(stats.requests) / stats.flushes;
+        } else {
+            cout << "-";
+        }
+        cout << endl;
+    }
+
+    filesystem::remove_all(filesystem::path(root) / "bench");
+    return 0;
+}
@@ -0,0 +1,136 @@
+// Zip packing and extraction throughput benchmark
+// Generates a tree of compressible text files (a few large, many small) and
+// packs it with CompressionManager::compressToZip at 1, 2, 4, ... threads up
+// to the core count (or max_threads), reporting input MB/s and the archive
+// size. The archive is the same at every thread count, so only the time
+// should change. The archive is then extracted with decompressFromZip at the
+// same thread counts, and the extracted tree compared with the original.
+//
+// Usage: zip_bench [root_dir] [small_files] [large_files] [large_mib] [max_threads]
+
+#include "../include/CompressionManager.h"
+#include "../include/PathUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Text-like content that deflates to roughly a third of its size
+static string makeText(mt19937_64& rng, size_t bytes) {
+    static const char* words[] = {"file", "explore", "virtual", "root", "index", "block", "deflate", "entry",
+                                  "archive", "thread", "writer", "cache", "path", "sandbox", "snapshot", "blob"};
+    string text;
+    text.reserve(bytes + 16);
+    while (text.size() < bytes) {
+        text += words[rng() % 16];
+        text += (rng() % 12 == 0) ? '\n' : ' ';
+        if (rng() % 5 == 0) {
+            text += to_string(rng() % 100000);
+            text += ' ';
+        }
+    }
+    text.resize(bytes);
+    return text;
+}
+
+// Every file under original has an identical copy at the same place under copy
+static bool sameTree(const filesystem::path& original, const filesystem::path& copy) {
+    for (const auto& entry : filesystem::recursive_directory_iterator(original)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        ifstream a(entry.path(), ios::binary);
+        ifstream b(copy / filesystem::relative(entry.path(), original), ios::binary);
+        if (!b || !equal(istreambuf_iterator<char>(a), istreambuf_iterator<char>(), istreambuf_iterator<char>(b),
+                         istreambuf_iterator<char>())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string root = (argc > 1) ? argv[1] : "./zip_bench_root";
+    size_t small_files = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 2000;
+    size_t large_files = (argc > 3) ? strtoull(argv[3], nullptr, 10) : 4;
+    size_t large_mib = (argc > 4) ? strtoull(argv[4], nullptr, 10) : 32;
+
+    mt19937_64 rng(1);
+    filesystem::path tree = filesystem::path(root) / "bench";
+    filesystem::remove_all(tree);
+    uintmax_t total = 0;
+    for (size_t f = 0; f < small_files; ++f) {
+        filesystem::path sub = tree / ("d" + to_string(f % 32));
+        filesystem::create_directories(sub);
+        string text = makeText(rng, 1024 + rng() % (64 * 1024));
+        ofstream(sub / ("f" + to_string(f) + ".txt"), ios::binary) << text;
+        total += text.size();
+    }
+    filesystem::create_directories(tree / "large");
+    for (size_t f = 0; f < large_files; ++f) {
+        string text = makeText(rng, large_mib << 20);
+        ofstream(tree / "large" / ("l" + to_string(f) + ".log"), ios::binary) << text;
+        total += text.size();
+    }
+    if (!PathUtils::initializeVFSRoot(root)) {
+        cerr << "Error: Failed to open benchmark root: " << root << endl;
+        return 1;
+    }
+
+    size_t cores = max(1u, thread::hardware_concurrency());
+    size_t max_threads = (argc > 5) ? max<size_t>(1, strtoull(argv[5], nullptr, 10)) : cores;
+    vector<size_t> counts;
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        counts.push_back(threads);
+    }
+    counts.push_back(max_threads);
+
+    cout << small_files << " small + " << large_files << " x " << large_mib << " MiB files, "
+         << fixed << setprecision(1) << total / 1e6 << " MB, " << cores << " cores" << endl;
+    cout << left << setw(10) << "threads" << setw(10) << "MB/s" << setw(12) << "seconds" << "archive MB" << endl;
+    for (size_t threads : counts) {
+        CompressionManager::Options options;
+        options.threads = threads;
+        auto start = chrono::steady_clock::now();
+        if (!CompressionManager::compressToZip("/bench.zip", {"/bench"}, options)) {
+            cerr << "Error: Packing failed" << endl;
+            return 1;
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(10) << threads << setw(10) << setprecision(1) << total / elapsed / 1e6
+             << setw(12) << setprecision(2) << elapsed << setprecision(1)
+             << filesystem::file_size(filesystem::path(root) / "bench.zip") / 1e6 << endl;
+    }
+
+    cout << left << setw(10) << "threads" << setw(10) << "MB/s" << setw(12) << "seconds" << "unzip" << endl;
+    filesystem::path unpacked = filesystem::path(root) / "unpacked";
+    for (size_t threads : counts) {
+        filesystem::remove_all(unpacked);
+        CompressionManager::Options options;
+        options.threads = threads;
+        auto start = chrono::steady_clock::now();
+        if (!CompressionManager::decompressFromZip("/bench.zip", "/unpacked", options)) {
+            cerr << "Error: Extraction failed" << endl;
+            return 1;
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << left << setw(10) << threads << setw(10) << setprecision(1) << total / elapsed / 1e6
+             << setw(12) << setprecision(2) << elapsed << (sameTree(tree, unpacked / "bench") ? "ok" : "DIFFERENT")
+             << endl;
+    }
+
+    filesystem::remove_all(tree);
+    filesystem::remove_all(unpacked);
+    filesystem::remove(filesystem::path(root) / "bench.zip");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * AppendWriter - Coalesced appends over cached file handles
+ * Each file appended to keeps an O_APPEND descriptor open in a small LRU,
+ * so a log-style append costs no open/close. Appends to one file queue up
+ * in arrival order; the first caller leads the queue and writes the whole
+ * batch with one writev, while the appends arriving meanwhile form the next
+ * batch (like GroupCommit does for fsync). With a coalescing window set, a
+ * leader whose file saw concurrent appenders last time also waits up to the
+ * window for more. It is off by default: a writev takes microseconds, not
+ * the milliseconds of an fsync, so batches fill up during the write itself.
+ * Batches of one file never overlap, so appends land in the order they were
+ * queued, and every caller returns once its bytes are written.
+ * Before each batch the cached descriptor is fstat'ed: a file that was
+ * replaced or removed since has no link left and is reopened by path, one
+ * that was hard linked (blob store, snapshots) is detached first, so a
+ * cached descriptor does not write to a stale or shared inode. The path
+ * itself is re-checked every REVALIDATE_MS for renames from outside.
+ */
+class AppendWriter {
+public:
+    // Counters for benchmarks and /api/system
+    struct Stats {
+        std::uint64_t appends;        // append() calls
+        std::uint64_t batches;        // writev batches
+        std::uint64_t bytes;
+        std::uint64_t opens;          // Descriptors opened (misses of the handle cache)
+        std::size_t open_files;
+
+        Stats() : appends(0), batches(0), bytes(0), opens(0), open_files(0) {}
+    };
+
+    // Descriptors kept open at most
+    static constexpr std::size_t MAX_OPEN_FILES = 64;
+
+    // Append length bytes to the normalized virtual path resolved (created if missing);
+    // returns after they were written. "" or "Error: ..."
+    static std::string append(const std::string& resolved, const char* data, std::size_t length);
+
+    // How long a batch leader waits for more appenders (0 = write at once)
+    static void setWindow(std::chrono::microseconds window);
+    static std::chrono::microseconds getWindow();
+
+    // Close every idle descriptor (at exit)
+    static void closeAll();
+
+    static Stats getStats();
+
+private:
+    struct Batch;
+    struct Target;
+
+    // Re-stat the path of a cached descriptor at least this often
+    static constexpr std::int64_t REVALIDATE_MS = 1000;
+
+    static std::mutex targets_mutex;
+    static std::unordered_map<std::string, std::shared_ptr<Target>> targets;
+    static std::list<std::string> recent;         // Most recently used first
+    static std::atomic<std::int64_t> window_us;
+
+    static std::atomic<std::uint64_t> appends;
+    static std::atomic<std::uint64_t> batches;
+    static std::atomic<std::uint64_t> bytes;
+    static std::atomic<std::uint64_t> opens;
+
+    // Find or create the entry of a path and pin it against eviction
+    static std::shared_ptr<Target> acquire(const std::string& resolved);
+
+    // Unpin an entry
+    static void release(const std::shared_ptr<Target>& target);
+
+    // Write one closed batch (the caller leads it); reopens the file when needed
+    static std::string writeBatch(Target& target, const std::string& resolved, const Batch& batch);
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <shared_mutex>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * BlobStore - Content-addressed, deduplicated storage beneath the VFS root
+ * When enabled, file contents are kept once in STORE_DIR/objects/<ab>/<sha256>
+ * and each file in the tree is a hard link to its blob, so writing or uploading
+ * content the store already holds only adds a link: no data is written.
+ * A blob's link count is its reference count (every link but the store's own),
+ * which stays exact across rm, mv and replacement without a side index;
+ * collectGarbage() removes blobs nothing links to anymore.
+ * Linked files share one inode, so anything that changes a file in place calls
+ * detach() first, which gives that path a private copy (a reflink where the
+ * filesystem supports FICLONE). Snapshots link files the same way, so detach()
+ * and release() also act while SnapshotManager holds any, store or not. The store is enabled while STORE_DIR exists
+ * without a "disabled" marker, so the setting lives with the VFS root.
+ */
+class BlobStore {
+public:
+    // Usage counters for the dedup command and /api/system
+    struct Stats {
+        std::uint64_t blobs;          // Blobs in the store
+        std::uint64_t references;     // Tree files linked to a blob
+        std::uint64_t stored_bytes;   // Bytes the blobs occupy
+        std::uint64_t logical_bytes;  // Bytes the referencing files would occupy without sharing
+        std::uint64_t hits;           // Writes that found their content already stored (this run)
+        std::uint64_t misses;         // Writes that stored new content (this run)
+
+        Stats() : blobs(0), references(0), stored_bytes(0), logical_bytes(0), hits(0), misses(0) {}
+    };
+
+    // Directory (beneath the root) holding the store
+    static const char* const STORE_DIR;
+
+    // Pick up the store of this VFS root and drop temp files of a previous run
+    static void initialize();
+
+    // Check if new writes go through the store
+    static bool isEnabled();
+
+    // Turn the store on (creating it) or off (existing links stay valid); "" or "Error: ..."
+    static std::string setEnabled(bool enabled);
+
+    // Check that hash is 64 lowercase hex digits
+    static bool isValidHash(const std::string& hash);
+
+    // Check whether a blob with this hash (and size, unless negative) is stored
+    static bool contains(const std::string& hash, long long size = -1);
+
+    // Store content and link it at the normalized virtual path resolved;
+    // deduplicated is set when the content was already stored. "" or "Error: ..."
+    static std::string writeContent(const std::string& resolved, const std::string& content, bool durable,
+                                    bool& deduplicated);
+
+    // Publish a finished temp file at resolved through the store (consumes temp_path)
+    static std::string adoptFile(const std::string& temp_path, const std::string& resolved, bool durable,
+                                 bool& deduplicated);
+
+    // Link an already stored blob at resolved
+    static std::string linkBlob(const std::string& hash, const std::string& resolved, bool durable);
+
+    // Before changing resolved in place: replace a shared inode with a private copy. "" or "Error: ..."
+    static std::string detach(const std::string& resolved);
+
+    // Before rewriting resolved from scratch: unlink it if its inode is shared
+    static void release(const std::string& resolved);
+
+    // Count blobs and references (walks the store)
+    static Stats getStats();
+
+    // Remove unreferenced blobs; returns how many, freed_bytes receives their size
+    static std::size_t collectGarbage(std::uint64_t& freed_bytes);
+
+private:
+    static std::atomic<bool> enabled;
+    static std::atomic<bool> present;            // STORE_DIR exists (enabled or not)
+    static std::atomic<std::uint64_t> hits;
+    static std::atomic<std::uint64_t> misses;
+
+    // Writers share it; garbage collection takes it exclusively so a blob
+    // cannot disappear between the lookup and the link
+    static std::shared_mutex store_mutex;
+
+    // STORE_DIR/objects/<first two digits>/<hash>
+    static std::string blobPath(const std::string& hash);
+
+    // Replace resolved with a new link to blob (same directory temp name, then rename)
+    static std::string linkInto(const std::string& blob, const std::string& resolved, bool durable);
+
+    // Give a temp file holding content with this hash a store name; blob receives the name in use
+    static std::string storeTemp(const std::string& temp_path, const std::string& hash, std::string& blob);
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * ChecksumManager - Parallel file checksums with a persistent digest cache
+ * Files are found with TreeWalker and hashed on its worker threads through a
+ * read-only mapping. CRC-32 is zlib's; CRC-32C uses the SSE4.2 crc32
+ * instruction where the CPU has it; XXH64 runs its four independent lanes
+ * per 32-byte stripe; SHA-256 is Sha256.
+ * Every digest computed is cached by (inode, size, mtime with nanoseconds),
+ * which the walk already has, so checksumming an unchanged tree again costs
+ * only the stats. Hard links (blob store, snapshots) share their inode and so
+ * their cache entry. The cache is saved next to the persistence state files
+ * as a sidecar index rather than in extended attributes, which would need an
+ * open per file and are not kept by every filesystem.
+ */
+class ChecksumManager {
+public:
+    enum class Algorithm { Crc32, Crc32c, Xxh64, Sha256 };
+
+    // What to checksum and how
+    struct Options {
+        Algorithm algorithm;
+        bool recursive;               // Descend into subdirectories of a directory path
+        std::size_t max_files;        // Stop after this many files (0 = no limit)
+        std::size_t threads;          // Walker threads (0 = hardware concurrency)
+
+        Options() : algorithm(Algorithm::Sha256), recursive(false), max_files(0), threads(0) {}
+    };
+
+    // Digest of one file
+    struct Result {
+        std::string path;             // Normalized virtual path
+        std::string digest;           // Lowercase hex
+        long long size;
+        bool cached;                  // Taken from the cache, not hashed
+    };
+
+    // Totals of a finished (or stopped) run
+    struct Summary {
+        std::uint64_t files;
+        std::uint64_t cache_hits;
+        std::uint64_t bytes_hashed;
+        std::uint64_t errors;         // Files that could not be read
+        bool truncated;               // Stopped at max_files
+        std::string error;            // "Error: ..." if the run could not start
+
+        Summary() : files(0), cache_hits(0), bytes_hashed(0), errors(0), truncated(false) {}
+    };
+
+    // Receives results one at a time (calls are serialized); return false to stop
+    using ResultCallback = std::function<bool(const Result&)>;
+
+    // Parse "crc32", "crc32c", "xxh64" or "sha256" (case-insensitive)
+    static bool parseAlgorithm(const std::string& name, Algorithm& algorithm);
+
+    // Lowercase name of an algorithm
+    static const char* algorithmName(Algorithm algorithm);
+
+    // Hex digest of a buffer
+    static std::string digest(Algorithm algorithm, std::string_view data);
+
+    // Checksum a file, or the files of a directory; blocks until done
+    static Summary checksum(const std::string& virtual_path, const Options& options, const ResultCallback& on_result);
+
+    // Check whether CRC-32C uses the SSE4.2 instruction on this CPU
+    static bool usesCrc32cInstruction();
+
+    // Write the cache if it changed since it was loaded or last saved
+    static void save();
+
+private:
+    // Raw digests of one inode; present has bit (1 << Algorithm) set for each one filled in
+    struct CacheEntry {
+        std::int64_t size;
+        std::int64_t mtime_ns;
+        std::uint8_t present;
+        std::uint32_t crc32;
+        std::uint32_t crc32c;
+        std::uint64_t xxh64;
+        std::uint8_t sha256[32];
+    };
+
+    // Saved cache layout version
+    static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+    // Start over rather than grow past this many inodes
+    static constexpr std::size_t MAX_CACHE_ENTRIES = 1 << 20;
+
+    static std::mutex cache_mutex;
+    static std::unordered_map<std::uint64_t, CacheEntry> cache;
+    static bool loaded;
+    static std::atomic<bool> dirty;
+
+    // Read the saved cache once (cache_mutex held)
+    static void loadLocked();
+
+    // Cached hex digest for this inode state; false on a miss
+    static bool lookup(std::uint64_t inode, long long size, std::int64_t mtime_ns, Algorithm algorithm,
+                       std::string& hex_digest);
+
+    // Remember a hex digest for this inode state
+    static void store(std::uint64_t inode, long long size, std::int64_t mtime_ns, Algorithm algorithm,
+                      const std::string& hex_digest);
+
+    // Hash a file whose walk entry gave inode, size and mtime; result.cached tells a cache hit
+    static std::string hashFile(const std::string& virtual_path, std::uint64_t inode, long long size,
+                                std::int64_t mtime_ns, Algorithm algorithm, Result& result);
+};
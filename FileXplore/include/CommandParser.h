@@ -5,6 +5,8 @@
 #include <map>
 #include <functional>
 
+class Session;
+
 /**
  * CommandParser - Parses and executes CLI commands
  * Handles command parsing, argument extraction, and command execution
@@ -22,8 +24,8 @@ public:
     // Initialize command parser
     static void initialize();
     
-    // Parse and execute a command
-    static CommandResult executeCommand(const std::string& input);
+    // Parse and execute a command in the context of a session
+    static CommandResult executeCommand(Session& session, const std::string& input);
     
     // Get list of available commands
     static std::vector<std::string> getAvailableCommands();
@@ -33,7 +35,7 @@ public:
     
 private:
     // Command function type
-    using CommandFunction = std::function<CommandResult(const std::vector<std::string>&)>;
+    using CommandFunction = std::function<CommandResult(Session&, const std::vector<std::string>&)>;
     
     // Map of command names to functions
     static std::map<std::string, CommandFunction> commands;
@@ -45,22 +47,29 @@ private:
     static std::string extractQuotedString(const std::vector<std::string>& args, size_t start_index);
     
     // Command implementations
-    static CommandResult cmdMkdir(const std::vector<std::string>& args);
-    static CommandResult cmdRmdir(const std::vector<std::string>& args);
-    static CommandResult cmdLs(const std::vector<std::string>& args);
-    static CommandResult cmdTree(const std::vector<std::string>& args);
-    static CommandResult cmdCd(const std::vector<std::string>& args);
-    static CommandResult cmdPwd(const std::vector<std::string>& args);
-    static CommandResult cmdCreate(const std::vector<std::string>& args);
-    static CommandResult cmdWrite(const std::vector<std::string>& args);
-    static CommandResult cmdAppend(const std::vector<std::string>& args);
-    static CommandResult cmdRead(const std::vector<std::string>& args);
-    static CommandResult cmdDelete(const std::vector<std::string>& args);
-    static CommandResult cmdHelp(const std::vector<std::string>& args);
-    static CommandResult cmdClear(const std::vector<std::string>& args);
-    static CommandResult cmdHistory(const std::vector<std::string>& args);
-    static CommandResult cmdDf(const std::vector<std::string>& args);
-    static CommandResult cmdZip(const std::vector<std::string>& args);
-    static CommandResult cmdUnzip(const std::vector<std::string>& args);
-    static CommandResult cmdExit(const std::vector<std::string>& args);
+    static CommandResult cmdMkdir(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdRmdir(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdLs(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdTree(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdCd(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdPwd(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdCreate(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdWrite(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdAppend(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdRead(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdDelete(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdHelp(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdClear(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdHistory(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdDf(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdLogLevel(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdDurability(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdDedup(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdSnapshot(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdGrep(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdLocate(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdChecksum(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdZip(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdUnzip(Session& session, const std::vector<std::string>& args);
+    static CommandResult cmdExit(Session& session, const std::vector<std::string>& args);
 };
\ No newline at end of file
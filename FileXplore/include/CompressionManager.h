@@ -2,18 +2,76 @@
 
 #include <string>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
 /**
  * CompressionManager - Handles file compression and decompression
  * Supports ZIP format for archiving files and directories
+ * Archives are packed in parallel: files are split into 1 MiB blocks that
+ * worker threads read and deflate on their own, each primed with the 32 KiB
+ * before it and ended with a full flush so the blocks of a file join into
+ * one deflate stream (as pigz does). The calling thread writes blocks in
+ * order, so the archive is the same whatever the thread count.
+ * Each entry gets a policy before its blocks are packed: data that is
+ * already compressed (known magic or extension, or a head sample with byte
+ * entropy near 8 bits) is stored, the rest deflated at a level chosen by
+ * entry size and profile.
+ * Archives are written to a temporary file renamed over the target, so a
+ * ZipArchive still reading the old one keeps a valid mapping. Reading goes
+ * through ZipArchive's indexed central directory; entry names are made
+ * relative to the destination and names climbing out with ".." are skipped.
+ * Extraction creates every directory once, then spreads the files over
+ * worker threads, largest first; each worker preallocates its output and
+ * streams the entry into it through one fixed buffer, so memory stays at a
+ * buffer per thread whatever the entry sizes.
  */
 class CompressionManager {
 public:
+    // How entries are compressed: Auto stores incompressible data and picks deflate levels by
+    // entry size; Fast and Best deflate at level 1 and 9 (still storing incompressible data);
+    // Store never deflates
+    enum class Profile { Auto, Fast, Best, Store };
+    
+    // How to build an archive
+    struct Options {
+        std::size_t threads;          // Packing/extraction threads (0 = hardware concurrency)
+        Profile profile;
+
+        Options() : threads(0), profile(Profile::Auto) {}
+    };
+    
+    // What packing did, for the caller to report
+    struct PackStats {
+        std::size_t entries;
+        std::size_t stored;           // Entries stored as-is (method 0)
+        std::uint64_t bytes_in;       // Entry data before and after compression
+        std::uint64_t bytes_out;
+        std::uint64_t stored_bytes;
+        std::uint64_t deflated_bytes;
+        std::uint64_t deflate_cpu_ns; // CPU time spent deflating
+        std::uint64_t saved_cpu_ns;   // Estimated CPU time storing saved, at this run's deflate rate
+                                      // (0 when too little was deflated to measure one)
+
+        PackStats() : entries(0), stored(0), bytes_in(0), bytes_out(0), stored_bytes(0), deflated_bytes(0),
+                      deflate_cpu_ns(0), saved_cpu_ns(0) {}
+    };
+
     // Compress files/directories to a zip file
     static bool compressToZip(const std::string& zipPath, const std::vector<std::string>& paths);
+    static bool compressToZip(const std::string& zipPath, const std::vector<std::string>& paths,
+                              const Options& options);
+    static bool compressToZip(const std::string& zipPath, const std::vector<std::string>& paths,
+                              const Options& options, PackStats& stats);
     
     // Decompress a zip file to a destination directory
     static bool decompressFromZip(const std::string& zipPath, const std::string& destDir);
+    static bool decompressFromZip(const std::string& zipPath, const std::string& destDir,
+                                  const Options& options);
+    
+    // Extract one entry (named with or without its leading '/') to a destination directory
+    static bool extractFromZip(const std::string& zipPath, const std::string& entryName,
+                               const std::string& destDir);
     
     // Check if a file is a zip archive
     static bool isZipFile(const std::string& path);
@@ -2,6 +2,11 @@
 
 #include <string>
 #include <vector>
+#include <ctime>
+#include <cstdint>
+#include <sys/types.h>
+
+class Session;
 
 /**
  * DirManager - Handles all directory operations
@@ -9,6 +14,64 @@
  */
 class DirManager {
 public:
+    // Kind of a directory entry (symlinks are reported, not followed)
+    enum class EntryType { File, Directory, Symlink, Other };
+    
+    // One directory entry with the metadata the listings need
+    struct DirEntry {
+        std::string name;
+        EntryType type;
+        long long size;
+        std::time_t mtime;
+        std::uint32_t mtime_nsec;   // Sub-second part of mtime (0 where the platform has none)
+        mode_t mode;
+        std::uint64_t inode;    // 0 where the platform has none
+        
+        DirEntry() : type(EntryType::Other), size(0), mtime(0), mtime_nsec(0), mode(0), inode(0) {}
+    };
+    
+    /**
+     * DirIterator - Resumable walk over a directory in on-disk order (unsorted)
+     * The cursor is an opaque position just past the last entry returned (the
+     * getdents64 d_off cookie on Linux), so a later request can resume from it
+     * with a fixed-size buffer no matter how large the directory is.
+     */
+    class DirIterator {
+    public:
+        explicit DirIterator(const std::string& virtual_path, std::uint64_t cursor = 0);
+        ~DirIterator();
+        
+        DirIterator(const DirIterator&) = delete;
+        DirIterator& operator=(const DirIterator&) = delete;
+        
+        // Check if the directory could be opened
+        bool isOpen() const;
+        
+        // Check whether another entry follows (does not move the cursor)
+        bool hasNext();
+        
+        // Read the next entry; false at the end of the directory
+        bool next(DirEntry& entry);
+        
+        // Position to resume after the last entry returned by next()
+        std::uint64_t getCursor() const;
+        
+    private:
+        int fd_;
+        std::vector<char> buffer_;
+        std::size_t buffer_offset_;
+        std::size_t buffer_length_;
+        std::uint64_t cursor_;
+        bool end_;
+        bool root_;                 // Listing "/", whose reserved entries are skipped
+        
+        // Fallback without getdents64: a sorted listing indexed by the cursor
+        std::vector<DirEntry> entries_;
+        
+        // Refill the buffer from the kernel; false at the end or on error
+        bool fill();
+    };
+    
     // Create directory
     static bool createDirectory(const std::string& virtual_path);
     
@@ -18,14 +81,24 @@ public:
     // List directory contents
     static std::vector<std::string> listDirectory(const std::string& virtual_path);
     
+    // List directory contents with type, size, mtime and mode, sorted by name; reserved
+    // directories list as empty and are left out of the root's listing
+    static std::vector<DirEntry> listDirectoryEx(const std::string& virtual_path);
+    
+    // Type name used by the API ("file", "directory", "symlink", "other")
+    static std::string typeName(EntryType type);
+    
+    // Format permission bits as "rwxr-xr-x"
+    static std::string formatPermissions(mode_t mode);
+    
     // Display directory tree structure
     static void displayTree(const std::string& virtual_path, int depth = 0);
     
-    // Change current directory
-    static bool changeDirectory(const std::string& virtual_path);
+    // Change the session's current directory
+    static bool changeDirectory(Session& session, const std::string& virtual_path);
     
-    // Get current working directory
-    static std::string getCurrentDirectory();
+    // Get the session's current working directory
+    static std::string getCurrentDirectory(const Session& session);
     
     // Check if directory exists
     static bool directoryExists(const std::string& virtual_path);
@@ -34,9 +107,9 @@ public:
     static bool isDirectoryEmpty(const std::string& virtual_path);
     
 private:
-    // Helper method for recursive tree display
-    static void displayTreeRecursive(const std::string& real_path, const std::string& virtual_path, 
-                                   int depth, const std::string& prefix);
+    // listDirectoryEx for a normalized path, without the reserved-path check (also backs
+    // DirIterator where getdents64 is unavailable, so owners can list their own directories)
+    static std::vector<DirEntry> listResolved(const std::string& resolved);
     
     // Helper method to validate directory operations
     static bool validateDirectoryOperation(const std::string& virtual_path, bool should_exist = true);
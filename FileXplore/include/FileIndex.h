@@ -0,0 +1,164 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * FileIndex - Filename index over the whole VFS root for locate and quick-open
+ * Every file and directory is one entry holding its name (once, in a shared
+ * arena) and its parent's entry, so a path costs only its last component.
+ * Each trigram of a case-folded name has a sorted posting list of entries;
+ * a query intersects the lists of its own trigrams and verifies the few
+ * survivors. A two-byte query takes the union of the trigrams that start or
+ * end with it; a single byte, or a very common pair, scans the folded names
+ * in one pass.
+ * Removing an entry only marks it dead: results are built by walking up the
+ * parents, which drops anything beneath a dead directory for free, and the
+ * garbage goes at the next rebuild.
+ * FileManager, DirManager and the other writers report their changes here.
+ * A background thread builds the index at start and saves it next to the
+ * persistence state files, so the next start answers queries from the saved
+ * copy at once while the rebuild picks up changes made in between.
+ */
+class FileIndex {
+public:
+    // One located path
+    struct Result {
+        std::string path;             // Normalized virtual path
+        bool is_directory;
+    };
+
+    // Sizes reported by the locate command and /api/system
+    struct Stats {
+        std::size_t entries;          // Live files and directories
+        std::size_t dead;             // Removed entries awaiting the next rebuild
+        std::size_t trigrams;         // Distinct trigrams
+        std::size_t memory_bytes;     // Approximate heap use
+        bool ready;                   // A complete index (built or loaded) is available
+        bool building;                // A rebuild is running
+        double last_build_ms;
+
+        Stats() : entries(0), dead(0), trigrams(0), memory_bytes(0), ready(false), building(false),
+                  last_build_ms(0) {}
+    };
+
+    // Load the saved index of this VFS root (if any) and start the background rebuild
+    static void start();
+
+    // Save the index and stop the background thread
+    static void stop();
+
+    // A path was created, written or removed; rescan also indexes a directory's contents
+    static void update(const std::string& virtual_path, bool rescan = false);
+
+    // Ask the background thread for a full rebuild
+    static void rebuild();
+
+    // Find up to limit entries whose name contains query (ASCII case-insensitive),
+    // exact and prefix matches first; returns the total number of matches
+    static std::size_t locate(const std::string& query, std::size_t limit, std::vector<Result>& results);
+
+    // Get entry counts and build state
+    static Stats getStats();
+
+private:
+    struct Entry {
+        std::uint32_t parent;
+        std::uint32_t name_offset;    // Into Index::names
+        std::uint16_t name_length;
+        std::uint8_t type;            // DirManager::EntryType
+        bool alive;
+    };
+
+    struct Index {
+        std::vector<Entry> entries;   // Entry 0 is the root; parents precede their children
+        std::string names;            // Each name followed by a NUL, in entry order
+        std::string folded;           // The same with ASCII case folded, scanned by queries
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings;
+        std::vector<std::uint32_t> short_names;   // Entries whose name has no trigram
+        // Open-addressed (parent, name) -> entry table for path lookups: 0 is empty, REMOVED_SLOT removed
+        std::vector<std::uint32_t> slots;
+        std::size_t slots_used = 0;
+        std::size_t dead = 0;
+    };
+
+    static constexpr std::uint32_t REMOVED_SLOT = UINT32_MAX;
+
+    // Paths and entry types found beneath a directory, walked before the index is locked
+    using WalkedTree = std::vector<std::pair<std::string, std::uint8_t>>;
+
+    // Saved index file layout version
+    static constexpr std::uint32_t FORMAT_VERSION = 1;
+
+    // Save a changed index at most this often (seconds)
+    static constexpr int SAVE_INTERVAL = 30;
+
+    static std::shared_mutex index_mutex;
+    static std::unique_ptr<Index> index;
+    static std::atomic<bool> ready;
+    static std::atomic<bool> dirty;
+    static double last_build_ms;
+
+    // Changes reported while a rebuild runs, replayed onto its result
+    static std::mutex pending_mutex;
+    static std::vector<std::pair<std::string, bool>> pending;
+    static bool building;
+
+    static std::mutex thread_mutex;
+    static std::condition_variable wake;
+    static bool rebuild_requested;
+    static std::atomic<bool> stopping;
+    static std::thread worker;
+
+    static std::unique_ptr<Index> createIndex();
+
+    // Append an entry and post its trigrams (the caller checked it is new)
+    static std::uint32_t addEntry(Index& target, std::uint32_t parent, const char* name, std::size_t length,
+                                  std::uint8_t type);
+
+    // Add an entry to the lookup table (growing it as needed) or take it out
+    static void linkChild(Index& target, std::uint32_t id);
+    static void unlinkChild(Index& target, std::uint32_t id);
+
+    // Entry of a child by name, or 0 when there is none
+    static std::uint32_t findChild(const Index& target, std::uint32_t parent, const char* name, std::size_t length);
+
+    // Entry of a virtual path, or 0 when it is not indexed (the root itself is never looked up)
+    static std::uint32_t findPath(const Index& target, const std::string& virtual_path);
+
+    // Add (or retype) a path, creating missing ancestors as directories
+    static std::uint32_t insertPath(Index& target, const std::string& virtual_path, std::uint8_t type);
+
+    // Stat a path and add, retype or remove it; rescan indexes a directory's contents,
+    // taking them from walked when the caller already listed them
+    static void applyUpdate(Index& target, const std::string& virtual_path, bool rescan,
+                            const WalkedTree* walked);
+
+    // Index everything beneath a directory
+    static void indexTree(Index& target, const std::string& virtual_dir);
+
+    // List everything beneath a directory without touching the index
+    static void collectTree(const std::string& virtual_dir, WalkedTree& found);
+
+    // Full path of an entry (path may be null to only check); false when it or an ancestor was removed
+    static bool entryPath(const Index& target, std::uint32_t id, std::string* path);
+
+    // Write the index to the persistence directory (temp file, then rename)
+    static bool save();
+
+    // Read the saved index; false when it is missing, damaged or for another root
+    static bool load();
+
+    // Background thread body: builds, rebuilds on request, saves when dirty
+    static void workerLoop();
+};
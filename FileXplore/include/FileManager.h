@@ -1,7 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <atomic>
+#include <functional>
+#include <cstddef>
 
 /**
  * FileManager - Handles all file operations
@@ -9,18 +13,119 @@
  */
 class FileManager {
 public:
+    // How writeFile replaces a file's contents
+    enum class Durability {
+        None,       // Truncate and write in place (a crash can leave a partial file)
+        Atomic,     // Write a temp file and rename it over the target
+        Durable     // Atomic, plus fsync of the data and the directory (batched by GroupCommit)
+    };
+    
+    // Access pattern hint for a mapping (passed to madvise)
+    enum class AccessPattern { Normal, Sequential, Random, WillNeed };
+    
+    /**
+     * MappedFile - Read-only memory mapping of a whole file, unmapped on destruction
+     * Pages are faulted in on first touch, so only the bytes actually used cost
+     * I/O. An empty file maps to an open handle of size 0. The file must not be
+     * truncated while mapped.
+     */
+    class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+        
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        
+        // Check if the file was mapped; getError() explains why not
+        bool isOpen() const;
+        
+        // Mapped bytes (nullptr for an empty file)
+        const char* data() const;
+        std::size_t size() const;
+        std::string_view view() const;
+        
+        // "Error: ..." message when the file could not be mapped
+        const std::string& getError() const;
+        
+        // Change the hint for part of the mapping (e.g. WillNeed ahead of a scan)
+        void advise(std::size_t offset, std::size_t length, AccessPattern pattern) const;
+        
+    private:
+        friend class FileManager;
+        
+        void* address_;
+        std::size_t size_;
+        bool open_;
+        std::string error_;
+        // Owned copy of the contents where mmap is unavailable
+        std::string fallback_;
+        
+        void reset();
+    };
+    
     // File operations
     static std::string createFile(const std::string& virtual_path);
     static std::string writeFile(const std::string& virtual_path, const std::string& content);
+    static std::string writeFile(const std::string& virtual_path, const std::string& content,
+                                 Durability durability);
     static std::string appendFile(const std::string& virtual_path, const std::string& content);
     static std::string readFile(const std::string& virtual_path);
+    
+    // Read at most length bytes starting at offset (only those bytes are read from disk);
+    // file_size receives the full size of the file when given
+    static std::string readRange(const std::string& virtual_path, long long offset, std::size_t length,
+                                 long long* file_size = nullptr);
+    
+    // Outcome of an asynchronous read: the bytes, or an "Error: ..." message
+    struct ReadResult {
+        std::string data;
+        long long file_size = -1;
+        std::string error;
+    };
+    using ReadCallback = std::function<void(ReadResult&)>;
+    
+    // readRange through IoEngine: the caller never blocks on the disk, done runs on an engine thread
+    static void readRangeAsync(const std::string& virtual_path, long long offset, std::size_t length,
+                               ReadCallback done);
+    
+    // Map a file read-only without copying it
+    static MappedFile mapFile(const std::string& virtual_path,
+                              AccessPattern pattern = AccessPattern::Sequential);
+    
+    // Map a regular file already opened for reading (the descriptor stays the caller's); for
+    // owners of the reserved directories, whose paths the virtual-path calls refuse
+    static MappedFile mapFile(int fd, AccessPattern pattern = AccessPattern::Sequential);
     static std::string deleteFile(const std::string& virtual_path);
     
+    // Copy size bytes between open files, cloning the extents where the filesystem can
+    // (FICLONE, then copy_file_range, then read/write)
+    static bool copyContents(int source_fd, int target_fd, long long size);
+    
+    // Durability used by writeFile when none is given (Atomic unless changed)
+    static void setDefaultDurability(Durability durability);
+    static Durability getDefaultDurability();
+    
+    // Parse "none", "atomic" or "durable" (case-insensitive)
+    static bool parseDurability(const std::string& name, Durability& durability);
+    static std::string durabilityName(Durability durability);
+    
     // File information
     static bool fileExists(const std::string& virtual_path);
     static long long getFileSize(const std::string& virtual_path);
     
 private:
+    static std::atomic<Durability> default_durability;
+    
+    // Temp file + rename path of writeFile; resolved is the normalized target
+    static std::string replaceFile(const std::string& resolved, const std::string& virtual_path,
+                                   const std::string& content, Durability durability);
+    
+    // Open a regular file for reading; returns "" and sets fd/size, or an "Error: ..." message
+    static std::string openForRead(const std::string& virtual_path, int& fd, long long& size);
+    
     // Helper method for validation
-    static bool validateFileOperation(const std::string& real_path, const std::string& operation);
+    static bool validateFileOperation(const std::string& virtual_path, const std::string& operation);
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * GroupCommit - Shares one flush between concurrent durable writers
+ * The first caller becomes the leader: it waits up to the commit window for
+ * as many writers as joined the previous batch (not at all after a solo
+ * batch), then flushes the whole batch while later arrivals queue up for the
+ * next one. The leader fsyncs each descriptor of the batch, after starting
+ * writeback on all of them at once where Linux allows it, so their data goes
+ * out together and the later fsyncs mostly find their journal commit already
+ * done. Every caller returns only after its descriptor's data is on stable
+ * storage, and a failed flush fails exactly the writers it belongs to.
+ */
+class GroupCommit {
+public:
+    // Counters for the durability command and benchmarks
+    struct Stats {
+        std::uint64_t requests;      // sync() calls
+        std::uint64_t flushes;       // Batches flushed
+        std::uint64_t failures;      // Batches in which some flush failed
+
+        Stats() : requests(0), flushes(0), failures(0) {}
+    };
+
+    // Make fd's data and metadata durable; false if the flush failed
+    static bool sync(int fd);
+
+    // How long a leader waits for more writers before flushing (0 = flush at once)
+    static void setWindow(std::chrono::microseconds window);
+    static std::chrono::microseconds getWindow();
+
+    // Disabled, every caller flushes its own descriptor (baseline for benchmarks)
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+
+    static Stats getStats();
+    static void resetStats();
+
+private:
+    struct Batch {
+        std::vector<int> fds;
+        std::vector<char> ok;                    // Per descriptor, filled in by the flush
+        bool done = false;
+    };
+
+    static std::mutex mutex;
+    static std::condition_variable done_cv;
+    static std::condition_variable join_cv;      // A writer joined the open batch
+    static std::shared_ptr<Batch> open_batch;    // Batch collecting writers
+    static bool leader_active;
+    static std::size_t last_batch_size;          // Writers the next leader waits for
+    static std::chrono::microseconds window;
+    static bool enabled;
+    static Stats stats;
+
+    // Flush every descriptor of a batch, recording which succeeded; false if any failed
+    static bool flush(const std::vector<int>& fds, std::vector<char>& ok);
+};
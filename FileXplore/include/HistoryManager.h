@@ -3,37 +3,40 @@
 #include <string>
 #include <vector>
 #include <deque>
+#include <mutex>
 
 /**
  * HistoryManager - Manages command history
  * Maintains the last 20 executed commands and provides history functionality
  * Supports persistence through PersistenceManager
+ * Each Session owns one instance; access is serialized by an internal mutex
  */
 class HistoryManager {
 private:
-    static std::deque<std::string> command_history;
+    std::deque<std::string> command_history;
+    mutable std::mutex history_mutex;
     static const std::size_t MAX_HISTORY_SIZE = 20;
 
 public:
     // Add command to history
-    static void addCommand(const std::string& command);
+    void addCommand(const std::string& command);
     
     // Get command history
-    static std::vector<std::string> getHistory();
+    std::vector<std::string> getHistory() const;
     
     // Display command history
-    static void displayHistory();
+    void displayHistory() const;
     
     // Clear command history
-    static void clearHistory();
+    void clearHistory();
     
     // Get history size
-    static std::size_t getHistorySize();
+    std::size_t getHistorySize() const;
     
     // Get command at specific index (0 = most recent)
-    static std::string getCommand(std::size_t index);
+    std::string getCommand(std::size_t index) const;
     
     // Persistence methods
-    static bool saveHistory();
-    static bool loadHistory();
+    bool saveHistory() const;
+    bool loadHistory();
 };
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/**
+ * IoEngine - Asynchronous file I/O on io_uring, with a thread-pool fallback
+ * Requests (read, write, open beneath the sandbox root, stat) complete through
+ * a callback or a future instead of blocking the caller. On Linux the engine
+ * drives an io_uring instance with raw syscalls: submit() queues a request
+ * with one io_uring_enter, and one completion thread reaps the results. Where io_uring is missing or blocked (old kernel,
+ * seccomp, other platforms) the same requests run as blocking calls on a small
+ * thread pool. Before start() every request runs synchronously in the caller.
+ * Callbacks run on an engine thread: keep them short and never wait in one for
+ * another engine request.
+ */
+class IoEngine {
+public:
+    enum class Backend { Inline, IoUring, ThreadPool };
+    enum class Op { Read, Write, Open, Stat };
+
+    // Outcome of one request: value is the byte count or the new descriptor, error an errno (0 = success)
+    struct Result {
+        long long value;
+        int error;
+
+        Result() : value(0), error(0) {}
+    };
+
+    using Callback = std::function<void(const Result&)>;
+
+    // One request; build it with the *Request helpers below
+    struct Request {
+        Op op;
+        int fd;                      // Read/Write: descriptor
+        void* buffer;                // Read/Write: caller-owned until the callback runs
+        std::size_t length;
+        std::uint64_t offset;
+        std::string path;            // Open/Stat: normalized virtual path
+        int flags;                   // Open: O_* flags
+        mode_t mode;                 // Open: mode for O_CREAT
+        struct stat* info;           // Stat: filled in on success
+        Callback callback;
+
+        Request() : op(Op::Read), fd(-1), buffer(nullptr), length(0), offset(0), flags(0), mode(0), info(nullptr) {}
+    };
+
+    static Request readRequest(int fd, void* buffer, std::size_t length, std::uint64_t offset, Callback callback);
+    static Request writeRequest(int fd, const void* buffer, std::size_t length, std::uint64_t offset,
+                                Callback callback);
+    static Request openRequest(const std::string& virtual_path, int flags, mode_t mode, Callback callback);
+    static Request statRequest(const std::string& virtual_path, struct stat& info, Callback callback);
+
+    // Start the engine; io_uring is tried first unless use_io_uring is false
+    // (threads = pool size for the fallback, 0 = pick from the CPU count)
+    static bool start(bool use_io_uring = true, std::size_t threads = 0);
+
+    // Wait for in-flight requests and shut the engine down
+    static void stop();
+
+    static Backend getBackend();
+    static std::string backendName(Backend backend);
+
+    // Queue a request; its callback runs when it completes
+    static void submit(Request request);
+
+    // Future forms of the single requests
+    static std::future<Result> read(int fd, void* buffer, std::size_t length, std::uint64_t offset);
+    static std::future<Result> write(int fd, const void* buffer, std::size_t length, std::uint64_t offset);
+    static std::future<Result> open(const std::string& virtual_path, int flags, mode_t mode = 0);
+    static std::future<Result> stat(const std::string& virtual_path, struct stat& info);
+
+private:
+    // io_uring instance and its mapped rings (defined in IoEngine.cpp)
+    struct Ring;
+
+    static std::atomic<Backend> backend;
+    static std::unique_ptr<Ring> ring;
+
+    // Thread-pool fallback
+    static std::mutex pool_mutex;
+    static std::condition_variable pool_cv;
+    static std::deque<Request> pool_queue;
+    static std::vector<std::thread> pool_threads;
+    static bool pool_stopping;
+
+    // Set up the ring and its completion thread; false if io_uring is unusable here
+    static bool startRing(unsigned entries);
+    static void stopRing();
+    static void submitToRing(std::vector<Request>& requests);
+    static void reapLoop();
+
+    static void poolLoop();
+
+    // Run one request as a blocking call and invoke its callback
+    static void runBlocking(Request& request);
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+// Numeric levels so the compile-time threshold can be tested with #if
+#define FX_LOG_LEVEL_TRACE 0
+#define FX_LOG_LEVEL_DEBUG 1
+#define FX_LOG_LEVEL_INFO  2
+#define FX_LOG_LEVEL_WARN  3
+#define FX_LOG_LEVEL_ERROR 4
+#define FX_LOG_LEVEL_OFF   5
+
+// Messages below this level are removed by the preprocessor (arguments are never evaluated)
+#ifndef FX_LOG_COMPILE_LEVEL
+#define FX_LOG_COMPILE_LEVEL FX_LOG_LEVEL_DEBUG
+#endif
+
+enum class LogLevel { Trace = 0, Debug, Info, Warn, Error, Off };
+
+/**
+ * Logger - Leveled asynchronous logging for diagnostics
+ * Producers format a line and copy it into a fixed-size lock-free ring; a
+ * background thread drains the ring to stderr in batches, so a hot path never
+ * blocks on a mutex or flushes a stream. When the ring is full new messages
+ * are dropped and counted rather than waited for.
+ * Use the FX_LOG_* macros: levels below FX_LOG_COMPILE_LEVEL compile to
+ * nothing, the rest are filtered by the runtime level before formatting.
+ */
+class Logger {
+public:
+    // Start the drain thread (messages are written synchronously until then)
+    static void start();
+
+    // Drain what is queued and stop the drain thread
+    static void stop();
+
+    // Runtime threshold check used by the macros before any formatting
+    static bool isEnabled(LogLevel level) {
+        return static_cast<int>(level) >= runtime_level.load(std::memory_order_relaxed);
+    }
+
+    // Get or set the runtime level
+    static LogLevel getLevel();
+    static void setLevel(LogLevel level);
+
+    // Lowest level compiled into this build
+    static LogLevel getCompiledLevel();
+
+    // Parse "trace", "debug", "info", "warn", "error" or "off" (case-insensitive)
+    static bool parseLevel(const std::string& name, LogLevel& level);
+
+    // Lower-case level name
+    static std::string levelName(LogLevel level);
+
+    // Messages lost because the ring was full
+    static std::uint64_t getDropped();
+
+    // Queue one message (called by the macros)
+    static void write(LogLevel level, const std::string& message);
+
+private:
+    // Longer messages are truncated; one slot is a few cache lines
+    static constexpr std::size_t MAX_MESSAGE = 240;
+    // Power of two so positions wrap with a mask
+    static constexpr std::size_t RING_SIZE = 2048;
+
+    // Slot sequence numbers follow the bounded MPMC queue scheme (single consumer here)
+    struct Slot {
+        std::atomic<std::size_t> sequence;
+        LogLevel level;
+        std::int64_t time_ms;
+        std::uint16_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    static Slot ring[RING_SIZE];
+    static std::atomic<std::size_t> enqueue_pos;
+    static std::size_t dequeue_pos;
+    static std::atomic<int> runtime_level;
+    static std::atomic<std::uint64_t> dropped;
+    static std::atomic<bool> running;
+
+    // Set by the first producer after a drain, so a batch costs one wake-up
+    static std::atomic<bool> wake_pending;
+    static std::mutex wake_mutex;
+    static std::condition_variable wake_cv;
+    static std::thread drainer;
+
+    // Format one line into out
+    static void formatLine(LogLevel level, std::int64_t time_ms, const char* text, std::size_t length,
+                           std::string& out);
+
+    // Move everything queued to stderr; false if the ring was empty
+    static bool drain();
+
+    // Drain thread body
+    static void drainLoop();
+};
+
+#define FX_LOG(level, expr) \
+    do { \
+        if (Logger::isEnabled(level)) { \
+            std::ostringstream fx_log_stream; \
+            fx_log_stream << expr; \
+            Logger::write(level, fx_log_stream.str()); \
+        } \
+    } while (0)
+
+#define FX_LOG_DISABLED() do {} while (0)
+
+#if FX_LOG_COMPILE_LEVEL <= FX_LOG_LEVEL_TRACE
+#define FX_LOG_TRACE(expr) FX_LOG(LogLevel::Trace, expr)
+#else
+#define FX_LOG_TRACE(expr) FX_LOG_DISABLED()
+#endif
+
+#if FX_LOG_COMPILE_LEVEL <= FX_LOG_LEVEL_DEBUG
+#define FX_LOG_DEBUG(expr) FX_LOG(LogLevel::Debug, expr)
+#else
+#define FX_LOG_DEBUG(expr) FX_LOG_DISABLED()
+#endif
+
+#if FX_LOG_COMPILE_LEVEL <= FX_LOG_LEVEL_INFO
+#define FX_LOG_INFO(expr) FX_LOG(LogLevel::Info, expr)
+#else
+#define FX_LOG_INFO(expr) FX_LOG_DISABLED()
+#endif
+
+#if FX_LOG_COMPILE_LEVEL <= FX_LOG_LEVEL_WARN
+#define FX_LOG_WARN(expr) FX_LOG(LogLevel::Warn, expr)
+#else
+#define FX_LOG_WARN(expr) FX_LOG_DISABLED()
+#endif
+
+#if FX_LOG_COMPILE_LEVEL <= FX_LOG_LEVEL_ERROR
+#define FX_LOG_ERROR(expr) FX_LOG(LogLevel::Error, expr)
+#else
+#define FX_LOG_ERROR(expr) FX_LOG_DISABLED()
+#endif
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "DirManager.h"
+
+/**
+ * MetadataCache - In-process cache of stat results and sorted directory listings
+ * Entries are keyed by normalized virtual path, which maps one-to-one onto the
+ * real path beneath the VFS root. An inotify watcher on every cached directory
+ * invalidates entries on external changes; FileManager/DirManager mutations
+ * invalidate synchronously so a client always sees its own writes.
+ * Without inotify (non-Linux) the cache stays disabled and every call misses.
+ */
+class MetadataCache {
+public:
+    // Counters reported by /api/system
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::size_t entries;
+        std::size_t watches;
+        bool enabled;
+
+        Stats() : hits(0), misses(0), entries(0), watches(0), enabled(false) {}
+    };
+
+    // Start the inotify watcher for the open sandbox root (clears any previous state)
+    static bool start();
+
+    // Stop the watcher thread and drop all entries
+    static void stop();
+
+    // Cached Sandbox::statPath (negative results are cached for ENOENT)
+    static bool statPath(const std::string& virtual_path, struct stat& info);
+
+    // Look up a cached sorted listing of a directory
+    static bool lookupListing(const std::string& virtual_path, std::vector<DirManager::DirEntry>& entries);
+
+    // Watch a directory and return a token to pass to storeListing (0 = do not cache)
+    static std::uint64_t beginListing(const std::string& virtual_path);
+
+    // Store a listing read after beginListing; dropped if anything changed meanwhile
+    static void storeListing(const std::string& virtual_path, const std::vector<DirManager::DirEntry>& entries,
+                             std::uint64_t token);
+
+    // Contents or attributes of a path changed
+    static void invalidate(const std::string& virtual_path);
+
+    // A path was created, removed or renamed: drop it, its subtree and its parent
+    static void invalidateTree(const std::string& virtual_path);
+
+    // Drop every entry
+    static void clear();
+
+    // Get hit/miss counters and sizes
+    static Stats getStats();
+
+private:
+    struct Entry {
+        bool has_stat = false;
+        bool exists = false;
+        struct stat info;
+        bool has_listing = false;
+        std::vector<DirManager::DirEntry> listing;
+    };
+
+    // std::map keeps a subtree contiguous so it can be erased by prefix
+    static std::map<std::string, Entry> entries;
+    static std::shared_mutex entries_mutex;
+
+    // Bumped by every invalidation; fills started before a bump are discarded
+    static std::atomic<std::uint64_t> generation;
+    static std::atomic<std::uint64_t> hits;
+    static std::atomic<std::uint64_t> misses;
+    static std::atomic<bool> enabled;
+
+    // inotify watch descriptors <-> watched directories
+    static std::mutex watch_mutex;
+    static std::unordered_map<int, std::string> watch_paths;
+    static std::map<std::string, int> watched_dirs;
+    static int inotify_fd;
+    static int wake_pipe[2];
+    static std::thread watcher;
+
+    // Watch a directory; false if it cannot be watched (entries under it are not cached)
+    static bool ensureWatched(const std::string& virtual_dir);
+
+    // Drop watches on a directory and everything beneath it
+    static void unwatchTree(const std::string& virtual_dir);
+
+    // Erase a key and all keys beneath it (caller holds entries_mutex)
+    static void eraseSubtree(const std::string& virtual_path);
+
+    // Forget a directory's listing but keep its stat (caller holds entries_mutex)
+    static void dropListing(const std::string& virtual_dir);
+
+    // Store a stat result if nothing was invalidated since token was taken
+    static void storeStat(const std::string& virtual_path, bool exists, const struct stat& info,
+                          std::uint64_t token);
+
+    // Watcher thread body
+    static void watchLoop();
+};
@@ -1,77 +1,84 @@
-#ifndef PATHUTILS_H
-#define PATHUTILS_H
-
-#include <string>
-#include <vector>
-
-using std::string;
-using std::vector;
-
-/**
- * PathUtils class for safe path resolution and sandbox security
- * Compatible with older compilers that don't support filesystem
- * Supports persistence through PersistenceManager
- */
-class PathUtils {
-private:
-    static string vfs_root;
-    static string current_virtual_path;
-
-public:
-    // Initialize the VFS root directory
-    static bool initializeVFSRoot(const string& root_path);
-    
-    // Convert virtual path to real filesystem path
-    static string virtualToRealPath(const string& virtual_path);
-    
-    // Ensure path is within sandbox (security check)
-    static bool isPathSafe(const string& real_path);
-    
-    // Resolve and normalize path (handle .., ., etc.)
-    static string resolvePath(const string& path);
-    
-    // Normalize path separators and remove redundant components
-    static string normalizePath(const string& path);
-    
-    // Get current virtual directory
-    static string getCurrentVirtualPath();
-    
-    // Set current virtual directory
-    static bool setCurrentVirtualPath(const string& path);
-    
-    // Check if path exists
-    static bool pathExists(const string& path);
-    
-    // Check if path is a directory
-    static bool isDirectory(const string& path);
-    
-    // Check if path is a regular file
-    static bool isFile(const string& path);
-    
-    // Get VFS root path
-    static string getVFSRoot();
-    
-    // Split path into components
-    static vector<string> splitPath(const string& path);
-    
-    // Join path components
-    static string joinPath(const vector<string>& components);
-    
-    // Get parent directory
-    static string getParentPath(const string& path);
-    
-    // Get filename from path
-    static string getFilename(const string& path);
-    
-    // Persistence methods
-    static bool saveVFSState();
-    static bool loadVFSState();
-
-    // Resolve a virtual path to a real filesystem path (wrapper convenience)
-    static string resolveVirtualPath(const string& path);
-
-    // Convert a real filesystem path under VFS root back to virtual path
-    static string getVirtualPath(const string& real_path);
-};
-
+#ifndef PATHUTILS_H
+#define PATHUTILS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class Session;
+
+/**
+ * PathUtils class for safe path resolution and sandbox security
+ * Compatible with older compilers that don't support filesystem
+ * Supports persistence through PersistenceManager
+ */
+class PathUtils {
+private:
+    static string vfs_root;
+
+public:
+    // Initialize the VFS root directory
+    static bool initializeVFSRoot(const string& root_path);
+    
+    // Convert virtual path to real filesystem path
+    static string virtualToRealPath(const string& virtual_path);
+    
+    // Ensure path is within sandbox (security check)
+    static bool isPathSafe(const string& real_path);
+    
+    // Ensure a virtual path resolves beneath the VFS root (need not exist yet) and
+    // outside FileXplore's reserved directories
+    static bool isVirtualPathSafe(const string& virtual_path);
+    
+    // Check if a normalized virtual path is, or lies under, one of FileXplore's reserved
+    // bookkeeping directories; clients never reach these, only the modules that own them
+    static bool isReservedPath(std::string_view virtual_path);
+    
+    // Resolve and normalize path against a base directory (handle .., ., etc.)
+    static string resolvePath(std::string_view path, std::string_view base = "/");
+    
+    // Normalize path separators and remove redundant components
+    static string normalizePath(std::string_view path);
+    
+    // Check if a path is already absolute and normalized (no copy needed)
+    static bool isNormalizedPath(std::string_view path);
+    
+    // Check if path exists
+    static bool pathExists(const string& path);
+    
+    // Check if path is a directory
+    static bool isDirectory(const string& path);
+    
+    // Check if path is a regular file
+    static bool isFile(const string& path);
+    
+    // Get VFS root path
+    static string getVFSRoot();
+    
+    // Split path into components
+    static vector<string> splitPath(std::string_view path);
+    
+    // Join path components
+    static string joinPath(const vector<string>& components);
+    
+    // Get parent directory
+    static string getParentPath(std::string_view path);
+    
+    // Get filename from path
+    static string getFilename(std::string_view path);
+    
+    // Persistence methods (the working directory lives in the session)
+    static bool saveVFSState(const Session& session);
+    static bool loadVFSState(Session& session);
+
+    // Resolve a virtual path to a real filesystem path (wrapper convenience)
+    static string resolveVirtualPath(const string& path);
+
+    // Convert a real filesystem path under VFS root back to virtual path
+    static string getVirtualPath(const string& real_path);
+};
+
 #endif // PATHUTILS_H
\ No newline at end of file
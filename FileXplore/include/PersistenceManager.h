@@ -3,6 +3,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 /**
  * PersistenceManager - Handles saving and loading application state
@@ -57,4 +60,34 @@ public:
     static std::string getHistoryFile();
     static std::string getVFSStateFile();
     static std::string getSettingsFile();
+    static std::string getIndexFile();
+    static std::string getDigestCacheFile();
+
+    // Sidecar caches (file index, digest cache) start with an 8-byte magic, a layout
+    // version and the VFS root they describe; the owner's records follow. Start one:
+    static std::string beginSidecar(const char (&magic)[8], std::uint32_t version);
+
+    // Write a sidecar through a temp file and a rename; false on failure
+    static bool writeSidecar(const std::string& file, const std::string& data);
+
+    // Read a sidecar; false when missing, or for another version or root. offset is left
+    // at the first record
+    static bool readSidecar(const std::string& file, const char (&magic)[8], std::uint32_t version,
+                            std::string& data, std::size_t& offset);
+
+    // Sidecar records: local caches, so integers are stored in host byte order
+    template <typename T>
+    static void appendValue(std::string& data, T value) {
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static bool readValue(const std::string& data, std::size_t& offset, T& value) {
+        if (data.size() - offset < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        offset += sizeof(value);
+        return true;
+    }
 };
\ No newline at end of file
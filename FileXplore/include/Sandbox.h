@@ -0,0 +1,111 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/**
+ * Sandbox - Descriptor-based access to the VFS root
+ * Opens the VFS root once as a directory descriptor and resolves virtual paths
+ * beneath it with openat2(RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS), or with a
+ * component-by-component openat() walk on kernels that lack openat2. Neither
+ * follows symlinks, even ones that stay beneath the root, so both behave the
+ * same: a symlink leaf is stat'ed or listed as the link itself and refused
+ * (ELOOP) when opened for I/O. Escapes through "..", symlinks or mount tricks
+ * fail with EXDEV/ELOOP instead of being canonicalized.
+ *
+ * All virtual paths passed in must already be normalized ("/a/b").
+ */
+class Sandbox {
+public:
+    // Open the VFS root directory and probe for openat2 support
+    static bool open(const std::string& root_path);
+
+    // Release the root descriptor
+    static void close();
+
+    // Check if the sandbox root is open
+    static bool isOpen();
+
+    // Get the root directory descriptor (-1 if not open)
+    static int getRootFd();
+
+    // Check whether openat2(RESOLVE_BENEATH) is in use
+    static bool usesOpenat2();
+
+    // Open a virtual path beneath the root (returns fd, or -1 with errno set)
+    static int openPath(const std::string& virtual_path, int flags, mode_t mode = 0);
+
+    // Open the parent directory of a virtual path; leaf receives the last component
+    static int openParent(const std::string& virtual_path, std::string& leaf);
+
+    // Stat a virtual path (a symlink is reported as itself, like lstat)
+    static bool statPath(const std::string& virtual_path, struct stat& info);
+
+    // Directory and file mutations relative to the parent descriptor
+    static bool makeDirectory(const std::string& virtual_path, mode_t mode = 0755);
+    static bool removeDirectory(const std::string& virtual_path);
+    static bool removeFile(const std::string& virtual_path);
+    static bool renamePath(const std::string& from_virtual, const std::string& to_virtual);
+
+    // Add a hard link to_virtual for from_virtual (fails with EEXIST if to_virtual exists)
+    static bool linkPath(const std::string& from_virtual, const std::string& to_virtual);
+
+    // Check whether errno from a call above means the path tried to leave the root
+    static bool isEscapeError(int error);
+
+    // Write the whole buffer, retrying on short writes and EINTR
+    static bool writeAll(int fd, const char* data, std::size_t length);
+
+    // "<dir>/.<name><tag><pid>.<n>": hidden and beside virtual_path, so the final rename stays in one directory
+    static std::string siblingTempPath(const std::string& virtual_path, const char* tag);
+
+    // Modification time of a stat result, with nanoseconds where the platform keeps them
+    static std::int64_t mtimeNanoseconds(const struct stat& info);
+
+private:
+    static int root_fd;
+    static bool openat2_supported;
+
+    // Resolve a root-relative path with openat2 or the fallback walk
+    static int openBeneath(const std::string& relative_path, int flags, mode_t mode);
+
+    // Fallback resolver: one openat() per component, never following symlinks
+    static int walkBeneath(const std::string& relative_path, int flags, mode_t mode);
+};
+
+/**
+ * ScopedFd - Closes a file descriptor when it goes out of scope
+ */
+class ScopedFd {
+public:
+    explicit ScopedFd(int fd = -1) : fd_(fd) {}
+    ~ScopedFd() { reset(); }
+
+    ScopedFd(const ScopedFd&) = delete;
+    ScopedFd& operator=(const ScopedFd&) = delete;
+
+    ScopedFd(ScopedFd&& other) noexcept : fd_(other.release()) {}
+    ScopedFd& operator=(ScopedFd&& other) noexcept {
+        if (this != &other) {
+            reset(other.release());
+        }
+        return *this;
+    }
+
+    int get() const { return fd_; }
+    bool valid() const { return fd_ >= 0; }
+
+    int release() {
+        int fd = fd_;
+        fd_ = -1;
+        return fd;
+    }
+
+    void reset(int fd = -1);
+
+private:
+    int fd_;
+};
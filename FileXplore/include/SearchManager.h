@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * SearchManager - Parallel content search (grep) beneath the sandbox root
+ * Files are found with TreeWalker, so several are scanned at once, and read
+ * through a read-only mapping, so nothing is copied. A pattern without regex
+ * metacharacters is a literal: candidates come from a vectorized scan for
+ * its first and last byte (AVX2 where the CPU has it, memchr otherwise) and
+ * are verified in place. Any other pattern is an ECMAScript regex, run only
+ * on lines that contain its longest required literal when it has one, and
+ * never on lines longer than MAX_REGEX_LINE_LENGTH: std::regex backtracks by
+ * recursion, so a long enough line would overflow the stack.
+ * Files with a NUL byte in their first block are treated as binary and
+ * skipped. Matches are reported as they are found, one per line.
+ *
+ * The web API runs searches as jobs: start one, then collect the matches
+ * found so far until the job reports it is done.
+ */
+class SearchManager {
+public:
+    // What to search for and where
+    struct Options {
+        std::string pattern;
+        bool recursive;               // Descend into subdirectories of a directory path
+        bool ignore_case;             // ASCII case-insensitive
+        std::size_t max_matches;      // Stop after this many matches (0 = no limit)
+        std::size_t threads;          // Walker threads (0 = hardware concurrency)
+
+        Options() : recursive(false), ignore_case(false), max_matches(0), threads(0) {}
+    };
+
+    // One matching line
+    struct Match {
+        std::string path;             // Normalized virtual path
+        std::uint64_t line_number;    // 1-based
+        std::string line;             // Without the newline, cut at MAX_LINE_LENGTH
+    };
+
+    // Totals of a finished (or stopped) search
+    struct Summary {
+        std::uint64_t files_scanned;
+        std::uint64_t files_matched;
+        std::uint64_t binary_skipped;
+        std::uint64_t long_lines_skipped;  // Lines the regex was not run on
+        std::uint64_t bytes_scanned;
+        std::uint64_t matches;
+        bool truncated;               // Stopped at max_matches or cancelled
+        std::string error;            // "Error: ..." if the search could not run
+
+        Summary() : files_scanned(0), files_matched(0), binary_skipped(0), long_lines_skipped(0),
+                    bytes_scanned(0), matches(0), truncated(false) {}
+    };
+
+    // Receives matches one at a time (calls are serialized); return false to stop the search
+    using MatchCallback = std::function<bool(const Match&)>;
+
+    // Longest line text kept in a Match
+    static constexpr std::size_t MAX_LINE_LENGTH = 1024;
+
+    // Longest line a regex is tried on; longer ones are counted in long_lines_skipped
+    static constexpr std::size_t MAX_REGEX_LINE_LENGTH = 4096;
+
+    // Search a file, or the files of a directory; blocks until done
+    static Summary search(const std::string& virtual_path, const Options& options, const MatchCallback& on_match);
+
+    // Check whether the literal scan uses AVX2 on this CPU
+    static bool usesAvx2();
+
+    // Start a background search for the web API; returns its ID
+    static std::string startJob(const std::string& virtual_path, const Options& options);
+
+    // Copy matches from index from onward; false if the job is unknown
+    static bool getJobResults(const std::string& job_id, std::size_t from, std::vector<Match>& matches,
+                              Summary& summary, bool& done);
+
+    // Stop a job and forget it
+    static bool cancelJob(const std::string& job_id);
+
+private:
+    struct Job {
+        std::mutex mutex;
+        std::vector<Match> matches;
+        Summary summary;
+        bool done = false;
+        std::atomic<bool> cancelled{false};
+        std::time_t last_access = 0;
+    };
+
+    // Jobs not polled for this long are cancelled and dropped
+    static constexpr std::time_t JOB_IDLE_TIMEOUT = 60;
+
+    static std::mutex jobs_mutex;
+    static std::unordered_map<std::string, std::shared_ptr<Job>> jobs;
+
+    // Drop jobs nobody has polled within JOB_IDLE_TIMEOUT
+    static void expireJobs();
+};
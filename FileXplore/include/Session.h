@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <chrono>
+#include "HistoryManager.h"
+
+/**
+ * Session - Per-client state: working directory, command history and settings
+ * The CLI runs a single session; the web server keeps one per client, keyed by
+ * a session token, so concurrent clients never see each other's cwd.
+ * All members are safe to call from several request threads at once.
+ */
+class Session {
+public:
+    explicit Session(const std::string& id = "");
+
+    // Session token / identifier
+    const std::string& getId() const;
+
+    // Current working directory (normalized virtual path)
+    std::string getCurrentPath() const;
+
+    // Change the working directory (must be an existing directory in the sandbox)
+    bool setCurrentPath(const std::string& path);
+
+    // Resolve a path typed by this session's user against its working directory
+    std::string resolvePath(const std::string& path) const;
+
+    // Command history of this session
+    HistoryManager& getHistory();
+    const HistoryManager& getHistory() const;
+
+    // User settings/preferences
+    std::string getSetting(const std::string& key, const std::string& default_value = "") const;
+    void setSetting(const std::string& key, const std::string& value);
+    std::map<std::string, std::string> getSettings() const;
+    void setSettings(const std::map<std::string, std::string>& settings);
+
+    // Idle tracking for expiry
+    void touch();
+    std::chrono::steady_clock::time_point getLastUsed() const;
+
+private:
+    std::string id_;
+    mutable std::mutex mutex_;
+    std::string current_path_;
+    std::map<std::string, std::string> settings_;
+    std::chrono::steady_clock::time_point last_used_;
+    HistoryManager history_;
+};
+
+/**
+ * SessionManager - Registry of web client sessions keyed by token
+ */
+class SessionManager {
+public:
+    // Look up a session by token, creating a fresh one if the token is unknown
+    static std::shared_ptr<Session> acquire(const std::string& token, bool& created);
+
+    // Look up an existing session (nullptr if unknown)
+    static std::shared_ptr<Session> find(const std::string& token);
+
+    // Number of live sessions
+    static std::size_t getSessionCount();
+
+    // Drop sessions idle for longer than max_idle
+    static void expireIdle(std::chrono::seconds max_idle);
+
+    // Random 128-bit hex token (session tokens, upload IDs)
+    static std::string generateToken();
+
+private:
+    static std::shared_mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Sha256 - Incremental SHA-256 (FIPS 180-4)
+ * Feed data with update() in pieces of any size, then read the digest once
+ * with finish() or hexDigest(). Used to name content-addressed blobs.
+ */
+class Sha256 {
+public:
+    static constexpr std::size_t DIGEST_SIZE = 32;
+
+    Sha256();
+
+    // Hash more bytes
+    void update(const void* data, std::size_t length);
+    void update(std::string_view data) { update(data.data(), data.size()); }
+
+    // Pad and write the 32-byte digest (the hasher must not be updated afterwards)
+    void finish(std::uint8_t digest[DIGEST_SIZE]);
+
+    // finish() as 64 lowercase hex digits
+    std::string hexDigest();
+
+    // One-shot hash of a buffer as hex
+    static std::string hash(std::string_view data);
+
+private:
+    std::uint32_t state_[8];
+    std::uint8_t block_[64];
+    std::size_t block_length_;
+    std::uint64_t total_length_;
+
+    // Compress one 64-byte block into the state
+    void transform(const std::uint8_t* block);
+};
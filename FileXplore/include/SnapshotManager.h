@@ -0,0 +1,119 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <ctime>
+#include <cstdint>
+#include "DirManager.h"
+
+/**
+ * SnapshotManager - Copy-on-write snapshots of the VFS root
+ * A snapshot is a hard link farm: SNAPSHOT_DIR/<name>/tree mirrors the root
+ * with a real directory per directory and a link per file and symlink, so
+ * taking one costs a link() per file and no data I/O however large the
+ * files are. Most writers put a new inode in place (a temp file and a rename).
+ * The two that change a file in place, appends and unsynced overwrites, give
+ * a shared inode up first (BlobStore::detach/release) and hold holdLinks()
+ * from that check until their write is done; create and restore take it
+ * exclusively, so no link appears in between. Where a link is refused (another
+ * device, a link limit) the file is copied, cloned where FICLONE works.
+ * SNAPSHOT_DIR/<name>/manifest lists type, mode, size, mtime and inode of
+ * every entry and is written last, so a snapshot without one is incomplete.
+ * Diff and restore compare the manifest with the tree: a file whose inode,
+ * size and mtime all match is still the snapshot's own inode and is neither
+ * reported nor touched, so restore only relinks what changed.
+ */
+class SnapshotManager {
+public:
+    // One snapshot, as read from its manifest header
+    struct Info {
+        std::string name;
+        std::time_t created;
+        std::uint64_t files;
+        std::uint64_t directories;
+        std::uint64_t bytes;          // Logical size of the files
+
+        Info() : created(0), files(0), directories(0), bytes(0) {}
+    };
+
+    // One difference between a snapshot and the tree
+    struct Change {
+        char kind;                    // 'A' added since, 'D' deleted since, 'M' modified
+        std::string path;             // Normalized virtual path
+    };
+
+    // Counters reported by restore
+    struct RestoreStats {
+        std::uint64_t restored;       // Files and symlinks linked back
+        std::uint64_t unchanged;      // Files left alone
+        std::uint64_t removed;        // Entries not in the snapshot
+        std::uint64_t directories;    // Directories recreated
+
+        RestoreStats() : restored(0), unchanged(0), removed(0), directories(0) {}
+    };
+
+    // What the manifest records per entry (and a scan of the tree, to compare)
+    struct Item {
+        DirManager::EntryType type;
+        mode_t mode;
+        long long size;
+        std::time_t mtime;
+        std::uint64_t inode;
+    };
+
+    // Directory (beneath the root) holding the snapshots
+    static const char* const SNAPSHOT_DIR;
+
+    // Pick up the snapshots of this VFS root and drop incomplete ones
+    static void initialize();
+
+    // Check whether any snapshot may share inodes with the tree
+    static bool hasSnapshots();
+
+    // Check that name is usable as a snapshot name
+    static bool isValidName(const std::string& name);
+
+    // Held by a writer that changes a file in place, from its link count check to the end of its write
+    static std::shared_lock<std::shared_mutex> holdLinks();
+
+    // Snapshot the whole root (an empty name picks a timestamp); "" or "Error: ..."
+    static std::string create(const std::string& name, Info& info);
+
+    // Complete snapshots, oldest first
+    static std::string list(std::vector<Info>& snapshots);
+
+    // Make virtual_path (a normalized path, "/" for everything) match the snapshot
+    static std::string restore(const std::string& name, const std::string& virtual_path, RestoreStats& stats);
+
+    // Differences between the snapshot and the tree beneath virtual_path, sorted by path
+    static std::string diff(const std::string& name, const std::string& virtual_path, std::vector<Change>& changes);
+
+    // Delete a snapshot
+    static std::string remove(const std::string& name);
+
+private:
+    // Manifest layout version
+    static constexpr int FORMAT_VERSION = 1;
+
+    static std::atomic<bool> present;            // SNAPSHOT_DIR exists
+    static std::mutex snapshot_mutex;            // One create, restore or delete at a time
+    static std::shared_mutex link_mutex;         // Exclusive while create or restore links inodes
+
+    // SNAPSHOT_DIR/<name>
+    static std::string snapshotPath(const std::string& name);
+
+    // Read a manifest, keeping the entries at or beneath scope
+    // (items may be null to read only the header)
+    static std::string readManifest(const std::string& name, const std::string& scope, Info& info,
+                                    std::vector<std::pair<std::string, Item>>* items);
+
+    // Stat the tree at or beneath scope, sorted by path
+    static void scanTree(const std::string& scope, std::vector<std::pair<std::string, Item>>& items);
+
+    // Remove a directory and everything beneath it
+    static void removeTree(const std::string& virtual_path);
+};
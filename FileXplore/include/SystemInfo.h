@@ -2,6 +2,8 @@
 
 #include <string>
 
+class Session;
+
 /**
  * SystemInfo - Provides system information and statistics
  * Handles disk usage, file/folder counts, and other system utilities
@@ -22,15 +24,15 @@ public:
     static DiskUsage getDiskUsage();
     
     // Display disk usage information (df command)
-    static void displayDiskUsage();
+    static void displayDiskUsage(const Session& session);
     
     // Format bytes to human-readable format
     static std::string formatBytes(std::size_t bytes);
     
     // Get VFS information summary
-    static std::string getVFSInfo();
+    static std::string getVFSInfo(const Session& session);
     
 private:
-    // Recursively calculate directory size and counts
-    static void calculateDirectoryStats(const std::string& path, DiskUsage& usage);
+    // Calculate directory size and counts under a virtual path with the parallel walker
+    static void calculateDirectoryStats(const std::string& virtual_path, DiskUsage& usage);
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include "DirManager.h"
+
+/**
+ * TreeWalker - Parallel recursive directory walk shared by tree, df and zip
+ * Each worker thread owns a deque of pending directories: it pops its own
+ * newest work (depth-first, cache friendly) and steals the oldest work of
+ * other workers when it runs dry, so wide trees keep every core busy.
+ * Directories are read with DirManager::DirIterator (one getdents64 buffer
+ * plus one fstatat per entry) and opened beneath the sandbox root.
+ * Symlinks are reported but never followed, so the walk cannot loop.
+ */
+class TreeWalker {
+public:
+    // One entry found beneath the walk root
+    struct WalkEntry {
+        std::string path;             // Normalized virtual path
+        DirManager::DirEntry info;    // Name, type, size, mtime, mode
+        int depth;                    // 1 for direct children of the root
+        bool last_sibling;            // Last in its directory (ordered walks only)
+
+        WalkEntry() : depth(0), last_sibling(false) {}
+    };
+
+    // Walk configuration
+    struct Options {
+        int max_depth;                // Deepest level reported (-1 = unlimited)
+        std::size_t threads;          // Worker count (0 = hardware concurrency)
+        // Entries rejected by the filter are neither reported nor descended into
+        std::function<bool(const WalkEntry&)> filter;
+
+        Options() : max_depth(-1), threads(0) {}
+    };
+
+    // Visit every entry in no particular order; visit runs concurrently on the workers
+    static bool walk(const std::string& virtual_root, const Options& options,
+                     const std::function<void(const WalkEntry&)>& visit);
+
+    // Collect every entry in depth-first order with siblings sorted by name
+    static bool walkOrdered(const std::string& virtual_root, const Options& options,
+                            std::vector<WalkEntry>& entries);
+
+private:
+    struct Node;
+
+    // Shared engine: visit is optional, root receives the ordered tree when given
+    static bool run(const std::string& virtual_root, const Options& options,
+                    const std::function<void(const WalkEntry&)>* visit, Node* root);
+
+    // Flatten an ordered tree into pre-order
+    static void flatten(Node& node, std::vector<WalkEntry>& entries);
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+/**
+ * UploadManager - Chunked, resumable uploads published with an atomic rename
+ * Each upload gets a random ID and a temp file in UPLOAD_DIR, a reserved
+ * directory beneath the sandbox root: on the same filesystem as every target,
+ * so publishing stays a rename, yet unreachable through client paths. Only
+ * the session that began an upload can send, query, finish or abort it.
+ * Chunks are written with pwrite at their byte offset, so a chunk is never
+ * held beyond the request that carries it. A client that loses its
+ * connection asks for the acknowledged offset and continues from there. finalize() renames the temp file over the target in one step, so
+ * readers see either the old file or the complete new one.
+ */
+class UploadManager {
+public:
+    // Snapshot of an upload's progress
+    struct Status {
+        std::string id;
+        std::string target;          // Normalized virtual path published on finalize
+        std::uint64_t received;      // Contiguous bytes acknowledged from offset 0
+        long long expected_size;     // Declared total size (-1 = unknown)
+        std::time_t last_activity;
+        bool complete;               // Published by begin() from the blob store: no data to send
+
+        Status() : received(0), expected_size(-1), last_activity(0), complete(false) {}
+    };
+
+    // Reserved directory (beneath the root) holding in-progress uploads
+    static const char* const UPLOAD_DIR;
+
+    // Largest chunk accepted in one request
+    static constexpr std::size_t MAX_CHUNK_SIZE = 8 * 1024 * 1024;
+
+    // Remove temp files left behind by a previous run (their uploads cannot be resumed)
+    static void initialize();
+
+    // Start an upload to a normalized virtual path for the session owner; returns "" or an
+    // "Error: ..." message. With a content_hash (SHA-256 hex) the blob store already holds,
+    // the target is linked at once and status.complete is set: the client skips the transfer.
+    static std::string begin(const std::string& owner, const std::string& virtual_target, long long expected_size,
+                             Status& status, const std::string& content_hash = "");
+
+    // The calls below treat an upload begun by another session as unknown
+
+    // Write a chunk at offset; offset may repeat acknowledged bytes but not skip ahead
+    static std::string writeChunk(const std::string& upload_id, const std::string& owner, std::uint64_t offset,
+                                  const char* data, std::size_t length, Status& status);
+
+    // Look up an upload's progress
+    static bool getStatus(const std::string& upload_id, const std::string& owner, Status& status);
+
+    // Publish the upload at its target path
+    static std::string finalize(const std::string& upload_id, const std::string& owner, Status& status);
+
+    // Discard an upload and its temp file
+    static std::string abort(const std::string& upload_id, const std::string& owner);
+
+private:
+    struct Upload {
+        std::mutex mutex;            // Serializes chunks of one upload
+        Status status;
+        std::string owner;           // ID of the session that began the upload
+        std::string temp_path;
+        bool closed = false;         // Finalized or aborted
+    };
+
+    // Uploads idle this long are discarded by the next begin()
+    static constexpr std::time_t IDLE_TIMEOUT = 24 * 60 * 60;
+
+    static std::mutex uploads_mutex;
+    static std::unordered_map<std::string, std::shared_ptr<Upload>> uploads;
+
+    // Find an upload by ID; nullptr unless owner began it
+    static std::shared_ptr<Upload> find(const std::string& upload_id, const std::string& owner);
+
+    // Unregister an upload and drop its temp file (caller holds the upload's mutex)
+    static void discard(const std::string& upload_id, Upload& upload);
+
+    // Abort uploads idle longer than IDLE_TIMEOUT
+    static void expireIdle();
+
+    // Remove UPLOAD_DIR once no upload is registered (begin creates it under the same lock)
+    static void removeUploadDirIfIdle();
+};
@@ -22,6 +22,23 @@
 #endif
 #define CROW_MAIN
 #include "../third_party/include/crow/crow_all.h"
+#include "Session.h"
+#include "DirManager.h"
+
+/**
+ * SessionMiddleware - Attaches a Session to every request
+ * The token comes from the fx_session cookie or the X-Session-Token header;
+ * unknown or missing tokens get a fresh session, returned on the response.
+ */
+struct SessionMiddleware {
+    struct context {
+        std::shared_ptr<Session> session;
+        bool created = false;
+    };
+
+    void before_handle(crow::request& req, crow::response& res, context& ctx);
+    void after_handle(crow::request& req, crow::response& res, context& ctx);
+};
 
 /**
  * WebServer - HTTP server for GUI communication
@@ -83,7 +100,7 @@ public:
 
 private:
     // Server instance
-    std::unique_ptr<crow::SimpleApp> app_;
+    std::unique_ptr<crow::App<SessionMiddleware>> app_;
 
     // Server thread
     std::unique_ptr<std::thread> server_thread_;
@@ -98,12 +115,29 @@ private:
     // API endpoint handlers
     crow::response handleCommand(const crow::request& req);
     crow::response handleFileSystem(const crow::request& req);
+    crow::response handleFileSystemPage(const crow::request& req, const std::string& path);
     crow::response handleFileContent(const crow::request& req, const std::string& path);
+    void handleFileRange(const crow::request& req, crow::response& res, const std::string& path);
+    crow::response handleDownload(const crow::request& req, const std::string& path);
     crow::response handleFileUpload(const crow::request& req, const std::string& path);
+    crow::response handleAppend(const crow::request& req, const std::string& path);
+    crow::response handleUploadBegin(const crow::request& req);
+    crow::response handleUpload(const crow::request& req, const std::string& upload_id);
+    crow::response handleUploadFinalize(const crow::request& req, const std::string& upload_id);
+    crow::response handleSearch(const crow::request& req);
+    crow::response handleLocate(const crow::request& req);
+    crow::response handleChecksum(const crow::request& req);
+    crow::response handleSearchResults(const crow::request& req, const std::string& search_id);
     crow::response handleHistory(const crow::request& req);
     crow::response handleSystemInfo(const crow::request& req);
+    crow::response handleLogLevel(const crow::request& req);
     crow::response handleCompress(const crow::request& req);
     crow::response handleDecompress(const crow::request& req);
+    crow::response handleZipList(const crow::request& req);
+    crow::response handleZipEntry(const crow::request& req);
+
+    // Session attached to a request by SessionMiddleware
+    Session& getSession(const crow::request& req);
 
     // Static file serving
     crow::response handleStaticFile(const std::string& filename);
@@ -115,8 +149,9 @@ private:
     std::string getMimeType(const std::string& filepath);
 
     // Convert command results to API responses
-    ApiResponse executeCommandAPI(const std::string& command, const std::vector<std::string>& args);
-    FileSystemData getFileSystemData(const std::string& path = ".");
+    ApiResponse executeCommandAPI(Session& session, const std::string& command, const std::vector<std::string>& args);
+    FileSystemData getFileSystemData(const Session& session, const std::string& path = ".");
+    FileInfo makeFileInfo(const std::string& dir_path, const DirManager::DirEntry& entry);
 
     // CORS headers
     void addCorsHeaders(crow::response& res);
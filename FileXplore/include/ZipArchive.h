@@ -0,0 +1,125 @@
+#pragma once
+
+#include "FileManager.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+struct z_stream_s;
+
+/**
+ * ZipArchive - Indexed, random-access reader for zip archives
+ * The archive is mapped read-only; the end of central directory record is
+ * found by scanning the mapped tail once, then the central directory (ZIP64
+ * included) is parsed into an entry table with a hash index by name. Entry
+ * data is not touched until an entry is opened, so listing a 100k-entry
+ * archive costs only its central directory. Parsed archives are cached by
+ * path and reused while the file's inode, size and mtime are unchanged;
+ * archives FileXplore writes are replaced by rename, so a cached mapping
+ * stays valid for readers still holding it.
+ */
+class ZipArchive : public std::enable_shared_from_this<ZipArchive> {
+public:
+    // One central directory record
+    struct Entry {
+        std::string name;
+        std::uint16_t compression;    // 0 = stored, 8 = deflate
+        std::uint32_t crc32;
+        std::uint64_t compressed_size;
+        std::uint64_t uncompressed_size;
+        std::uint64_t local_header_offset;
+    };
+
+    /**
+     * EntryReader - Streams one entry's uncompressed bytes
+     * Stored data is copied out of the mapping, deflated data inflated in
+     * pieces of the caller's buffer size; the CRC and size are checked at
+     * the end. Keeps the archive (and its mapping) alive while open.
+     */
+    class EntryReader {
+    public:
+        EntryReader();
+        ~EntryReader();
+
+        EntryReader(EntryReader&& other) noexcept;
+        EntryReader& operator=(EntryReader&& other) noexcept;
+        EntryReader(const EntryReader&) = delete;
+        EntryReader& operator=(const EntryReader&) = delete;
+
+        // Check if the entry could be opened; getError() explains why not
+        bool isOpen() const;
+
+        // Next bytes of the entry: the count, 0 at the end, -1 if the data is corrupt
+        long long read(char* buffer, std::size_t capacity);
+
+        // "Error: ..." message when opening or reading failed
+        const std::string& getError() const;
+
+    private:
+        friend class ZipArchive;
+
+        std::shared_ptr<const ZipArchive> archive_;
+        const Entry* entry_;
+        const char* data_;                   // Compressed bytes in the mapping
+        std::uint64_t consumed_;
+        std::uint64_t produced_;
+        std::uint32_t crc_;
+        std::unique_ptr<z_stream_s> stream_; // Inflate state (deflated entries)
+        bool finished_;
+        std::string error_;
+
+        // Check the CRC and size once the data ends
+        long long finish();
+    };
+
+    // Archives kept parsed at most
+    static constexpr std::size_t MAX_CACHED_ARCHIVES = 8;
+
+    // Open the archive at a normalized virtual path (from the cache when unchanged); nullptr and
+    // "Error: ..." in error on failure
+    static std::shared_ptr<const ZipArchive> open(const std::string& virtual_path, std::string& error);
+
+    // Drop every cached archive
+    static void clearCache();
+
+    // Central directory entries, in archive order
+    const std::vector<Entry>& entries() const { return entries_; }
+
+    // Entry by name, with or without a leading '/'; nullptr if absent
+    const Entry* find(const std::string& name) const;
+
+    // Stream an entry's data
+    EntryReader openEntry(const Entry& entry) const;
+
+    // Relative path an entry may be extracted to, or "" if its name is absolute in a way that
+    // cannot be made relative or climbs out with ".."
+    static std::string safeEntryPath(const std::string& name);
+
+private:
+    // Cached archive and the file state it was parsed from
+    struct CacheSlot {
+        std::string path;
+        std::uint64_t inode;
+        std::int64_t size;
+        std::int64_t mtime_ns;
+        std::shared_ptr<const ZipArchive> archive;
+    };
+
+    static std::mutex cache_mutex;
+    static std::list<CacheSlot> cache;       // Most recently used first
+
+    FileManager::MappedFile mapping_;
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string_view, std::size_t> index_;
+
+    ZipArchive() = default;
+
+    // Locate and parse the central directory of mapping_; "" or "Error: ..."
+    std::string parse(const std::string& virtual_path);
+};
@@ -6,6 +6,14 @@
 #endif
 #include "include/PersistenceManager.h"
 #include "include/HistoryManager.h"
+#include "include/Session.h"
+#include "include/Logger.h"
+#include "include/IoEngine.h"
+#include "include/BlobStore.h"
+#include "include/SnapshotManager.h"
+#include "include/FileIndex.h"
+#include "include/ChecksumManager.h"
+#include "include/AppendWriter.h"
 #include <iostream>
 #include <string>
 #include <algorithm>
@@ -61,8 +69,8 @@ void showUsage() {
     cout << "  FileXplore --gui /tmp/myfs    # Start GUI mode with custom VFS root" << endl;
 }
 
-void displayPrompt() {
-    string current_dir = PathUtils::getCurrentVirtualPath();
+void displayPrompt(const Session& session) {
+    string current_dir = session.getCurrentPath();
     cout << "FileXplore:" << current_dir << "$ ";
 }
 
@@ -91,6 +99,9 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Diagnostics go through the background drain from here on
+    Logger::start();
+
     // Initialize the virtual file system
     if (!PathUtils::initializeVFSRoot(vfs_root)) {
         cerr << "Error: Failed to initialize VFS root directory: " << vfs_root << endl;
@@ -98,24 +109,41 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Deduplicated storage is on when this root has a blob store
+    BlobStore::initialize();
+
+    // Snapshots share inodes with the tree, so writers must know about them
+    SnapshotManager::initialize();
+
+    // Asynchronous file I/O (io_uring when available) for previews and zip packing
+    IoEngine::start();
+
+    // The CLI is a single session; the web server creates one per client
+    Session session("cli");
+
     // Initialize persistence system
     if (PersistenceManager::initialize(vfs_root)) {
         if (!gui_mode) {
             cout << "Persistence system initialized." << endl;
 
             // Load previous state if available
-            if (PathUtils::loadVFSState()) {
+            if (PathUtils::loadVFSState(session)) {
                 cout << "Previous VFS state restored." << endl;
             }
 
-            if (HistoryManager::loadHistory()) {
+            if (session.getHistory().loadHistory()) {
                 cout << "Command history restored." << endl;
             }
+
+            session.setSettings(PersistenceManager::loadSettings());
         }
     } else if (!gui_mode) {
         cout << "Warning: Persistence system not available. Session data will not be saved." << endl;
     }
 
+    // Filename index for locate: the saved copy is loaded and refreshed in the background
+    FileIndex::start();
+
     // Initialize command parser
     CommandParser::initialize();
 
@@ -140,6 +168,9 @@ int main(int argc, char* argv[]) {
         }
 
         server.stop();
+        FileIndex::stop();
+        ChecksumManager::save();
+        AppendWriter::closeAll();
         return 0;
 #else
         cerr << "GUI is disabled in this build. Rebuild with a newer compiler (e.g., MSYS2 MinGW-w64 GCC >= 9) or MSVC to enable GUI." << endl;
@@ -152,7 +183,7 @@ int main(int argc, char* argv[]) {
 
     // Show initial system information
     cout << "VFS Root: " << PathUtils::getVFSRoot() << endl;
-    cout << "Current Directory: " << PathUtils::getCurrentVirtualPath() << endl;
+    cout << "Current Directory: " << session.getCurrentPath() << endl;
     cout << string(70, '-') << endl;
 
     // Main CLI loop
@@ -160,7 +191,7 @@ int main(int argc, char* argv[]) {
     bool running = true;
 
     while (running) {
-        displayPrompt();
+        displayPrompt(session);
 
         // Get user input
         if (!getline(cin, input)) {
@@ -175,7 +206,7 @@ int main(int argc, char* argv[]) {
         }
 
         // Execute command
-        CommandParser::CommandResult result = CommandParser::executeCommand(input);
+        CommandParser::CommandResult result = CommandParser::executeCommand(session, input);
 
         // Handle command result
         if (!result.success) {
@@ -198,14 +229,19 @@ int main(int argc, char* argv[]) {
     if (PersistenceManager::isPersistenceAvailable()) {
         cout << "Saving session data..." << endl;
 
-        if (PathUtils::saveVFSState()) {
+        if (PathUtils::saveVFSState(session)) {
             cout << "VFS state saved." << endl;
         }
 
-        if (HistoryManager::saveHistory()) {
+        if (session.getHistory().saveHistory()) {
             cout << "Command history saved." << endl;
         }
+
+        PersistenceManager::saveSettings(session.getSettings());
     }
+    FileIndex::stop();
+    ChecksumManager::save();
+    AppendWriter::closeAll();
 
     return 0;
 }
\ No newline at end of file
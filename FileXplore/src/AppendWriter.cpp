@@ -0,0 +1,288 @@
+#include "../include/AppendWriter.h"
+#include "../include/Sandbox.h"
+#include "../include/BlobStore.h"
+#include "../include/SnapshotManager.h"
+#include "../include/MetadataCache.h"
+#include "../include/FileIndex.h"
+#include "../include/Logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+    #include <sys/uio.h>
+    #include <climits>
+#endif
+
+using namespace std;
+
+// One queued append: the caller's buffer stays valid until its batch is done
+struct AppendWriter::Batch {
+    vector<pair<const char*, size_t>> pieces;
+    bool done = false;
+    string error;
+};
+
+struct AppendWriter::Target {
+    mutex queue_mutex;                           // Guards the batch fields
+    condition_variable done_cv;
+    condition_variable join_cv;                  // An appender joined the open batch
+    shared_ptr<Batch> open_batch;
+    bool writing = false;                        // A leader is writing a batch
+    size_t last_batch_size = 1;                  // Appenders the next leader waits for
+    ScopedFd fd;                                 // Written by the leader only
+    uint64_t inode = 0;
+    chrono::steady_clock::time_point checked;    // Last time the path was stat'ed
+    size_t users = 0;                            // Guarded by targets_mutex
+    list<string>::iterator position;             // In recent, guarded by targets_mutex
+};
+
+// Static member definitions
+mutex AppendWriter::targets_mutex;
+unordered_map<string, shared_ptr<AppendWriter::Target>> AppendWriter::targets;
+list<string> AppendWriter::recent;
+atomic<int64_t> AppendWriter::window_us(0);
+atomic<uint64_t> AppendWriter::appends(0);
+atomic<uint64_t> AppendWriter::batches(0);
+atomic<uint64_t> AppendWriter::bytes(0);
+atomic<uint64_t> AppendWriter::opens(0);
+
+// Write every piece in order, as few writev calls as the iovec limit allows
+static bool writePieces(int fd, const vector<pair<const char*, size_t>>& pieces) {
+#ifdef _WIN32
+    for (const auto& piece : pieces) {
+        const char* data = piece.first;
+        size_t length = piece.second;
+        while (length > 0) {
+            int written = _write(fd, data, static_cast<unsigned>(min<size_t>(length, INT_MAX)));
+            if (written < 0) {
+                return false;
+            }
+            data += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+    return true;
+#else
+    vector<iovec> iov;
+    iov.reserve(min<size_t>(pieces.size(), IOV_MAX));
+    size_t next = 0;
+    while (next < pieces.size()) {
+        iov.clear();
+        for (size_t i = next; i < pieces.size() && iov.size() < IOV_MAX; ++i) {
+            iov.push_back({const_cast<char*>(pieces[i].first), pieces[i].second});
+        }
+        next += iov.size();
+
+        // A short write resumes inside the iovec it stopped in
+        size_t first = 0;
+        while (first < iov.size()) {
+            ssize_t written = ::writev(fd, iov.data() + first, static_cast<int>(iov.size() - first));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            size_t remaining = static_cast<size_t>(written);
+            while (first < iov.size() && remaining >= iov[first].iov_len) {
+                remaining -= iov[first].iov_len;
+                ++first;
+            }
+            if (first < iov.size()) {
+                iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+                iov[first].iov_len -= remaining;
+            }
+        }
+    }
+    return true;
+#endif
+}
+
+string AppendWriter::append(const string& resolved, const char* data, size_t length) {
+    appends++;
+    shared_ptr<Target> target = acquire(resolved);
+    string error;
+    {
+        unique_lock<mutex> lock(target->queue_mutex);
+        if (!target->open_batch) {
+            target->open_batch = make_shared<Batch>();
+        }
+        shared_ptr<Batch> batch = target->open_batch;
+        batch->pieces.emplace_back(data, length);
+        // Wake a waiting leader only once the batch it waits for is complete
+        if (target->writing && batch->pieces.size() == target->last_batch_size) {
+            target->join_cv.notify_one();
+        }
+
+        while (!batch->done) {
+            if (target->writing) {
+                // A batch is being written; its leader wakes us when it finishes
+                target->done_cv.wait(lock);
+                continue;
+            }
+
+            // Lead the open batch; wait for company only if this file had it last time
+            target->writing = true;
+            size_t expected = target->last_batch_size;
+            chrono::microseconds window(window_us.load());
+            if (window.count() > 0 && expected > 1) {
+                target->join_cv.wait_for(lock, window, [&]() {
+                    return target->open_batch->pieces.size() >= expected;
+                });
+            }
+            shared_ptr<Batch> closing = target->open_batch;
+            target->open_batch.reset();
+
+            lock.unlock();
+            string result = writeBatch(*target, resolved, *closing);
+            lock.lock();
+
+            closing->error = result;
+            closing->done = true;
+            target->last_batch_size = closing->pieces.size();
+            target->writing = false;
+            target->done_cv.notify_all();
+        }
+        error = batch->error;
+    }
+    release(target);
+    return error;
+}
+
+void AppendWriter::setWindow(chrono::microseconds window) {
+    window_us = max<int64_t>(0, window.count());
+}
+
+chrono::microseconds AppendWriter::getWindow() {
+    return chrono::microseconds(window_us.load());
+}
+
+void AppendWriter::closeAll() {
+    lock_guard<mutex> lock(targets_mutex);
+    for (auto it = targets.begin(); it != targets.end();) {
+        if (it->second->users == 0) {
+            recent.erase(it->second->position);
+            it = targets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+AppendWriter::Stats AppendWriter::getStats() {
+    Stats stats;
+    stats.appends = appends.load();
+    stats.batches = batches.load();
+    stats.bytes = bytes.load();
+    stats.opens = opens.load();
+    lock_guard<mutex> lock(targets_mutex);
+    stats.open_files = targets.size();
+    return stats;
+}
+
+shared_ptr<AppendWriter::Target> AppendWriter::acquire(const string& resolved) {
+    lock_guard<mutex> lock(targets_mutex);
+    auto it = targets.find(resolved);
+    if (it != targets.end()) {
+        recent.splice(recent.begin(), recent, it->second->position);
+        it->second->users++;
+        return it->second;
+    }
+
+    // Evict the least recently used idle entry; busy ones stay so a path never has two queues
+    if (targets.size() >= MAX_OPEN_FILES) {
+        for (auto victim = recent.rbegin(); victim != recent.rend(); ++victim) {
+            auto entry = targets.find(*victim);
+            if (entry->second->users == 0) {
+                recent.erase(next(victim).base());
+                targets.erase(entry);
+                break;
+            }
+        }
+    }
+
+    shared_ptr<Target> target = make_shared<Target>();
+    recent.push_front(resolved);
+    target->position = recent.begin();
+    target->users = 1;
+    targets.emplace(resolved, target);
+    return target;
+}
+
+void AppendWriter::release(const shared_ptr<Target>& target) {
+    lock_guard<mutex> lock(targets_mutex);
+    target->users--;
+}
+
+string AppendWriter::writeBatch(Target& target, const string& resolved, const Batch& batch) {
+    // One fstat of the cached descriptor catches what FileXplore itself does to a file:
+    // replacing or deleting it leaves no link, linking it (blob store, snapshots) adds one.
+    // The path is checked as well when opening, and now and then for outside renames.
+    // No snapshot may link the file between the link count check and the write
+    shared_lock<shared_mutex> links = SnapshotManager::holdLinks();
+    auto now = chrono::steady_clock::now();
+    bool check_path = !target.fd.valid() || now - target.checked >= chrono::milliseconds(REVALIDATE_MS);
+    if (!check_path) {
+        struct stat opened;
+        check_path = fstat(target.fd.get(), &opened) != 0 || opened.st_nlink != 1;
+    }
+
+    if (check_path) {
+        struct stat current;
+        bool exists = Sandbox::statPath(resolved, current);
+
+        // A shared inode gets a private copy before it grows
+        if (exists && (current.st_mode & S_IFMT) == S_IFREG && current.st_nlink > 1) {
+            string error = BlobStore::detach(resolved);
+            if (!error.empty()) {
+                return error;
+            }
+            exists = Sandbox::statPath(resolved, current);
+        }
+
+        // The cached descriptor is good while the path still names its inode
+        if (target.fd.valid() && (!exists || static_cast<uint64_t>(current.st_ino) != target.inode)) {
+            target.fd.reset();
+        }
+        if (!target.fd.valid()) {
+            target.fd.reset(Sandbox::openPath(resolved, O_WRONLY | O_CREAT | O_APPEND, 0644));
+            if (!target.fd.valid()) {
+                if (Sandbox::isEscapeError(errno)) {
+                    return "Error: Invalid file path or access denied";
+                }
+                return "Error: Cannot open file for appending: " + resolved;
+            }
+            struct stat opened;
+            target.inode = fstat(target.fd.get(), &opened) == 0 ? static_cast<uint64_t>(opened.st_ino) : 0;
+            opens++;
+            if (!exists) {
+                FileIndex::update(resolved);
+            }
+        }
+        target.checked = now;
+    }
+
+    bool ok = writePieces(target.fd.get(), batch.pieces);
+    MetadataCache::invalidateTree(resolved);
+    if (!ok) {
+        target.fd.reset();
+        return "Error: Failed to append to file: " + resolved;
+    }
+
+    size_t total = 0;
+    for (const auto& piece : batch.pieces) {
+        total += piece.second;
+    }
+    batches++;
+    bytes += total;
+    FX_LOG_TRACE("Appended " << batch.pieces.size() << " writes (" << total << " bytes) to " << resolved);
+    return "";
+}
@@ -0,0 +1,402 @@
+#include "../include/BlobStore.h"
+#include "../include/FileManager.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/Session.h"
+#include "../include/DirManager.h"
+#include "../include/MetadataCache.h"
+#include "../include/GroupCommit.h"
+#include "../include/Sha256.h"
+#include "../include/SnapshotManager.h"
+#include "../include/Logger.h"
+#include <mutex>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+using namespace std;
+
+// Static member definitions
+const char* const BlobStore::STORE_DIR = "/.fxstore";
+atomic<bool> BlobStore::enabled(false);
+atomic<bool> BlobStore::present(false);
+atomic<uint64_t> BlobStore::hits(0);
+atomic<uint64_t> BlobStore::misses(0);
+shared_mutex BlobStore::store_mutex;
+
+static string objectsDir() {
+    return string(BlobStore::STORE_DIR) + "/objects";
+}
+
+static string tempDir() {
+    return string(BlobStore::STORE_DIR) + "/tmp";
+}
+
+static string disabledMarker() {
+    return string(BlobStore::STORE_DIR) + "/disabled";
+}
+
+void BlobStore::initialize() {
+    struct stat info;
+    present = Sandbox::statPath(STORE_DIR, info) && (info.st_mode & S_IFMT) == S_IFDIR;
+    enabled = present && !Sandbox::statPath(disabledMarker(), info);
+    if (!present) {
+        return;
+    }
+
+    // Temp files of an interrupted write never got a store name or a link
+    DirManager::DirIterator it(tempDir());
+    DirManager::DirEntry entry;
+    while (it.isOpen() && it.next(entry)) {
+        if (entry.type == DirManager::EntryType::File) {
+            Sandbox::removeFile(tempDir() + "/" + entry.name);
+        }
+    }
+    MetadataCache::invalidateTree(tempDir());
+}
+
+bool BlobStore::isEnabled() {
+    return enabled.load();
+}
+
+string BlobStore::setEnabled(bool enable) {
+    if (!enable) {
+        if (present) {
+            ScopedFd marker(Sandbox::openPath(disabledMarker(), O_WRONLY | O_CREAT, 0644));
+            if (!marker.valid()) {
+                return "Error: Cannot update the blob store (" + string(strerror(errno)) + ")";
+            }
+            MetadataCache::invalidateTree(disabledMarker());
+        }
+        enabled = false;
+        return "";
+    }
+
+    for (const string& dir : {string(STORE_DIR), objectsDir(), tempDir()}) {
+        if (!Sandbox::makeDirectory(dir, 0755) && errno != EEXIST) {
+            return "Error: Cannot create blob store directory " + dir + " (" + strerror(errno) + ")";
+        }
+    }
+    Sandbox::removeFile(disabledMarker());
+    MetadataCache::invalidateTree(STORE_DIR);
+    present = true;
+    enabled = true;
+    return "";
+}
+
+bool BlobStore::isValidHash(const string& hash) {
+    if (hash.size() != Sha256::DIGEST_SIZE * 2) {
+        return false;
+    }
+    for (char c : hash) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BlobStore::contains(const string& hash, long long size) {
+    if (!present || !isValidHash(hash)) {
+        return false;
+    }
+    struct stat info;
+    if (!Sandbox::statPath(blobPath(hash), info) || (info.st_mode & S_IFMT) != S_IFREG) {
+        return false;
+    }
+    // A size mismatch means the blob was damaged by an in-place write; it gets replaced
+    return size < 0 || static_cast<long long>(info.st_size) == size;
+}
+
+string BlobStore::writeContent(const string& resolved, const string& content, bool durable,
+                               bool& deduplicated) {
+    shared_lock<shared_mutex> lock(store_mutex);
+    string hash = Sha256::hash(content);
+    deduplicated = contains(hash, static_cast<long long>(content.size()));
+    if (deduplicated) {
+        hits++;
+        return linkInto(blobPath(hash), resolved, durable);
+    }
+
+    string temp_path = tempDir() + "/" + SessionManager::generateToken();
+    {
+        ScopedFd fd(Sandbox::openPath(temp_path, O_WRONLY | O_CREAT | O_EXCL, 0644));
+        if (!fd.valid()) {
+            return "Error: Cannot write to the blob store (" + string(strerror(errno)) + ")";
+        }
+        string error;
+        if (!Sandbox::writeAll(fd.get(), content.data(), content.size())) {
+            error = "Error: Failed to write to file: " + resolved;
+        } else if (durable && !GroupCommit::sync(fd.get())) {
+            error = "Error: Failed to sync file: " + resolved;
+        }
+        if (!error.empty()) {
+            Sandbox::removeFile(temp_path);
+            return error;
+        }
+    }
+
+    string blob;
+    string error = storeTemp(temp_path, hash, blob);
+    if (!error.empty()) {
+        return error;
+    }
+    misses++;
+    return linkInto(blob, resolved, durable);
+}
+
+string BlobStore::adoptFile(const string& temp_path, const string& resolved, bool durable, bool& deduplicated) {
+    shared_lock<shared_mutex> lock(store_mutex);
+
+    string hash;
+    long long size = 0;
+    {
+        // Upload temp files live in a reserved directory, which path-based reads refuse
+        ScopedFd fd(Sandbox::openPath(temp_path, O_RDONLY));
+        if (!fd.valid()) {
+            Sandbox::removeFile(temp_path);
+            return "Error: Cannot open file for reading: " + temp_path;
+        }
+        FileManager::MappedFile file = FileManager::mapFile(fd.get());
+        if (!file.isOpen()) {
+            Sandbox::removeFile(temp_path);
+            return file.getError();
+        }
+        hash = Sha256::hash(file.view());
+        size = static_cast<long long>(file.size());
+    }
+
+    deduplicated = contains(hash, size);
+    if (deduplicated) {
+        Sandbox::removeFile(temp_path);
+        hits++;
+        return linkInto(blobPath(hash), resolved, durable);
+    }
+
+    {
+        // Every link shares the blob's mode, so it gets the mode new files get
+        ScopedFd fd(Sandbox::openPath(temp_path, O_WRONLY));
+        bool ok = fd.valid();
+#ifndef _WIN32
+        ok = ok && fchmod(fd.get(), 0644) == 0;
+#endif
+        if (!ok || (durable && !GroupCommit::sync(fd.get()))) {
+            Sandbox::removeFile(temp_path);
+            return "Error: Failed to sync file: " + resolved;
+        }
+    }
+
+    string blob;
+    string error = storeTemp(temp_path, hash, blob);
+    if (!error.empty()) {
+        return error;
+    }
+    misses++;
+    return linkInto(blob, resolved, durable);
+}
+
+string BlobStore::linkBlob(const string& hash, const string& resolved, bool durable) {
+    shared_lock<shared_mutex> lock(store_mutex);
+    if (!contains(hash)) {
+        return "Error: Unknown blob: " + hash;
+    }
+    hits++;
+    return linkInto(blobPath(hash), resolved, durable);
+}
+
+string BlobStore::detach(const string& resolved) {
+    struct stat info;
+    if (!(present || SnapshotManager::hasSnapshots()) || !Sandbox::statPath(resolved, info) ||
+        (info.st_mode & S_IFMT) != S_IFREG || info.st_nlink <= 1) {
+        return "";
+    }
+
+    ScopedFd source(Sandbox::openPath(resolved, O_RDONLY));
+    if (!source.valid()) {
+        return "Error: Cannot open file for writing: " + resolved;
+    }
+    string temp_path = Sandbox::siblingTempPath(resolved, ".fxcopy.");
+    ScopedFd copy(Sandbox::openPath(temp_path, O_WRONLY | O_CREAT | O_EXCL, info.st_mode & 07777));
+    if (!copy.valid()) {
+        return "Error: Cannot open file for writing: " + resolved;
+    }
+    if (!FileManager::copyContents(source.get(), copy.get(), static_cast<long long>(info.st_size)) ||
+        !Sandbox::renamePath(temp_path, resolved)) {
+        Sandbox::removeFile(temp_path);
+        return "Error: Failed to copy shared file: " + resolved;
+    }
+    MetadataCache::invalidateTree(resolved);
+    FX_LOG_DEBUG("Detached " << resolved << " from its shared blob");
+    return "";
+}
+
+void BlobStore::release(const string& resolved) {
+    struct stat info;
+    if ((present || SnapshotManager::hasSnapshots()) && Sandbox::statPath(resolved, info) && (info.st_mode & S_IFMT) == S_IFREG &&
+        info.st_nlink > 1 && Sandbox::removeFile(resolved)) {
+        MetadataCache::invalidateTree(resolved);
+    }
+}
+
+BlobStore::Stats BlobStore::getStats() {
+    Stats stats;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    if (!present) {
+        return stats;
+    }
+
+    DirManager::DirIterator fanouts(objectsDir());
+    DirManager::DirEntry fanout;
+    while (fanouts.isOpen() && fanouts.next(fanout)) {
+        if (fanout.type != DirManager::EntryType::Directory) {
+            continue;
+        }
+        string dir = objectsDir() + "/" + fanout.name;
+        DirManager::DirIterator blobs(dir);
+        DirManager::DirEntry entry;
+        while (blobs.isOpen() && blobs.next(entry)) {
+            struct stat info;
+            if (entry.type != DirManager::EntryType::File || !Sandbox::statPath(dir + "/" + entry.name, info)) {
+                continue;
+            }
+            uint64_t links = info.st_nlink > 1 ? static_cast<uint64_t>(info.st_nlink) - 1 : 0;
+            stats.blobs++;
+            stats.references += links;
+            stats.stored_bytes += static_cast<uint64_t>(info.st_size);
+            stats.logical_bytes += static_cast<uint64_t>(info.st_size) * links;
+        }
+    }
+    return stats;
+}
+
+size_t BlobStore::collectGarbage(uint64_t& freed_bytes) {
+    freed_bytes = 0;
+    if (!present) {
+        return 0;
+    }
+
+    unique_lock<shared_mutex> lock(store_mutex);
+    size_t removed = 0;
+    vector<string> dirs;
+    DirManager::DirIterator fanouts(objectsDir());
+    DirManager::DirEntry fanout;
+    while (fanouts.isOpen() && fanouts.next(fanout)) {
+        if (fanout.type == DirManager::EntryType::Directory) {
+            dirs.push_back(objectsDir() + "/" + fanout.name);
+        }
+    }
+
+    for (const auto& dir : dirs) {
+        vector<string> names;
+        DirManager::DirIterator blobs(dir);
+        DirManager::DirEntry entry;
+        while (blobs.isOpen() && blobs.next(entry)) {
+            names.push_back(entry.name);
+        }
+        for (const auto& name : names) {
+            // The store's own link is the last one: nothing in the tree uses this content
+            struct stat info;
+            string path = dir + "/" + name;
+            if (Sandbox::statPath(path, info) && (info.st_mode & S_IFMT) == S_IFREG && info.st_nlink == 1 &&
+                Sandbox::removeFile(path)) {
+                removed++;
+                freed_bytes += static_cast<uint64_t>(info.st_size);
+            }
+        }
+        Sandbox::removeDirectory(dir);
+    }
+    MetadataCache::invalidateTree(STORE_DIR);
+    FX_LOG_DEBUG("Blob store garbage collection removed " << removed << " blobs (" << freed_bytes << " bytes)");
+    return removed;
+}
+
+string BlobStore::blobPath(const string& hash) {
+    return objectsDir() + "/" + hash.substr(0, 2) + "/" + hash;
+}
+
+string BlobStore::linkInto(const string& blob, const string& resolved, bool durable) {
+    struct stat target;
+    if (Sandbox::statPath(resolved, target)) {
+        if ((target.st_mode & S_IFMT) != S_IFREG) {
+            return "Error: Cannot open file for writing: " + resolved;
+        }
+        struct stat stored;
+        if (Sandbox::statPath(blob, stored) && stored.st_ino == target.st_ino && stored.st_dev == target.st_dev) {
+            return "";
+        }
+    }
+
+    // A new link under a temp name, renamed over the target: readers see the old file or the new one
+    string temp_path = Sandbox::siblingTempPath(resolved, ".fxlink.");
+    if (!Sandbox::linkPath(blob, temp_path)) {
+        int error = errno;
+        if (error == ENOENT) {
+            return "Error: Parent directory does not exist: " + PathUtils::getParentPath(resolved);
+        }
+        if (error == EXDEV || error == ELOOP) {
+            return "Error: Invalid file path or access denied";
+        }
+        return "Error: Failed to link file: " + resolved + " (" + strerror(error) + ")";
+    }
+    if (!Sandbox::renamePath(temp_path, resolved)) {
+        Sandbox::removeFile(temp_path);
+        return "Error: Failed to write to file: " + resolved;
+    }
+    MetadataCache::invalidateTree(resolved);
+
+#ifndef _WIN32
+    if (durable) {
+        ScopedFd dir(Sandbox::openPath(PathUtils::getParentPath(resolved), O_RDONLY | O_DIRECTORY));
+        if (!dir.valid() || !GroupCommit::sync(dir.get())) {
+            return "Error: Content written but directory sync failed: " + resolved;
+        }
+    }
+#else
+    (void)durable;
+#endif
+    return "";
+}
+
+string BlobStore::storeTemp(const string& temp_path, const string& hash, string& blob) {
+    blob = blobPath(hash);
+    string fanout = PathUtils::getParentPath(blob);
+    if (!Sandbox::makeDirectory(fanout, 0755) && errno != EEXIST) {
+        Sandbox::removeFile(temp_path);
+        return "Error: Cannot write to the blob store (" + string(strerror(errno)) + ")";
+    }
+
+    // link() never replaces: of two writers storing the same new content, one name wins
+    if (!Sandbox::linkPath(temp_path, blob)) {
+        int error = errno;
+        struct stat stored;
+        struct stat fresh;
+        bool damaged = error == EEXIST && Sandbox::statPath(blob, stored) && Sandbox::statPath(temp_path, fresh) &&
+                       stored.st_size != fresh.st_size;
+        if (damaged) {
+            // Existing links keep the damaged inode; new ones get the good content
+            FX_LOG_WARN("Replacing damaged blob " << hash);
+            if (!Sandbox::renamePath(temp_path, blob)) {
+                error = errno;
+            } else {
+                MetadataCache::invalidateTree(blob);
+                return "";
+            }
+        }
+        if (error != EEXIST) {
+            Sandbox::removeFile(temp_path);
+            return "Error: Cannot write to the blob store (" + string(strerror(error)) + ")";
+        }
+    }
+    Sandbox::removeFile(temp_path);
+    MetadataCache::invalidateTree(blob);
+    return "";
+}
@@ -0,0 +1,513 @@
+#include "../include/ChecksumManager.h"
+#include "../include/FileManager.h"
+#include "../include/TreeWalker.h"
+#include "../include/PathUtils.h"
+#include "../include/PersistenceManager.h"
+#include "../include/Sandbox.h"
+#include "../include/Sha256.h"
+#include "../include/Logger.h"
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define FX_HAVE_SSE42_CRC 1
+#else
+    #define FX_HAVE_SSE42_CRC 0
+#endif
+
+using namespace std;
+
+// Static member definitions
+mutex ChecksumManager::cache_mutex;
+unordered_map<uint64_t, ChecksumManager::CacheEntry> ChecksumManager::cache;
+bool ChecksumManager::loaded = false;
+atomic<bool> ChecksumManager::dirty(false);
+
+// Start of a saved cache file
+static const char CACHE_MAGIC[8] = {'F', 'X', 'D', 'I', 'G', 'E', 'S', 'T'};
+
+// zlib takes lengths as uInt; larger buffers go in pieces of this size
+static const size_t ZLIB_CHUNK = size_t(1) << 30;
+
+static string toHex(const uint8_t* bytes, size_t length) {
+    static const char digits[] = "0123456789abcdef";
+    string hex(length * 2, '0');
+    for (size_t i = 0; i < length; ++i) {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0x0f];
+    }
+    return hex;
+}
+
+// Big-endian hex of an integer digest (how cksum-style tools print them)
+static string toHex(uint64_t value, size_t bytes) {
+    uint8_t big_endian[8];
+    for (size_t i = 0; i < bytes; ++i) {
+        big_endian[i] = static_cast<uint8_t>(value >> (8 * (bytes - 1 - i)));
+    }
+    return toHex(big_endian, bytes);
+}
+
+static bool fromHex(const string& hex, uint8_t* bytes, size_t length) {
+    if (hex.size() != length * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < hex.size(); ++i) {
+        char c = hex[i];
+        int nibble = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : -1;
+        if (nibble < 0) {
+            return false;
+        }
+        bytes[i / 2] = static_cast<uint8_t>((i % 2 == 0) ? nibble << 4 : bytes[i / 2] | nibble);
+    }
+    return true;
+}
+
+static uint64_t hexValue(const string& hex) {
+    return strtoull(hex.c_str(), nullptr, 16);
+}
+
+// ---- CRC-32 (zlib) ----
+
+static uint32_t crc32Zlib(const uint8_t* data, size_t length) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    while (length > 0) {
+        size_t piece = min(length, ZLIB_CHUNK);
+        crc = crc32(crc, data, static_cast<uInt>(piece));
+        data += piece;
+        length -= piece;
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+// ---- CRC-32C (Castagnoli) ----
+
+// Slicing-by-8 tables for CPUs without the crc32 instruction
+struct Crc32cTables {
+    uint32_t table[8][256];
+
+    Crc32cTables() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t crc = n;
+            for (int k = 0; k < 8; ++k) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+            }
+            table[0][n] = crc;
+        }
+        for (uint32_t n = 0; n < 256; ++n) {
+            for (int slice = 1; slice < 8; ++slice) {
+                table[slice][n] = (table[slice - 1][n] >> 8) ^ table[0][table[slice - 1][n] & 0xff];
+            }
+        }
+    }
+};
+
+static const Crc32cTables crc32c_tables;
+
+static uint32_t crc32cSoftware(uint32_t crc, const uint8_t* data, size_t length) {
+    const auto& t = crc32c_tables.table;
+    while (length >= 8) {
+        uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8 |
+                              static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24);
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0) {
+        crc = t[0][(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if FX_HAVE_SSE42_CRC
+__attribute__((target("sse4.2")))
+static uint32_t crc32cHardware(uint32_t crc, const uint8_t* data, size_t length) {
+    uint64_t wide = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = static_cast<uint32_t>(wide);
+    while (length-- > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+static bool detectSse42() {
+#if FX_HAVE_SSE42_CRC
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#else
+    return false;
+#endif
+}
+
+static const bool cpu_has_sse42 = detectSse42();
+
+static uint32_t crc32c(const uint8_t* data, size_t length) {
+#if FX_HAVE_SSE42_CRC
+    if (cpu_has_sse42) {
+        return ~crc32cHardware(~0u, data, length);
+    }
+#endif
+    return ~crc32cSoftware(~0u, data, length);
+}
+
+// ---- XXH64 ----
+
+static const uint64_t XXH_PRIME1 = 11400714785074694791ULL;
+static const uint64_t XXH_PRIME2 = 14029467366897019727ULL;
+static const uint64_t XXH_PRIME3 = 1609587929392839161ULL;
+static const uint64_t XXH_PRIME4 = 9650029242287828579ULL;
+static const uint64_t XXH_PRIME5 = 2870177450012600261ULL;
+
+static inline uint64_t rotl64(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// xxHash reads its input little-endian
+static inline uint64_t readLE64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+static inline uint32_t readLE32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    return rotl64(acc, 31) * XXH_PRIME1;
+}
+
+static inline uint64_t xxhMerge(uint64_t acc, uint64_t lane) {
+    acc ^= xxhRound(0, lane);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+static uint64_t xxh64(const uint8_t* data, size_t length, uint64_t seed = 0) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    uint64_t h;
+
+    if (length >= 32) {
+        // Four independent lanes per 32-byte stripe keep the multipliers busy in parallel
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint64_t v2 = seed + XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME1;
+        const uint8_t* limit = end - 32;
+        do {
+            v1 = xxhRound(v1, readLE64(p));
+            v2 = xxhRound(v2, readLE64(p + 8));
+            v3 = xxhRound(v3, readLE64(p + 16));
+            v4 = xxhRound(v4, readLE64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxhMerge(h, v1);
+        h = xxhMerge(h, v2);
+        h = xxhMerge(h, v3);
+        h = xxhMerge(h, v4);
+    } else {
+        h = seed + XXH_PRIME5;
+    }
+    h += static_cast<uint64_t>(length);
+
+    while (end - p >= 8) {
+        h ^= xxhRound(0, readLE64(p));
+        h = rotl64(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+        p += 8;
+    }
+    if (end - p >= 4) {
+        h ^= static_cast<uint64_t>(readLE32(p)) * XXH_PRIME1;
+        h = rotl64(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p++) * XXH_PRIME5;
+        h = rotl64(h, 11) * XXH_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+bool ChecksumManager::parseAlgorithm(const string& name, Algorithm& algorithm) {
+    string lower = name;
+    transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == "crc32") {
+        algorithm = Algorithm::Crc32;
+    } else if (lower == "crc32c") {
+        algorithm = Algorithm::Crc32c;
+    } else if (lower == "xxh64") {
+        algorithm = Algorithm::Xxh64;
+    } else if (lower == "sha256") {
+        algorithm = Algorithm::Sha256;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* ChecksumManager::algorithmName(Algorithm algorithm) {
+    switch (algorithm) {
+        case Algorithm::Crc32:  return "crc32";
+        case Algorithm::Crc32c: return "crc32c";
+        case Algorithm::Xxh64:  return "xxh64";
+        case Algorithm::Sha256: return "sha256";
+    }
+    return "unknown";
+}
+
+string ChecksumManager::digest(Algorithm algorithm, string_view data) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+    switch (algorithm) {
+        case Algorithm::Crc32:  return toHex(crc32Zlib(bytes, data.size()), 4);
+        case Algorithm::Crc32c: return toHex(crc32c(bytes, data.size()), 4);
+        case Algorithm::Xxh64:  return toHex(xxh64(bytes, data.size()), 8);
+        case Algorithm::Sha256: return Sha256::hash(data);
+    }
+    return "";
+}
+
+ChecksumManager::Summary ChecksumManager::checksum(const string& virtual_path, const Options& options,
+                                                   const ResultCallback& on_result) {
+    Summary summary;
+    // FileXplore's bookkeeping directories are not there as far as clients can tell
+    struct stat info;
+    if (PathUtils::isReservedPath(virtual_path) || !Sandbox::statPath(virtual_path, info)) {
+        summary.error = "Error: Path does not exist: " + virtual_path;
+        return summary;
+    }
+
+    mutex report_mutex;
+    atomic<bool> stopped(false);
+    atomic<uint64_t> cache_hits(0);
+    atomic<uint64_t> bytes_hashed(0);
+    atomic<uint64_t> errors(0);
+    uint64_t files = 0;
+
+    auto checkFile = [&](const string& path, uint64_t inode, long long size, int64_t mtime_ns) {
+        if (stopped) {
+            return;
+        }
+        Result result;
+        if (!hashFile(path, inode, size, mtime_ns, options.algorithm, result).empty()) {
+            errors++;
+            return;
+        }
+        if (result.cached) {
+            cache_hits++;
+        } else {
+            bytes_hashed += static_cast<uint64_t>(result.size);
+        }
+
+        lock_guard<mutex> lock(report_mutex);
+        if (stopped) {
+            return;
+        }
+        files++;
+        if (!on_result(result) || (options.max_files > 0 && files >= options.max_files)) {
+            stopped = true;
+        }
+    };
+
+    if ((info.st_mode & S_IFMT) == S_IFREG) {
+        checkFile(virtual_path, static_cast<uint64_t>(info.st_ino), static_cast<long long>(info.st_size),
+                  Sandbox::mtimeNanoseconds(info));
+    } else if ((info.st_mode & S_IFMT) == S_IFDIR) {
+        TreeWalker::Options walk_options;
+        walk_options.max_depth = options.recursive ? -1 : 1;
+        walk_options.threads = options.threads;
+        walk_options.filter = [&stopped](const TreeWalker::WalkEntry& entry) {
+            return !stopped && !PathUtils::isReservedPath(entry.path);
+        };
+        bool walked = TreeWalker::walk(virtual_path, walk_options, [&](const TreeWalker::WalkEntry& entry) {
+            if (entry.info.type == DirManager::EntryType::File) {
+                checkFile(entry.path, entry.info.inode, entry.info.size,
+                          static_cast<int64_t>(entry.info.mtime) * 1000000000 + entry.info.mtime_nsec);
+            }
+        });
+        if (!walked) {
+            summary.error = "Error: Cannot read directory: " + virtual_path;
+            return summary;
+        }
+    } else {
+        summary.error = "Error: Not a file or directory: " + virtual_path;
+        return summary;
+    }
+
+    summary.files = files;
+    summary.cache_hits = cache_hits;
+    summary.bytes_hashed = bytes_hashed;
+    summary.errors = errors;
+    summary.truncated = stopped;
+    FX_LOG_DEBUG("Checksum (" << algorithmName(options.algorithm) << ") of " << virtual_path << ": "
+                 << summary.files << " files, " << summary.cache_hits << " cached, " << summary.bytes_hashed
+                 << " bytes hashed");
+    save();
+    return summary;
+}
+
+bool ChecksumManager::usesCrc32cInstruction() {
+    return cpu_has_sse42;
+}
+
+void ChecksumManager::save() {
+    if (!dirty.load() || !PersistenceManager::isPersistenceAvailable()) {
+        return;
+    }
+
+    string data;
+    {
+        lock_guard<mutex> lock(cache_mutex);
+        dirty = false;
+        data = PersistenceManager::beginSidecar(CACHE_MAGIC, FORMAT_VERSION);
+        PersistenceManager::appendValue(data, static_cast<uint64_t>(cache.size()));
+        data.reserve(data.size() + cache.size() * (sizeof(uint64_t) + sizeof(CacheEntry)));
+        for (const auto& item : cache) {
+            PersistenceManager::appendValue(data, item.first);
+            PersistenceManager::appendValue(data, item.second);
+        }
+    }
+
+    string file = PersistenceManager::getDigestCacheFile();
+    if (!PersistenceManager::writeSidecar(file, data)) {
+        FX_LOG_WARN("Failed to save digest cache: " << file);
+        return;
+    }
+    FX_LOG_DEBUG("Saved digest cache: " << data.size() << " bytes");
+}
+
+void ChecksumManager::loadLocked() {
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+    if (!PersistenceManager::isPersistenceAvailable()) {
+        return;
+    }
+    string data;
+    size_t offset = 0;
+    uint64_t count = 0;
+    if (!PersistenceManager::readSidecar(PersistenceManager::getDigestCacheFile(), CACHE_MAGIC, FORMAT_VERSION,
+                                         data, offset)) {
+        return;
+    }
+    if (!PersistenceManager::readValue(data, offset, count) ||
+        (data.size() - offset) / (sizeof(uint64_t) + sizeof(CacheEntry)) < count) {
+        FX_LOG_WARN("Ignoring damaged digest cache: " << PersistenceManager::getDigestCacheFile());
+        return;
+    }
+
+    cache.reserve(static_cast<size_t>(count));
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t inode = 0;
+        CacheEntry entry{};
+        PersistenceManager::readValue(data, offset, inode);
+        PersistenceManager::readValue(data, offset, entry);
+        cache[inode] = entry;
+    }
+    FX_LOG_DEBUG("Loaded digest cache: " << cache.size() << " files");
+}
+
+bool ChecksumManager::lookup(uint64_t inode, long long size, int64_t mtime_ns, Algorithm algorithm,
+                             string& hex_digest) {
+    lock_guard<mutex> lock(cache_mutex);
+    loadLocked();
+    auto it = cache.find(inode);
+    unsigned bit = 1u << static_cast<unsigned>(algorithm);
+    if (it == cache.end() || it->second.size != size || it->second.mtime_ns != mtime_ns ||
+        !(it->second.present & bit)) {
+        return false;
+    }
+    const CacheEntry& entry = it->second;
+    switch (algorithm) {
+        case Algorithm::Crc32:  hex_digest = toHex(entry.crc32, 4); break;
+        case Algorithm::Crc32c: hex_digest = toHex(entry.crc32c, 4); break;
+        case Algorithm::Xxh64:  hex_digest = toHex(entry.xxh64, 8); break;
+        case Algorithm::Sha256: hex_digest = toHex(entry.sha256, sizeof(entry.sha256)); break;
+    }
+    return true;
+}
+
+void ChecksumManager::store(uint64_t inode, long long size, int64_t mtime_ns, Algorithm algorithm,
+                            const string& hex_digest) {
+    lock_guard<mutex> lock(cache_mutex);
+    loadLocked();
+    auto it = cache.find(inode);
+    if (it == cache.end() && cache.size() >= MAX_CACHE_ENTRIES) {
+        FX_LOG_DEBUG("Digest cache full, starting over");
+        cache.clear();
+    }
+
+    CacheEntry& entry = cache[inode];
+    if (entry.size != size || entry.mtime_ns != mtime_ns) {
+        // A new inode, or this one changed: the other digests are stale
+        entry = CacheEntry{};
+        entry.size = size;
+        entry.mtime_ns = mtime_ns;
+    }
+    switch (algorithm) {
+        case Algorithm::Crc32:  entry.crc32 = static_cast<uint32_t>(hexValue(hex_digest)); break;
+        case Algorithm::Crc32c: entry.crc32c = static_cast<uint32_t>(hexValue(hex_digest)); break;
+        case Algorithm::Xxh64:  entry.xxh64 = hexValue(hex_digest); break;
+        case Algorithm::Sha256:
+            if (!fromHex(hex_digest, entry.sha256, sizeof(entry.sha256))) {
+                return;
+            }
+            break;
+    }
+    entry.present |= static_cast<uint8_t>(1u << static_cast<unsigned>(algorithm));
+    dirty = true;
+}
+
+string ChecksumManager::hashFile(const string& virtual_path, uint64_t inode, long long size, int64_t mtime_ns,
+                                 Algorithm algorithm, Result& result) {
+    result.path = virtual_path;
+    result.size = size;
+    result.cached = inode != 0 && lookup(inode, size, mtime_ns, algorithm, result.digest);
+    if (result.cached) {
+        return "";
+    }
+
+    FileManager::MappedFile file = FileManager::mapFile(virtual_path, FileManager::AccessPattern::Sequential);
+    if (!file.isOpen()) {
+        return file.getError();
+    }
+    result.digest = digest(algorithm, file.view());
+    result.size = static_cast<long long>(file.size());
+
+    // Only remember the digest if the file did not change under us
+    struct stat after;
+    if (inode != 0 && Sandbox::statPath(virtual_path, after) && static_cast<uint64_t>(after.st_ino) == inode &&
+        static_cast<long long>(after.st_size) == size && Sandbox::mtimeNanoseconds(after) == mtime_ns &&
+        result.size == size) {
+        store(inode, size, mtime_ns, algorithm, result.digest);
+    }
+    return "";
+}
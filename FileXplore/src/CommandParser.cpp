@@ -4,16 +4,32 @@ using namespace std;
 #include "../include/FileManager.h"
 #include "../include/DirManager.h"
 #include "../include/HistoryManager.h"
+#include "../include/Session.h"
 #include "../include/SystemInfo.h"
 #include "../include/CompressionManager.h"
+#include "../include/ZipArchive.h"
+#include "../include/Logger.h"
+#include "../include/GroupCommit.h"
+#include "../include/BlobStore.h"
+#include "../include/SearchManager.h"
+#include "../include/FileIndex.h"
+#include "../include/SnapshotManager.h"
+#include "../include/ChecksumManager.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 #include <cstdlib>
+#include <iomanip>
+#include <ctime>
 
 // Static member definition
 map<string, CommandParser::CommandFunction> CommandParser::commands;
 
+// The prompt adds its own "Error: " prefix to failed results
+static string withoutErrorPrefix(const string& error) {
+    return error.substr(error.rfind("Error: ", 0) == 0 ? 7 : 0);
+}
+
 void CommandParser::initialize() {
     commands["mkdir"] = cmdMkdir;
     commands["rmdir"] = cmdRmdir;
@@ -26,16 +42,23 @@ void CommandParser::initialize() {
     commands["append"] = cmdAppend;
     commands["read"] = cmdRead;
     commands["delete"] = cmdDelete;
+    commands["grep"] = cmdGrep;
+    commands["locate"] = cmdLocate;
+    commands["checksum"] = cmdChecksum;
     commands["help"] = cmdHelp;
     commands["clear"] = cmdClear;
     commands["history"] = cmdHistory;
     commands["df"] = cmdDf;
+    commands["loglevel"] = cmdLogLevel;
+    commands["durability"] = cmdDurability;
+    commands["dedup"] = cmdDedup;
+    commands["snapshot"] = cmdSnapshot;
     commands["zip"] = cmdZip;
     commands["unzip"] = cmdUnzip;
     commands["exit"] = cmdExit;
 }
 
-CommandParser::CommandResult CommandParser::executeCommand(const string& input) {
+CommandParser::CommandResult CommandParser::executeCommand(Session& session, const string& input) {
     if (input.empty()) {
         return CommandResult(true, "");
     }
@@ -50,12 +73,12 @@ CommandParser::CommandResult CommandParser::executeCommand(const string& input)
     
     // Add command to history (except for history command itself)
     if (command != "history") {
-        HistoryManager::addCommand(input);
+        session.getHistory().addCommand(input);
     }
     
     auto it = commands.find(command);
     if (it != commands.end()) {
-        return it->second(tokens);
+        return it->second(session, tokens);
     } else {
         return CommandResult(false, "Unknown command: " + command + ". Type 'help' for available commands.");
     }
@@ -80,7 +103,7 @@ void CommandParser::displayHelp() {
     cout << "Directory Operations:" << endl;
     cout << "  mkdir <path>        - Create directory" << endl;
     cout << "  rmdir <path>        - Remove empty directory" << endl;
-    cout << "  ls [path]           - List directory contents" << endl;
+    cout << "  ls [-l] [path]      - List directory contents (-l: mode, size, mtime)" << endl;
     cout << "  tree [path]         - Display directory tree" << endl;
     cout << "  cd <path>           - Change current directory" << endl;
     cout << "  pwd                 - Show current directory" << endl;
@@ -91,14 +114,23 @@ void CommandParser::displayHelp() {
     cout << "  append <path> \"text\"- Append content to file" << endl;
     cout << "  read <path>         - Display file content" << endl;
     cout << "  delete <path>       - Delete file" << endl;
+    cout << "  grep [-rin] <pattern> [path] - Search file contents (literal or regex)" << endl;
+    cout << "  locate <text> [-n limit] - Find files and directories by name (--rebuild to reindex)" << endl;
+    cout << "  checksum [-r] <path> [--algo crc32|crc32c|xxh64|sha256] - Hash files (default sha256)" << endl;
     
     cout << endl << "Compression:" << endl;
-    cout << "  zip <output.zip> <path1> [path2] ... - Compress files/directories to zip" << endl;
-    cout << "  unzip <input.zip> [dest_dir]         - Extract zip file to directory" << endl;
+    cout << "  zip [-j threads] [--fast|--best|--store] <output.zip> <paths> - Compress files/directories to zip" << endl;
+    cout << "  unzip [-j threads] <input.zip> [entry] [dest_dir] - Extract zip file (or one entry) to directory" << endl;
+    cout << "  unzip -l <input.zip>                 - List zip entries and sizes" << endl;
     
     cout << endl << "System & Utility:" << endl;
     cout << "  df                  - Show disk usage statistics" << endl;
     cout << "  history             - Show command history" << endl;
+    cout << "  loglevel [level]    - Show or set log level (trace|debug|info|warn|error|off)" << endl;
+    cout << "  durability [mode] [window_us] - Show or set write durability (none|atomic|durable)" << endl;
+    cout << "  dedup [on|off|gc]   - Show or set deduplicated storage, or drop unused blobs" << endl;
+    cout << "  snapshot create [name] | list | diff <name> [path] | restore <name> [path] | delete <name>" << endl;
+    cout << "                      - Copy-on-write snapshots of the whole tree" << endl;
     cout << "  clear               - Clear terminal screen" << endl;
     cout << "  help                - Show this help message" << endl;
     cout << "  exit                - Exit FileXplore" << endl;
@@ -162,76 +194,110 @@ string CommandParser::extractQuotedString(const vector<string>& args, size_t sta
 }
 
 // Command implementations
-CommandParser::CommandResult CommandParser::cmdMkdir(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdMkdir(Session& session, const vector<string>& args) {
     if (args.size() < 2) {
         return CommandResult(false, "Usage: mkdir <path>");
     }
     
-    if (DirManager::createDirectory(args[1])) {
+    if (DirManager::createDirectory(session.resolvePath(args[1]))) {
         return CommandResult(true, "Directory created: " + args[1]);
     } else {
         return CommandResult(false, "Failed to create directory: " + args[1]);
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdRmdir(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdRmdir(Session& session, const vector<string>& args) {
     if (args.size() < 2) {
         return CommandResult(false, "Usage: rmdir <path>");
     }
     
-    if (DirManager::removeDirectory(args[1])) {
+    if (DirManager::removeDirectory(session.resolvePath(args[1]))) {
         return CommandResult(true, "Directory removed: " + args[1]);
     } else {
         return CommandResult(false, "Failed to remove directory: " + args[1]);
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdLs(const vector<string>& args) {
-    string path = (args.size() > 1) ? args[1] : ".";
+CommandParser::CommandResult CommandParser::cmdLs(Session& session, const vector<string>& args) {
+    bool long_format = false;
+    string path = ".";
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "-l") {
+            long_format = true;
+        } else {
+            path = args[i];
+        }
+    }
     
-    vector<string> entries = DirManager::listDirectory(path);
+    vector<DirManager::DirEntry> entries = DirManager::listDirectoryEx(session.resolvePath(path));
     if (entries.empty()) {
         return CommandResult(true, "Directory is empty or does not exist.");
     }
     
     cout << "Contents of " << path << ":" << endl;
     for (const auto& entry : entries) {
-        cout << "  " << entry << endl;
+        if (!long_format) {
+            cout << "  " << entry.name << endl;
+            continue;
+        }
+        
+        char type_char = '-';
+        if (entry.type == DirManager::EntryType::Directory) {
+            type_char = 'd';
+        } else if (entry.type == DirManager::EntryType::Symlink) {
+            type_char = 'l';
+        } else if (entry.type == DirManager::EntryType::Other) {
+            type_char = '?';
+        }
+        
+        char modified[32];
+        std::tm local_tm;
+#ifdef _WIN32
+        localtime_s(&local_tm, &entry.mtime);
+#else
+        localtime_r(&entry.mtime, &local_tm);
+#endif
+        strftime(modified, sizeof(modified), "%Y-%m-%d %H:%M", &local_tm);
+        
+        cout << "  " << type_char << DirManager::formatPermissions(entry.mode)
+             << " " << setw(10) << entry.size
+             << " " << modified
+             << " " << entry.name << endl;
     }
     
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdTree(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdTree(Session& session, const vector<string>& args) {
     string path = (args.size() > 1) ? args[1] : ".";
     
-    DirManager::displayTree(path);
+    DirManager::displayTree(session.resolvePath(path));
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdCd(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdCd(Session& session, const vector<string>& args) {
     if (args.size() < 2) {
         return CommandResult(false, "Usage: cd <path>");
     }
     
-    if (DirManager::changeDirectory(args[1])) {
+    if (DirManager::changeDirectory(session, args[1])) {
         return CommandResult(true, "Changed directory to: " + args[1]);
     } else {
         return CommandResult(false, "Failed to change directory to: " + args[1]);
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdPwd(const vector<string>& args) {
-    cout << DirManager::getCurrentDirectory() << endl;
+CommandParser::CommandResult CommandParser::cmdPwd(Session& session, [[maybe_unused]] const vector<string>& args) {
+    cout << DirManager::getCurrentDirectory(session) << endl;
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdCreate(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdCreate(Session& session, const vector<string>& args) {
     if (args.size() < 2) {
         return CommandResult(false, "Usage: create <path>");
     }
     
-    string result = FileManager::createFile(args[1]);
+    string result = FileManager::createFile(session.resolvePath(args[1]));
     if (result.find("Error:") == 0) {
         return CommandResult(false, result);
     } else {
@@ -239,14 +305,14 @@ CommandParser::CommandResult CommandParser::cmdCreate(const vector<string>& args
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdWrite(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdWrite(Session& session, const vector<string>& args) {
     if (args.size() < 3) {
         return CommandResult(false, "Usage: write <path> \"content\"");
     }
     
     string content = extractQuotedString(args, 2);
     
-    string result = FileManager::writeFile(args[1], content);
+    string result = FileManager::writeFile(session.resolvePath(args[1]), content);
     if (result.find("Error:") == 0) {
         return CommandResult(false, result);
     } else {
@@ -254,13 +320,13 @@ CommandParser::CommandResult CommandParser::cmdWrite(const vector<string>& args)
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdAppend(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdAppend(Session& session, const vector<string>& args) {
     if (args.size() < 3) {
         return CommandResult(false, "Usage: append <path> <content>");
     }
     
     string content = extractQuotedString(args, 2);
-    string result = FileManager::appendFile(args[1], content);
+    string result = FileManager::appendFile(session.resolvePath(args[1]), content);
     if (result.find("Error:") == 0) {
         return CommandResult(false, result);
     } else {
@@ -268,16 +334,19 @@ CommandParser::CommandResult CommandParser::cmdAppend(const vector<string>& args
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdRead(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdRead(Session& session, const vector<string>& args) {
     if (args.size() < 2) {
         return CommandResult(false, "Usage: read <path>");
     }
     
-    string content = FileManager::readFile(args[1]);
-    if (!content.empty() || FileManager::fileExists(args[1])) {
+    string path = session.resolvePath(args[1]);
+    // Written straight from the mapping, no copy of the contents
+    FileManager::MappedFile file = FileManager::mapFile(path);
+    if (file.isOpen()) {
         cout << "Content of " << args[1] << ":" << endl;
         cout << string(50, '-') << endl;
-        cout << content << endl;
+        cout.write(file.data(), static_cast<std::streamsize>(file.size()));
+        cout << endl;
         cout << string(50, '-') << endl;
         return CommandResult(true, "");
     } else {
@@ -285,12 +354,12 @@ CommandParser::CommandResult CommandParser::cmdRead(const vector<string>& args)
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdDelete(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdDelete(Session& session, const vector<string>& args) {
     if (args.size() < 2) {
         return CommandResult(false, "Usage: delete <path>");
     }
     
-    string result = FileManager::deleteFile(args[1]);
+    string result = FileManager::deleteFile(session.resolvePath(args[1]));
     if (result.find("Error:") == 0) {
         return CommandResult(false, result);
     } else {
@@ -298,12 +367,12 @@ CommandParser::CommandResult CommandParser::cmdDelete(const vector<string>& args
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdHelp(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdHelp([[maybe_unused]] Session& session, [[maybe_unused]] const vector<string>& args) {
     displayHelp();
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdClear(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdClear([[maybe_unused]] Session& session, [[maybe_unused]] const vector<string>& args) {
 #ifdef _WIN32
     system("cls");
 #else
@@ -312,54 +381,438 @@ CommandParser::CommandResult CommandParser::cmdClear(const vector<string>& args)
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdHistory(const vector<string>& args) {
-    HistoryManager::displayHistory();
+CommandParser::CommandResult CommandParser::cmdHistory(Session& session, [[maybe_unused]] const vector<string>& args) {
+    session.getHistory().displayHistory();
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdDf(const vector<string>& args) {
-    SystemInfo::displayDiskUsage();
+CommandParser::CommandResult CommandParser::cmdDf(Session& session, [[maybe_unused]] const vector<string>& args) {
+    SystemInfo::displayDiskUsage(session);
     return CommandResult(true, "");
 }
 
-CommandParser::CommandResult CommandParser::cmdZip(const vector<string>& args) {
-    if (args.size() < 3) {
-        return CommandResult(false, "Usage: zip <output.zip> <path1> [path2] ...");
+CommandParser::CommandResult CommandParser::cmdLogLevel([[maybe_unused]] Session& session, const vector<string>& args) {
+    string compiled = Logger::levelName(Logger::getCompiledLevel());
+    if (args.size() < 2) {
+        return CommandResult(true, "Log level: " + Logger::levelName(Logger::getLevel()) +
+                                   " (compiled minimum: " + compiled + ")");
     }
     
-    string zipPath = args[1];
-    vector<string> pathsToZip;
-    for (size_t i = 2; i < args.size(); ++i) {
-        pathsToZip.push_back(args[i]);
+    LogLevel level;
+    if (!Logger::parseLevel(args[1], level)) {
+        return CommandResult(false, "Usage: loglevel [trace|debug|info|warn|error|off]");
+    }
+    Logger::setLevel(level);
+    
+    string message = "Log level set to: " + Logger::levelName(level);
+    if (level < Logger::getCompiledLevel()) {
+        message += " (messages below " + compiled + " are compiled out of this build)";
+    }
+    return CommandResult(true, message);
+}
+
+CommandParser::CommandResult CommandParser::cmdDurability([[maybe_unused]] Session& session, const vector<string>& args) {
+    if (args.size() > 3) {
+        return CommandResult(false, "Usage: durability [none|atomic|durable] [window_us]");
+    }
+    
+    if (args.size() > 1) {
+        FileManager::Durability durability;
+        if (!FileManager::parseDurability(args[1], durability)) {
+            return CommandResult(false, "Usage: durability [none|atomic|durable] [window_us]");
+        }
+        if (args.size() > 2) {
+            char* end = nullptr;
+            long long window = strtoll(args[2].c_str(), &end, 10);
+            if (args[2].empty() || *end != '\0' || window < 0) {
+                return CommandResult(false, "Error: Invalid group commit window: " + args[2]);
+            }
+            GroupCommit::setWindow(chrono::microseconds(window));
+        }
+        FileManager::setDefaultDurability(durability);
+    }
+    
+    GroupCommit::Stats stats = GroupCommit::getStats();
+    ostringstream message;
+    message << "Write durability: " << FileManager::durabilityName(FileManager::getDefaultDurability())
+            << " (group commit window " << GroupCommit::getWindow().count() << "us, "
+            << stats.requests << " syncs in " << stats.flushes << " flushes)";
+    return CommandResult(true, message.str());
+}
+
+CommandParser::CommandResult CommandParser::cmdGrep(Session& session, const vector<string>& args) {
+    const string usage = "Usage: grep [-r] [-i] [-n] [--] <pattern> [path]";
+    SearchManager::Options options;
+    bool line_numbers = false;
+    vector<string> operands;
+    bool flags_done = false;
+    for (size_t i = 1; i < args.size(); ++i) {
+        const string& arg = args[i];
+        // Flags may be combined (-rn); after "--" a leading '-' belongs to the pattern
+        if (!flags_done && arg == "--") {
+            flags_done = true;
+        } else if (!flags_done && arg.size() > 1 && arg[0] == '-' &&
+                   arg.find_first_not_of("rin", 1) == string::npos) {
+            options.recursive = options.recursive || arg.find('r') != string::npos;
+            options.ignore_case = options.ignore_case || arg.find('i') != string::npos;
+            line_numbers = line_numbers || arg.find('n') != string::npos;
+        } else {
+            operands.push_back(arg);
+        }
+    }
+    if (operands.empty() || operands.size() > 2) {
+        return CommandResult(false, usage);
+    }
+    options.pattern = operands[0];
+    string path = session.resolvePath(operands.size() > 1 ? operands[1] : ".");
+    
+    // Matches are printed as the workers find them; file order is not defined
+    bool show_path = PathUtils::isDirectory(path);
+    SearchManager::Summary summary = SearchManager::search(path, options, [&](const SearchManager::Match& match) {
+        if (show_path) {
+            cout << match.path << ":";
+        }
+        if (line_numbers) {
+            cout << match.line_number << ":";
+        }
+        cout << match.line << "\n";
+        return true;
+    });
+    cout.flush();
+    if (!summary.error.empty()) {
+        return CommandResult(false, withoutErrorPrefix(summary.error));
+    }
+    
+    ostringstream message;
+    message << summary.matches << " matching lines in " << summary.files_matched << " of "
+            << summary.files_scanned << " files (" << SystemInfo::formatBytes(summary.bytes_scanned) << " scanned";
+    if (summary.binary_skipped > 0) {
+        message << ", " << summary.binary_skipped << " binary skipped";
+    }
+    if (summary.long_lines_skipped > 0) {
+        message << ", " << summary.long_lines_skipped << " lines too long for a regex";
+    }
+    message << ")";
+    return CommandResult(true, message.str());
+}
+
+CommandParser::CommandResult CommandParser::cmdLocate([[maybe_unused]] Session& session, const vector<string>& args) {
+    const string usage = "Usage: locate <text> [-n limit] | locate --rebuild";
+    if (args.size() == 2 && args[1] == "--rebuild") {
+        FileIndex::rebuild();
+        return CommandResult(true, "Rebuilding the file index in the background");
+    }
+    
+    string query;
+    size_t limit = 50;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "-n" && i + 1 < args.size()) {
+            limit = static_cast<size_t>(strtoull(args[++i].c_str(), nullptr, 10));
+        } else if (query.empty()) {
+            query = args[i];
+        } else {
+            return CommandResult(false, usage);
+        }
+    }
+    if (query.empty() || limit == 0) {
+        return CommandResult(false, usage);
+    }
+    
+    FileIndex::Stats stats = FileIndex::getStats();
+    if (!stats.ready) {
+        return CommandResult(false, "The file index is still being built; try again shortly");
+    }
+    
+    vector<FileIndex::Result> results;
+    size_t total = FileIndex::locate(query, limit, results);
+    for (const auto& result : results) {
+        cout << result.path << (result.is_directory ? "/" : "") << "\n";
+    }
+    
+    ostringstream message;
+    message << (results.size() < total ? "Showing " + to_string(results.size()) + " of " : "") << total
+            << " matches among " << stats.entries << " indexed paths" << (stats.building ? " (refreshing)" : "");
+    return CommandResult(true, message.str());
+}
+
+CommandParser::CommandResult CommandParser::cmdChecksum(Session& session, const vector<string>& args) {
+    const string usage = "Usage: checksum [-r] <path> [--algo crc32|crc32c|xxh64|sha256]";
+    ChecksumManager::Options options;
+    string target;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (args[i] == "-r") {
+            options.recursive = true;
+        } else if (args[i] == "--algo" && i + 1 < args.size()) {
+            if (!ChecksumManager::parseAlgorithm(args[++i], options.algorithm)) {
+                return CommandResult(false, usage);
+            }
+        } else if (target.empty()) {
+            target = args[i];
+        } else {
+            return CommandResult(false, usage);
+        }
+    }
+    if (target.empty()) {
+        return CommandResult(false, usage);
     }
     
-    if (CompressionManager::compressToZip(zipPath, pathsToZip)) {
-        return CommandResult(true, "Files compressed to: " + zipPath);
+    // Workers finish in any order; print like sha256sum, sorted by path
+    vector<ChecksumManager::Result> results;
+    string path = session.resolvePath(target);
+    ChecksumManager::Summary summary = ChecksumManager::checksum(path, options,
+        [&results](const ChecksumManager::Result& result) {
+            results.push_back(result);
+            return true;
+        });
+    if (!summary.error.empty()) {
+        return CommandResult(false, withoutErrorPrefix(summary.error));
+    }
+    sort(results.begin(), results.end(), [](const ChecksumManager::Result& a, const ChecksumManager::Result& b) {
+        return a.path < b.path;
+    });
+    for (const auto& result : results) {
+        cout << result.digest << "  " << result.path << "\n";
+    }
+    cout.flush();
+    
+    ostringstream message;
+    message << summary.files << " files (" << ChecksumManager::algorithmName(options.algorithm) << "): "
+            << summary.cache_hits << " cached, " << SystemInfo::formatBytes(summary.bytes_hashed) << " hashed";
+    if (summary.errors > 0) {
+        message << ", " << summary.errors << " unreadable";
+    }
+    return CommandResult(true, message.str());
+}
+
+CommandParser::CommandResult CommandParser::cmdDedup([[maybe_unused]] Session& session, const vector<string>& args) {
+    if (args.size() > 2) {
+        return CommandResult(false, "Usage: dedup [on|off|gc]");
+    }
+    
+    ostringstream message;
+    if (args.size() > 1) {
+        string action = args[1];
+        transform(action.begin(), action.end(), action.begin(), ::tolower);
+        if (action == "on" || action == "off") {
+            string error = BlobStore::setEnabled(action == "on");
+            if (!error.empty()) {
+                return CommandResult(false, error);
+            }
+        } else if (action == "gc") {
+            uint64_t freed = 0;
+            size_t removed = BlobStore::collectGarbage(freed);
+            message << "Removed " << removed << " unused blobs (" << SystemInfo::formatBytes(freed) << ")" << endl;
+        } else {
+            return CommandResult(false, "Usage: dedup [on|off|gc]");
+        }
+    }
+    
+    BlobStore::Stats stats = BlobStore::getStats();
+    uint64_t saved = stats.logical_bytes > stats.stored_bytes ? stats.logical_bytes - stats.stored_bytes : 0;
+    message << "Deduplicated storage: " << (BlobStore::isEnabled() ? "on" : "off") << endl
+            << "  Blobs:      " << stats.blobs << " (" << SystemInfo::formatBytes(stats.stored_bytes) << ")" << endl
+            << "  References: " << stats.references << " files (" << SystemInfo::formatBytes(stats.logical_bytes)
+            << ", " << SystemInfo::formatBytes(saved) << " saved)" << endl
+            << "  This run:   " << stats.hits << " writes linked, " << stats.misses << " stored";
+    return CommandResult(true, message.str());
+}
+
+CommandParser::CommandResult CommandParser::cmdSnapshot(Session& session, const vector<string>& args) {
+    const string usage =
+        "Usage: snapshot create [name] | list | diff <name> [path] | restore <name> [path] | delete <name>";
+    if (args.size() < 2) {
+        return CommandResult(false, usage);
+    }
+    string action = args[1];
+    transform(action.begin(), action.end(), action.begin(), ::tolower);
+    
+    if (action == "create" && args.size() <= 3) {
+        SnapshotManager::Info info;
+        string error = SnapshotManager::create(args.size() > 2 ? args[2] : "", info);
+        if (!error.empty()) {
+            return CommandResult(false, withoutErrorPrefix(error));
+        }
+        return CommandResult(true, "Snapshot " + info.name + " created: " + to_string(info.files) + " files, " +
+                                   to_string(info.directories) + " directories (" +
+                                   SystemInfo::formatBytes(info.bytes) + ")");
+    }
+    
+    if (action == "list" && args.size() == 2) {
+        vector<SnapshotManager::Info> snapshots;
+        SnapshotManager::list(snapshots);
+        if (snapshots.empty()) {
+            return CommandResult(true, "No snapshots");
+        }
+        ostringstream message;
+        for (size_t i = 0; i < snapshots.size(); ++i) {
+            const auto& info = snapshots[i];
+            char created[32];
+            std::tm local_tm;
+#ifdef _WIN32
+            localtime_s(&local_tm, &info.created);
+#else
+            localtime_r(&info.created, &local_tm);
+#endif
+            strftime(created, sizeof(created), "%Y-%m-%d %H:%M:%S", &local_tm);
+            message << left << setw(24) << info.name << created << "  " << info.files << " files, "
+                    << info.directories << " directories, " << SystemInfo::formatBytes(info.bytes)
+                    << (i + 1 < snapshots.size() ? "\n" : "");
+        }
+        return CommandResult(true, message.str());
+    }
+    
+    if ((action == "diff" || action == "restore") && (args.size() == 3 || args.size() == 4)) {
+        string path = session.resolvePath(args.size() > 3 ? args[3] : "/");
+        if (action == "diff") {
+            vector<SnapshotManager::Change> changes;
+            string error = SnapshotManager::diff(args[2], path, changes);
+            if (!error.empty()) {
+                return CommandResult(false, withoutErrorPrefix(error));
+            }
+            for (const auto& change : changes) {
+                cout << change.kind << " " << change.path << "\n";
+            }
+            return CommandResult(true, to_string(changes.size()) + " changes since snapshot " + args[2]);
+        }
+        
+        SnapshotManager::RestoreStats stats;
+        string error = SnapshotManager::restore(args[2], path, stats);
+        if (!error.empty()) {
+            return CommandResult(false, withoutErrorPrefix(error));
+        }
+        return CommandResult(true, "Restored " + path + " from snapshot " + args[2] + ": " +
+                                   to_string(stats.restored) + " files restored, " + to_string(stats.unchanged) +
+                                   " unchanged, " + to_string(stats.removed) + " removed, " +
+                                   to_string(stats.directories) + " directories recreated");
+    }
+    
+    if (action == "delete" && args.size() == 3) {
+        string error = SnapshotManager::remove(args[2]);
+        if (!error.empty()) {
+            return CommandResult(false, withoutErrorPrefix(error));
+        }
+        return CommandResult(true, "Snapshot deleted: " + args[2]);
+    }
+    return CommandResult(false, usage);
+}
+
+CommandParser::CommandResult CommandParser::cmdZip(Session& session, const vector<string>& args) {
+    const string usage = "Usage: zip [-j threads] [--fast|--best|--store] <output.zip> <path1> [path2] ...";
+    CompressionManager::Options options;
+    size_t first = 1;
+    while (first < args.size()) {
+        if (args[first] == "-j" && first + 1 < args.size()) {
+            char* end = nullptr;
+            long long threads = strtoll(args[first + 1].c_str(), &end, 10);
+            if (args[first + 1].empty() || *end != '\0' || threads < 1) {
+                return CommandResult(false, "Invalid thread count: " + args[first + 1]);
+            }
+            options.threads = static_cast<size_t>(threads);
+            first += 2;
+        } else if (args[first] == "--fast") {
+            options.profile = CompressionManager::Profile::Fast;
+            first++;
+        } else if (args[first] == "--best") {
+            options.profile = CompressionManager::Profile::Best;
+            first++;
+        } else if (args[first] == "--store") {
+            options.profile = CompressionManager::Profile::Store;
+            first++;
+        } else if (args[first].rfind("--", 0) == 0) {
+            return CommandResult(false, usage);
+        } else {
+            break;
+        }
+    }
+    if (args.size() < first + 2) {
+        return CommandResult(false, usage);
+    }
+    
+    string zipPath = args[first];
+    vector<string> pathsToZip;
+    for (size_t i = first + 1; i < args.size(); ++i) {
+        pathsToZip.push_back(session.resolvePath(args[i]));
+    }
+    
+    CompressionManager::PackStats stats;
+    if (CompressionManager::compressToZip(session.resolvePath(zipPath), pathsToZip, options, stats)) {
+        ostringstream report;
+        report << fixed << setprecision(1) << "Files compressed to: " << zipPath << " (" << stats.entries
+               << " entries, " << stats.stored << " stored; " << stats.bytes_in / 1e6 << " MB -> "
+               << stats.bytes_out / 1e6 << " MB";
+        if (stats.saved_cpu_ns > 0) {
+            report << "; storing " << stats.stored_bytes / 1e6 << " MB saved ~" << setprecision(2)
+                   << stats.saved_cpu_ns / 1e9 << " s CPU";
+        }
+        report << ")";
+        return CommandResult(true, report.str());
     } else {
         return CommandResult(false, "Failed to create zip file: " + zipPath);
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdUnzip(const vector<string>& args) {
-    if (args.size() < 2) {
-        return CommandResult(false, "Usage: unzip <input.zip> [dest_dir]");
+CommandParser::CommandResult CommandParser::cmdUnzip(Session& session, const vector<string>& args) {
+    const string usage = "Usage: unzip [-j threads] <input.zip> [entry] [dest_dir] | unzip -l <input.zip>";
+    bool listOnly = args.size() > 1 && args[1] == "-l";
+    size_t first = listOnly ? 2 : 1;
+    CompressionManager::Options options;
+    if (args.size() > 2 && args[1] == "-j") {
+        char* end = nullptr;
+        long long threads = strtoll(args[2].c_str(), &end, 10);
+        if (args[2].empty() || *end != '\0' || threads < 1) {
+            return CommandResult(false, "Invalid thread count: " + args[2]);
+        }
+        options.threads = static_cast<size_t>(threads);
+        first = 3;
+    }
+    if (args.size() < first + 1 || args.size() > first + 3 || (listOnly && args.size() > first + 1)) {
+        return CommandResult(false, usage);
     }
     
-    string zipPath = args[1];
-    string destDir = (args.size() > 2) ? args[2] : ".";
+    string zipPath = session.resolvePath(args[first]);
     
     if (!CompressionManager::isZipFile(zipPath)) {
         return CommandResult(false, "Error: Not a valid zip file: " + zipPath);
     }
     
-    if (CompressionManager::decompressFromZip(zipPath, destDir)) {
+    // Listing reads only the central directory
+    string error;
+    shared_ptr<const ZipArchive> archive = ZipArchive::open(zipPath, error);
+    if (!archive) {
+        return CommandResult(false, withoutErrorPrefix(error));
+    }
+    if (listOnly) {
+        unsigned long long total = 0;
+        for (const auto& entry : archive->entries()) {
+            cout << setw(12) << entry.uncompressed_size << "  " << entry.name << "\n";
+            total += entry.uncompressed_size;
+        }
+        return CommandResult(true, to_string(archive->entries().size()) + " entries, " + to_string(total) +
+                                   " bytes");
+    }
+    
+    // A second argument naming an entry extracts just that entry; otherwise it is the destination
+    const ZipArchive::Entry* entry = (args.size() > first + 1) ? archive->find(args[first + 1]) : nullptr;
+    if (args.size() == first + 3 && !entry) {
+        return CommandResult(false, "No such entry in archive: " + args[first + 1]);
+    }
+    size_t destArg = entry ? first + 2 : first + 1;
+    string destDir = session.resolvePath((args.size() > destArg) ? args[destArg] : ".");
+    
+    if (entry) {
+        if (CompressionManager::extractFromZip(zipPath, entry->name, destDir)) {
+            return CommandResult(true, "Extracted " + entry->name + " to: " + destDir);
+        }
+        return CommandResult(false, "Failed to extract " + entry->name + " from: " + zipPath);
+    }
+    if (CompressionManager::decompressFromZip(zipPath, destDir, options)) {
         return CommandResult(true, "Zip file extracted to: " + destDir);
     } else {
         return CommandResult(false, "Failed to extract zip file: " + zipPath);
     }
 }
 
-CommandParser::CommandResult CommandParser::cmdExit(const vector<string>& args) {
+CommandParser::CommandResult CommandParser::cmdExit([[maybe_unused]] Session& session, [[maybe_unused]] const vector<string>& args) {
     cout << "Goodbye! Exiting FileXplore..." << endl;
     return CommandResult(true, "EXIT");
 }
\ No newline at end of file
@@ -2,18 +2,37 @@
 #include "../include/PathUtils.h"
 #include "../include/FileManager.h"
 #include "../include/DirManager.h"
+#include "../include/MetadataCache.h"
+#include "../include/FileIndex.h"
+#include "../include/TreeWalker.h"
+#include "../include/Sandbox.h"
+#include "../include/ZipArchive.h"
+#include "../include/Logger.h"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <algorithm>
 #include <cstdint>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <cerrno>
+#include <fcntl.h>
 
 #ifdef _WIN32
     #include <windows.h>
     #include <direct.h>
+    #include <io.h>
     #define PATH_SEPARATOR '\\'
     #define mkdir(path, mode) _mkdir(path)
 #else
@@ -36,6 +55,36 @@
 using namespace std;
 namespace fs = std::filesystem;
 
+// Large files are split into blocks of this size, deflated in parallel (pigz-style)
+static const size_t PACK_BLOCK = 1024 * 1024;
+
+// Each block is primed with this much of the input before it, so splitting costs no ratio
+static const size_t PACK_DICTIONARY = 32 * 1024;
+
+// Blocks compressed ahead of the writer, per worker; bounds the memory of a run
+static const size_t PACK_AHEAD_PER_WORKER = 4;
+
+// Entries are classified from a sample of this many bytes from their start
+static const size_t POLICY_SAMPLE = 64 * 1024;
+
+// A sample with at least this much byte entropy (bits per byte) is taken as incompressible
+static const double STORE_ENTROPY = 7.5;
+
+// Auto profile size classes: small entries deflate at level 9 (one block, cheap either way),
+// large ones at level 4, where CPU time adds up; the rest at zlib's default
+static const uint64_t SMALL_ENTRY = 1024 * 1024;
+static const uint64_t LARGE_ENTRY = 64 * 1024 * 1024;
+
+// Formats that are compressed already; storing them costs no ratio
+static const char* const COMPRESSED_EXTENSIONS[] = {
+    "jpg", "jpeg", "png", "gif", "webp", "heic", "zip", "gz", "tgz", "bz2", "xz", "zst", "7z", "rar",
+    "jar", "apk", "docx", "xlsx", "pptx", "odt", "epub", "mp3", "mp4", "m4a", "mkv", "mov", "avi",
+    "webm", "ogg", "flac"
+};
+
+// Entries are extracted through a buffer of this size
+static const size_t EXTRACT_BUFFER = 256 * 1024;
+
 // Simple ZIP file structure (without minizip)
 struct ZipLocalFileHeader {
     uint32_t signature;      // 0x04034b50
@@ -71,6 +120,23 @@ struct ZipCentralDirHeader {
     uint32_t localHeaderOffset;
 };
 
+// An entry as the central directory describes it, with ZIP64 values at full width
+struct ZipEntryRecord {
+    string name;
+    uint16_t compression;
+    uint32_t crc32;
+    uint64_t compressedSize;
+    uint64_t uncompressedSize;
+    uint64_t localHeaderOffset;
+};
+
+// Header fields at these values defer to the ZIP64 extra field or end records
+static const uint32_t ZIP64_MARKER_32 = 0xFFFFFFFF;
+static const uint16_t ZIP64_MARKER_16 = 0xFFFF;
+static const uint16_t ZIP64_EXTRA_TAG = 0x0001;
+static const uint16_t ZIP_VERSION = 20;
+static const uint16_t ZIP64_VERSION = 45;
+
 static void writeUint16(ofstream& file, uint16_t value) {
     file.write(reinterpret_cast<const char*>(&value), 2);
 }
@@ -79,90 +145,543 @@ static void writeUint32(ofstream& file, uint32_t value) {
     file.write(reinterpret_cast<const char*>(&value), 4);
 }
 
-static uint16_t readUint16(ifstream& file) {
-    uint16_t value;
-    file.read(reinterpret_cast<char*>(&value), 2);
-    return value;
+static void writeUint64(ofstream& file, uint64_t value) {
+    file.write(reinterpret_cast<const char*>(&value), 8);
 }
 
-static uint32_t readUint32(ifstream& file) {
-    uint32_t value;
-    file.read(reinterpret_cast<char*>(&value), 4);
-    return value;
+// Write a local file header; crc and sizes may be placeholders patched later
+static void writeLocalHeader(ofstream& file, const ZipLocalFileHeader& header, const string& filename) {
+    writeUint32(file, header.signature);
+    writeUint16(file, header.version);
+    writeUint16(file, header.flags);
+    writeUint16(file, header.compression);
+    writeUint16(file, header.modTime);
+    writeUint16(file, header.modDate);
+    writeUint32(file, header.crc32);
+    writeUint32(file, header.compressedSize);
+    writeUint32(file, header.uncompressedSize);
+    writeUint16(file, header.filenameLength);
+    writeUint16(file, header.extraFieldLength);
+    file.write(filename.c_str(), filename.length());
 }
 
-static uint32_t calculateCRC32(const string& data) {
-    uLong crc = crc32(0L, Z_NULL, 0);
-    crc = crc32(crc, reinterpret_cast<const Bytef*>(data.c_str()), static_cast<uInt>(data.length()));
-    return static_cast<uint32_t>(crc);
+// Write a central directory header; values past 32 bits go into a ZIP64 extra field,
+// which holds only the overflowing ones, in this order
+static void writeCentralHeader(ofstream& file, const ZipEntryRecord& entry) {
+    vector<uint64_t> wide;
+    if (entry.uncompressedSize >= ZIP64_MARKER_32) wide.push_back(entry.uncompressedSize);
+    if (entry.compressedSize >= ZIP64_MARKER_32) wide.push_back(entry.compressedSize);
+    if (entry.localHeaderOffset >= ZIP64_MARKER_32) wide.push_back(entry.localHeaderOffset);
+    
+    ZipCentralDirHeader header;
+    header.signature = 0x02014b50;
+    header.versionMadeBy = wide.empty() ? ZIP_VERSION : ZIP64_VERSION;
+    header.versionNeeded = header.versionMadeBy;
+    header.flags = 0;
+    header.compression = entry.compression;
+    header.modTime = 0;
+    header.modDate = 0;
+    header.crc32 = entry.crc32;
+    header.compressedSize = static_cast<uint32_t>(min<uint64_t>(entry.compressedSize, ZIP64_MARKER_32));
+    header.uncompressedSize = static_cast<uint32_t>(min<uint64_t>(entry.uncompressedSize, ZIP64_MARKER_32));
+    header.filenameLength = entry.name.length();
+    header.extraFieldLength = wide.empty() ? 0 : static_cast<uint16_t>(4 + 8 * wide.size());
+    header.commentLength = 0;
+    header.diskNumber = 0;
+    header.internalAttribs = 0;
+    header.externalAttribs = 0;
+    header.localHeaderOffset = static_cast<uint32_t>(min<uint64_t>(entry.localHeaderOffset, ZIP64_MARKER_32));
+    
+    writeUint32(file, header.signature);
+    writeUint16(file, header.versionMadeBy);
+    writeUint16(file, header.versionNeeded);
+    writeUint16(file, header.flags);
+    writeUint16(file, header.compression);
+    writeUint16(file, header.modTime);
+    writeUint16(file, header.modDate);
+    writeUint32(file, header.crc32);
+    writeUint32(file, header.compressedSize);
+    writeUint32(file, header.uncompressedSize);
+    writeUint16(file, header.filenameLength);
+    writeUint16(file, header.extraFieldLength);
+    writeUint16(file, header.commentLength);
+    writeUint16(file, header.diskNumber);
+    writeUint16(file, header.internalAttribs);
+    writeUint32(file, header.externalAttribs);
+    writeUint32(file, header.localHeaderOffset);
+    file.write(entry.name.c_str(), entry.name.length());
+    if (!wide.empty()) {
+        writeUint16(file, ZIP64_EXTRA_TAG);
+        writeUint16(file, static_cast<uint16_t>(8 * wide.size()));
+        for (uint64_t value : wide) {
+            writeUint64(file, value);
+        }
+    }
 }
 
-static string compressData(const string& data) {
-    if (data.empty()) {
-        return "";
+// Write the end records; the ZIP64 ones come first when a count, size or offset overflows
+static void writeEndOfCentralDirectory(ofstream& file, uint64_t entries, uint64_t centralDirOffset,
+                                       uint64_t centralDirSize) {
+    bool zip64 = entries >= ZIP64_MARKER_16 || centralDirOffset >= ZIP64_MARKER_32 ||
+                 centralDirSize >= ZIP64_MARKER_32;
+    if (zip64) {
+        uint64_t recordOffset = static_cast<uint64_t>(file.tellp());
+        writeUint32(file, 0x06064b50);  // ZIP64 EOCD signature
+        writeUint64(file, 44);  // size of the rest of the record
+        writeUint16(file, ZIP64_VERSION);  // version made by
+        writeUint16(file, ZIP64_VERSION);  // version needed
+        writeUint32(file, 0);  // disk number
+        writeUint32(file, 0);  // disk with central dir
+        writeUint64(file, entries);  // entries in this disk
+        writeUint64(file, entries);  // total entries
+        writeUint64(file, centralDirSize);
+        writeUint64(file, centralDirOffset);
+        
+        writeUint32(file, 0x07064b50);  // ZIP64 EOCD locator signature
+        writeUint32(file, 0);  // disk with the ZIP64 EOCD
+        writeUint64(file, recordOffset);
+        writeUint32(file, 1);  // total disks
     }
     
+    writeUint32(file, 0x06054b50);  // EOCD signature
+    writeUint16(file, 0);  // disk number
+    writeUint16(file, 0);  // disk with central dir
+    writeUint16(file, static_cast<uint16_t>(min<uint64_t>(entries, ZIP64_MARKER_16)));  // entries in this disk
+    writeUint16(file, static_cast<uint16_t>(min<uint64_t>(entries, ZIP64_MARKER_16)));  // total entries
+    writeUint32(file, static_cast<uint32_t>(min<uint64_t>(centralDirSize, ZIP64_MARKER_32)));  // central dir size
+    writeUint32(file, static_cast<uint32_t>(min<uint64_t>(centralDirOffset, ZIP64_MARKER_32)));  // central dir offset
+    writeUint16(file, 0);  // comment length
+}
+
+// One file to pack and the blocks it was split into
+struct PackSource {
+    string name;             // Entry name in the archive
+    string path;             // Normalized virtual path
+    uint64_t size;           // Size when listed
+    size_t first_block;      // Index of its first block in the run
+    size_t blocks;
+};
+
+// How one entry is packed
+struct PackPolicy {
+    uint16_t method = 8;     // 0 = stored, 8 = deflate
+    int level = Z_DEFAULT_COMPRESSION;
+};
+
+// A compressed block, ready for the writer
+struct PackBlock {
+    string data;             // Raw deflate output ending byte-aligned, or the input if stored
+    uint32_t crc = 0;
+    uint64_t length = 0;     // Input bytes
+    uint16_t method = 8;
+    uint64_t cpu_ns = 0;     // CPU time deflating it
+    bool failed = false;
+    bool ready = false;
+};
+
+// CPU time of the calling thread, for the packing report
+static uint64_t threadCpuNanoseconds() {
+#ifdef _WIN32
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count());
+#else
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+#endif
+}
+
+// Read up to length bytes at offset; the count read, or -1
+static long long readAt(int fd, char* data, size_t length, uint64_t offset) {
+#ifdef _WIN32
+    // No pread here; every block opens its own descriptor, so seeking it races with nothing
+    if (_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) {
+        return -1;
+    }
+#endif
+    size_t total = 0;
+    while (total < length) {
+#ifdef _WIN32
+        ssize_t n = ::read(fd, data + total, static_cast<unsigned int>(min<size_t>(length - total, 1u << 30)));
+#else
+        ssize_t n = ::pread(fd, data + total, length - total, static_cast<off_t>(offset + total));
+#endif
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    return static_cast<long long>(total);
+}
+
+// Signatures of compressed formats
+static bool hasCompressedMagic(const unsigned char* p, size_t length) {
+    auto starts = [&](const char* magic, size_t n, size_t at = 0) {
+        return length >= at + n && memcmp(p + at, magic, n) == 0;
+    };
+    return starts("\xFF\xD8\xFF", 3) ||                        // JPEG
+           starts("\x89PNG", 4) || starts("GIF8", 4) ||
+           (starts("RIFF", 4) && starts("WEBP", 4, 8)) ||
+           starts("PK\x03\x04", 4) || starts("\x1F\x8B", 2) ||   // zip family, gzip
+           starts("BZh", 3) || starts("\xFD" "7zXZ", 5) || starts("\x28\xB5\x2F\xFD", 4) ||
+           starts("7z\xBC\xAF\x27\x1C", 6) || starts("Rar!", 4) ||
+           starts("ftyp", 4, 4) || starts("OggS", 4) || starts("fLaC", 4) || starts("ID3", 3);
+}
+
+// Shannon entropy of the byte distribution, in bits per byte
+static double byteEntropy(const unsigned char* p, size_t length) {
+    size_t counts[256] = {};
+    for (size_t i = 0; i < length; ++i) {
+        counts[p[i]]++;
+    }
+    double entropy = 0;
+    for (size_t count : counts) {
+        if (count > 0) {
+            double share = static_cast<double>(count) / static_cast<double>(length);
+            entropy -= share * log2(share);
+        }
+    }
+    return entropy;
+}
+
+// Decide how to pack a source from its name, size and the sample of its head
+static PackPolicy choosePolicy(const PackSource& source, CompressionManager::Profile profile,
+                               const char* sample, size_t length) {
+    PackPolicy policy;
+    if (profile == CompressionManager::Profile::Store || source.size == 0) {
+        policy.method = 0;
+        return policy;
+    }
+
+    string extension = fs::path(source.name).extension().string();
+    if (!extension.empty()) {
+        extension.erase(0, 1);
+        transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    }
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(sample);
+    bool compressed = find(begin(COMPRESSED_EXTENSIONS), end(COMPRESSED_EXTENSIONS), extension) !=
+                          end(COMPRESSED_EXTENSIONS) ||
+                      hasCompressedMagic(bytes, length) || byteEntropy(bytes, length) >= STORE_ENTROPY;
+    if (compressed) {
+        policy.method = 0;
+    } else if (profile == CompressionManager::Profile::Fast) {
+        policy.level = 1;
+    } else if (profile == CompressionManager::Profile::Best || source.size <= SMALL_ENTRY) {
+        policy.level = 9;
+    } else if (source.size >= LARGE_ENTRY) {
+        policy.level = 4;
+    }
+    return policy;
+}
+
+// Deflate one block of an entry; every block but the last ends with a full flush, so
+// the blocks of an entry concatenate into one deflate stream
+static bool deflateBlock(const char* dictionary, size_t dictionary_length, const char* data, size_t length,
+                         bool last, int level, string& out) {
     z_stream zs;
     memset(&zs, 0, sizeof(zs));
-    
-    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
-        return "";
+    if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
     }
-    
-    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data.c_str()));
-    zs.avail_in = static_cast<uInt>(data.length());
-    
-    string compressed;
-    char buffer[16384];
-    
+    if (dictionary_length > 0 &&
+        deflateSetDictionary(&zs, reinterpret_cast<const Bytef*>(dictionary), static_cast<uInt>(dictionary_length)) != Z_OK) {
+        deflateEnd(&zs);
+        return false;
+    }
+
+    out.resize(deflateBound(&zs, static_cast<uLong>(length)) + 16);
+    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+    zs.avail_in = static_cast<uInt>(length);
+    size_t produced = 0;
+    int ret;
     do {
-        zs.next_out = reinterpret_cast<Bytef*>(buffer);
-        zs.avail_out = sizeof(buffer);
-        
-        int ret = deflate(&zs, Z_FINISH);
-        if (ret == Z_STREAM_ERROR) {
-            deflateEnd(&zs);
-            return "";
+        if (produced == out.size()) {
+            out.resize(out.size() * 2);
         }
-        
-        compressed.append(buffer, sizeof(buffer) - zs.avail_out);
-    } while (zs.avail_out == 0);
-    
+        zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+        zs.avail_out = static_cast<uInt>(out.size() - produced);
+        ret = deflate(&zs, last ? Z_FINISH : Z_FULL_FLUSH);
+        produced = out.size() - zs.avail_out;
+    } while (ret == Z_OK && (last || zs.avail_out == 0));
     deflateEnd(&zs);
-    return compressed;
+    out.resize(produced);
+    return ret == (last ? Z_STREAM_END : Z_OK);
 }
 
-static string decompressData(const string& compressed, size_t uncompressedSize) {
-    if (compressed.empty() || uncompressedSize == 0) {
-        return "";
+// Read and deflate (or store) block index of a source. Whichever block of a source comes
+// first decides its policy: the first block from the data it read, others from a sample.
+static void packBlock(const PackSource& source, size_t index, CompressionManager::Profile profile,
+                      PackPolicy& policy, once_flag& decided, PackBlock& block) {
+    block.failed = true;
+    ScopedFd fd(Sandbox::openPath(source.path, O_RDONLY));
+    if (!fd.valid()) {
+        return;
     }
-    
-    z_stream zs;
-    memset(&zs, 0, sizeof(zs));
-    
-    if (inflateInit2(&zs, -MAX_WBITS) != Z_OK) {
-        return "";
+
+    string input;
+    uint64_t offset = static_cast<uint64_t>(index) * PACK_BLOCK;
+    if (index == 0) {
+        input.resize(PACK_BLOCK);
+        long long n = readAt(fd.get(), &input[0], input.size(), 0);
+        if (n < 0) {
+            return;
+        }
+        input.resize(static_cast<size_t>(n));
+        call_once(decided, [&]() {
+            policy = choosePolicy(source, profile, input.data(), min(input.size(), POLICY_SAMPLE));
+        });
+    } else {
+        call_once(decided, [&]() {
+            string sample(POLICY_SAMPLE, '\0');
+            long long n = readAt(fd.get(), &sample[0], sample.size(), 0);
+            policy = choosePolicy(source, profile, sample.data(), static_cast<size_t>(max(0LL, n)));
+        });
+        // Deflated blocks are primed with the input before them
+        size_t dictionary = policy.method == 8 ? PACK_DICTIONARY : 0;
+        input.resize(dictionary + PACK_BLOCK);
+        long long n = readAt(fd.get(), &input[0], input.size(), offset - dictionary);
+        if (n < 0) {
+            return;
+        }
+        input.resize(static_cast<size_t>(n));
     }
-    
-    zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(compressed.c_str()));
-    zs.avail_in = static_cast<uInt>(compressed.length());
-    
-    string decompressed;
-    decompressed.resize(uncompressedSize);
-    zs.next_out = reinterpret_cast<Bytef*>(&decompressed[0]);
-    zs.avail_out = static_cast<uInt>(uncompressedSize);
-    
-    int ret = inflate(&zs, Z_FINISH);
-    inflateEnd(&zs);
-    
-    if (ret != Z_STREAM_END) {
-        return "";
+
+    // The file may have shrunk since it was listed; its blocks then just hold less
+    size_t dictionary = (index > 0 && policy.method == 8) ? min(PACK_DICTIONARY, input.size()) : 0;
+    const char* data = input.data() + dictionary;
+    size_t length = input.size() - dictionary;
+    block.crc = static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data),
+                                            static_cast<uInt>(length)));
+    block.length = length;
+    block.method = policy.method;
+    block.cpu_ns = 0;
+    if (policy.method == 0) {
+        block.data.assign(data, length);
+    } else {
+        uint64_t start = threadCpuNanoseconds();
+        bool last = index + 1 == source.blocks;
+        if (!deflateBlock(input.data(), dictionary, data, length, last, policy.level, block.data)) {
+            return;
+        }
+        block.cpu_ns = threadCpuNanoseconds() - start;
+    }
+    block.failed = false;
+}
+
+// Write entries in order as their blocks come back: local header first (sizes patched
+// once the last block is in), then the blocks, combining their CRCs
+class PackWriter {
+public:
+    PackWriter(ofstream& zipFile, vector<ZipEntryRecord>& centralDir, CompressionManager::PackStats& stats)
+        : zipFile_(zipFile), centralDir_(centralDir), stats_(stats), crc_(0), compressed_(0), uncompressed_(0),
+          cpu_ns_(0), method_(8), zip64_(false), failed_(false), failures_(0) {}
+
+    void write(const PackSource& source, size_t index, const PackBlock& block) {
+        if (index == 0) {
+            begin(source, block.method);
+        }
+        if (failed_) {
+            return;
+        }
+        if (block.failed) {
+            cerr << "Error: Cannot compress file: " << source.path << endl;
+            failed_ = true;
+            failures_++;
+            zipFile_.seekp(headerPos_);
+            return;
+        }
+
+        zipFile_.write(block.data.data(), static_cast<streamsize>(block.data.size()));
+        crc_ = static_cast<uint32_t>(crc32_combine(crc_, block.crc, static_cast<z_off_t>(block.length)));
+        compressed_ += block.data.size();
+        uncompressed_ += block.length;
+        cpu_ns_ += block.cpu_ns;
+        if (index + 1 == source.blocks) {
+            finish(source);
+        }
+    }
+
+    // Entries that failed part way and were written over
+    size_t failures() const { return failures_; }
+
+private:
+    ofstream& zipFile_;
+    vector<ZipEntryRecord>& centralDir_;
+    CompressionManager::PackStats& stats_;
+    streampos headerPos_;
+    uint32_t crc_;
+    uint64_t compressed_;
+    uint64_t uncompressed_;
+    uint64_t cpu_ns_;
+    uint16_t method_;
+    bool zip64_;             // The local header carries a ZIP64 extra field for the sizes
+    bool failed_;
+    size_t failures_;
+
+    void begin(const PackSource& source, uint16_t method) {
+        headerPos_ = zipFile_.tellp();
+        crc_ = 0;
+        compressed_ = 0;
+        uncompressed_ = 0;
+        cpu_ns_ = 0;
+        method_ = method;
+        failed_ = false;
+
+        // Sizes are only known at the end, so the ZIP64 field is reserved for any file that
+        // could reach 4 GiB: at most one block per listed block, plus deflate's worst case growth
+        uint64_t most = static_cast<uint64_t>(source.blocks) * PACK_BLOCK;
+        zip64_ = most + most / 256 + 64 * source.blocks >= ZIP64_MARKER_32;
+
+        ZipLocalFileHeader header;
+        header.signature = 0x04034b50;
+        header.version = zip64_ ? ZIP64_VERSION : ZIP_VERSION;
+        header.flags = 0;
+        header.compression = method_;
+        header.modTime = 0;
+        header.modDate = 0;
+        header.crc32 = 0;
+        header.compressedSize = zip64_ ? ZIP64_MARKER_32 : 0;
+        header.uncompressedSize = zip64_ ? ZIP64_MARKER_32 : 0;
+        header.filenameLength = source.name.length();
+        header.extraFieldLength = zip64_ ? 20 : 0;
+        writeLocalHeader(zipFile_, header, source.name);
+        if (zip64_) {
+            writeUint16(zipFile_, ZIP64_EXTRA_TAG);
+            writeUint16(zipFile_, 16);
+            writeUint64(zipFile_, 0);  // uncompressed size
+            writeUint64(zipFile_, 0);  // compressed size
+        }
+    }
+
+    void finish(const PackSource& source) {
+        // CRC and sizes sit 14 bytes into the local header, ZIP64 sizes right after the name
+        streampos endPos = zipFile_.tellp();
+        zipFile_.seekp(static_cast<streamoff>(headerPos_) + 14);
+        writeUint32(zipFile_, crc_);
+        if (zip64_) {
+            zipFile_.seekp(static_cast<streamoff>(headerPos_) + 30 + static_cast<streamoff>(source.name.length()) + 4);
+            writeUint64(zipFile_, uncompressed_);
+            writeUint64(zipFile_, compressed_);
+        } else {
+            writeUint32(zipFile_, static_cast<uint32_t>(compressed_));
+            writeUint32(zipFile_, static_cast<uint32_t>(uncompressed_));
+        }
+        zipFile_.seekp(endPos);
+
+        ZipEntryRecord record;
+        record.name = source.name;
+        record.compression = method_;
+        record.crc32 = crc_;
+        record.compressedSize = compressed_;
+        record.uncompressedSize = uncompressed_;
+        record.localHeaderOffset = static_cast<uint64_t>(headerPos_);
+        centralDir_.push_back(std::move(record));
+
+        stats_.entries++;
+        stats_.bytes_in += uncompressed_;
+        stats_.bytes_out += compressed_;
+        if (method_ == 0) {
+            stats_.stored++;
+            stats_.stored_bytes += uncompressed_;
+        } else {
+            stats_.deflated_bytes += uncompressed_;
+            stats_.deflate_cpu_ns += cpu_ns_;
+        }
+    }
+};
+
+// Compress all blocks on worker threads while the calling thread writes them in order.
+// Workers run at most PACK_AHEAD_PER_WORKER blocks per thread ahead of the writer.
+static void packSources(const vector<PackSource>& sources, size_t threads, CompressionManager::Profile profile,
+                        PackWriter& writer) {
+    vector<pair<size_t, size_t>> jobs;  // (source, block index)
+    for (size_t s = 0; s < sources.size(); ++s) {
+        for (size_t b = 0; b < sources[s].blocks; ++b) {
+            jobs.emplace_back(s, b);
+        }
+    }
+    if (jobs.empty()) {
+        return;
+    }
+
+    size_t worker_count = min(threads, jobs.size());
+    size_t ahead = worker_count * PACK_AHEAD_PER_WORKER;
+    vector<PackPolicy> policies(sources.size());
+    vector<once_flag> decided(sources.size());
+    vector<PackBlock> slots(ahead);
+    mutex slots_mutex;
+    condition_variable slot_free;     // The writer consumed a block
+    condition_variable slot_ready;    // A worker finished a block
+    size_t next_job = 0;
+    size_t written = 0;
+
+    vector<thread> workers;
+    for (size_t w = 0; w < worker_count; ++w) {
+        workers.emplace_back([&]() {
+            PackBlock block;
+            while (true) {
+                size_t job;
+                {
+                    unique_lock<mutex> lock(slots_mutex);
+                    slot_free.wait(lock, [&]() { return next_job >= jobs.size() || next_job < written + ahead; });
+                    if (next_job >= jobs.size()) {
+                        return;
+                    }
+                    job = next_job++;
+                }
+
+                size_t s = jobs[job].first;
+                packBlock(sources[s], jobs[job].second, profile, policies[s], decided[s], block);
+                {
+                    lock_guard<mutex> lock(slots_mutex);
+                    PackBlock& slot = slots[job % ahead];
+                    swap(slot, block);
+                    slot.ready = true;
+                }
+                slot_ready.notify_one();
+            }
+        });
+    }
+
+    for (size_t job = 0; job < jobs.size(); ++job) {
+        PackBlock& slot = slots[job % ahead];
+        {
+            unique_lock<mutex> lock(slots_mutex);
+            slot_ready.wait(lock, [&]() { return slot.ready; });
+        }
+        // The slot is not reused until written moves past it
+        writer.write(sources[jobs[job].first], jobs[job].second, slot);
+        {
+            lock_guard<mutex> lock(slots_mutex);
+            slot.ready = false;
+            written++;
+        }
+        slot_free.notify_all();
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
     }
-    
-    return decompressed;
 }
 
 bool CompressionManager::compressToZip(const string& zipPath, const vector<string>& paths) {
+    return compressToZip(zipPath, paths, Options());
+}
+
+bool CompressionManager::compressToZip(const string& zipPath, const vector<string>& paths, const Options& options) {
+    PackStats stats;
+    return compressToZip(zipPath, paths, options, stats);
+}
+
+bool CompressionManager::compressToZip(const string& zipPath, const vector<string>& paths, const Options& options,
+                                       PackStats& stats) {
+    stats = PackStats();
     string realZipPath = PathUtils::virtualToRealPath(zipPath);
     
     if (!PathUtils::isPathSafe(realZipPath)) {
@@ -174,15 +693,18 @@ bool CompressionManager::compressToZip(const string& zipPath, const vector<strin
     fs::path zipParent = fs::path(realZipPath).parent_path();
     if (!zipParent.empty() && !fs::exists(zipParent)) {
         fs::create_directories(zipParent);
+        // Any number of ancestors may be new; cheaper to start the cache over
+        MetadataCache::clear();
     }
     
-    ofstream zipFile(realZipPath, ios::binary);
-    if (!zipFile.is_open()) {
-        cerr << "Error: Cannot create zip file: " << zipPath << endl;
-        return false;
-    }
-    
-    vector<pair<string, uint32_t>> centralDir;  // filename, local header offset
+    // List every file first; a file of n bytes becomes ceil(n / PACK_BLOCK) blocks
+    vector<PackSource> sources;
+    size_t blockCount = 0;
+    auto addSource = [&](const string& name, const string& resolved, long long size) {
+        size_t blocks = max<size_t>(1, (static_cast<size_t>(max(0LL, size)) + PACK_BLOCK - 1) / PACK_BLOCK);
+        sources.push_back({name, resolved, static_cast<uint64_t>(max(0LL, size)), blockCount, blocks});
+        blockCount += blocks;
+    };
     
     for (const auto& path : paths) {
         string realPath = PathUtils::virtualToRealPath(path);
@@ -192,304 +714,280 @@ bool CompressionManager::compressToZip(const string& zipPath, const vector<strin
         }
         
         if (fs::is_directory(realPath)) {
-            // Add directory recursively
-            try {
-                for (const auto& entry : fs::recursive_directory_iterator(realPath)) {
-                    if (entry.is_regular_file()) {
-                        string entryPath = entry.path().string();
-                        string relativePath = fs::relative(entryPath, PathUtils::getVFSRoot()).string();
-                        
-                        // Convert to forward slashes for zip
-                        replace(relativePath.begin(), relativePath.end(), PATH_SEPARATOR, '/');
-                        if (relativePath[0] != '/') {
-                            relativePath = "/" + relativePath;
-                        }
-                        
-                        ifstream file(entryPath, ios::binary);
-                        if (!file.is_open()) continue;
-                        
-                        string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
-                        file.close();
-                        
-                        // Write local file header
-                        uint32_t headerOffset = zipFile.tellp();
-                        ZipLocalFileHeader header;
-                        header.signature = 0x04034b50;
-                        header.version = 20;
-                        header.flags = 0;
-                        header.compression = 8;  // DEFLATE
-                        header.modTime = 0;
-                        header.modDate = 0;
-                        header.crc32 = calculateCRC32(content);
-                        
-                        string compressed = compressData(content);
-                        header.compressedSize = compressed.length();
-                        header.uncompressedSize = content.length();
-                        header.filenameLength = relativePath.length();
-                        header.extraFieldLength = 0;
-                        
-                        writeUint32(zipFile, header.signature);
-                        writeUint16(zipFile, header.version);
-                        writeUint16(zipFile, header.flags);
-                        writeUint16(zipFile, header.compression);
-                        writeUint16(zipFile, header.modTime);
-                        writeUint16(zipFile, header.modDate);
-                        writeUint32(zipFile, header.crc32);
-                        writeUint32(zipFile, header.compressedSize);
-                        writeUint32(zipFile, header.uncompressedSize);
-                        writeUint16(zipFile, header.filenameLength);
-                        writeUint16(zipFile, header.extraFieldLength);
-                        zipFile.write(relativePath.c_str(), relativePath.length());
-                        zipFile.write(compressed.c_str(), compressed.length());
-                        
-                        centralDir.push_back({relativePath, headerOffset});
-                    }
+            // Add directory recursively; the walker lists in parallel, entries come back sorted
+            vector<TreeWalker::WalkEntry> walked;
+            if (!TreeWalker::walkOrdered(path, TreeWalker::Options(), walked)) {
+                cerr << "Error processing directory: " << path << endl;
+                continue;
+            }
+            for (const auto& entry : walked) {
+                if (entry.info.type == DirManager::EntryType::File) {
+                    addSource(entry.path, entry.path, entry.info.size);
                 }
-            } catch (const exception& e) {
-                cerr << "Error processing directory: " << e.what() << endl;
             }
         } else if (fs::is_regular_file(realPath)) {
             // Add single file
-            ifstream file(realPath, ios::binary);
-            if (!file.is_open()) {
-                cerr << "Warning: Cannot open file: " << path << endl;
-                continue;
-            }
-            
-            string content((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
-            file.close();
-            
             string relativePath = path;
             if (relativePath[0] != '/') {
                 relativePath = "/" + relativePath;
             }
-            
-            // Write local file header
-            uint32_t headerOffset = zipFile.tellp();
-            ZipLocalFileHeader header;
-            header.signature = 0x04034b50;
-            header.version = 20;
-            header.flags = 0;
-            header.compression = 8;  // DEFLATE
-            header.modTime = 0;
-            header.modDate = 0;
-            header.crc32 = calculateCRC32(content);
-            
-            string compressed = compressData(content);
-            header.compressedSize = compressed.length();
-            header.uncompressedSize = content.length();
-            header.filenameLength = relativePath.length();
-            header.extraFieldLength = 0;
-            
-            writeUint32(zipFile, header.signature);
-            writeUint16(zipFile, header.version);
-            writeUint16(zipFile, header.flags);
-            writeUint16(zipFile, header.compression);
-            writeUint16(zipFile, header.modTime);
-            writeUint16(zipFile, header.modDate);
-            writeUint32(zipFile, header.crc32);
-            writeUint32(zipFile, header.compressedSize);
-            writeUint32(zipFile, header.uncompressedSize);
-            writeUint16(zipFile, header.filenameLength);
-            writeUint16(zipFile, header.extraFieldLength);
-            zipFile.write(relativePath.c_str(), relativePath.length());
-            zipFile.write(compressed.c_str(), compressed.length());
-            
-            centralDir.push_back({relativePath, headerOffset});
+            error_code ec;
+            addSource(relativePath, PathUtils::resolvePath(path), static_cast<long long>(fs::file_size(realPath, ec)));
         }
     }
     
-    // Write central directory
-    streampos centralDirPos = zipFile.tellp();
-    uint32_t centralDirOffset = static_cast<uint32_t>(centralDirPos);
-    for (const auto& entry : centralDir) {
-        ZipCentralDirHeader cdHeader;
-        cdHeader.signature = 0x02014b50;
-        cdHeader.versionMadeBy = 20;
-        cdHeader.versionNeeded = 20;
-        cdHeader.flags = 0;
-        cdHeader.compression = 8;
-        cdHeader.modTime = 0;
-        cdHeader.modDate = 0;
-        cdHeader.crc32 = 0;  // Will be filled from local header
-        cdHeader.compressedSize = 0;
-        cdHeader.uncompressedSize = 0;
-        cdHeader.filenameLength = entry.first.length();
-        cdHeader.extraFieldLength = 0;
-        cdHeader.commentLength = 0;
-        cdHeader.diskNumber = 0;
-        cdHeader.internalAttribs = 0;
-        cdHeader.externalAttribs = 0;
-        cdHeader.localHeaderOffset = entry.second;
-        
-        writeUint32(zipFile, cdHeader.signature);
-        writeUint16(zipFile, cdHeader.versionMadeBy);
-        writeUint16(zipFile, cdHeader.versionNeeded);
-        writeUint16(zipFile, cdHeader.flags);
-        writeUint16(zipFile, cdHeader.compression);
-        writeUint16(zipFile, cdHeader.modTime);
-        writeUint16(zipFile, cdHeader.modDate);
-        writeUint32(zipFile, cdHeader.crc32);
-        writeUint32(zipFile, cdHeader.compressedSize);
-        writeUint32(zipFile, cdHeader.uncompressedSize);
-        writeUint16(zipFile, cdHeader.filenameLength);
-        writeUint16(zipFile, cdHeader.extraFieldLength);
-        writeUint16(zipFile, cdHeader.commentLength);
-        writeUint16(zipFile, cdHeader.diskNumber);
-        writeUint16(zipFile, cdHeader.internalAttribs);
-        writeUint32(zipFile, cdHeader.externalAttribs);
-        writeUint32(zipFile, cdHeader.localHeaderOffset);
-        zipFile.write(entry.first.c_str(), entry.first.length());
+    // Written beside the target and renamed over it once complete, so readers mapping the old
+    // archive (and files sharing its inode through links) are left intact; listed after the walk
+    // so a temp file inside a packed directory is not packed itself
+    string resolvedZip = PathUtils::resolvePath(zipPath);
+    string tempZip = Sandbox::siblingTempPath(resolvedZip, ".fxtmp.");
+    string realTempZip = PathUtils::virtualToRealPath(tempZip);
+    ofstream zipFile(realTempZip, ios::binary | ios::trunc);
+    if (!zipFile.is_open()) {
+        cerr << "Error: Cannot create zip file: " << zipPath << endl;
+        return false;
     }
     
-    streampos endPos = zipFile.tellp();
-    uint32_t centralDirSize = static_cast<uint32_t>(endPos) - centralDirOffset;
+    vector<ZipEntryRecord> centralDir;
+    PackWriter writer(zipFile, centralDir, stats);
+    size_t threads = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    packSources(sources, threads, options.profile, writer);
     
-    // Write end of central directory record
-    writeUint32(zipFile, 0x06054b50);  // EOCD signature
-    writeUint16(zipFile, 0);  // disk number
-    writeUint16(zipFile, 0);  // disk with central dir
-    writeUint16(zipFile, centralDir.size());  // entries in this disk
-    writeUint16(zipFile, centralDir.size());  // total entries
-    writeUint32(zipFile, centralDirSize);  // central dir size
-    writeUint32(zipFile, centralDirOffset);  // central dir offset
-    writeUint16(zipFile, 0);  // comment length
+    // Deflating the stored entries would have run at about the rate the deflated ones did; a few
+    // deflated bytes are mostly setup cost, so a rate is only taken from a block's worth or more
+    if (stats.deflated_bytes >= PACK_BLOCK) {
+        stats.saved_cpu_ns = static_cast<uint64_t>(static_cast<long double>(stats.deflate_cpu_ns) *
+                                                   stats.stored_bytes / stats.deflated_bytes);
+    }
+    
+    // Write central directory
+    uint64_t centralDirOffset = static_cast<uint64_t>(zipFile.tellp());
+    for (const auto& entry : centralDir) {
+        writeCentralHeader(zipFile, entry);
+    }
+    uint64_t centralDirSize = static_cast<uint64_t>(zipFile.tellp()) - centralDirOffset;
+    writeEndOfCentralDirectory(zipFile, centralDir.size(), centralDirOffset, centralDirSize);
     
+    // An archive missing some of the files is not published; an existing one stays as it was
     zipFile.close();
+    if (writer.failures() > 0) {
+        Sandbox::removeFile(tempZip);
+        cerr << "Error: " << writer.failures() << " of " << sources.size() << " files could not be compressed"
+             << endl;
+        return false;
+    }
+    if (!zipFile || !Sandbox::renamePath(tempZip, resolvedZip)) {
+        Sandbox::removeFile(tempZip);
+        cerr << "Error: Cannot write zip file: " << zipPath << endl;
+        return false;
+    }
+    MetadataCache::invalidateTree(resolvedZip);
+    FileIndex::update(resolvedZip);
     return true;
 }
 
-bool CompressionManager::decompressFromZip(const string& zipPath, const string& destDir) {
-    string realZipPath = PathUtils::virtualToRealPath(zipPath);
-    string realDestDir = PathUtils::virtualToRealPath(destDir);
+// Create a directory and its missing ancestors beneath the sandbox
+static bool makeDirectories(const string& resolved) {
+    string path;
+    for (const string& part : PathUtils::splitPath(resolved)) {
+        path += "/" + part;
+        if (!Sandbox::makeDirectory(path) && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stream one entry into the file at target (a normalized virtual path); "" or "Error: ..."
+static string extractEntry(const ZipArchive& archive, const ZipArchive::Entry& entry, const string& target,
+                           vector<char>& buffer) {
+    ZipArchive::EntryReader reader = archive.openEntry(entry);
+    if (!reader.isOpen()) {
+        return reader.getError();
+    }
     
-    if (!PathUtils::isPathSafe(realZipPath) || !PathUtils::isPathSafe(realDestDir)) {
+    // Written beside the target and renamed over it once complete: a corrupt entry or a full disk
+    // leaves an existing file (and any inode it shares with the blob store) untouched
+    string temp = Sandbox::siblingTempPath(target, ".fxtmp.");
+    ScopedFd out(Sandbox::openPath(temp, O_WRONLY | O_CREAT | O_EXCL, 0644));
+    if (!out.valid()) {
+        return "Error: Cannot create file: " + target;
+    }
+#if defined(__linux__)
+    // Reserve the blocks up front so the file is laid out in one piece; only sizes deflate
+    // could produce from the stored bytes are trusted, and a failure just loses the hint
+    uint64_t limit = (entry.compression == 0) ? entry.compressed_size : entry.compressed_size * 1032;
+    if (entry.uncompressed_size > 0 && entry.uncompressed_size <= limit) {
+        (void)fallocate(out.get(), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(entry.uncompressed_size));
+    }
+#endif
+    while (true) {
+        long long count = reader.read(buffer.data(), buffer.size());
+        if (count < 0 || (count > 0 && !Sandbox::writeAll(out.get(), buffer.data(), static_cast<size_t>(count)))) {
+            out.reset();
+            Sandbox::removeFile(temp);
+            return count < 0 ? reader.getError() : "Error: Failed to write file: " + target;
+        }
+        if (count == 0) {
+            break;
+        }
+    }
+    out.reset();
+    if (!Sandbox::renamePath(temp, target)) {
+        Sandbox::removeFile(temp);
+        return "Error: Cannot create file: " + target;
+    }
+    return "";
+}
+
+// One file to extract
+struct ExtractJob {
+    const ZipArchive::Entry* entry;
+    string target;           // Normalized virtual path
+};
+
+// Extract the given entries under destDir, counting those written; names are made relative, and
+// ones that would leave destDir skipped. Every directory is created once up front, then files are
+// spread over worker threads, largest first, each streamed through its worker's buffer. False if
+// any entry failed, after the rest were still extracted.
+static bool extractEntries(const string& zipPath, const ZipArchive& archive,
+                           const vector<const ZipArchive::Entry*>& entries, const string& destDir,
+                           size_t threads, size_t& extracted) {
+    extracted = 0;
+    string realDestDir = PathUtils::virtualToRealPath(destDir);
+    if (!PathUtils::isPathSafe(realDestDir)) {
         cerr << "Error: Invalid paths" << endl;
         return false;
     }
-    
-    ifstream zipFile(realZipPath, ios::binary);
-    if (!zipFile.is_open()) {
-        cerr << "Error: Cannot open zip file: " << zipPath << endl;
+    string root = PathUtils::resolvePath(destDir);
+    if (!makeDirectories(root)) {
+        cerr << "Error: Cannot create directory: " << destDir << endl;
         return false;
     }
     
-    // Create destination directory
-    if (!fs::exists(realDestDir)) {
-        fs::create_directories(realDestDir);
+    // A name given twice is written once, with the later entry as a serial extraction would leave it
+    string prefix = (root == "/") ? "" : root;
+    vector<ExtractJob> jobs;
+    unordered_map<string, size_t> jobByTarget;
+    set<string> directories;     // Sorted, so parents come before their children
+    size_t directoryEntries = 0;
+    for (const ZipArchive::Entry* entry : entries) {
+        string relative = ZipArchive::safeEntryPath(entry->name);
+        if (relative.empty()) {
+            cerr << "Warning: Skipping unsafe entry: " << entry->name << endl;
+            continue;
+        }
+        string target = prefix + "/" + relative;
+        if (PathUtils::isReservedPath(target)) {
+            cerr << "Warning: Skipping reserved entry: " << entry->name << endl;
+            continue;
+        }
+        bool directory = entry->name.back() == '/' || entry->name.back() == '\\';
+        string dir = directory ? target : PathUtils::getParentPath(target);
+        while (dir != root && dir.size() > root.size() && directories.insert(dir).second) {
+            dir = PathUtils::getParentPath(dir);
+        }
+        if (directory) {
+            directoryEntries++;
+            continue;
+        }
+        auto known = jobByTarget.find(target);
+        if (known != jobByTarget.end()) {
+            jobs[known->second].entry = entry;
+            continue;
+        }
+        jobByTarget.emplace(target, jobs.size());
+        jobs.push_back({entry, std::move(target)});
     }
+    size_t failures = 0;
+    for (const string& dir : directories) {
+        if (!Sandbox::makeDirectory(dir) && errno != EEXIST) {
+            cerr << "Error: Cannot create directory: " << dir << endl;
+            failures++;
+        }
+    }
+    sort(jobs.begin(), jobs.end(), [](const ExtractJob& a, const ExtractJob& b) {
+        return a.entry->uncompressed_size > b.entry->uncompressed_size;
+    });
     
-    // Find end of central directory
-    zipFile.seekg(0, ios::end);
-    size_t fileSize = zipFile.tellg();
-    
-    // Search backwards for EOCD signature
-    bool found = false;
-    uint32_t centralDirOffset = 0;
-    uint16_t numEntries = 0;
-    
-    for (size_t i = fileSize - 22; i > 0 && i < fileSize; --i) {
-        zipFile.seekg(i);
-        uint32_t sig = readUint32(zipFile);
-        if (sig == 0x06054b50) {
-            readUint16(zipFile);  // disk number
-            readUint16(zipFile);  // disk with central dir
-            numEntries = readUint16(zipFile);
-            readUint16(zipFile);  // total entries
-            readUint32(zipFile);  // central dir size
-            centralDirOffset = readUint32(zipFile);
-            found = true;
-            break;
+    atomic<size_t> next(0);
+    atomic<size_t> written(0);
+    atomic<size_t> failed(0);
+    mutex report;
+    auto work = [&]() {
+        vector<char> buffer(EXTRACT_BUFFER);
+        for (size_t i = next++; i < jobs.size(); i = next++) {
+            string error = extractEntry(archive, *jobs[i].entry, jobs[i].target, buffer);
+            if (!error.empty()) {
+                failed++;
+                lock_guard<mutex> lock(report);
+                cerr << error << endl;
+                continue;
+            }
+            written++;
         }
+    };
+    size_t workerCount = min(threads, jobs.size());
+    vector<thread> workers;
+    for (size_t w = 1; w < workerCount; ++w) {
+        workers.emplace_back(work);
     }
+    work();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    extracted = written + directoryEntries;
+    failures += failed;
     
-    if (!found) {
-        cerr << "Error: Invalid zip file format" << endl;
+    FX_LOG_DEBUG("Extracted " << extracted << " of " << entries.size() << " entries of " << zipPath << " to "
+                 << root << " on " << max<size_t>(1, workerCount) << " threads");
+    MetadataCache::invalidateTree(root);
+    // The destination may already exist, so its new contents are walked
+    FileIndex::update(root, true);
+    if (failures > 0) {
+        cerr << "Error: " << failures << " of " << entries.size() << " entries could not be extracted" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool CompressionManager::decompressFromZip(const string& zipPath, const string& destDir) {
+    return decompressFromZip(zipPath, destDir, Options());
+}
+
+bool CompressionManager::decompressFromZip(const string& zipPath, const string& destDir, const Options& options) {
+    string error;
+    shared_ptr<const ZipArchive> archive = ZipArchive::open(zipPath, error);
+    if (!archive) {
+        cerr << error << endl;
         return false;
     }
     
-    // Read central directory
-    zipFile.seekg(centralDirOffset);
-    for (uint16_t i = 0; i < numEntries; ++i) {
-        uint32_t sig = readUint32(zipFile);
-        if (sig != 0x02014b50) break;
-        
-        readUint16(zipFile);  // version made by
-        readUint16(zipFile);  // version needed
-        readUint16(zipFile);  // flags
-        readUint16(zipFile);  // compression
-        readUint16(zipFile);  // mod time
-        readUint16(zipFile);  // mod date
-        readUint32(zipFile);  // crc32 (not used in extraction)
-        uint32_t compressedSize = readUint32(zipFile);
-        uint32_t uncompressedSize = readUint32(zipFile);
-        uint16_t filenameLength = readUint16(zipFile);
-        uint16_t extraFieldLength = readUint16(zipFile);
-        uint16_t commentLength = readUint16(zipFile);
-        readUint16(zipFile);  // disk number
-        readUint16(zipFile);  // internal attribs
-        readUint32(zipFile);  // external attribs
-        uint32_t localHeaderOffset = readUint32(zipFile);
-        
-        string filename(filenameLength, '\0');
-        zipFile.read(&filename[0], filenameLength);
-        zipFile.seekg(extraFieldLength + commentLength, ios::cur);
-        
-        // Read local file header
-        zipFile.seekg(localHeaderOffset);
-        uint32_t localSig = readUint32(zipFile);
-        if (localSig != 0x04034b50) continue;
-        
-        readUint16(zipFile);  // version
-        readUint16(zipFile);  // flags
-        uint16_t compression = readUint16(zipFile);
-        readUint16(zipFile);  // mod time
-        readUint16(zipFile);  // mod date
-        readUint32(zipFile);  // crc32
-        readUint32(zipFile);  // compressed size
-        readUint32(zipFile);  // uncompressed size
-        uint16_t localFilenameLength = readUint16(zipFile);
-        uint16_t localExtraLength = readUint16(zipFile);
-        
-        string localFilename(localFilenameLength, '\0');
-        zipFile.read(&localFilename[0], localFilenameLength);
-        zipFile.seekg(localExtraLength, ios::cur);
-        
-        // Read compressed data
-        string compressed(compressedSize, '\0');
-        zipFile.read(&compressed[0], compressedSize);
-        
-        // Decompress
-        string content;
-        if (compression == 0) {
-            content = compressed;  // Stored (no compression)
-        } else if (compression == 8) {
-            content = decompressData(compressed, uncompressedSize);
-        } else {
-            cerr << "Warning: Unsupported compression method for: " << filename << endl;
-            continue;
-        }
-        
-        // Convert path separators
-        string destPath = filename;
-        replace(destPath.begin(), destPath.end(), '/', PATH_SEPARATOR);
-        
-        // Build full destination path
-        fs::path fullPath = fs::path(realDestDir) / destPath;
-        
-        // Create parent directories
-        fs::create_directories(fullPath.parent_path());
-        
-        // Write file
-        ofstream outFile(fullPath.string(), ios::binary);
-        if (outFile.is_open()) {
-            outFile.write(content.c_str(), content.length());
-            outFile.close();
-        }
+    vector<const ZipArchive::Entry*> entries;
+    entries.reserve(archive->entries().size());
+    for (const auto& entry : archive->entries()) {
+        entries.push_back(&entry);
+    }
+    size_t threads = options.threads > 0 ? options.threads : max(1u, thread::hardware_concurrency());
+    size_t extracted = 0;
+    return extractEntries(zipPath, *archive, entries, destDir, threads, extracted);
+}
+
+bool CompressionManager::extractFromZip(const string& zipPath, const string& entryName, const string& destDir) {
+    string error;
+    shared_ptr<const ZipArchive> archive = ZipArchive::open(zipPath, error);
+    if (!archive) {
+        cerr << error << endl;
+        return false;
     }
     
-    zipFile.close();
-    return true;
+    const ZipArchive::Entry* entry = archive->find(entryName);
+    if (!entry) {
+        cerr << "Error: No such entry in archive: " << entryName << endl;
+        return false;
+    }
+    size_t extracted = 0;
+    return extractEntries(zipPath, *archive, {entry}, destDir, 1, extracted) && extracted == 1;
 }
 
 bool CompressionManager::isZipFile(const string& path) {
@@ -513,64 +1011,15 @@ bool CompressionManager::isZipFile(const string& path) {
 
 vector<string> CompressionManager::listZipContents(const string& zipPath) {
     vector<string> contents;
-    string realZipPath = PathUtils::virtualToRealPath(zipPath);
-    
-    if (!isZipFile(zipPath)) {
+    string error;
+    shared_ptr<const ZipArchive> archive = ZipArchive::open(zipPath, error);
+    if (!archive) {
         return contents;
     }
     
-    ifstream zipFile(realZipPath, ios::binary);
-    if (!zipFile.is_open()) {
-        return contents;
+    contents.reserve(archive->entries().size());
+    for (const auto& entry : archive->entries()) {
+        contents.push_back(entry.name);
     }
-    
-    // Find end of central directory (simplified - just read first entries)
-    zipFile.seekg(0, ios::end);
-    size_t fileSize = zipFile.tellg();
-    
-    for (size_t i = fileSize - 22; i > 0 && i < fileSize; --i) {
-        zipFile.seekg(i);
-        uint32_t sig = readUint32(zipFile);
-        if (sig == 0x06054b50) {
-            readUint16(zipFile);
-            readUint16(zipFile);
-            uint16_t numEntries = readUint16(zipFile);
-            readUint16(zipFile);
-            readUint32(zipFile);
-            uint32_t centralDirOffset = readUint32(zipFile);
-            
-            zipFile.seekg(centralDirOffset);
-            for (uint16_t j = 0; j < numEntries && j < 1000; ++j) {  // Limit to 1000 entries
-                uint32_t cdSig = readUint32(zipFile);
-                if (cdSig != 0x02014b50) break;
-                
-                readUint16(zipFile);
-                readUint16(zipFile);
-                readUint16(zipFile);
-                readUint16(zipFile);
-                readUint16(zipFile);
-                readUint16(zipFile);
-                readUint32(zipFile);
-                readUint32(zipFile);
-                readUint32(zipFile);
-                uint16_t filenameLength = readUint16(zipFile);
-                uint16_t extraFieldLength = readUint16(zipFile);
-                uint16_t commentLength = readUint16(zipFile);
-                readUint16(zipFile);
-                readUint16(zipFile);
-                readUint32(zipFile);
-                readUint32(zipFile);
-                
-                string filename(filenameLength, '\0');
-                zipFile.read(&filename[0], filenameLength);
-                zipFile.seekg(extraFieldLength + commentLength, ios::cur);
-                
-                contents.push_back(filename);
-            }
-            break;
-        }
-    }
-    
-    zipFile.close();
     return contents;
-}
\ No newline at end of file
+}
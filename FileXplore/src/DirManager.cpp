@@ -9,9 +9,18 @@ using std::cerr;
 using std::endl;
 #include "../include/DirManager.h"
 #include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/Session.h"
+#include "../include/MetadataCache.h"
+#include "../include/FileIndex.h"
+#include "../include/Logger.h"
+#include "../include/TreeWalker.h"
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
 
 #ifdef _WIN32
     #include <windows.h>
@@ -20,6 +29,9 @@ using std::endl;
     #include <dirent.h>
     #include <sys/stat.h>
     #include <unistd.h>
+    #if defined(__linux__)
+        #include <sys/syscall.h>
+    #endif
 #endif
 
 bool DirManager::createDirectory(const string& virtual_path) {
@@ -27,34 +39,21 @@ bool DirManager::createDirectory(const string& virtual_path) {
         return false;
     }
     
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    if (real_path.empty()) {
-        cerr << "Error: Invalid path: " << virtual_path << endl;
-        return false;
-    }
-    
-    // Check if directory already exists (use virtual path)
-    if (PathUtils::pathExists(virtual_path)) {
-        cerr << "Error: Directory already exists: " << virtual_path << endl;
-        return false;
-    }
+    string resolved = PathUtils::resolvePath(virtual_path);
     
-    // Create directory
-#ifdef _WIN32
-    if (_mkdir(real_path.c_str()) == 0) {
+    // mkdirat on the parent descriptor reports EEXIST itself, no pre-check needed
+    if (Sandbox::makeDirectory(resolved, 0755)) {
+        MetadataCache::invalidateTree(resolved);
+        FileIndex::update(resolved);
         return true;
-    } else {
-        cerr << "Error creating directory: " << virtual_path << endl;
-        return false;
     }
-#else
-    if (mkdir(real_path.c_str(), 0755) == 0) {
-        return true;
+    
+    if (errno == EEXIST) {
+        cerr << "Error: Directory already exists: " << virtual_path << endl;
     } else {
         cerr << "Error creating directory: " << virtual_path << endl;
-        return false;
     }
-#endif
+    return false;
 }
 
 bool DirManager::removeDirectory(const string& virtual_path) {
@@ -62,170 +61,422 @@ bool DirManager::removeDirectory(const string& virtual_path) {
         return false;
     }
     
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    if (real_path.empty()) {
-        cerr << "Error: Invalid path: " << virtual_path << endl;
-        return false;
-    }
+    string resolved = PathUtils::resolvePath(virtual_path);
     
-    // Check if directory exists (use virtual path)
-    if (!PathUtils::pathExists(virtual_path)) {
+    struct stat info;
+    if (!Sandbox::statPath(resolved, info)) {
         cerr << "Error: Directory does not exist: " << virtual_path << endl;
         return false;
     }
     
-    // Check if it's actually a directory (use virtual path)
-    if (!PathUtils::isDirectory(virtual_path)) {
+    if ((info.st_mode & S_IFMT) != S_IFDIR) {
         cerr << "Error: Path is not a directory: " << virtual_path << endl;
         return false;
     }
     
-    // Check if directory is empty
-    if (!isDirectoryEmpty(virtual_path)) {
-        cerr << "Error: Directory is not empty: " << virtual_path << endl;
-        return false;
+    // unlinkat(AT_REMOVEDIR) refuses non-empty directories atomically
+    if (Sandbox::removeDirectory(resolved)) {
+        MetadataCache::invalidateTree(resolved);
+        FileIndex::update(resolved);
+        return true;
     }
     
-    // Remove directory
-#ifdef _WIN32
-    if (_rmdir(real_path.c_str()) == 0) {
-        return true;
+    if (errno == ENOTEMPTY || errno == EEXIST) {
+        cerr << "Error: Directory is not empty: " << virtual_path << endl;
     } else {
         cerr << "Error removing directory: " << virtual_path << endl;
-        return false;
     }
+    return false;
+}
+
+vector<string> DirManager::listDirectory(const string& virtual_path) {
+    vector<string> names;
+    for (DirEntry& entry : listDirectoryEx(virtual_path)) {
+        names.push_back(std::move(entry.name));
+    }
+    return names;
+}
+
+#ifdef _WIN32
+// Seconds between 1601-01-01 (FILETIME epoch) and 1970-01-01, in 100ns units
+static const unsigned long long FILETIME_UNIX_OFFSET = 116444736000000000ULL;
+
+static std::time_t fileTimeToTime(const FILETIME& ft) {
+    unsigned long long ticks = (static_cast<unsigned long long>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    return static_cast<std::time_t>((ticks - FILETIME_UNIX_OFFSET) / 10000000ULL);
+}
 #else
-    if (rmdir(real_path.c_str()) == 0) {
-        return true;
-    } else {
-        cerr << "Error removing directory: " << virtual_path << endl;
-        return false;
+static DirManager::EntryType typeFromMode(mode_t mode) {
+    switch (mode & S_IFMT) {
+        case S_IFREG: return DirManager::EntryType::File;
+        case S_IFDIR: return DirManager::EntryType::Directory;
+        case S_IFLNK: return DirManager::EntryType::Symlink;
+        default:      return DirManager::EntryType::Other;
     }
-#endif
 }
 
-vector<string> DirManager::listDirectory(const string& virtual_path) {
-    vector<string> entries;
+// Fill name/size/mtime/mode/inode of one entry with a single fstatat on the directory fd
+static bool statEntry(int dir_fd, const char* name, unsigned char d_type, DirManager::DirEntry& entry) {
+    struct stat info;
+    if (fstatat(dir_fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) {
+        return false;  // Removed between the directory read and the stat
+    }
     
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    cout << "DEBUG listDirectory: Virtual: " << virtual_path << ", Real: " << real_path << endl;
+    entry.name = name;
+    switch (d_type) {
+        case DT_REG: entry.type = DirManager::EntryType::File; break;
+        case DT_DIR: entry.type = DirManager::EntryType::Directory; break;
+        case DT_LNK: entry.type = DirManager::EntryType::Symlink; break;
+        case DT_UNKNOWN: entry.type = typeFromMode(info.st_mode); break;
+        default: entry.type = DirManager::EntryType::Other; break;
+    }
+    entry.size = static_cast<long long>(info.st_size);
+    entry.mtime = info.st_mtime;
+#if defined(__APPLE__)
+    entry.mtime_nsec = static_cast<std::uint32_t>(info.st_mtimespec.tv_nsec);
+#else
+    entry.mtime_nsec = static_cast<std::uint32_t>(info.st_mtim.tv_nsec);
+#endif
+    entry.mode = info.st_mode;
+    entry.inode = static_cast<std::uint64_t>(info.st_ino);
+    return true;
+}
+
+static bool isDotEntry(const char* name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+#endif
+
+#if defined(__linux__)
+// Kernel record layout returned by getdents64 (glibc does not always export it)
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[1];
+};
+
+// Large enough that a 50k-entry directory needs only a few dozen calls
+static const size_t GETDENTS_BUFFER_SIZE = 256 * 1024;
+#endif
+
+// FileXplore's reserved bookkeeping directories are left out of the root's listings
+static bool isHiddenEntry(const string& directory, const char* name) {
+    return name[0] == '.' && directory == "/" && PathUtils::isReservedPath(directory + name);
+}
+
+vector<DirManager::DirEntry> DirManager::listDirectoryEx(const string& virtual_path) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+    FX_LOG_DEBUG("listDirectory: Virtual: " << virtual_path << ", Resolved: " << resolved);
     
-    if (real_path.empty()) {
-        cout << "DEBUG listDirectory: Real path is empty" << endl;
-        return entries;
+    if (PathUtils::isReservedPath(resolved)) {
+        return vector<DirEntry>();
     }
+    return listResolved(resolved);
+}
+
+vector<DirManager::DirEntry> DirManager::listResolved(const string& resolved) {
+    vector<DirEntry> entries;
     
-    if (!PathUtils::pathExists(virtual_path)) {
-        cout << "DEBUG listDirectory: Path does not exist" << endl;
+    // Repeat listings of an unchanged directory are served from the cache
+    if (MetadataCache::lookupListing(resolved, entries)) {
         return entries;
     }
+    uint64_t cache_token = MetadataCache::beginListing(resolved);
     
-    if (!PathUtils::isDirectory(virtual_path)) {
-        cout << "DEBUG listDirectory: Path is not a directory" << endl;
+#ifdef _WIN32
+    string real_path = PathUtils::virtualToRealPath(resolved);
+    if (real_path.empty() || !PathUtils::isDirectory(resolved)) {
+        FX_LOG_DEBUG("listDirectory: Path is not a directory");
         return entries;
     }
     
-#ifdef _WIN32
     WIN32_FIND_DATA findFileData;
     string searchPath = real_path + "\\*";
-    cout << "DEBUG listDirectory: Search path: " << searchPath << endl;
+    FX_LOG_DEBUG("listDirectory: Search path: " << searchPath);
     HANDLE hFind = FindFirstFile(searchPath.c_str(), &findFileData);
     
     if (hFind != INVALID_HANDLE_VALUE) {
         do {
             string filename = findFileData.cFileName;
-            if (filename != "." && filename != "..") {
-                entries.push_back(filename);
-                cout << "DEBUG listDirectory: Found file: " << filename << endl;
+            if (filename != "." && filename != ".." && !isHiddenEntry(resolved, filename.c_str())) {
+                DirEntry entry;
+                entry.name = filename;
+                DWORD attributes = findFileData.dwFileAttributes;
+                if (attributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+                    entry.type = EntryType::Symlink;
+                } else if (attributes & FILE_ATTRIBUTE_DIRECTORY) {
+                    entry.type = EntryType::Directory;
+                } else {
+                    entry.type = EntryType::File;
+                }
+                entry.size = (static_cast<long long>(findFileData.nFileSizeHigh) << 32) | findFileData.nFileSizeLow;
+                entry.mtime = fileTimeToTime(findFileData.ftLastWriteTime);
+                entry.mode = (entry.type == EntryType::Directory) ? 0755 : 0644;
+                if (attributes & FILE_ATTRIBUTE_READONLY) {
+                    entry.mode &= ~0222;
+                }
+                entries.push_back(entry);
             }
         } while (FindNextFile(hFind, &findFileData) != 0);
         FindClose(hFind);
     } else {
-        cout << "DEBUG listDirectory: FindFirstFile failed" << endl;
+        FX_LOG_WARN("listDirectory: FindFirstFile failed");
     }
 #else
-    DIR* dir = opendir(real_path.c_str());
-    if (dir != nullptr) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            string filename = entry->d_name;
-            if (filename != "." && filename != "..") {
-                entries.push_back(filename);
+    // O_DIRECTORY makes the open fail for non-directories, no separate stat needed
+    ScopedFd dir(Sandbox::openPath(resolved, O_RDONLY | O_DIRECTORY));
+    if (!dir.valid()) {
+        FX_LOG_DEBUG("listDirectory: Cannot open directory: " << strerror(errno));
+        return entries;
+    }
+    
+#if defined(__linux__)
+    // One getdents64 per buffer plus one fstatat per entry, nothing else
+    vector<char> buffer(GETDENTS_BUFFER_SIZE);
+    while (true) {
+        long length = syscall(SYS_getdents64, dir.get(), buffer.data(), buffer.size());
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FX_LOG_WARN("listDirectory: getdents64 failed: " << strerror(errno));
+            return vector<DirEntry>();
+        }
+        if (length == 0) {
+            break;
+        }
+        
+        for (long offset = 0; offset < length;) {
+            const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+            offset += record->d_reclen;
+            if (isDotEntry(record->d_name) || isHiddenEntry(resolved, record->d_name)) {
+                continue;
+            }
+            DirEntry entry;
+            if (statEntry(dir.get(), record->d_name, record->d_type, entry)) {
+                entries.push_back(std::move(entry));
             }
         }
-        closedir(dir);
     }
+#else
+    int stream_fd = ::dup(dir.get());
+    DIR* stream = (stream_fd >= 0) ? fdopendir(stream_fd) : nullptr;
+    if (stream == nullptr) {
+        if (stream_fd >= 0) {
+            close(stream_fd);
+        }
+        return entries;
+    }
+    
+    struct dirent* record;
+    while ((record = readdir(stream)) != nullptr) {
+        if (isDotEntry(record->d_name) || isHiddenEntry(resolved, record->d_name)) {
+            continue;
+        }
+        DirEntry entry;
+        if (statEntry(dir.get(), record->d_name, record->d_type, entry)) {
+            entries.push_back(std::move(entry));
+        }
+    }
+    closedir(stream);
+#endif
 #endif
     
-    sort(entries.begin(), entries.end());
-    cout << "DEBUG listDirectory: Total entries found: " << entries.size() << endl;
+    sort(entries.begin(), entries.end(), [](const DirEntry& a, const DirEntry& b) {
+        return a.name < b.name;
+    });
+    MetadataCache::storeListing(resolved, entries, cache_token);
+    FX_LOG_DEBUG("listDirectory: Total entries found: " << entries.size());
     return entries;
 }
 
-void DirManager::displayTree(const string& virtual_path, int depth) {
+#if defined(__linux__)
+// Per-request buffer for paged listings; bounds memory regardless of directory size
+static const size_t DIR_ITERATOR_BUFFER_SIZE = 32 * 1024;
+#endif
+
+DirManager::DirIterator::DirIterator(const string& virtual_path, uint64_t cursor)
+    : fd_(-1), buffer_offset_(0), buffer_length_(0), cursor_(cursor), end_(false), root_(false) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+    root_ = (resolved == "/");
+    
+#if defined(__linux__)
+    fd_ = Sandbox::openPath(resolved, O_RDONLY | O_DIRECTORY);
+    if (fd_ < 0) {
+        end_ = true;
+        return;
+    }
+    // d_off cookies are valid lseek positions on a directory descriptor
+    if (cursor != 0 && lseek(fd_, static_cast<off_t>(cursor), SEEK_SET) < 0) {
+        end_ = true;
+        return;
+    }
+    buffer_.resize(DIR_ITERATOR_BUFFER_SIZE);
+#else
+    if (!PathUtils::isDirectory(resolved)) {
+        end_ = true;
+        return;
+    }
+    // No descriptor is held here; 0 only marks the iterator as open
+    fd_ = 0;
+    entries_ = listResolved(resolved);
+#endif
+}
+
+DirManager::DirIterator::~DirIterator() {
+#if defined(__linux__)
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+#endif
+}
+
+bool DirManager::DirIterator::isOpen() const {
+    return fd_ >= 0;
+}
+
+uint64_t DirManager::DirIterator::getCursor() const {
+    return cursor_;
+}
+
+bool DirManager::DirIterator::fill() {
+#if defined(__linux__)
+    while (!end_) {
+        long length = syscall(SYS_getdents64, fd_, buffer_.data(), buffer_.size());
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            end_ = true;
+            break;
+        }
+        buffer_offset_ = 0;
+        buffer_length_ = static_cast<size_t>(length);
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool DirManager::DirIterator::hasNext() {
+#if defined(__linux__)
+    while (true) {
+        if (buffer_offset_ >= buffer_length_ && !fill()) {
+            return false;
+        }
+        const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(buffer_.data() + buffer_offset_);
+        if (!isDotEntry(record->d_name) && !(root_ && isHiddenEntry("/", record->d_name))) {
+            return true;
+        }
+        buffer_offset_ += record->d_reclen;
+        cursor_ = static_cast<uint64_t>(record->d_off);
+    }
+#else
+    return !end_ && cursor_ < entries_.size();
+#endif
+}
+
+bool DirManager::DirIterator::next(DirEntry& entry) {
+#if defined(__linux__)
+    while (hasNext()) {
+        const LinuxDirent64* record = reinterpret_cast<const LinuxDirent64*>(buffer_.data() + buffer_offset_);
+        buffer_offset_ += record->d_reclen;
+        cursor_ = static_cast<uint64_t>(record->d_off);
+        if (statEntry(fd_, record->d_name, record->d_type, entry)) {
+            return true;
+        }
+    }
+    return false;
+#else
+    if (!hasNext()) {
+        return false;
+    }
+    entry = entries_[cursor_++];
+    return true;
+#endif
+}
+
+string DirManager::typeName(EntryType type) {
+    switch (type) {
+        case EntryType::File:      return "file";
+        case EntryType::Directory: return "directory";
+        case EntryType::Symlink:   return "symlink";
+        default:                   return "other";
+    }
+}
+
+string DirManager::formatPermissions(mode_t mode) {
+    string permissions = "---------";
+    const char flags[] = "rwxrwxrwx";
+    for (int bit = 0; bit < 9; ++bit) {
+        if (mode & (0400 >> bit)) {
+            permissions[bit] = flags[bit];
+        }
+    }
+    return permissions;
+}
+
+void DirManager::displayTree(const string& virtual_path, [[maybe_unused]] int depth) {
     if (!validateDirectoryOperation(virtual_path, true)) {
         return;
     }
     
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
+    string resolved = PathUtils::resolvePath(virtual_path);
+    string real_path = PathUtils::virtualToRealPath(resolved);
     if (real_path.empty()) {
         cerr << "Error: Invalid path: " << virtual_path << endl;
         return;
     }
     
     // Check if directory exists
-    if (!PathUtils::pathExists(real_path)) {
+    if (!PathUtils::pathExists(resolved)) {
         cerr << "Error: Directory does not exist: " << virtual_path << endl;
         return;
     }
     
     // Check if it's actually a directory
-    if (!PathUtils::isDirectory(real_path)) {
+    if (!PathUtils::isDirectory(resolved)) {
         cerr << "Error: Path is not a directory: " << virtual_path << endl;
         return;
     }
     
-    cout << virtual_path << endl;
-    displayTreeRecursive(real_path, virtual_path, 0, "");
-}
-
-void DirManager::displayTreeRecursive(const string& real_path, const string& virtual_path, 
-                                     int depth, const string& prefix) {
-    if (depth > 10) { // Prevent infinite recursion
+    vector<TreeWalker::WalkEntry> entries;
+    if (!TreeWalker::walkOrdered(resolved, TreeWalker::Options(), entries)) {
+        cerr << "Error: Cannot read directory: " << virtual_path << endl;
         return;
     }
     
-    vector<string> entries = listDirectory(virtual_path);
-    
-    for (size_t i = 0; i < entries.size(); ++i) {
-        const string& name = entries[i];
-        bool is_last = (i == entries.size() - 1);
-        
-        string current_prefix = prefix + (is_last ? "└── " : "├── ");
-        string next_prefix = prefix + (is_last ? "    " : "│   ");
+    // last_open[d] is true while the ancestor at depth d still has siblings to come
+    cout << virtual_path << endl;
+    vector<bool> last_open;
+    for (const auto& entry : entries) {
+        last_open.resize(entry.depth);
+        last_open[entry.depth - 1] = !entry.last_sibling;
         
-        string full_virtual_path = virtual_path + "/" + name;
-        string full_real_path = PathUtils::virtualToRealPath(full_virtual_path);
+        string prefix;
+        for (int level = 0; level + 1 < entry.depth; ++level) {
+            prefix += last_open[level] ? "│   " : "    ";
+        }
+        prefix += entry.last_sibling ? "└── " : "├── ";
         
-        cout << current_prefix << name;
-        if (PathUtils::isDirectory(full_real_path)) {
+        cout << prefix << entry.info.name;
+        if (entry.info.type == EntryType::Directory) {
             cout << "/";
-            cout << endl;
-            // Recursively display subdirectories
-            displayTreeRecursive(full_real_path, full_virtual_path, depth + 1, next_prefix);
-        } else {
-            cout << endl;
         }
+        cout << endl;
     }
 }
 
-bool DirManager::changeDirectory(const string& virtual_path) {
-    if (!validateDirectoryOperation(virtual_path, true)) {
+bool DirManager::changeDirectory(Session& session, const string& virtual_path) {
+    string resolved = session.resolvePath(virtual_path);
+    if (!validateDirectoryOperation(resolved, true)) {
         return false;
     }
     
-    // Use PathUtils to change directory (it handles validation)
-    if (!PathUtils::setCurrentVirtualPath(virtual_path)) {
+    // The session re-checks that the target is a directory beneath the root
+    if (!session.setCurrentPath(resolved)) {
         cerr << "Error: Cannot change to directory: " << virtual_path << endl;
         return false;
     }
@@ -233,22 +484,23 @@ bool DirManager::changeDirectory(const string& virtual_path) {
     return true;
 }
 
-string DirManager::getCurrentDirectory() {
-    return PathUtils::getCurrentVirtualPath();
+string DirManager::getCurrentDirectory(const Session& session) {
+    return session.getCurrentPath();
 }
 
 bool DirManager::directoryExists(const string& virtual_path) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    return !real_path.empty() && PathUtils::pathExists(real_path) && PathUtils::isDirectory(real_path);
+    return PathUtils::isDirectory(virtual_path);
 }
 
 bool DirManager::isDirectoryEmpty(const string& virtual_path) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    if (real_path.empty() || !PathUtils::pathExists(virtual_path) || !PathUtils::isDirectory(virtual_path)) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+    
+#ifdef _WIN32
+    string real_path = PathUtils::virtualToRealPath(resolved);
+    if (real_path.empty() || !PathUtils::isDirectory(resolved)) {
         return false;
     }
     
-#ifdef _WIN32
     WIN32_FIND_DATA findFileData;
     string searchPath = real_path + "\\*";
     HANDLE hFind = FindFirstFile(searchPath.c_str(), &findFileData);
@@ -265,29 +517,37 @@ bool DirManager::isDirectoryEmpty(const string& virtual_path) {
     }
     return true;
 #else
-    DIR* dir = opendir(real_path.c_str());
-    if (dir != nullptr) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            string filename = entry->d_name;
-            if (filename != "." && filename != "..") {
-                closedir(dir);
-                return false;
-            }
+    int fd = Sandbox::openPath(resolved, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    DIR* dir = fdopendir(fd);
+    if (dir == nullptr) {
+        close(fd);
+        return false;
+    }
+    
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        string filename = entry->d_name;
+        if (filename != "." && filename != "..") {
+            closedir(dir);
+            return false;
         }
-        closedir(dir);
     }
+    closedir(dir);
     return true;
 #endif
 }
 
-bool DirManager::validateDirectoryOperation(const string& virtual_path, bool should_exist) {
+bool DirManager::validateDirectoryOperation(const string& virtual_path, [[maybe_unused]] bool should_exist) {
     if (virtual_path.empty()) {
         cerr << "Error: Empty path provided" << endl;
         return false;
     }
     
-    if (!PathUtils::isPathSafe(PathUtils::virtualToRealPath(virtual_path))) {
+    if (!PathUtils::isVirtualPathSafe(virtual_path)) {
         cerr << "Error: Unsafe path (outside sandbox): " << virtual_path << endl;
         return false;
     }
@@ -0,0 +1,672 @@
+#include "../include/FileIndex.h"
+#include "../include/TreeWalker.h"
+#include "../include/DirManager.h"
+#include "../include/PathUtils.h"
+#include "../include/PersistenceManager.h"
+#include "../include/Sandbox.h"
+#include "../include/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Static member definitions
+shared_mutex FileIndex::index_mutex;
+unique_ptr<FileIndex::Index> FileIndex::index;
+atomic<bool> FileIndex::ready(false);
+atomic<bool> FileIndex::dirty(false);
+double FileIndex::last_build_ms = 0;
+mutex FileIndex::pending_mutex;
+vector<pair<string, bool>> FileIndex::pending;
+bool FileIndex::building = false;
+mutex FileIndex::thread_mutex;
+condition_variable FileIndex::wake;
+bool FileIndex::rebuild_requested = false;
+atomic<bool> FileIndex::stopping(false);
+thread FileIndex::worker;
+
+// Start of a saved index file
+static const char INDEX_MAGIC[8] = {'F', 'X', 'I', 'N', 'D', 'E', 'X', '\0'};
+
+// Deepest path entryPath() follows
+static const size_t MAX_DEPTH = 2048;
+
+// Posting lists a query intersects before verifying names directly
+static const size_t MAX_INTERSECTED_LISTS = 3;
+
+// Rebuild on our own once this many entries are dead and they outnumber the live ones
+static const size_t GARBAGE_THRESHOLD = 4096;
+
+static inline char foldCase(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+// Key of three already folded bytes
+static inline uint32_t trigramKey(const char* text) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(text[0])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(text[1])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[2]));
+}
+
+// Options for indexing walks: reserved paths are skipped, and returning false from the
+// filter also ends a walk early once stopping is set
+static TreeWalker::Options walkOptions(const atomic<bool>& stopping) {
+    TreeWalker::Options options;
+    options.filter = [&stopping](const TreeWalker::WalkEntry& entry) {
+        return !stopping.load() && !PathUtils::isReservedPath(entry.path);
+    };
+    return options;
+}
+
+static inline uint64_t childKey(uint32_t parent, const char* name, size_t length) {
+    return hash<string_view>()(string_view(name, length)) ^ (static_cast<uint64_t>(parent) * 0x9e3779b97f4a7c15ULL);
+}
+
+unique_ptr<FileIndex::Index> FileIndex::createIndex() {
+    unique_ptr<Index> created(new Index());
+    created->entries.push_back(Entry{0, 0, 0, static_cast<uint8_t>(DirManager::EntryType::Directory), true});
+    return created;
+}
+
+uint32_t FileIndex::addEntry(Index& target, uint32_t parent, const char* name, size_t length, uint8_t type) {
+    uint32_t id = static_cast<uint32_t>(target.entries.size());
+    size_t offset = target.names.size();
+    target.entries.push_back(Entry{parent, static_cast<uint32_t>(offset), static_cast<uint16_t>(length), type, true});
+    // The NUL keeps a scan of the whole arena from matching across two names
+    target.names.append(name, length);
+    target.names += '\0';
+    target.folded.append(name, length);
+    target.folded += '\0';
+    transform(target.folded.begin() + offset, target.folded.end(), target.folded.begin() + offset, foldCase);
+    linkChild(target, id);
+    if (length < 3) {
+        target.short_names.push_back(id);
+    }
+
+    // Ids only grow, so appending keeps every posting list sorted; a trigram
+    // repeated within the name is posted once
+    const char* folded = target.folded.data() + offset;
+    for (size_t i = 0; i + 3 <= length; ++i) {
+        vector<uint32_t>& list = target.postings[trigramKey(folded + i)];
+        if (list.empty() || list.back() != id) {
+            list.push_back(id);
+        }
+    }
+    return id;
+}
+
+void FileIndex::linkChild(Index& target, uint32_t id) {
+    // Keep the table at most half full (removed slots count until the next resize)
+    if ((target.slots_used + 1) * 2 > target.slots.size()) {
+        size_t live = target.entries.size() - target.dead;
+        size_t size = 1024;
+        while (size < live * 4) {
+            size *= 2;
+        }
+        target.slots.assign(size, 0);
+        target.slots_used = 0;
+        for (uint32_t other = 1; other < target.entries.size(); ++other) {
+            if (other != id && target.entries[other].alive) {
+                linkChild(target, other);
+            }
+        }
+    }
+
+    const Entry& entry = target.entries[id];
+    size_t mask = target.slots.size() - 1;
+    size_t slot = childKey(entry.parent, target.names.data() + entry.name_offset, entry.name_length) & mask;
+    while (target.slots[slot] != 0 && target.slots[slot] != REMOVED_SLOT) {
+        slot = (slot + 1) & mask;
+    }
+    if (target.slots[slot] == 0) {
+        target.slots_used++;
+    }
+    target.slots[slot] = id;
+}
+
+void FileIndex::unlinkChild(Index& target, uint32_t id) {
+    const Entry& entry = target.entries[id];
+    size_t mask = target.slots.size() - 1;
+    size_t slot = childKey(entry.parent, target.names.data() + entry.name_offset, entry.name_length) & mask;
+    while (target.slots[slot] != 0) {
+        if (target.slots[slot] == id) {
+            target.slots[slot] = REMOVED_SLOT;
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+uint32_t FileIndex::findChild(const Index& target, uint32_t parent, const char* name, size_t length) {
+    if (target.slots.empty()) {
+        return 0;
+    }
+    size_t mask = target.slots.size() - 1;
+    size_t slot = childKey(parent, name, length) & mask;
+    while (target.slots[slot] != 0) {
+        uint32_t id = target.slots[slot];
+        if (id != REMOVED_SLOT) {
+            const Entry& entry = target.entries[id];
+            if (entry.parent == parent && entry.name_length == length &&
+                memcmp(target.names.data() + entry.name_offset, name, length) == 0) {
+                return id;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    return 0;
+}
+
+uint32_t FileIndex::findPath(const Index& target, const string& virtual_path) {
+    uint32_t current = 0;
+    size_t start = 1;
+    while (start < virtual_path.size()) {
+        size_t end = virtual_path.find('/', start);
+        if (end == string::npos) {
+            end = virtual_path.size();
+        }
+        current = findChild(target, current, virtual_path.data() + start, end - start);
+        if (current == 0) {
+            return 0;
+        }
+        start = end + 1;
+    }
+    return current;
+}
+
+uint32_t FileIndex::insertPath(Index& target, const string& virtual_path, uint8_t type) {
+    uint32_t current = 0;
+    size_t start = 1;
+    while (start < virtual_path.size()) {
+        size_t end = virtual_path.find('/', start);
+        bool last = (end == string::npos);
+        if (last) {
+            end = virtual_path.size();
+        }
+        size_t length = end - start;
+        if (length == 0 || length > UINT16_MAX) {
+            return 0;
+        }
+
+        uint8_t component_type = last ? type : static_cast<uint8_t>(DirManager::EntryType::Directory);
+        uint32_t child = findChild(target, current, virtual_path.data() + start, length);
+        if (child == 0) {
+            child = addEntry(target, current, virtual_path.data() + start, length, component_type);
+        } else {
+            target.entries[child].type = component_type;
+        }
+        current = child;
+        start = end + 1;
+    }
+    return current;
+}
+
+void FileIndex::indexTree(Index& target, const string& virtual_dir) {
+    // Directories are read in parallel; the index itself takes one writer at a time
+    mutex insert_mutex;
+    TreeWalker::walk(virtual_dir, walkOptions(stopping), [&](const TreeWalker::WalkEntry& entry) {
+        lock_guard<mutex> lock(insert_mutex);
+        insertPath(target, entry.path, static_cast<uint8_t>(entry.info.type));
+    });
+}
+
+void FileIndex::collectTree(const string& virtual_dir, WalkedTree& found) {
+    mutex found_mutex;
+    TreeWalker::walk(virtual_dir, walkOptions(stopping), [&](const TreeWalker::WalkEntry& entry) {
+        lock_guard<mutex> lock(found_mutex);
+        found.emplace_back(entry.path, static_cast<uint8_t>(entry.info.type));
+    });
+}
+
+void FileIndex::applyUpdate(Index& target, const string& virtual_path, bool rescan, const WalkedTree* walked) {
+    // FileXplore's own bookkeeping directories are not indexed
+    if (PathUtils::isReservedPath(virtual_path)) {
+        return;
+    }
+    auto indexContents = [&]() {
+        if (walked == nullptr) {
+            indexTree(target, virtual_path);
+            return;
+        }
+        for (const auto& found : *walked) {
+            insertPath(target, found.first, found.second);
+        }
+    };
+    if (virtual_path == "/") {
+        if (rescan) {
+            indexContents();
+        }
+        return;
+    }
+
+    struct stat info;
+    if (!Sandbox::statPath(virtual_path, info)) {
+        // Gone: mark it dead; anything beneath it is unreachable from now on
+        uint32_t id = findPath(target, virtual_path);
+        if (id != 0) {
+            unlinkChild(target, id);
+            target.entries[id].alive = false;
+            target.dead++;
+        }
+        return;
+    }
+
+    DirManager::EntryType type = DirManager::EntryType::Other;
+    if ((info.st_mode & S_IFMT) == S_IFREG) {
+        type = DirManager::EntryType::File;
+    } else if ((info.st_mode & S_IFMT) == S_IFDIR) {
+        type = DirManager::EntryType::Directory;
+    }
+    bool existed = findPath(target, virtual_path) != 0;
+    insertPath(target, virtual_path, static_cast<uint8_t>(type));
+    if (type == DirManager::EntryType::Directory && (rescan || !existed)) {
+        indexContents();
+    }
+}
+
+bool FileIndex::entryPath(const Index& target, uint32_t id, string* path) {
+    uint32_t chain[MAX_DEPTH];
+    size_t depth = 0;
+    for (uint32_t current = id; current != 0; current = target.entries[current].parent) {
+        if (!target.entries[current].alive || depth == MAX_DEPTH) {
+            return false;
+        }
+        chain[depth++] = current;
+    }
+    if (path != nullptr) {
+        path->clear();
+        while (depth > 0) {
+            const Entry& entry = target.entries[chain[--depth]];
+            *path += '/';
+            path->append(target.names, entry.name_offset, entry.name_length);
+        }
+    }
+    return true;
+}
+
+void FileIndex::start() {
+    stopping = false;
+    {
+        lock_guard<mutex> lock(pending_mutex);
+        building = true;
+    }
+    worker = thread(workerLoop);
+}
+
+void FileIndex::stop() {
+    {
+        lock_guard<mutex> lock(thread_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+    if (dirty.load()) {
+        save();
+    }
+}
+
+void FileIndex::update(const string& virtual_path, bool rescan) {
+    // A directory's contents are walked before the index is taken exclusively, so locate
+    // queries and other writers only wait for the merge. The path itself is still stat'ed
+    // under the lock, so updates of one path apply in the order they were made.
+    WalkedTree walked;
+    bool have_walk = false;
+    if (!PathUtils::isReservedPath(virtual_path)) {
+        bool walk;
+        {
+            shared_lock<shared_mutex> lock(index_mutex);
+            walk = index && (rescan || (virtual_path != "/" && findPath(*index, virtual_path) == 0));
+        }
+        struct stat info;
+        if (walk && Sandbox::statPath(virtual_path, info) && (info.st_mode & S_IFMT) == S_IFDIR) {
+            collectTree(virtual_path, walked);
+            have_walk = true;
+        }
+    }
+
+    unique_lock<shared_mutex> lock(index_mutex);
+    {
+        lock_guard<mutex> pending_lock(pending_mutex);
+        if (building) {
+            pending.emplace_back(virtual_path, rescan);
+        }
+    }
+    if (index) {
+        applyUpdate(*index, virtual_path, rescan, have_walk ? &walked : nullptr);
+        dirty = true;
+    }
+}
+
+void FileIndex::rebuild() {
+    {
+        lock_guard<mutex> lock(thread_mutex);
+        rebuild_requested = true;
+    }
+    wake.notify_all();
+}
+
+size_t FileIndex::locate(const string& query, size_t limit, vector<Result>& results) {
+    results.clear();
+    string folded = query;
+    transform(folded.begin(), folded.end(), folded.begin(), foldCase);
+    if (folded.empty()) {
+        return 0;
+    }
+
+    shared_lock<shared_mutex> lock(index_mutex);
+    if (!index) {
+        return 0;
+    }
+    const Index& target = *index;
+
+    // Candidates: entries posted under every trigram of the query, rarest list first
+    vector<uint32_t> candidates;
+    bool scan_all = folded.size() < 2;
+    if (folded.size() == 2) {
+        // A two-byte query is in some trigram starting or ending with it, or in a name shorter than three
+        size_t total = target.short_names.size();
+        vector<const vector<uint32_t>*> lists;
+        char trigram[3];
+        for (int other = 0; other < 256; ++other) {
+            trigram[0] = folded[0];
+            trigram[1] = folded[1];
+            trigram[2] = static_cast<char>(other);
+            for (int shift = 0; shift < 2; ++shift) {
+                auto it = target.postings.find(trigramKey(trigram));
+                if (it != target.postings.end()) {
+                    lists.push_back(&it->second);
+                    total += it->second.size();
+                }
+                trigram[2] = folded[1];
+                trigram[1] = folded[0];
+                trigram[0] = static_cast<char>(other);
+            }
+        }
+        // Past a fraction of the index, one pass over the names is cheaper than merging
+        scan_all = total > target.entries.size() / 4;
+        if (!scan_all) {
+            candidates.reserve(total);
+            candidates = target.short_names;
+            for (const vector<uint32_t>* list : lists) {
+                candidates.insert(candidates.end(), list->begin(), list->end());
+            }
+            sort(candidates.begin(), candidates.end());
+            candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+        }
+    } else if (!scan_all) {
+        vector<const vector<uint32_t>*> lists;
+        for (size_t i = 0; i + 3 <= folded.size(); ++i) {
+            auto it = target.postings.find(trigramKey(folded.data() + i));
+            if (it == target.postings.end()) {
+                return 0;
+            }
+            lists.push_back(&it->second);
+        }
+        sort(lists.begin(), lists.end(), [](const vector<uint32_t>* a, const vector<uint32_t>* b) {
+            return a->size() < b->size();
+        });
+        candidates = *lists[0];
+        // The rarest lists narrow the candidates most; past a few, verifying the
+        // survivors costs less than walking more lists
+        for (size_t i = 1; i < min(lists.size(), MAX_INTERSECTED_LISTS) && !candidates.empty(); ++i) {
+            if (lists[i] == lists[i - 1]) {
+                continue;
+            }
+            // Both are sorted: gallop ahead from the previous hit, then binary search the last step
+            const vector<uint32_t>& list = *lists[i];
+            size_t position = 0;
+            auto kept = candidates.begin();
+            for (uint32_t id : candidates) {
+                size_t step = 1;
+                while (position + step < list.size() && list[position + step] < id) {
+                    step *= 2;
+                }
+                size_t end = min(position + step + 1, list.size());
+                position = lower_bound(list.begin() + position, list.begin() + end, id) - list.begin();
+                if (position == list.size()) {
+                    break;
+                }
+                if (list[position] == id) {
+                    *kept++ = id;
+                }
+            }
+            candidates.erase(kept, candidates.end());
+        }
+    }
+
+    // Rank: whole name, then prefix, then anywhere; shorter names first
+    struct Ranked {
+        uint8_t score;
+        uint16_t length;
+        uint32_t id;
+    };
+    vector<Ranked> matches;
+    string_view arena(target.folded);
+    auto consider = [&](uint32_t id) {
+        const Entry& entry = target.entries[id];
+        if (!entry.alive) {
+            return;
+        }
+        size_t position = arena.substr(entry.name_offset, entry.name_length).find(folded);
+        if (position == string_view::npos || !entryPath(target, id, nullptr)) {
+            return;
+        }
+        uint8_t score = (entry.name_length == folded.size()) ? 0 : (position == 0 ? 1 : 2);
+        matches.push_back(Ranked{score, entry.name_length, id});
+    };
+    if (scan_all) {
+        // One pass over the folded arena; each hit is mapped to its entry by
+        // advancing a cursor, since names are stored in entry order
+        uint32_t id = 1;
+        size_t position = arena.find(folded);
+        while (position != string_view::npos && id < target.entries.size()) {
+            while (id + 1 < target.entries.size() && target.entries[id + 1].name_offset <= position) {
+                id++;
+            }
+            consider(id);
+            position = arena.find(folded, target.entries[id].name_offset + target.entries[id].name_length + 1);
+            id++;
+        }
+    } else {
+        for (uint32_t id : candidates) {
+            consider(id);
+        }
+    }
+
+    size_t keep = min(limit, matches.size());
+    partial_sort(matches.begin(), matches.begin() + keep, matches.end(), [](const Ranked& a, const Ranked& b) {
+        if (a.score != b.score) {
+            return a.score < b.score;
+        }
+        if (a.length != b.length) {
+            return a.length < b.length;
+        }
+        return a.id < b.id;
+    });
+    results.reserve(keep);
+    for (size_t i = 0; i < keep; ++i) {
+        Result result;
+        entryPath(target, matches[i].id, &result.path);
+        result.is_directory = target.entries[matches[i].id].type == static_cast<uint8_t>(DirManager::EntryType::Directory);
+        results.push_back(move(result));
+    }
+    return matches.size();
+}
+
+FileIndex::Stats FileIndex::getStats() {
+    Stats stats;
+    shared_lock<shared_mutex> lock(index_mutex);
+    stats.ready = ready.load();
+    stats.last_build_ms = last_build_ms;
+    {
+        lock_guard<mutex> pending_lock(pending_mutex);
+        stats.building = building;
+    }
+    if (index) {
+        stats.entries = index->entries.size() - 1 - index->dead;
+        stats.dead = index->dead;
+        stats.trigrams = index->postings.size();
+        // Node overhead of the posting table is estimated at two pointers plus the key
+        stats.memory_bytes = index->entries.capacity() * sizeof(Entry) + index->names.capacity() +
+                             index->folded.capacity() + index->slots.capacity() * sizeof(uint32_t) +
+                             index->postings.size() * (2 * sizeof(void*) + sizeof(uint32_t) + sizeof(vector<uint32_t>));
+        for (const auto& posting : index->postings) {
+            stats.memory_bytes += posting.second.capacity() * sizeof(uint32_t);
+        }
+    }
+    return stats;
+}
+
+bool FileIndex::save() {
+    if (!PersistenceManager::isPersistenceAvailable()) {
+        return false;
+    }
+
+    // Live entries only, renumbered in order (parents still precede children)
+    string data;
+    {
+        shared_lock<shared_mutex> lock(index_mutex);
+        if (!index || !ready.load()) {
+            return false;
+        }
+        dirty = false;
+        const Index& target = *index;
+
+        data = PersistenceManager::beginSidecar(INDEX_MAGIC, FORMAT_VERSION);
+        size_t count_offset = data.size();
+        PersistenceManager::appendValue(data, static_cast<uint64_t>(0));
+        data.reserve(data.size() + target.names.size() + target.entries.size() * 7);
+
+        vector<uint32_t> renumbered(target.entries.size(), UINT32_MAX);
+        renumbered[0] = 0;
+        uint32_t count = 0;
+        for (uint32_t id = 1; id < target.entries.size(); ++id) {
+            const Entry& entry = target.entries[id];
+            if (!entry.alive || renumbered[entry.parent] == UINT32_MAX) {
+                continue;
+            }
+            renumbered[id] = ++count;
+            PersistenceManager::appendValue(data, renumbered[entry.parent]);
+            PersistenceManager::appendValue(data, entry.type);
+            PersistenceManager::appendValue(data, entry.name_length);
+            data.append(target.names, entry.name_offset, entry.name_length);
+        }
+        uint64_t total = count;
+        memcpy(&data[count_offset], &total, sizeof(total));
+    }
+
+    string file = PersistenceManager::getIndexFile();
+    if (!PersistenceManager::writeSidecar(file, data)) {
+        FX_LOG_WARN("Failed to save file index: " << file);
+        return false;
+    }
+    FX_LOG_DEBUG("Saved file index: " << data.size() << " bytes");
+    return true;
+}
+
+bool FileIndex::load() {
+    if (!PersistenceManager::isPersistenceAvailable()) {
+        return false;
+    }
+    string data;
+    size_t offset = 0;
+    uint64_t count = 0;
+    if (!PersistenceManager::readSidecar(PersistenceManager::getIndexFile(), INDEX_MAGIC, FORMAT_VERSION, data,
+                                         offset) ||
+        !PersistenceManager::readValue(data, offset, count)) {
+        return false;
+    }
+
+    unique_ptr<Index> loaded = createIndex();
+    loaded->entries.reserve(static_cast<size_t>(count) + 1);
+    loaded->names.reserve(data.size() - offset);
+    loaded->folded.reserve(data.size() - offset);
+    for (uint64_t i = 0; i < count; ++i) {
+        uint32_t parent = 0;
+        uint8_t type = 0;
+        uint16_t length = 0;
+        if (!PersistenceManager::readValue(data, offset, parent) || !PersistenceManager::readValue(data, offset, type) ||
+            !PersistenceManager::readValue(data, offset, length) || parent >= loaded->entries.size() || length == 0 || data.size() - offset < length) {
+            FX_LOG_WARN("Ignoring damaged file index: " << PersistenceManager::getIndexFile());
+            return false;
+        }
+        addEntry(*loaded, parent, data.data() + offset, length, type);
+        offset += length;
+    }
+
+    unique_lock<shared_mutex> lock(index_mutex);
+    // Changes made while loading are in pending and reach the index with the rebuild
+    index = move(loaded);
+    ready = true;
+    return true;
+}
+
+void FileIndex::workerLoop() {
+    auto started = chrono::steady_clock::now();
+    if (load()) {
+        double elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+        FX_LOG_DEBUG("Loaded saved file index in " << elapsed_ms << " ms");
+    }
+
+    bool build = true;
+    while (true) {
+        if (build) {
+            {
+                lock_guard<mutex> lock(pending_mutex);
+                building = true;
+                pending.clear();
+            }
+            started = chrono::steady_clock::now();
+            unique_ptr<Index> fresh = createIndex();
+            indexTree(*fresh, "/");
+            if (stopping.load()) {
+                // The walk was cut short; the previous index stays
+                return;
+            }
+            // Posting lists only grow by appends from here on
+            for (auto& posting : fresh->postings) {
+                posting.second.shrink_to_fit();
+            }
+            fresh->names.shrink_to_fit();
+            fresh->folded.shrink_to_fit();
+
+            {
+                unique_lock<shared_mutex> lock(index_mutex);
+                lock_guard<mutex> pending_lock(pending_mutex);
+                for (const auto& change : pending) {
+                    applyUpdate(*fresh, change.first, change.second, nullptr);
+                }
+                pending.clear();
+                building = false;
+                index = move(fresh);
+                last_build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+                FX_LOG_DEBUG("Indexed " << index->entries.size() - 1 << " paths in " << last_build_ms << " ms");
+            }
+            ready = true;
+            save();
+        } else if (dirty.load()) {
+            save();
+        }
+
+        {
+            unique_lock<mutex> lock(thread_mutex);
+            wake.wait_for(lock, chrono::seconds(SAVE_INTERVAL), [] { return stopping.load() || rebuild_requested; });
+            if (stopping.load()) {
+                return;
+            }
+            build = rebuild_requested;
+            rebuild_requested = false;
+        }
+        if (!build) {
+            shared_lock<shared_mutex> lock(index_mutex);
+            build = index && index->dead > GARBAGE_THRESHOLD && index->dead > index->entries.size() / 2;
+        }
+    }
+}
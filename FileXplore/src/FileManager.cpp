@@ -1,205 +1,668 @@
-using namespace std;
+using namespace std;
 #include "../include/FileManager.h"
 #include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/MetadataCache.h"
+#include "../include/FileIndex.h"
+#include "../include/GroupCommit.h"
+#include "../include/BlobStore.h"
+#include "../include/SnapshotManager.h"
+#include "../include/AppendWriter.h"
+#include "../include/IoEngine.h"
+#include "../include/Logger.h"
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #if defined(__linux__)
+        #include <sys/ioctl.h>
+        #include <linux/fs.h>
+    #endif
+#endif
 
 string FileManager::createFile(const string& virtual_path) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    
-    // Debug output
-    cout << "DEBUG: Creating file - Virtual: " << virtual_path << ", Real: " << real_path << endl;
-    
-    if (!validateFileOperation(real_path, "create")) {
-        cout << "DEBUG: Validation failed for: " << real_path << endl;
+    string resolved = PathUtils::resolvePath(virtual_path);
+
+    FX_LOG_DEBUG("Creating file - Virtual: " << virtual_path << ", Resolved: " << resolved);
+
+    if (!validateFileOperation(resolved, "create")) {
+        FX_LOG_DEBUG("Validation failed for: " << resolved);
         return "Error: Invalid file path or access denied";
     }
-    
-    // Check if file already exists
-    cout << "DEBUG: Checking if file exists: " << virtual_path << endl;
-    cout << "DEBUG: Real path for existence check: " << real_path << endl;
-    if (PathUtils::pathExists(virtual_path)) {
-        cout << "DEBUG: File exists check returned true" << endl;
-        return "Error: File already exists: " + virtual_path;
-    }
-    cout << "DEBUG: File already exists check passed for: " << virtual_path << endl;
-    
-    // Create parent directories if they don't exist
-    string parent_path = PathUtils::getParentPath(virtual_path);
-    string real_parent = PathUtils::virtualToRealPath(parent_path);
-    
-    cout << "DEBUG: Parent path - Virtual: " << parent_path << ", Real: " << real_parent << endl;
-    
-    if (!PathUtils::pathExists(parent_path)) {
-        cout << "DEBUG: Parent directory does not exist: " << parent_path << endl;
-        return "Error: Parent directory does not exist: " + parent_path;
-    }
-    
-    try {
-        cout << "DEBUG: Attempting to create file at: " << real_path << endl;
-        ofstream file(real_path);
-        if (!file.is_open()) {
-            cout << "DEBUG: Failed to open file for creation: " << real_path << endl;
-            return "Error: Failed to create file: " + virtual_path;
-        }
-        file.close();
-        cout << "DEBUG: File created successfully at: " << real_path << endl;
-        return "File created: " + virtual_path;
-    } catch (const exception& e) {
-        cout << "DEBUG: Exception during file creation: " << e.what() << endl;
-        return "Error creating file: " + string(e.what());
+
+    // O_EXCL makes the existence check and the creation a single step
+    ScopedFd fd(Sandbox::openPath(resolved, O_WRONLY | O_CREAT | O_EXCL, 0644));
+    if (!fd.valid()) {
+        int error = errno;
+        FX_LOG_DEBUG("openat failed for: " << resolved << " (" << strerror(error) << ")");
+        if (error == EEXIST) {
+            return "Error: File already exists: " + virtual_path;
+        }
+        if (error == ENOENT) {
+            return "Error: Parent directory does not exist: " + PathUtils::getParentPath(resolved);
+        }
+        if (Sandbox::isEscapeError(error)) {
+            return "Error: Invalid file path or access denied";
+        }
+        return "Error: Failed to create file: " + virtual_path;
     }
+    MetadataCache::invalidateTree(resolved);
+    FileIndex::update(resolved);
+
+    FX_LOG_DEBUG("File created successfully at: " << resolved);
+    return "File created: " + virtual_path;
 }
 
+std::atomic<FileManager::Durability> FileManager::default_durability(FileManager::Durability::Atomic);
+
 string FileManager::writeFile(const string& virtual_path, const string& content) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    
-    if (!validateFileOperation(real_path, "write")) {
+    return writeFile(virtual_path, content, default_durability.load());
+}
+
+string FileManager::writeFile(const string& virtual_path, const string& content, Durability durability) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+
+    if (!validateFileOperation(resolved, "write")) {
         return "Error: Invalid file path or access denied";
     }
-    
-    try {
-        ofstream file(real_path, ios::trunc);
-        if (!file.is_open()) {
-            return "Error: Cannot open file for writing: " + virtual_path;
-        }
-        
-        file << content;
-        file.close();
-        
-        if (file.fail()) {
-            return "Error: Failed to write to file: " + virtual_path;
+
+    // Deduplicated storage: the file becomes a link to its content's blob
+    if (BlobStore::isEnabled()) {
+        bool deduplicated = false;
+        string error = BlobStore::writeContent(resolved, content, durability == Durability::Durable, deduplicated);
+        if (!error.empty()) {
+            return error;
         }
-        
+        FX_LOG_DEBUG("Stored " << resolved << (deduplicated ? " as a link to an existing blob" : " as a new blob"));
+        FileIndex::update(resolved);
         return "Content written to file: " + virtual_path;
-    } catch (const exception& e) {
-        return "Error writing file: " + string(e.what());
     }
+
+    if (durability != Durability::None) {
+        return replaceFile(resolved, virtual_path, content, durability);
+    }
+
+    // Truncating a linked file in place would rewrite every file sharing its blob,
+    // so no snapshot may link it again until the write is done
+    shared_lock<shared_mutex> links = SnapshotManager::holdLinks();
+    BlobStore::release(resolved);
+    ScopedFd fd(Sandbox::openPath(resolved, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (!fd.valid()) {
+        if (Sandbox::isEscapeError(errno)) {
+            return "Error: Invalid file path or access denied";
+        }
+        return "Error: Cannot open file for writing: " + virtual_path;
+    }
+    // O_CREAT may have added the file, so the parent listing goes too
+    MetadataCache::invalidateTree(resolved);
+    FileIndex::update(resolved);
+
+    if (!Sandbox::writeAll(fd.get(), content.data(), content.size())) {
+        return "Error: Failed to write to file: " + virtual_path;
+    }
+
+    return "Content written to file: " + virtual_path;
+}
+
+string FileManager::replaceFile(const string& resolved, const string& virtual_path, const string& content,
+                                Durability durability) {
+    // The replacement keeps the permissions of the file it replaces
+    struct stat existing;
+    bool exists = Sandbox::statPath(resolved, existing);
+    if (exists && (existing.st_mode & S_IFMT) != S_IFREG) {
+        return "Error: Cannot open file for writing: " + virtual_path;
+    }
+
+    string temp_path = Sandbox::siblingTempPath(resolved, ".fxtmp.");
+    ScopedFd fd(Sandbox::openPath(temp_path, O_WRONLY | O_CREAT | O_EXCL, 0644));
+    if (!fd.valid()) {
+        int error = errno;
+        if (error == ENOENT) {
+            return "Error: Parent directory does not exist: " + PathUtils::getParentPath(resolved);
+        }
+        if (Sandbox::isEscapeError(error)) {
+            return "Error: Invalid file path or access denied";
+        }
+        return "Error: Cannot open file for writing: " + virtual_path;
+    }
+
+    string error;
+    if (!Sandbox::writeAll(fd.get(), content.data(), content.size())) {
+        error = "Error: Failed to write to file: " + virtual_path;
+    }
+#ifndef _WIN32
+    else if (exists && fchmod(fd.get(), existing.st_mode & 07777) != 0) {
+        error = "Error: Failed to write to file: " + virtual_path;
+    }
+#endif
+    // The data must be durable before the rename can expose it
+    else if (durability == Durability::Durable && !GroupCommit::sync(fd.get())) {
+        error = "Error: Failed to sync file: " + virtual_path;
+    }
+    else if (!Sandbox::renamePath(temp_path, resolved)) {
+        error = "Error: Failed to write to file: " + virtual_path;
+    }
+    if (!error.empty()) {
+        Sandbox::removeFile(temp_path);
+        return error;
+    }
+    MetadataCache::invalidateTree(resolved);
+    FileIndex::update(resolved);
+
+#ifndef _WIN32
+    // Then the directory entry the rename changed
+    if (durability == Durability::Durable) {
+        ScopedFd dir(Sandbox::openPath(PathUtils::getParentPath(resolved), O_RDONLY | O_DIRECTORY));
+        if (!dir.valid() || !GroupCommit::sync(dir.get())) {
+            return "Error: Content written but directory sync failed: " + virtual_path;
+        }
+    }
+#endif
+
+    return "Content written to file: " + virtual_path;
 }
 
 string FileManager::appendFile(const string& virtual_path, const string& content) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    
-    if (!validateFileOperation(real_path, "append")) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+
+    if (!validateFileOperation(resolved, "append")) {
         return "Error: Invalid file path or access denied";
     }
-    
-    try {
-        ofstream file(real_path, ios::app);
-        if (!file.is_open()) {
-            return "Error: Cannot open file for appending: " + virtual_path;
+
+    // Batched with concurrent appends to the same file over a cached descriptor
+    string error = AppendWriter::append(resolved, content.data(), content.size());
+    if (!error.empty()) {
+        return error;
+    }
+
+    return "Content appended to file: " + virtual_path;
+}
+
+bool FileManager::copyContents(int src, int dst, long long size) {
+#if defined(__linux__) && defined(FICLONE)
+    if (ioctl(dst, FICLONE, src) == 0) {
+        return true;
+    }
+#endif
+#if defined(__linux__)
+    // In-kernel copy; server-side on NFS, and never through user space
+    long long copied = 0;
+    while (copied < size) {
+        ssize_t n = copy_file_range(src, nullptr, dst, nullptr, static_cast<size_t>(size - copied), 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
         }
-        
-        file << content;
-        file.close();
-        
-        if (file.fail()) {
-            return "Error: Failed to append to file: " + virtual_path;
+        if (n <= 0) {
+            break;
+        }
+        copied += n;
+    }
+    if (copied == size) {
+        return true;
+    }
+    if (lseek(src, copied, SEEK_SET) < 0 || lseek(dst, copied, SEEK_SET) < 0) {
+        return false;
+    }
+#else
+    (void)size;
+#endif
+    vector<char> buffer(64 * 1024);
+    for (;;) {
+        ssize_t n = ::read(src, buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        if (!Sandbox::writeAll(dst, buffer.data(), static_cast<size_t>(n))) {
+            return false;
         }
-        
-        return "Content appended to file: " + virtual_path;
-    } catch (const exception& e) {
-        return "Error appending to file: " + string(e.what());
     }
 }
 
-string FileManager::readFile(const string& virtual_path) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    
-    if (!validateFileOperation(real_path, "read")) {
+string FileManager::openForRead(const string& virtual_path, int& fd, long long& size) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+
+    if (!validateFileOperation(resolved, "read")) {
         return "Error: Invalid file path or access denied";
     }
-    
-    if (!PathUtils::pathExists(virtual_path)) {
-        return "Error: File does not exist: " + virtual_path;
+
+    ScopedFd file(Sandbox::openPath(resolved, O_RDONLY));
+    if (!file.valid()) {
+        if (errno == ENOENT) {
+            return "Error: File does not exist: " + virtual_path;
+        }
+        if (Sandbox::isEscapeError(errno)) {
+            return "Error: Invalid file path or access denied";
+        }
+        return "Error: Cannot open file for reading: " + virtual_path;
     }
-    
-    if (!PathUtils::isFile(virtual_path)) {
+
+    // Stat the descriptor we read from, not the path, so the check cannot race
+    struct stat info;
+    if (fstat(file.get(), &info) != 0) {
+        return "Error: Failed to read file: " + virtual_path;
+    }
+    if ((info.st_mode & S_IFMT) != S_IFREG) {
         return "Error: Path is not a file: " + virtual_path;
     }
-    
-    try {
-        ifstream file(real_path);
-        if (!file.is_open()) {
-            return "Error: Cannot open file for reading: " + virtual_path;
-        }
-        
-        stringstream buffer;
-        buffer << file.rdbuf();
-        file.close();
-        
-        if (file.fail() && !file.eof()) {
+
+    size = static_cast<long long>(info.st_size);
+    fd = file.release();
+    return "";
+}
+
+string FileManager::readFile(const string& virtual_path) {
+    int raw_fd = -1;
+    long long size = 0;
+    string error = openForRead(virtual_path, raw_fd, size);
+    if (!error.empty()) {
+        return error;
+    }
+    ScopedFd fd(raw_fd);
+
+    string content;
+    content.resize(static_cast<size_t>(size));
+    size_t total = 0;
+    while (true) {
+        if (total == content.size()) {
+            // File grew since fstat; keep reading in chunks
+            content.resize(content.size() + 16384);
+        }
+        ssize_t n = ::read(fd.get(), &content[total], content.size() - total);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
             return "Error: Failed to read file: " + virtual_path;
         }
-        
-        return buffer.str();
-    } catch (const exception& e) {
-        return "Error reading file: " + string(e.what());
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
     }
+    content.resize(total);
+
+    return content;
+}
+
+// Engine request that opens a file and, once that completes, reads [offset, offset + length) of it
+static IoEngine::Request makeRangeRead(const string& resolved, const string& virtual_path, long long offset,
+                                       size_t length, const FileManager::ReadCallback& done) {
+    return IoEngine::openRequest(resolved, O_RDONLY, 0, [=](const IoEngine::Result& opened) {
+        auto result = make_shared<FileManager::ReadResult>();
+        if (opened.error != 0) {
+            if (opened.error == ENOENT) {
+                result->error = "Error: File does not exist: " + virtual_path;
+            } else if (Sandbox::isEscapeError(opened.error)) {
+                result->error = "Error: Invalid file path or access denied";
+            } else {
+                result->error = "Error: Cannot open file for reading: " + virtual_path;
+            }
+            done(*result);
+            return;
+        }
+
+        // fstat of an open descriptor never waits on the disk
+        int fd = static_cast<int>(opened.value);
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            result->error = "Error: Failed to read file: " + virtual_path;
+        } else if ((info.st_mode & S_IFMT) != S_IFREG) {
+            result->error = "Error: Path is not a file: " + virtual_path;
+        }
+        if (!result->error.empty()) {
+            close(fd);
+            done(*result);
+            return;
+        }
+        result->file_size = static_cast<long long>(info.st_size);
+        if (offset >= result->file_size) {
+            close(fd);
+            done(*result);
+            return;
+        }
+
+        size_t count = std::min(length, static_cast<size_t>(result->file_size - offset));
+        result->data.resize(count);
+        IoEngine::submit(IoEngine::readRequest(fd, &result->data[0], count, static_cast<uint64_t>(offset),
+                                               [=](const IoEngine::Result& read) {
+            close(fd);
+            if (read.error != 0) {
+                result->data.clear();
+                result->error = "Error: Failed to read file: " + virtual_path;
+            } else {
+                // Short only if the file was truncated since the fstat
+                result->data.resize(static_cast<size_t>(read.value));
+            }
+            done(*result);
+        }));
+    });
+}
+
+void FileManager::readRangeAsync(const string& virtual_path, long long offset, size_t length, ReadCallback done) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+    if (offset < 0 || !validateFileOperation(resolved, "read")) {
+        ReadResult result;
+        result.error = (offset < 0) ? "Error: Invalid offset: " + to_string(offset)
+                                    : "Error: Invalid file path or access denied";
+        done(result);
+        return;
+    }
+    IoEngine::submit(makeRangeRead(resolved, virtual_path, offset, length, done));
+}
+
+string FileManager::readRange(const string& virtual_path, long long offset, size_t length,
+                              long long* file_size) {
+    if (offset < 0) {
+        return "Error: Invalid offset: " + std::to_string(offset);
+    }
+
+    int raw_fd = -1;
+    long long size = 0;
+    string error = openForRead(virtual_path, raw_fd, size);
+    if (!error.empty()) {
+        return error;
+    }
+    ScopedFd fd(raw_fd);
+    if (file_size != nullptr) {
+        *file_size = size;
+    }
+
+    if (offset >= size) {
+        return "";
+    }
+    length = static_cast<size_t>(std::min<long long>(static_cast<long long>(length), size - offset));
+
+    // pread only touches the requested pages, however large the file is
+    string content;
+    content.resize(length);
+    size_t total = 0;
+    while (total < length) {
+        ssize_t n = ::pread(fd.get(), &content[total], length - total, static_cast<off_t>(offset + total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return "Error: Failed to read file: " + virtual_path;
+        }
+        if (n == 0) {
+            break;  // Truncated since fstat
+        }
+        total += static_cast<size_t>(n);
+    }
+    content.resize(total);
+
+    return content;
+}
+
+FileManager::MappedFile FileManager::mapFile(const string& virtual_path, AccessPattern pattern) {
+    int raw_fd = -1;
+    long long size = 0;
+    string error = openForRead(virtual_path, raw_fd, size);
+    if (!error.empty()) {
+        MappedFile mapped;
+        mapped.error_ = error;
+        return mapped;
+    }
+    ScopedFd fd(raw_fd);
+
+    // Name the file in the descriptor variant's "Error: Failed to map file (reason)"
+    MappedFile mapped = mapFile(fd.get(), pattern);
+    static const string MAP_FAILED_PREFIX = "Error: Failed to map file";
+    if (!mapped.isOpen() && mapped.error_.compare(0, MAP_FAILED_PREFIX.size(), MAP_FAILED_PREFIX) == 0) {
+        mapped.error_.insert(MAP_FAILED_PREFIX.size(), ": " + virtual_path);
+    }
+    return mapped;
+}
+
+FileManager::MappedFile FileManager::mapFile(int fd, AccessPattern pattern) {
+    MappedFile mapped;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG) {
+        mapped.error_ = "Error: Path is not a file";
+        return mapped;
+    }
+    long long size = static_cast<long long>(info.st_size);
+
+    if (size == 0) {
+        mapped.open_ = true;
+        return mapped;
+    }
+
+#ifdef _WIN32
+    // Read from the start regardless of where the caller left the descriptor
+    mapped.fallback_.resize(static_cast<size_t>(size));
+    size_t total = 0;
+    _lseeki64(fd, 0, SEEK_SET);
+    while (total < mapped.fallback_.size()) {
+        int n = ::read(fd, &mapped.fallback_[total], static_cast<unsigned int>(mapped.fallback_.size() - total));
+        if (n <= 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    mapped.fallback_.resize(total);
+    mapped.size_ = total;
+    (void)pattern;
+#else
+    // The mapping keeps the file referenced; the descriptor can be closed right away
+    void* address = mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        mapped.error_ = string("Error: Failed to map file (") + strerror(errno) + ")";
+        return mapped;
+    }
+    mapped.address_ = address;
+    mapped.size_ = static_cast<size_t>(size);
+    mapped.advise(0, mapped.size_, pattern);
+#endif
+
+    mapped.open_ = true;
+    return mapped;
+}
+
+FileManager::MappedFile::MappedFile() : address_(nullptr), size_(0), open_(false) {}
+
+FileManager::MappedFile::~MappedFile() {
+    reset();
+}
+
+FileManager::MappedFile::MappedFile(MappedFile&& other) noexcept
+    : address_(other.address_), size_(other.size_), open_(other.open_),
+      error_(std::move(other.error_)), fallback_(std::move(other.fallback_)) {
+    other.address_ = nullptr;
+    other.size_ = 0;
+    other.open_ = false;
+}
+
+FileManager::MappedFile& FileManager::MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        reset();
+        address_ = other.address_;
+        size_ = other.size_;
+        open_ = other.open_;
+        error_ = std::move(other.error_);
+        fallback_ = std::move(other.fallback_);
+        other.address_ = nullptr;
+        other.size_ = 0;
+        other.open_ = false;
+    }
+    return *this;
+}
+
+void FileManager::MappedFile::reset() {
+#ifndef _WIN32
+    if (address_ != nullptr) {
+        munmap(address_, size_);
+    }
+#endif
+    address_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    fallback_.clear();
+}
+
+bool FileManager::MappedFile::isOpen() const {
+    return open_;
+}
+
+const char* FileManager::MappedFile::data() const {
+    if (address_ != nullptr) {
+        return static_cast<const char*>(address_);
+    }
+    return fallback_.empty() ? nullptr : fallback_.data();
+}
+
+size_t FileManager::MappedFile::size() const {
+    return size_;
+}
+
+std::string_view FileManager::MappedFile::view() const {
+    return std::string_view(data(), size_);
+}
+
+const string& FileManager::MappedFile::getError() const {
+    return error_;
+}
+
+void FileManager::MappedFile::advise(size_t offset, size_t length, AccessPattern pattern) const {
+#ifndef _WIN32
+    if (address_ == nullptr || offset >= size_) {
+        return;
+    }
+    // madvise wants a page-aligned start
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t aligned = offset - offset % page_size;
+    length = std::min(length, size_ - offset) + (offset - aligned);
+
+    int advice = MADV_NORMAL;
+    switch (pattern) {
+        case AccessPattern::Normal:     advice = MADV_NORMAL; break;
+        case AccessPattern::Sequential: advice = MADV_SEQUENTIAL; break;
+        case AccessPattern::Random:     advice = MADV_RANDOM; break;
+        case AccessPattern::WillNeed:   advice = MADV_WILLNEED; break;
+    }
+    // Only a hint: failure changes nothing but performance
+    madvise(static_cast<char*>(address_) + aligned, length, advice);
+#else
+    (void)offset;
+    (void)length;
+    (void)pattern;
+#endif
 }
 
 string FileManager::deleteFile(const string& virtual_path) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    
-    if (!validateFileOperation(real_path, "delete")) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+
+    if (!validateFileOperation(resolved, "delete")) {
         return "Error: Invalid file path or access denied";
     }
-    
-    if (!PathUtils::pathExists(virtual_path)) {
+
+    struct stat info;
+    if (!Sandbox::statPath(resolved, info)) {
+        if (Sandbox::isEscapeError(errno)) {
+            return "Error: Invalid file path or access denied";
+        }
         return "Error: File does not exist: " + virtual_path;
     }
-    
-    if (!PathUtils::isFile(virtual_path)) {
+
+    if ((info.st_mode & S_IFMT) != S_IFREG) {
         return "Error: Path is not a file: " + virtual_path;
     }
-    
-    try {
-        if (remove(real_path.c_str()) != 0) {
-            return "Error: Failed to delete file: " + virtual_path;
-        }
-        
-        return "File deleted: " + virtual_path;
-    } catch (const exception& e) {
-        return "Error deleting file: " + string(e.what());
+
+    if (!Sandbox::removeFile(resolved)) {
+        return "Error: Failed to delete file: " + virtual_path;
     }
+    MetadataCache::invalidateTree(resolved);
+    FileIndex::update(resolved);
+
+    return "File deleted: " + virtual_path;
+}
+
+void FileManager::setDefaultDurability(Durability durability) {
+    default_durability.store(durability);
+}
+
+FileManager::Durability FileManager::getDefaultDurability() {
+    return default_durability.load();
+}
+
+bool FileManager::parseDurability(const string& name, Durability& durability) {
+    string lower = name;
+    transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) {
+        return static_cast<char>(tolower(c));
+    });
+
+    if (lower == "none") {
+        durability = Durability::None;
+    } else if (lower == "atomic") {
+        durability = Durability::Atomic;
+    } else if (lower == "durable") {
+        durability = Durability::Durable;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+string FileManager::durabilityName(Durability durability) {
+    switch (durability) {
+        case Durability::None:    return "none";
+        case Durability::Atomic:  return "atomic";
+        case Durability::Durable: return "durable";
+    }
+    return "unknown";
 }
 
 bool FileManager::fileExists(const string& virtual_path) {
-    return PathUtils::pathExists(virtual_path) && PathUtils::isFile(virtual_path);
+    return PathUtils::isFile(virtual_path);
 }
 
 long long FileManager::getFileSize(const string& virtual_path) {
-    string real_path = PathUtils::virtualToRealPath(virtual_path);
-    
-    if (!PathUtils::isPathSafe(real_path) || !PathUtils::isFile(virtual_path)) {
+    struct stat info;
+    if (!MetadataCache::statPath(PathUtils::resolvePath(virtual_path), info)) {
         return -1;
     }
-    
-    try {
-        ifstream file(real_path, ios::binary | ios::ate);
-        if (!file.is_open()) {
-            return -1;
-        }
-        
-        long long size = file.tellg();
-        file.close();
-        return size;
-    } catch (const exception&) {
+
+    if ((info.st_mode & S_IFMT) != S_IFREG) {
         return -1;
     }
+
+    return static_cast<long long>(info.st_size);
 }
 
-bool FileManager::validateFileOperation(const string& real_path, const string& operation) {
-    if (real_path.empty()) {
+bool FileManager::validateFileOperation(const string& virtual_path, const string& operation) {
+    if (virtual_path.empty() || !Sandbox::isOpen()) {
+        return false;
+    }
+
+    // Writing to the root itself is never meaningful
+    if (virtual_path == "/" && operation != "read") {
         return false;
     }
-    
-    if (!PathUtils::isPathSafe(real_path)) {
+
+    // FileXplore's bookkeeping directories are only reached through their owners
+    if (PathUtils::isReservedPath(virtual_path)) {
         return false;
     }
-    
-    // Additional validation can be added here based on operation type
+
+    // Containment is enforced by the sandbox when the path is opened
     return true;
-}
\ No newline at end of file
+}
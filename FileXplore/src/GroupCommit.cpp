@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cerrno>
+#include "../include/GroupCommit.h"
+#include "../include/Logger.h"
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+#endif
+
+// Static member definitions
+std::mutex GroupCommit::mutex;
+std::condition_variable GroupCommit::done_cv;
+std::condition_variable GroupCommit::join_cv;
+std::shared_ptr<GroupCommit::Batch> GroupCommit::open_batch;
+bool GroupCommit::leader_active = false;
+size_t GroupCommit::last_batch_size = 1;
+std::chrono::microseconds GroupCommit::window(500);
+bool GroupCommit::enabled = true;
+GroupCommit::Stats GroupCommit::stats;
+
+// fsync one descriptor, retrying on EINTR
+static bool syncDescriptor(int fd) {
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#else
+    while (::fsync(fd) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+bool GroupCommit::sync(int fd) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stats.requests++;
+    if (!enabled) {
+        stats.flushes++;
+        lock.unlock();
+        return syncDescriptor(fd);
+    }
+
+    if (!open_batch) {
+        open_batch = std::make_shared<Batch>();
+    }
+    std::shared_ptr<Batch> batch = open_batch;
+    size_t slot = batch->fds.size();
+    batch->fds.push_back(fd);
+    if (leader_active) {
+        join_cv.notify_one();
+    }
+
+    while (!batch->done) {
+        if (leader_active) {
+            // A flush is running; its leader wakes us when it finishes
+            done_cv.wait(lock);
+            continue;
+        }
+
+        // Lead the open batch (ours: nobody else can close it while no leader is active)
+        // Waiting only pays off under concurrency: expect as many writers as last time,
+        // and never make a lone writer wait
+        leader_active = true;
+        size_t expected = last_batch_size;
+        if (window.count() > 0 && expected > 1) {
+            join_cv.wait_for(lock, window, [&]() {
+                return open_batch->fds.size() >= expected;
+            });
+        }
+        std::shared_ptr<Batch> closing = open_batch;
+        open_batch.reset();
+
+        lock.unlock();
+        bool ok = flush(closing->fds, closing->ok);
+        lock.lock();
+
+        closing->done = true;
+        last_batch_size = closing->fds.size();
+        stats.flushes++;
+        if (!ok) {
+            stats.failures++;
+        }
+        leader_active = false;
+        done_cv.notify_all();
+    }
+    return batch->ok[slot] != 0;
+}
+
+bool GroupCommit::flush(const std::vector<int>& fds, std::vector<char>& ok) {
+#if defined(__linux__)
+    // Queue every descriptor's dirty pages first so the device sees them as one burst;
+    // only a hint (directories refuse it), the fsyncs below are what report errors
+    if (fds.size() > 1) {
+        for (int fd : fds) {
+            (void)::sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+        }
+    }
+#endif
+    // Each descriptor gets its own fsync: syncfs would flush unrelated files too and
+    // does not report writeback errors before Linux 5.8
+    ok.assign(fds.size(), 0);
+    bool all = true;
+    for (size_t i = 0; i < fds.size(); ++i) {
+        ok[i] = syncDescriptor(fds[i]);
+        all = all && ok[i];
+    }
+    FX_LOG_TRACE("Group commit flushed " << fds.size() << " writers");
+    return all;
+}
+
+void GroupCommit::setWindow(std::chrono::microseconds new_window) {
+    std::lock_guard<std::mutex> lock(mutex);
+    window = std::max(new_window, std::chrono::microseconds(0));
+}
+
+std::chrono::microseconds GroupCommit::getWindow() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return window;
+}
+
+void GroupCommit::setEnabled(bool new_enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = new_enabled;
+}
+
+bool GroupCommit::isEnabled() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return enabled;
+}
+
+GroupCommit::Stats GroupCommit::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void GroupCommit::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats = Stats();
+}
@@ -4,14 +4,13 @@ using namespace std;
 #include <iostream>
 #include <iomanip>
 
-// Static member definition
-deque<string> HistoryManager::command_history;
-
 void HistoryManager::addCommand(const string& command) {
     if (command.empty()) {
         return;
     }
     
+    lock_guard<mutex> lock(history_mutex);
+    
     // Don't add duplicate consecutive commands
     if (!command_history.empty() && command_history.back() == command) {
         return;
@@ -26,11 +25,13 @@ void HistoryManager::addCommand(const string& command) {
     }
 }
 
-vector<string> HistoryManager::getHistory() {
+vector<string> HistoryManager::getHistory() const {
+    lock_guard<mutex> lock(history_mutex);
     return vector<string>(command_history.begin(), command_history.end());
 }
 
-void HistoryManager::displayHistory() {
+void HistoryManager::displayHistory() const {
+    lock_guard<mutex> lock(history_mutex);
     if (command_history.empty()) {
         cout << "No command history available." << endl;
         return;
@@ -47,15 +48,20 @@ void HistoryManager::displayHistory() {
 }
 
 void HistoryManager::clearHistory() {
-    command_history.clear();
+    {
+        lock_guard<mutex> lock(history_mutex);
+        command_history.clear();
+    }
     cout << "Command history cleared." << endl;
 }
 
-size_t HistoryManager::getHistorySize() {
+size_t HistoryManager::getHistorySize() const {
+    lock_guard<mutex> lock(history_mutex);
     return command_history.size();
 }
 
-string HistoryManager::getCommand(size_t index) {
+string HistoryManager::getCommand(size_t index) const {
+    lock_guard<mutex> lock(history_mutex);
     if (index >= command_history.size()) {
         return "";
     }
@@ -65,7 +71,7 @@ string HistoryManager::getCommand(size_t index) {
     return command_history[actual_index];
 }
 
-bool HistoryManager::saveHistory() {
+bool HistoryManager::saveHistory() const {
     vector<string> history = getHistory();
     return PersistenceManager::saveHistory(history);
 }
@@ -74,6 +80,7 @@ bool HistoryManager::loadHistory() {
     vector<string> history = PersistenceManager::loadHistory();
     
     // Clear current history and load from persistence
+    lock_guard<mutex> lock(history_mutex);
     command_history.clear();
     
     for (const string& command : history) {
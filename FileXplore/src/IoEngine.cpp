@@ -0,0 +1,572 @@
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <cstdlib>
+#include "../include/IoEngine.h"
+#include "../include/Sandbox.h"
+#include "../include/Logger.h"
+#include <fcntl.h>
+
+using std::string;
+using std::vector;
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+    #if defined(__linux__) && defined(FX_ENABLE_IO_URING) && __has_include(<linux/io_uring.h>)
+        #include <sys/mman.h>
+        #include <sys/syscall.h>
+        #include <linux/io_uring.h>
+        #include <linux/openat2.h>
+        #if defined(SYS_io_uring_setup) && defined(SYS_io_uring_enter) && defined(SYS_io_uring_register)
+            #define FX_HAVE_IO_URING 1
+        #endif
+    #endif
+#endif
+
+#ifndef FX_HAVE_IO_URING
+    #define FX_HAVE_IO_URING 0
+#endif
+
+#ifndef O_CLOEXEC
+    #define O_CLOEXEC 0
+#endif
+
+// Submission queue depth; the completion queue is twice as deep
+static const unsigned RING_ENTRIES = 256;
+
+// Fallback pool size when none is given: I/O-bound, so a few threads per core is plenty
+static const size_t MAX_POOL_THREADS = 8;
+
+#if FX_HAVE_IO_URING
+
+// A request in flight: owns what the kernel reads while the SQE is processed
+struct InFlight {
+    IoEngine::Request request;
+    string relative;
+    struct open_how how;
+};
+
+struct IoEngine::Ring {
+    int fd = -1;
+    unsigned sq_entries = 0;
+    unsigned cq_entries = 0;
+
+    void* sq_map = MAP_FAILED;
+    size_t sq_map_size = 0;
+    void* cq_map = MAP_FAILED;
+    size_t cq_map_size = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // Submissions are serialized; inflight never exceeds the completion queue
+    std::mutex submit_mutex;
+    std::condition_variable space_cv;
+    size_t inflight = 0;
+
+    std::thread reaper;
+
+    ~Ring() {
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size);
+        }
+        if (cq_map != MAP_FAILED && cq_map != sq_map) {
+            munmap(cq_map, cq_map_size);
+        }
+        if (sq_map != MAP_FAILED) {
+            munmap(sq_map, sq_map_size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+static int ringSetup(unsigned entries, io_uring_params& params) {
+    return static_cast<int>(syscall(SYS_io_uring_setup, entries, &params));
+}
+
+static int ringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+// Strip the leading '/' of a normalized virtual path; the root maps to "."
+static string toRelative(const string& virtual_path) {
+    size_t start = virtual_path.find_first_not_of('/');
+    return (start == string::npos) ? "." : virtual_path.substr(start);
+}
+
+#else
+
+struct IoEngine::Ring {};
+
+#endif
+
+// Static member definitions
+std::atomic<IoEngine::Backend> IoEngine::backend(IoEngine::Backend::Inline);
+std::unique_ptr<IoEngine::Ring> IoEngine::ring;
+std::mutex IoEngine::pool_mutex;
+std::condition_variable IoEngine::pool_cv;
+std::deque<IoEngine::Request> IoEngine::pool_queue;
+vector<std::thread> IoEngine::pool_threads;
+bool IoEngine::pool_stopping = false;
+
+IoEngine::Request IoEngine::readRequest(int fd, void* buffer, size_t length, uint64_t offset, Callback callback) {
+    Request request;
+    request.op = Op::Read;
+    request.fd = fd;
+    request.buffer = buffer;
+    request.length = length;
+    request.offset = offset;
+    request.callback = std::move(callback);
+    return request;
+}
+
+IoEngine::Request IoEngine::writeRequest(int fd, const void* buffer, size_t length, uint64_t offset,
+                                         Callback callback) {
+    Request request = readRequest(fd, const_cast<void*>(buffer), length, offset, std::move(callback));
+    request.op = Op::Write;
+    return request;
+}
+
+IoEngine::Request IoEngine::openRequest(const string& virtual_path, int flags, mode_t mode, Callback callback) {
+    Request request;
+    request.op = Op::Open;
+    request.path = virtual_path;
+    request.flags = flags;
+    request.mode = mode;
+    request.callback = std::move(callback);
+    return request;
+}
+
+IoEngine::Request IoEngine::statRequest(const string& virtual_path, struct stat& info, Callback callback) {
+    Request request;
+    request.op = Op::Stat;
+    request.path = virtual_path;
+    request.info = &info;
+    request.callback = std::move(callback);
+    return request;
+}
+
+bool IoEngine::start(bool use_io_uring, size_t threads) {
+    if (backend.load() != Backend::Inline) {
+        return true;
+    }
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        std::atexit(stop);
+    }
+
+    // Opens through the ring rely on openat2's RESOLVE_BENEATH, like Sandbox::openPath
+    if (use_io_uring && Sandbox::usesOpenat2() && startRing(RING_ENTRIES)) {
+        backend.store(Backend::IoUring);
+        FX_LOG_DEBUG("I/O engine: io_uring with " << RING_ENTRIES << " entries");
+        return true;
+    }
+
+    if (threads == 0) {
+        threads = std::min<size_t>(MAX_POOL_THREADS, std::max(2u, std::thread::hardware_concurrency()));
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        pool_stopping = false;
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        pool_threads.emplace_back(poolLoop);
+    }
+    backend.store(Backend::ThreadPool);
+    FX_LOG_DEBUG("I/O engine: thread pool with " << threads << " threads");
+    return true;
+}
+
+void IoEngine::stop() {
+    Backend previous = backend.exchange(Backend::Inline);
+    if (previous == Backend::IoUring) {
+        stopRing();
+    } else if (previous == Backend::ThreadPool) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            pool_stopping = true;
+        }
+        pool_cv.notify_all();
+        for (auto& thread : pool_threads) {
+            thread.join();
+        }
+        pool_threads.clear();
+    }
+}
+
+IoEngine::Backend IoEngine::getBackend() {
+    return backend.load();
+}
+
+string IoEngine::backendName(Backend which) {
+    switch (which) {
+        case Backend::Inline:     return "inline";
+        case Backend::IoUring:    return "io_uring";
+        case Backend::ThreadPool: return "thread pool";
+    }
+    return "unknown";
+}
+
+void IoEngine::submit(Request request) {
+    switch (backend.load()) {
+        case Backend::IoUring: {
+            vector<Request> requests;
+            requests.push_back(std::move(request));
+            submitToRing(requests);
+            break;
+        }
+        case Backend::ThreadPool: {
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                pool_queue.push_back(std::move(request));
+            }
+            pool_cv.notify_one();
+            break;
+        }
+        case Backend::Inline:
+            runBlocking(request);
+            break;
+    }
+}
+
+// Wrap a request so its result fulfils a future
+static std::future<IoEngine::Result> submitForFuture(IoEngine::Request request) {
+    auto promise = std::make_shared<std::promise<IoEngine::Result>>();
+    std::future<IoEngine::Result> future = promise->get_future();
+    request.callback = [promise](const IoEngine::Result& result) {
+        promise->set_value(result);
+    };
+    IoEngine::submit(std::move(request));
+    return future;
+}
+
+std::future<IoEngine::Result> IoEngine::read(int fd, void* buffer, size_t length, uint64_t offset) {
+    return submitForFuture(readRequest(fd, buffer, length, offset, nullptr));
+}
+
+std::future<IoEngine::Result> IoEngine::write(int fd, const void* buffer, size_t length, uint64_t offset) {
+    return submitForFuture(writeRequest(fd, buffer, length, offset, nullptr));
+}
+
+std::future<IoEngine::Result> IoEngine::open(const string& virtual_path, int flags, mode_t mode) {
+    return submitForFuture(openRequest(virtual_path, flags, mode, nullptr));
+}
+
+std::future<IoEngine::Result> IoEngine::stat(const string& virtual_path, struct stat& info) {
+    return submitForFuture(statRequest(virtual_path, info, nullptr));
+}
+
+void IoEngine::runBlocking(Request& request) {
+    Result result;
+    long long value = -1;
+    switch (request.op) {
+        case Op::Read:
+            do {
+                value = ::pread(request.fd, request.buffer, request.length, static_cast<off_t>(request.offset));
+            } while (value < 0 && errno == EINTR);
+            break;
+        case Op::Write:
+            do {
+                value = ::pwrite(request.fd, request.buffer, request.length, static_cast<off_t>(request.offset));
+            } while (value < 0 && errno == EINTR);
+            break;
+        case Op::Open:
+            value = Sandbox::openPath(request.path, request.flags, request.mode);
+            break;
+        case Op::Stat:
+            value = Sandbox::statPath(request.path, *request.info) ? 0 : -1;
+            break;
+    }
+    if (value < 0) {
+        result.error = errno;
+    } else {
+        result.value = value;
+    }
+    if (request.callback) {
+        request.callback(result);
+    }
+}
+
+void IoEngine::poolLoop() {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            pool_cv.wait(lock, []() {
+                return pool_stopping || !pool_queue.empty();
+            });
+            // Drain what is queued before stopping so no callback is lost
+            if (pool_queue.empty()) {
+                return;
+            }
+            request = std::move(pool_queue.front());
+            pool_queue.pop_front();
+        }
+        runBlocking(request);
+    }
+}
+
+#if FX_HAVE_IO_URING
+
+bool IoEngine::startRing(unsigned entries) {
+    auto instance = std::make_unique<Ring>();
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 2;
+    instance->fd = ringSetup(entries, params);
+    if (instance->fd < 0) {
+        FX_LOG_DEBUG("io_uring unavailable (" << strerror(errno) << "), using the thread pool");
+        return false;
+    }
+
+    // Every opcode the engine issues must be supported by this kernel
+    vector<char> probe_buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+    if (syscall(SYS_io_uring_register, instance->fd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+        return false;
+    }
+    for (int op : {IORING_OP_NOP, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_OPENAT2}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            FX_LOG_DEBUG("io_uring lacks opcode " << op << ", using the thread pool");
+            return false;
+        }
+    }
+
+    instance->sq_entries = params.sq_entries;
+    instance->cq_entries = params.cq_entries;
+    instance->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    instance->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map) {
+        instance->sq_map_size = instance->cq_map_size = std::max(instance->sq_map_size, instance->cq_map_size);
+    }
+
+    instance->sq_map = mmap(nullptr, instance->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            instance->fd, IORING_OFF_SQ_RING);
+    if (instance->sq_map == MAP_FAILED) {
+        return false;
+    }
+    instance->cq_map = single_map ? instance->sq_map
+                                  : mmap(nullptr, instance->cq_map_size, PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_POPULATE, instance->fd, IORING_OFF_CQ_RING);
+    if (instance->cq_map == MAP_FAILED) {
+        return false;
+    }
+    instance->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    instance->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, instance->sqes_size, PROT_READ | PROT_WRITE,
+                                                     MAP_SHARED | MAP_POPULATE, instance->fd, IORING_OFF_SQES));
+    if (instance->sqes == MAP_FAILED) {
+        return false;
+    }
+
+    char* sq = static_cast<char*>(instance->sq_map);
+    char* cq = static_cast<char*>(instance->cq_map);
+    instance->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    instance->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    instance->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    instance->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    instance->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    instance->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    instance->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    ring = std::move(instance);
+    ring->reaper = std::thread(reapLoop);
+    return true;
+}
+
+void IoEngine::submitToRing(vector<Request>& requests) {
+    Ring& r = *ring;
+    bool on_reaper = std::this_thread::get_id() == r.reaper.get_id();
+    size_t next = 0;
+    while (next < requests.size()) {
+        std::unique_lock<std::mutex> lock(r.submit_mutex);
+        if (on_reaper && r.inflight >= r.cq_entries) {
+            // A callback chaining a request must not wait for completions only it can reap
+            lock.unlock();
+            for (; next < requests.size(); ++next) {
+                runBlocking(requests[next]);
+            }
+            return;
+        }
+        // Never queue more than the completion ring can hold
+        r.space_cv.wait(lock, [&]() {
+            return r.inflight < r.cq_entries;
+        });
+        size_t count = std::min<size_t>({requests.size() - next, r.sq_entries, r.cq_entries - r.inflight});
+
+        unsigned tail = *r.sq_tail;
+        for (size_t i = 0; i < count; ++i) {
+            InFlight* op = new InFlight();
+            op->request = std::move(requests[next + i]);
+            Request& request = op->request;
+
+            unsigned index = tail & *r.sq_mask;
+            io_uring_sqe* sqe = &r.sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->user_data = reinterpret_cast<uint64_t>(op);
+            switch (request.op) {
+                case Op::Read:
+                case Op::Write:
+                    sqe->opcode = (request.op == Op::Read) ? IORING_OP_READ : IORING_OP_WRITE;
+                    sqe->fd = request.fd;
+                    sqe->addr = reinterpret_cast<uint64_t>(request.buffer);
+                    sqe->len = static_cast<uint32_t>(std::min<size_t>(request.length, 0x7ffff000));
+                    sqe->off = request.offset;
+                    break;
+                case Op::Open:
+                case Op::Stat: {
+                    // A stat is an O_PATH open whose descriptor is fstat'ed and closed on completion
+                    memset(&op->how, 0, sizeof(op->how));
+                    op->how.flags = static_cast<uint64_t>(
+                        (request.op == Op::Stat ? O_PATH : request.flags) | O_CLOEXEC);
+                    op->how.mode = (request.op == Op::Open && (request.flags & O_CREAT)) ? request.mode : 0;
+                    op->how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+                    op->relative = toRelative(request.path);
+                    sqe->opcode = IORING_OP_OPENAT2;
+                    sqe->fd = Sandbox::getRootFd();
+                    sqe->addr = reinterpret_cast<uint64_t>(op->relative.c_str());
+                    sqe->len = sizeof(op->how);
+                    sqe->off = reinterpret_cast<uint64_t>(&op->how);
+                    break;
+                }
+            }
+            r.sq_array[index] = index;
+            tail++;
+        }
+        __atomic_store_n(r.sq_tail, tail, __ATOMIC_RELEASE);
+        r.inflight += count;
+
+        // One syscall for the whole group
+        size_t submitted = 0;
+        while (submitted < count) {
+            int n = ringEnter(r.fd, static_cast<unsigned>(count - submitted), 0, 0);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                FX_LOG_ERROR("io_uring_enter failed: " << strerror(errno));
+                break;
+            }
+            submitted += static_cast<size_t>(n);
+        }
+        next += count;
+    }
+}
+
+void IoEngine::reapLoop() {
+    Ring& r = *ring;
+    bool stopping = false;
+    while (true) {
+        unsigned head = *r.cq_head;
+        unsigned tail = __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            if (stopping) {
+                return;
+            }
+            if (ringEnter(r.fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                FX_LOG_ERROR("io_uring wait failed: " << strerror(errno));
+                return;
+            }
+            continue;
+        }
+
+        io_uring_cqe cqe = r.cqes[head & *r.cq_mask];
+        __atomic_store_n(r.cq_head, head + 1, __ATOMIC_RELEASE);
+
+        if (cqe.user_data == 0) {
+            // Stop marker, submitted once nothing else was in flight
+            stopping = true;
+            continue;
+        }
+
+        std::unique_ptr<InFlight> op(reinterpret_cast<InFlight*>(cqe.user_data));
+        Request& request = op->request;
+        Result result;
+        if (cqe.res < 0) {
+            result.error = -cqe.res;
+        } else {
+            result.value = cqe.res;
+        }
+
+        // openat2 returns EAGAIN when a rename raced with the lookup; retry it in place
+        if ((request.op == Op::Open || request.op == Op::Stat) && result.error == EAGAIN) {
+            int fd = Sandbox::openPath(request.path, request.op == Op::Stat ? O_PATH : request.flags,
+                                       request.mode);
+            result.error = (fd < 0) ? errno : 0;
+            result.value = (fd < 0) ? 0 : fd;
+        }
+        if (request.op == Op::Stat && result.error == 0) {
+            int fd = static_cast<int>(result.value);
+            result.error = (fstat(fd, request.info) == 0) ? 0 : errno;
+            result.value = 0;
+            close(fd);
+        }
+
+        // Free the slot first so a callback that chains another request finds room
+        {
+            std::lock_guard<std::mutex> lock(r.submit_mutex);
+            r.inflight--;
+        }
+        r.space_cv.notify_all();
+        if (request.callback) {
+            request.callback(result);
+        }
+    }
+}
+
+void IoEngine::stopRing() {
+    Ring& r = *ring;
+    {
+        std::unique_lock<std::mutex> lock(r.submit_mutex);
+        r.space_cv.wait(lock, [&]() {
+            return r.inflight == 0;
+        });
+        unsigned tail = *r.sq_tail;
+        unsigned index = tail & *r.sq_mask;
+        memset(&r.sqes[index], 0, sizeof(io_uring_sqe));
+        r.sqes[index].opcode = IORING_OP_NOP;
+        r.sqes[index].user_data = 0;
+        r.sq_array[index] = index;
+        __atomic_store_n(r.sq_tail, tail + 1, __ATOMIC_RELEASE);
+        while (ringEnter(r.fd, 1, 0, 0) < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+        }
+    }
+    r.reaper.join();
+    ring.reset();
+}
+
+#else
+
+bool IoEngine::startRing(unsigned entries) {
+    (void)entries;
+    return false;
+}
+
+void IoEngine::stopRing() {
+}
+
+void IoEngine::submitToRing(vector<Request>& requests) {
+    for (auto& request : requests) {
+        runBlocking(request);
+    }
+}
+
+void IoEngine::reapLoop() {
+}
+
+#endif
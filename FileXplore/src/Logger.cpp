@@ -0,0 +1,226 @@
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+using std::string;
+#include "../include/Logger.h"
+
+Logger::Slot Logger::ring[Logger::RING_SIZE];
+std::atomic<std::size_t> Logger::enqueue_pos(0);
+std::size_t Logger::dequeue_pos = 0;
+std::atomic<int> Logger::runtime_level(static_cast<int>(LogLevel::Info));
+std::atomic<std::uint64_t> Logger::dropped(0);
+std::atomic<bool> Logger::running(false);
+std::atomic<bool> Logger::wake_pending(false);
+std::mutex Logger::wake_mutex;
+std::condition_variable Logger::wake_cv;
+std::thread Logger::drainer;
+
+// The drain thread also wakes on its own this often, bounding the delay of a wake-up
+// that raced with it going to sleep
+static const std::chrono::milliseconds DRAIN_INTERVAL(100);
+
+static std::int64_t nowMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void Logger::start() {
+    if (running.load()) {
+        return;
+    }
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        // Slot i starts out free for position i; nothing is queued before the first start
+        for (std::size_t i = 0; i < RING_SIZE; ++i) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        std::atexit(stop);
+    }
+    running.store(true, std::memory_order_release);
+    drainer = std::thread(drainLoop);
+}
+
+void Logger::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        wake_pending.store(true);
+    }
+    wake_cv.notify_one();
+    if (drainer.joinable()) {
+        drainer.join();
+    }
+}
+
+LogLevel Logger::getLevel() {
+    return static_cast<LogLevel>(runtime_level.load());
+}
+
+void Logger::setLevel(LogLevel level) {
+    runtime_level.store(static_cast<int>(level));
+}
+
+LogLevel Logger::getCompiledLevel() {
+    return static_cast<LogLevel>(FX_LOG_COMPILE_LEVEL);
+}
+
+bool Logger::parseLevel(const string& name, LogLevel& level) {
+    string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    if (lower == "trace") {
+        level = LogLevel::Trace;
+    } else if (lower == "debug") {
+        level = LogLevel::Debug;
+    } else if (lower == "info") {
+        level = LogLevel::Info;
+    } else if (lower == "warn" || lower == "warning") {
+        level = LogLevel::Warn;
+    } else if (lower == "error") {
+        level = LogLevel::Error;
+    } else if (lower == "off") {
+        level = LogLevel::Off;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+string Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace: return "trace";
+        case LogLevel::Debug: return "debug";
+        case LogLevel::Info:  return "info";
+        case LogLevel::Warn:  return "warn";
+        case LogLevel::Error: return "error";
+        case LogLevel::Off:   return "off";
+    }
+    return "unknown";
+}
+
+std::uint64_t Logger::getDropped() {
+    return dropped.load();
+}
+
+void Logger::write(LogLevel level, const string& message) {
+    std::int64_t time_ms = nowMilliseconds();
+    std::size_t length = std::min(message.size(), MAX_MESSAGE);
+
+    // Before start() (or after stop()) there is no drainer: write straight through
+    if (!running.load(std::memory_order_acquire)) {
+        string line;
+        formatLine(level, time_ms, message.data(), length, line);
+        std::fwrite(line.data(), 1, line.size(), stderr);
+        return;
+    }
+
+    // Claim a position: the slot is free when its sequence equals the position
+    std::size_t position = enqueue_pos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &ring[position & (RING_SIZE - 1)];
+        std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0) {
+            if (enqueue_pos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Ring full: never block the caller
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    slot->time_ms = time_ms;
+    slot->length = static_cast<std::uint16_t>(length);
+    std::memcpy(slot->text, message.data(), length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    if (!wake_pending.exchange(true, std::memory_order_acq_rel)) {
+        wake_cv.notify_one();
+    }
+}
+
+void Logger::formatLine(LogLevel level, std::int64_t time_ms, const char* text, std::size_t length,
+                        string& out) {
+    std::time_t seconds = static_cast<std::time_t>(time_ms / 1000);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char stamp[32];
+    std::size_t stamp_length = std::strftime(stamp, sizeof(stamp), "%H:%M:%S", &local);
+    std::snprintf(stamp + stamp_length, sizeof(stamp) - stamp_length, ".%03d",
+                  static_cast<int>(time_ms % 1000));
+
+    string name = levelName(level);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+        return static_cast<char>(std::toupper(c));
+    });
+
+    out += stamp;
+    out += " [";
+    out += name;
+    out += "] ";
+    out.append(text, length);
+    out += '\n';
+}
+
+bool Logger::drain() {
+    string batch;
+    while (true) {
+        Slot& slot = ring[dequeue_pos & (RING_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;
+        }
+        formatLine(slot.level, slot.time_ms, slot.text, slot.length, batch);
+        // Hand the slot back for the position one lap ahead
+        slot.sequence.store(dequeue_pos + RING_SIZE, std::memory_order_release);
+        ++dequeue_pos;
+    }
+
+    static std::uint64_t reported_drops = 0;
+    std::uint64_t drops = dropped.load();
+    if (drops != reported_drops) {
+        batch += "Warning: " + std::to_string(drops - reported_drops) + " log messages dropped\n";
+        reported_drops = drops;
+    }
+
+    if (batch.empty()) {
+        return false;
+    }
+    // One write and one flush per batch instead of per line
+    std::fwrite(batch.data(), 1, batch.size(), stderr);
+    std::fflush(stderr);
+    return true;
+}
+
+void Logger::drainLoop() {
+    while (running.load()) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake_cv.wait_for(lock, DRAIN_INTERVAL, []() {
+                return wake_pending.load();
+            });
+        }
+        wake_pending.store(false);
+        drain();
+    }
+    drain();
+}
@@ -0,0 +1,403 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+using std::string;
+using std::vector;
+using std::cerr;
+using std::endl;
+#include "../include/MetadataCache.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include <fcntl.h>
+
+#if defined(__linux__)
+    #include <sys/inotify.h>
+    #include <poll.h>
+    #include <unistd.h>
+    #define FX_HAVE_INOTIFY 1
+#else
+    #define FX_HAVE_INOTIFY 0
+#endif
+
+// Static member definitions
+std::map<string, MetadataCache::Entry> MetadataCache::entries;
+std::shared_mutex MetadataCache::entries_mutex;
+std::atomic<std::uint64_t> MetadataCache::generation(0);
+std::atomic<std::uint64_t> MetadataCache::hits(0);
+std::atomic<std::uint64_t> MetadataCache::misses(0);
+std::atomic<bool> MetadataCache::enabled(false);
+std::mutex MetadataCache::watch_mutex;
+std::unordered_map<int, string> MetadataCache::watch_paths;
+std::map<string, int> MetadataCache::watched_dirs;
+int MetadataCache::inotify_fd = -1;
+int MetadataCache::wake_pipe[2] = {-1, -1};
+std::thread MetadataCache::watcher;
+
+// Beyond this many entries the cache is simply emptied
+static const size_t MAX_ENTRIES = 65536;
+
+// Token handed out by a fill; 0 is reserved for "do not store"
+static std::uint64_t tokenFor(std::uint64_t generation_value) {
+    return generation_value + 1;
+}
+
+static string joinChild(const string& dir, const char* name) {
+    return (dir == "/") ? "/" + string(name) : dir + "/" + name;
+}
+
+bool MetadataCache::start() {
+    stop();
+
+#if FX_HAVE_INOTIFY
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        cerr << "Warning: inotify unavailable, metadata cache disabled (" << strerror(errno) << ")" << endl;
+        return false;
+    }
+    if (pipe2(wake_pipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return false;
+    }
+
+    static bool exit_hook_registered = false;
+    if (!exit_hook_registered) {
+        // The watcher thread must be joined before static destructors run
+        std::atexit(MetadataCache::stop);
+        exit_hook_registered = true;
+    }
+
+    enabled = true;
+    watcher = std::thread(watchLoop);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void MetadataCache::stop() {
+    enabled = false;
+
+#if FX_HAVE_INOTIFY
+    if (watcher.joinable()) {
+        char byte = 1;
+        ssize_t ignored = write(wake_pipe[1], &byte, 1);
+        (void)ignored;
+        watcher.join();
+    }
+    for (int& fd : wake_pipe) {
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+#endif
+
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex);
+        watch_paths.clear();
+        watched_dirs.clear();
+    }
+    clear();
+}
+
+bool MetadataCache::statPath(const string& virtual_path, struct stat& info) {
+    if (enabled) {
+        std::shared_lock<std::shared_mutex> lock(entries_mutex);
+        auto it = entries.find(virtual_path);
+        if (it != entries.end() && it->second.has_stat) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            if (!it->second.exists) {
+                errno = ENOENT;
+                return false;
+            }
+            info = it->second.info;
+            return true;
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+
+    // Watch the containing directory before looking, so no change can slip between
+    std::uint64_t token = 0;
+    if (enabled && ensureWatched(virtual_path == "/" ? "/" : PathUtils::getParentPath(virtual_path))) {
+        token = tokenFor(generation.load());
+    }
+
+    bool found = Sandbox::statPath(virtual_path, info);
+    int error = errno;
+    if (found || error == ENOENT) {
+        storeStat(virtual_path, found, info, token);
+    }
+    errno = error;
+    return found;
+}
+
+bool MetadataCache::lookupListing(const string& virtual_path, vector<DirManager::DirEntry>& listing) {
+    if (enabled) {
+        std::shared_lock<std::shared_mutex> lock(entries_mutex);
+        auto it = entries.find(virtual_path);
+        if (it != entries.end() && it->second.has_listing) {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            listing = it->second.listing;
+            return true;
+        }
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+std::uint64_t MetadataCache::beginListing(const string& virtual_path) {
+    if (!enabled || !ensureWatched(virtual_path)) {
+        return 0;
+    }
+    return tokenFor(generation.load());
+}
+
+void MetadataCache::storeListing(const string& virtual_path, const vector<DirManager::DirEntry>& listing,
+                                 std::uint64_t token) {
+    if (token == 0) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(entries_mutex);
+    if (!enabled || tokenFor(generation.load()) != token) {
+        return;
+    }
+    if (entries.size() >= MAX_ENTRIES) {
+        entries.clear();
+    }
+    Entry& entry = entries[virtual_path];
+    entry.listing = listing;
+    entry.has_listing = true;
+}
+
+void MetadataCache::storeStat(const string& virtual_path, bool exists, const struct stat& info, std::uint64_t token) {
+    if (token == 0) {
+        return;
+    }
+    std::unique_lock<std::shared_mutex> lock(entries_mutex);
+    if (!enabled || tokenFor(generation.load()) != token) {
+        return;
+    }
+    if (entries.size() >= MAX_ENTRIES) {
+        entries.clear();
+    }
+    Entry& entry = entries[virtual_path];
+    entry.has_stat = true;
+    entry.exists = exists;
+    if (exists) {
+        entry.info = info;
+    }
+}
+
+void MetadataCache::invalidate(const string& virtual_path) {
+    std::unique_lock<std::shared_mutex> lock(entries_mutex);
+    generation.fetch_add(1);
+    entries.erase(virtual_path);
+
+    // The parent's listing carries this entry's size, mtime and mode
+    if (virtual_path != "/") {
+        dropListing(PathUtils::getParentPath(virtual_path));
+    }
+}
+
+void MetadataCache::invalidateTree(const string& virtual_path) {
+    std::unique_lock<std::shared_mutex> lock(entries_mutex);
+    generation.fetch_add(1);
+    eraseSubtree(virtual_path);
+
+    // The parent's listing, mtime and link count changed with it, and the
+    // grandparent's listing shows the parent's mtime
+    if (virtual_path != "/") {
+        string parent = PathUtils::getParentPath(virtual_path);
+        entries.erase(parent);
+        if (parent != "/") {
+            dropListing(PathUtils::getParentPath(parent));
+        }
+    }
+}
+
+void MetadataCache::clear() {
+    std::unique_lock<std::shared_mutex> lock(entries_mutex);
+    generation.fetch_add(1);
+    entries.clear();
+}
+
+MetadataCache::Stats MetadataCache::getStats() {
+    Stats stats;
+    stats.hits = hits.load(std::memory_order_relaxed);
+    stats.misses = misses.load(std::memory_order_relaxed);
+    stats.enabled = enabled;
+    {
+        std::shared_lock<std::shared_mutex> lock(entries_mutex);
+        stats.entries = entries.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex);
+        stats.watches = watch_paths.size();
+    }
+    return stats;
+}
+
+void MetadataCache::eraseSubtree(const string& virtual_path) {
+    if (virtual_path == "/") {
+        entries.clear();
+        return;
+    }
+    entries.erase(virtual_path);
+
+    // Children sort between "<path>/" and "<path>0" ('0' follows '/')
+    string first = virtual_path + "/";
+    string last = virtual_path + "0";
+    entries.erase(entries.lower_bound(first), entries.lower_bound(last));
+}
+
+void MetadataCache::dropListing(const string& virtual_dir) {
+    auto it = entries.find(virtual_dir);
+    if (it != entries.end()) {
+        it->second.has_listing = false;
+        it->second.listing.clear();
+    }
+}
+
+bool MetadataCache::ensureWatched(const string& virtual_dir) {
+#if FX_HAVE_INOTIFY
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    if (watched_dirs.count(virtual_dir) != 0) {
+        return true;
+    }
+    if (inotify_fd < 0) {
+        return false;
+    }
+
+    // Watch through a descriptor opened beneath the root so the watch cannot escape it
+    ScopedFd dir(Sandbox::openPath(virtual_dir, O_PATH | O_DIRECTORY));
+    if (!dir.valid()) {
+        return false;
+    }
+    string proc_path = "/proc/self/fd/" + std::to_string(dir.get());
+
+    uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE |
+                    IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+                    IN_ONLYDIR | IN_EXCL_UNLINK;
+    int wd = inotify_add_watch(inotify_fd, proc_path.c_str(), mask);
+    if (wd < 0) {
+        return false;
+    }
+
+    // A hard-linked or re-added directory may come back with a known descriptor
+    auto known = watch_paths.find(wd);
+    if (known != watch_paths.end()) {
+        watched_dirs.erase(known->second);
+    }
+    watch_paths[wd] = virtual_dir;
+    watched_dirs[virtual_dir] = wd;
+    return true;
+#else
+    (void)virtual_dir;
+    return false;
+#endif
+}
+
+void MetadataCache::unwatchTree(const string& virtual_dir) {
+#if FX_HAVE_INOTIFY
+    std::lock_guard<std::mutex> lock(watch_mutex);
+    auto begin = watched_dirs.lower_bound(virtual_dir);
+    auto end = (virtual_dir == "/") ? watched_dirs.end() : watched_dirs.lower_bound(virtual_dir + "0");
+    for (auto it = begin; it != end;) {
+        bool inside = it->first == virtual_dir || virtual_dir == "/" ||
+                      it->first.compare(0, virtual_dir.size() + 1, virtual_dir + "/") == 0;
+        if (!inside) {
+            ++it;
+            continue;
+        }
+        inotify_rm_watch(inotify_fd, it->second);
+        watch_paths.erase(it->second);
+        it = watched_dirs.erase(it);
+    }
+#else
+    (void)virtual_dir;
+#endif
+}
+
+void MetadataCache::watchLoop() {
+#if FX_HAVE_INOTIFY
+    alignas(struct inotify_event) char buffer[64 * 1024];
+
+    while (true) {
+        struct pollfd fds[2];
+        fds[0].fd = inotify_fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = wake_pipe[0];
+        fds[1].events = POLLIN;
+
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+
+        for (char* p = buffer; p < buffer + length;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // Events were lost; nothing cached can be trusted
+                clear();
+                continue;
+            }
+
+            string dir;
+            {
+                std::lock_guard<std::mutex> lock(watch_mutex);
+                auto it = watch_paths.find(event->wd);
+                if (it == watch_paths.end()) {
+                    continue;
+                }
+                dir = it->second;
+                if (event->mask & IN_IGNORED) {
+                    watched_dirs.erase(dir);
+                    watch_paths.erase(it);
+                    continue;
+                }
+            }
+
+            if (event->len == 0) {
+                // Event on the watched directory itself
+                if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                    invalidateTree(dir);
+                    unwatchTree(dir);
+                } else {
+                    invalidate(dir);
+                }
+                continue;
+            }
+
+            string child = joinChild(dir, event->name);
+            if (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) {
+                invalidateTree(child);
+                if ((event->mask & IN_ISDIR) && (event->mask & (IN_DELETE | IN_MOVED_FROM))) {
+                    unwatchTree(child);
+                }
+            } else {
+                invalidate(child);
+            }
+        }
+    }
+#endif
+}
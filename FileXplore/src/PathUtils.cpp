@@ -2,20 +2,24 @@
 #include <vector>
 #include <map>
 #include <algorithm>
-#include <sstream>
+#include <string_view>
 #include <iostream>
 using std::string;
 using std::vector;
 using std::map;
 using std::replace;
-using std::stringstream;
 using std::cout;
 using std::cerr;
 using std::endl;
 using std::exception;
 #include "../include/PathUtils.h"
 #include "../include/PersistenceManager.h"
+#include "../include/Sandbox.h"
+#include "../include/Session.h"
+#include "../include/MetadataCache.h"
+#include "../include/Logger.h"
 #include <fstream>
+#include <cerrno>
 #include <sys/stat.h>
 
 #ifdef _WIN32
@@ -30,7 +34,10 @@ using std::exception;
 
 // Static member definitions
 string PathUtils::vfs_root = "";
-string PathUtils::current_virtual_path = "/";
+
+// Top-level bookkeeping directories: BlobStore::STORE_DIR, SnapshotManager::SNAPSHOT_DIR and
+// UploadManager::UPLOAD_DIR (spelled out here so PathUtils does not depend on their owners)
+static const std::string_view RESERVED_DIRS[] = {"/.fxstore", "/.fxsnap", "/.fxupload"};
 
 bool PathUtils::initializeVFSRoot(const string& root_path) {
     try {
@@ -51,9 +58,16 @@ bool PathUtils::initializeVFSRoot(const string& root_path) {
             return false;
         }
         
+        // Hold the root open so later lookups resolve beneath it by descriptor
+        if (!Sandbox::open(platform_root)) {
+            return false;
+        }
+        
+        // Stat results and listings are cached and invalidated through inotify
+        MetadataCache::start();
+        
         // Store the original Unix-style path for internal use
         vfs_root = root_path;
-        current_virtual_path = "/";
         
         cout << "VFS Root initialized: " << vfs_root << endl;
         return true;
@@ -76,13 +90,14 @@ string PathUtils::virtualToRealPath(const string& virtual_path) {
     
     // If the resolved path is not just the root, append the path
     if (resolved != "/" && !resolved.empty()) {
+        real_path.reserve(real_path.size() + resolved.size());
         if (real_path.back() != PATH_SEPARATOR) {
             real_path += PATH_SEPARATOR;
         }
-        // Remove leading '/' from resolved path and convert to platform separators
-        string path_part = resolved.substr(1);
-        replace(path_part.begin(), path_part.end(), '/', PATH_SEPARATOR);
-        real_path += path_part;
+        // Append without the leading '/', converting to platform separators in place
+        size_t offset = real_path.size();
+        real_path.append(resolved, 1, string::npos);
+        replace(real_path.begin() + offset, real_path.end(), '/', PATH_SEPARATOR);
     }
     
     return real_path;
@@ -115,23 +130,6 @@ bool PathUtils::isPathSafe(const string& real_path) {
     
     string canonical_real(resolved_real);
     string canonical_root(resolved_root);
-#else
-    // On Unix-like systems, use realpath
-    char* resolved_real = realpath(normalized_real.c_str(), nullptr);
-    char* resolved_root = realpath(normalized_root.c_str(), nullptr);
-    
-    if (!resolved_real || !resolved_root) {
-        if (resolved_real) free(resolved_real);
-        if (resolved_root) free(resolved_root);
-        return false;
-    }
-    
-    string canonical_real(resolved_real);
-    string canonical_root(resolved_root);
-    
-    free(resolved_real);
-    free(resolved_root);
-#endif
     
     // Ensure the canonical real path starts with the canonical VFS root
     // and add a separator check to prevent partial matches
@@ -151,135 +149,261 @@ bool PathUtils::isPathSafe(const string& real_path) {
     // Check that the character after the root is a path separator
     char next_char = canonical_real[canonical_root.length()];
     return (next_char == PATH_SEPARATOR);
-}
-
-string PathUtils::resolvePath(const string& path) {
-    if (path.empty()) {
-        return current_virtual_path;
+#else
+    // Real paths handed out by virtualToRealPath are the root string plus a
+    // relative part; map back lexically and let the sandbox do the resolution
+    while (normalized_root.size() > 1 && normalized_root.back() == PATH_SEPARATOR) {
+        normalized_root.pop_back();
+    }
+    if (normalized_real.compare(0, normalized_root.size(), normalized_root) != 0) {
+        return false;
+    }
+    if (normalized_real.size() > normalized_root.size() &&
+        normalized_real[normalized_root.size()] != PATH_SEPARATOR) {
+        return false;
     }
     
-    string working_path;
-    if (path[0] == '/') {
-        working_path = path; // Absolute path
-    } else {
-        // Relative path - combine with current directory
-        working_path = current_virtual_path;
-        if (working_path.back() != '/') {
-            working_path += '/';
+    // Reject ".." outright instead of letting normalization clamp it at the root
+    string relative = normalized_real.substr(normalized_root.size());
+    for (const auto& component : splitPath(relative)) {
+        if (component == "..") {
+            return false;
         }
-        working_path += path;
     }
     
-    return normalizePath(working_path);
+    return isVirtualPathSafe(normalizePath(relative));
+#endif
 }
 
-string PathUtils::normalizePath(const string& path) {
-    if (path.empty()) {
-        return "/";
+bool PathUtils::isVirtualPathSafe(const string& virtual_path) {
+    if (vfs_root.empty() || !Sandbox::isOpen()) {
+        return false;
     }
     
-    vector<string> components = splitPath(path);
-    vector<string> normalized;
+    string current = resolvePath(virtual_path);
+    if (isReservedPath(current)) {
+        return false;
+    }
     
-    for (const auto& component : components) {
-        if (component == "." || component.empty()) {
-            continue; // Skip current directory and empty components
-        } else if (component == "..") {
-            if (!normalized.empty() && normalized.back() != "..") {
-                normalized.pop_back(); // Go up one directory
-            }
-        } else {
-            normalized.push_back(component);
+    // Walk up to the deepest existing ancestor: it must resolve beneath the
+    // root, and the missing tail cannot contain links or ".." by construction
+    while (true) {
+        struct stat info;
+        if (Sandbox::statPath(current, info)) {
+            return true;
+        }
+        if (errno != ENOENT || current == "/") {
+            return false;
         }
+        current = getParentPath(current);
     }
-    
-    string result = "/";
-    for (size_t i = 0; i < normalized.size(); ++i) {
-        if (i > 0) result += "/";
-        result += normalized[i];
+}
+
+bool PathUtils::isReservedPath(std::string_view virtual_path) {
+    for (std::string_view dir : RESERVED_DIRS) {
+        if (virtual_path.compare(0, dir.size(), dir) == 0 &&
+            (virtual_path.size() == dir.size() || virtual_path[dir.size()] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+
+// Output buffer for path normalization: paths up to 256 bytes are assembled
+// on the stack, longer ones spill into a heap string only once
+class PathBuffer {
+public:
+    PathBuffer() : length_(0) {}
+
+    void push(char c) {
+        reserve(length_ + 1);
+        data()[length_++] = c;
+    }
+
+    void append(std::string_view part) {
+        reserve(length_ + part.size());
+        part.copy(data() + length_, part.size());
+        length_ += part.size();
+    }
+
+    // Drop the last component, never going above the leading '/'
+    void popComponent() {
+        while (length_ > 1 && data()[length_ - 1] != '/') {
+            --length_;
+        }
+        if (length_ > 1) {
+            --length_;
+        }
+    }
+
+    std::string_view view() const {
+        return std::string_view(heap_.empty() ? inline_ : heap_.data(), length_);
+    }
+
+private:
+    static const size_t INLINE_CAPACITY = 256;
+
+    char inline_[INLINE_CAPACITY];
+    string heap_;
+    size_t length_;
+
+    char* data() {
+        return heap_.empty() ? inline_ : &heap_[0];
+    }
+
+    void reserve(size_t needed) {
+        if (heap_.empty() && needed <= INLINE_CAPACITY) {
+            return;
+        }
+        if (heap_.empty()) {
+            heap_.assign(inline_, length_);
+        }
+        if (heap_.size() < needed) {
+            heap_.resize(std::max(needed, heap_.size() * 2));
+        }
+    }
+};
+
+// Call fn(component) for each non-empty '/'-separated component
+template <typename Fn>
+void forEachComponent(std::string_view path, Fn fn) {
+    size_t pos = 0;
+    while (pos < path.size()) {
+        size_t next = path.find('/', pos);
+        if (next == std::string_view::npos) {
+            next = path.size();
+        }
+        if (next > pos) {
+            fn(path.substr(pos, next - pos));
+        }
+        pos = next + 1;
     }
-    
-    return result;
 }
 
-string PathUtils::getCurrentVirtualPath() {
-    return current_virtual_path;
+// Collapse ".", "..", empty components and duplicate separators into out
+void normalizeInto(std::string_view path, PathBuffer& out) {
+    out.push('/');
+    forEachComponent(path, [&out](std::string_view component) {
+        if (component == ".") {
+            return;
+        }
+        if (component == "..") {
+            out.popComponent();
+            return;
+        }
+        if (out.view().size() > 1) {
+            out.push('/');
+        }
+        out.append(component);
+    });
 }
 
-bool PathUtils::setCurrentVirtualPath(const string& path) {
-    string resolved = resolvePath(path);
-    string real_path = virtualToRealPath(resolved);
-    
-    if (!isPathSafe(real_path)) {
+} // namespace
+
+bool PathUtils::isNormalizedPath(std::string_view path) {
+    if (path.empty() || path[0] != '/') {
         return false;
     }
-    
-    if (isDirectory(resolved)) {
-        current_virtual_path = resolved;
+    if (path.size() == 1) {
         return true;
     }
+    if (path.back() == '/') {
+        return false;
+    }
+
+    // Every component must be non-empty and neither "." nor ".."
+    size_t start = 1;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == std::string_view::npos) {
+            end = path.size();
+        }
+        size_t length = end - start;
+        if (length == 0) {
+            return false;
+        }
+        if (path[start] == '.' && (length == 1 || (length == 2 && path[start + 1] == '.'))) {
+            return false;
+        }
+        start = end + 1;
+    }
+    return true;
+}
+
+string PathUtils::resolvePath(std::string_view path, std::string_view base) {
+    if (path.empty()) {
+        return normalizePath(base);
+    }
     
-    return false;
+    if (path[0] == '/') {
+        return normalizePath(path); // Absolute path
+    }
+    
+    // Relative path - combine with the base directory without an intermediate string
+    PathBuffer combined;
+    combined.append(base);
+    combined.push('/');
+    combined.append(path);
+    
+    PathBuffer normalized;
+    normalizeInto(combined.view(), normalized);
+    return string(normalized.view());
 }
 
-bool PathUtils::pathExists(const string& virtual_path) {
-    string real_path = virtualToRealPath(virtual_path);
-    cout << "DEBUG pathExists: Virtual: " << virtual_path << ", Real: " << real_path << endl;
+string PathUtils::normalizePath(std::string_view path) {
+    if (path.empty()) {
+        return "/";
+    }
     
-    if (!isPathSafe(real_path)) {
-        cout << "DEBUG pathExists: Path not safe" << endl;
-        return false;
+    // Fast path: most paths arriving here are already canonical
+    if (isNormalizedPath(path)) {
+        return string(path);
     }
     
+    PathBuffer normalized;
+    normalizeInto(path, normalized);
+    return string(normalized.view());
+}
+
+bool PathUtils::pathExists(const string& virtual_path) {
+    string resolved = resolvePath(virtual_path);
+    FX_LOG_TRACE("pathExists: Virtual: " << virtual_path << ", Resolved: " << resolved);
+    
     struct stat info;
-    int result = stat(real_path.c_str(), &info);
-    cout << "DEBUG pathExists: stat result: " << result << endl;
-    return result == 0;
+    bool exists = MetadataCache::statPath(resolved, info);
+    FX_LOG_TRACE("pathExists: stat result: " << (exists ? 0 : -1));
+    return exists;
 }
 
 bool PathUtils::isDirectory(const string& virtual_path) {
-    string real_path = virtualToRealPath(virtual_path);
-    if (!isPathSafe(real_path)) {
-        return false;
-    }
-    
     struct stat info;
-    if (stat(real_path.c_str(), &info) != 0) {
+    if (!MetadataCache::statPath(resolvePath(virtual_path), info)) {
         return false;
     }
     
-    return (info.st_mode & S_IFDIR) != 0;
+    return (info.st_mode & S_IFMT) == S_IFDIR;
 }
 
 bool PathUtils::isFile(const string& virtual_path) {
-    string real_path = virtualToRealPath(virtual_path);
-    if (!isPathSafe(real_path)) {
-        return false;
-    }
-    
     struct stat info;
-    if (stat(real_path.c_str(), &info) != 0) {
+    if (!MetadataCache::statPath(resolvePath(virtual_path), info)) {
         return false;
     }
     
-    return (info.st_mode & S_IFREG) != 0;
+    return (info.st_mode & S_IFMT) == S_IFREG;
 }
 
 string PathUtils::getVFSRoot() {
     return vfs_root;
 }
 
-vector<string> PathUtils::splitPath(const string& path) {
+vector<string> PathUtils::splitPath(std::string_view path) {
     vector<string> components;
-    stringstream ss(path);
-    string component;
-    
-    while (getline(ss, component, '/')) {
-        if (!component.empty()) {
-            components.push_back(component);
-        }
-    }
-    
+    forEachComponent(path, [&components](std::string_view component) {
+        components.emplace_back(component);
+    });
     return components;
 }
 
@@ -297,38 +421,36 @@ string PathUtils::joinPath(const vector<string>& components) {
     return result;
 }
 
-string PathUtils::getParentPath(const string& path) {
-    if (path == "/" || path.empty()) {
+string PathUtils::getParentPath(std::string_view path) {
+    // Strip trailing separators, then the last component
+    size_t end = path.find_last_not_of('/');
+    if (end == std::string_view::npos) {
         return "/";
     }
-    
-    vector<string> components = splitPath(path);
-    if (components.empty()) {
+    size_t slash = path.rfind('/', end);
+    if (slash == std::string_view::npos || slash == 0) {
         return "/";
     }
     
-    components.pop_back();
-    return joinPath(components);
+    return normalizePath(path.substr(0, slash));
 }
 
-string PathUtils::getFilename(const string& path) {
-    if (path == "/" || path.empty()) {
-        return "";
-    }
-    
-    vector<string> components = splitPath(path);
-    if (components.empty()) {
+string PathUtils::getFilename(std::string_view path) {
+    size_t end = path.find_last_not_of('/');
+    if (end == std::string_view::npos) {
         return "";
     }
+    size_t slash = path.rfind('/', end);
+    size_t start = (slash == std::string_view::npos) ? 0 : slash + 1;
     
-    return components.back();
+    return string(path.substr(start, end + 1 - start));
 }
 
-bool PathUtils::saveVFSState() {
-    return PersistenceManager::saveVFSState(current_virtual_path, vfs_root);
+bool PathUtils::saveVFSState(const Session& session) {
+    return PersistenceManager::saveVFSState(session.getCurrentPath(), vfs_root);
 }
 
-bool PathUtils::loadVFSState() {
+bool PathUtils::loadVFSState(Session& session) {
     map<string, string> state = PersistenceManager::loadVFSState();
     
     if (state.empty()) {
@@ -338,8 +460,9 @@ bool PathUtils::loadVFSState() {
     // Load current directory if available
     if (state.find("current_directory") != state.end()) {
         string loaded_dir = state["current_directory"];
-        if (!loaded_dir.empty()) {
-            current_virtual_path = loaded_dir;
+        if (!loaded_dir.empty() && !session.setCurrentPath(loaded_dir)) {
+            // Saved directory no longer exists; stay at the root
+            session.setCurrentPath("/");
         }
     }
     
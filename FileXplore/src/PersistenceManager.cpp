@@ -4,7 +4,9 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <ctime>
+#include <cstdio>
 using std::string;
 using std::vector;
 using std::map;
@@ -13,7 +15,10 @@ using std::cout;
 using std::cerr;
 using std::endl;
 using std::exception;
+using std::uint32_t;
+using std::size_t;
 #include "../include/PersistenceManager.h"
+#include "../include/PathUtils.h"
 
 #ifdef _WIN32
     #include <direct.h>
@@ -29,7 +34,7 @@ using std::exception;
 string PersistenceManager::persistence_file = "";
 string PersistenceManager::config_file = "";
 
-bool PersistenceManager::initialize(const string& vfs_root) {
+bool PersistenceManager::initialize([[maybe_unused]] const string& vfs_root) {
     try {
         string persist_dir = getPersistenceDirectory();
         if (persist_dir.empty()) {
@@ -358,6 +363,8 @@ bool PersistenceManager::clearPersistentData() {
         string history_file = getHistoryFile();
         string vfs_file = getVFSStateFile();
         string settings_file = getSettingsFile();
+        string index_file = getIndexFile();
+        string digest_file = getDigestCacheFile();
         
         // Remove files if they exist
         if (!history_file.empty()) {
@@ -369,6 +376,12 @@ bool PersistenceManager::clearPersistentData() {
         if (!settings_file.empty()) {
             remove(settings_file.c_str());
         }
+        if (!index_file.empty()) {
+            remove(index_file.c_str());
+        }
+        if (!digest_file.empty()) {
+            remove(digest_file.c_str());
+        }
         
         return true;
     } catch (const exception& e) {
@@ -393,4 +406,66 @@ string PersistenceManager::getVFSStateFile() {
 
 string PersistenceManager::getSettingsFile() {
     return config_file;
-}
\ No newline at end of file
+}
+
+string PersistenceManager::getIndexFile() {
+    string persist_dir = getPersistenceDirectory();
+    return persist_dir + "/file_index.bin";
+}
+
+string PersistenceManager::getDigestCacheFile() {
+    string persist_dir = getPersistenceDirectory();
+    return persist_dir + "/digest_cache.bin";
+}
+
+string PersistenceManager::beginSidecar(const char (&magic)[8], uint32_t version) {
+    string root = PathUtils::getVFSRoot();
+    string data(magic, sizeof(magic));
+    appendValue(data, version);
+    appendValue(data, static_cast<uint32_t>(root.size()));
+    data += root;
+    return data;
+}
+
+bool PersistenceManager::writeSidecar(const string& file, const string& data) {
+    string temp_file = file + ".tmp";
+    {
+        std::ofstream out(temp_file, std::ios::binary | std::ios::trunc);
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            out.close();
+            std::remove(temp_file.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    std::remove(file.c_str());
+#endif
+    if (std::rename(temp_file.c_str(), file.c_str()) != 0) {
+        std::remove(temp_file.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool PersistenceManager::readSidecar(const string& file, const char (&magic)[8], uint32_t version, string& data,
+                                     size_t& offset) {
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+    const string& root = PathUtils::getVFSRoot();
+    uint32_t saved_version = 0;
+    uint32_t root_length = 0;
+    offset = sizeof(magic);
+    if (data.size() < offset || std::memcmp(data.data(), magic, sizeof(magic)) != 0 ||
+        !readValue(data, offset, saved_version) || saved_version != version ||
+        !readValue(data, offset, root_length) || data.size() - offset < root_length ||
+        root.size() != root_length || data.compare(offset, root_length, root) != 0) {
+        return false;
+    }
+    offset += root_length;
+    return true;
+}
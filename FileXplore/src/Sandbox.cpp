@@ -0,0 +1,453 @@
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <iostream>
+using std::string;
+using std::cerr;
+using std::endl;
+#include "../include/Sandbox.h"
+#include "../include/PathUtils.h"
+#include <fcntl.h>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <process.h>
+    #include <direct.h>
+    #include <windows.h>
+    #include <algorithm>
+#else
+    #include <unistd.h>
+    #include <sys/stat.h>
+    #if defined(__linux__)
+        #include <sys/syscall.h>
+        #if defined(SYS_openat2) && __has_include(<linux/openat2.h>)
+            #include <linux/openat2.h>
+            #define FX_HAVE_OPENAT2 1
+        #endif
+    #endif
+#endif
+
+#ifndef FX_HAVE_OPENAT2
+    #define FX_HAVE_OPENAT2 0
+#endif
+
+// O_PATH descriptors only carry a position in the tree; fall back to read-only elsewhere
+#if defined(O_PATH)
+    #define FX_O_PATH O_PATH
+#else
+    #define FX_O_PATH O_RDONLY
+#endif
+
+#ifndef O_CLOEXEC
+    #define O_CLOEXEC 0
+#endif
+
+// Static member definitions
+int Sandbox::root_fd = -1;
+bool Sandbox::openat2_supported = false;
+
+void ScopedFd::reset(int fd) {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = fd;
+}
+
+// Strip the leading '/' of a normalized virtual path; the root maps to "."
+static string toRelative(const string& virtual_path) {
+    size_t start = virtual_path.find_first_not_of('/');
+    if (start == string::npos) {
+        return ".";
+    }
+    return virtual_path.substr(start);
+}
+
+#ifdef _WIN32
+
+// Windows has no *at() family; resolve against the stored root string and
+// verify the canonical result stays under it (the pre-descriptor behaviour).
+static string windows_root;
+
+static string realPathFor(const string& virtual_path) {
+    string relative = toRelative(virtual_path);
+    string real_path = windows_root;
+    if (relative != ".") {
+        if (!real_path.empty() && real_path.back() != '\\') {
+            real_path += '\\';
+        }
+        real_path += relative;
+    }
+    std::replace(real_path.begin(), real_path.end(), '/', '\\');
+
+    char resolved_real[MAX_PATH];
+    char resolved_root[MAX_PATH];
+    if (GetFullPathNameA(real_path.c_str(), MAX_PATH, resolved_real, nullptr) == 0 ||
+        GetFullPathNameA(windows_root.c_str(), MAX_PATH, resolved_root, nullptr) == 0) {
+        return "";
+    }
+    string canonical_real(resolved_real);
+    string canonical_root(resolved_root);
+    if (canonical_real.compare(0, canonical_root.size(), canonical_root) != 0 ||
+        (canonical_real.size() > canonical_root.size() && canonical_real[canonical_root.size()] != '\\')) {
+        return "";
+    }
+    return canonical_real;
+}
+
+bool Sandbox::open(const string& root_path) {
+    windows_root = root_path;
+    std::replace(windows_root.begin(), windows_root.end(), '/', '\\');
+    root_fd = 0;
+    return true;
+}
+
+void Sandbox::close() {
+    windows_root.clear();
+    root_fd = -1;
+}
+
+int Sandbox::openBeneath(const string& relative_path, int flags, mode_t mode) {
+    return walkBeneath(relative_path, flags, mode);
+}
+
+int Sandbox::walkBeneath(const string& relative_path, int flags, mode_t mode) {
+    string real_path = realPathFor("/" + relative_path);
+    if (real_path.empty()) {
+        errno = EXDEV;
+        return -1;
+    }
+    return ::_open(real_path.c_str(), flags | _O_BINARY, mode);
+}
+
+int Sandbox::openParent(const string& virtual_path, string& leaf) {
+    errno = ENOSYS;
+    leaf.clear();
+    (void)virtual_path;
+    return -1;
+}
+
+bool Sandbox::statPath(const string& virtual_path, struct stat& info) {
+    string real_path = realPathFor(virtual_path);
+    if (real_path.empty()) {
+        errno = EXDEV;
+        return false;
+    }
+    return ::stat(real_path.c_str(), &info) == 0;
+}
+
+bool Sandbox::makeDirectory(const string& virtual_path, mode_t mode) {
+    (void)mode;
+    string real_path = realPathFor(virtual_path);
+    return !real_path.empty() && _mkdir(real_path.c_str()) == 0;
+}
+
+bool Sandbox::removeDirectory(const string& virtual_path) {
+    string real_path = realPathFor(virtual_path);
+    return !real_path.empty() && _rmdir(real_path.c_str()) == 0;
+}
+
+bool Sandbox::removeFile(const string& virtual_path) {
+    string real_path = realPathFor(virtual_path);
+    return !real_path.empty() && ::remove(real_path.c_str()) == 0;
+}
+
+bool Sandbox::renamePath(const string& from_virtual, const string& to_virtual) {
+    string real_from = realPathFor(from_virtual);
+    string real_to = realPathFor(to_virtual);
+    if (real_from.empty() || real_to.empty()) {
+        errno = EXDEV;
+        return false;
+    }
+    // MoveFileEx replaces the target like POSIX rename()
+    return MoveFileExA(real_from.c_str(), real_to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+bool Sandbox::linkPath(const string& from_virtual, const string& to_virtual) {
+    string real_from = realPathFor(from_virtual);
+    string real_to = realPathFor(to_virtual);
+    if (real_from.empty() || real_to.empty()) {
+        errno = EXDEV;
+        return false;
+    }
+    return CreateHardLinkA(real_to.c_str(), real_from.c_str(), nullptr) != 0;
+}
+
+#else
+
+bool Sandbox::open(const string& root_path) {
+    close();
+
+    root_fd = ::open(root_path.c_str(), FX_O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        cerr << "Error: Cannot open VFS root: " << root_path << " (" << strerror(errno) << ")" << endl;
+        return false;
+    }
+
+#if FX_HAVE_OPENAT2
+    // Probe once: old kernels return ENOSYS, some container seccomp filters EPERM
+    struct open_how how;
+    memset(&how, 0, sizeof(how));
+    how.flags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS;
+    long probe = syscall(SYS_openat2, root_fd, ".", &how, sizeof(how));
+    if (probe >= 0) {
+        ::close(static_cast<int>(probe));
+        openat2_supported = true;
+    } else {
+        openat2_supported = false;
+    }
+#else
+    openat2_supported = false;
+#endif
+
+    return true;
+}
+
+void Sandbox::close() {
+    if (root_fd >= 0) {
+        ::close(root_fd);
+    }
+    root_fd = -1;
+    openat2_supported = false;
+}
+
+int Sandbox::openBeneath(const string& relative_path, int flags, mode_t mode) {
+    if (root_fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+
+#if FX_HAVE_OPENAT2
+    if (openat2_supported) {
+        struct open_how how;
+        memset(&how, 0, sizeof(how));
+        // Symlinks are never followed, as in the fallback walk: a symlink leaf opens (O_PATH)
+        // or fails with ELOOP, a symlink in the middle fails with ELOOP
+        how.flags = static_cast<uint64_t>(flags | O_NOFOLLOW | O_CLOEXEC);
+        how.mode = (flags & O_CREAT) ? mode : 0;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS;
+
+        // EAGAIN signals a concurrent rename during resolution; retry briefly
+        for (int attempt = 0; attempt < 8; ++attempt) {
+            long fd = syscall(SYS_openat2, root_fd, relative_path.c_str(), &how, sizeof(how));
+            if (fd >= 0 || errno != EAGAIN) {
+                return static_cast<int>(fd);
+            }
+        }
+        return -1;
+    }
+#endif
+
+    return walkBeneath(relative_path, flags, mode);
+}
+
+int Sandbox::walkBeneath(const string& relative_path, int flags, mode_t mode) {
+    ScopedFd current;
+    int dir_fd = root_fd;
+    size_t start = 0;
+
+    while (true) {
+        size_t slash = relative_path.find('/', start);
+        if (slash == string::npos) {
+            break;
+        }
+
+        string component = relative_path.substr(start, slash - start);
+        start = slash + 1;
+        if (component.empty() || component == ".") {
+            continue;
+        }
+        if (component == "..") {
+            errno = EXDEV;
+            return -1;
+        }
+
+        // Intermediate components must be real directories; symlinks are refused
+        int next = ::openat(dir_fd, component.c_str(), FX_O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (next < 0) {
+            return -1;
+        }
+        current.reset(next);
+        dir_fd = next;
+    }
+
+    string leaf = relative_path.substr(start);
+    if (leaf == "..") {
+        errno = EXDEV;
+        return -1;
+    }
+    if (leaf.empty()) {
+        leaf = ".";
+    }
+
+    return ::openat(dir_fd, leaf.c_str(), flags | O_NOFOLLOW | O_CLOEXEC, mode);
+}
+
+int Sandbox::openParent(const string& virtual_path, string& leaf) {
+    string relative = toRelative(virtual_path);
+    if (relative == ".") {
+        // The root itself has no parent inside the sandbox
+        leaf.clear();
+        errno = EBUSY;
+        return -1;
+    }
+
+    size_t slash = relative.rfind('/');
+    if (slash == string::npos) {
+        leaf = relative;
+        if (leaf == "..") {
+            errno = EXDEV;
+            return -1;
+        }
+        return ::fcntl(root_fd, F_DUPFD_CLOEXEC, 0);
+    }
+
+    leaf = relative.substr(slash + 1);
+    if (leaf == "..") {
+        errno = EXDEV;
+        return -1;
+    }
+    return openBeneath(relative.substr(0, slash), FX_O_PATH | O_DIRECTORY, 0);
+}
+
+bool Sandbox::statPath(const string& virtual_path, struct stat& info) {
+    if (root_fd < 0) {
+        errno = EBADF;
+        return false;
+    }
+
+    string relative = toRelative(virtual_path);
+    if (relative == ".") {
+        return ::fstat(root_fd, &info) == 0;
+    }
+
+#if defined(O_PATH)
+    ScopedFd fd(openBeneath(relative, O_PATH, 0));
+    if (!fd.valid()) {
+        return false;
+    }
+    return ::fstat(fd.get(), &info) == 0;
+#else
+    string leaf;
+    ScopedFd parent(openParent(virtual_path, leaf));
+    if (!parent.valid()) {
+        return false;
+    }
+    return ::fstatat(parent.get(), leaf.c_str(), &info, AT_SYMLINK_NOFOLLOW) == 0;
+#endif
+}
+
+bool Sandbox::makeDirectory(const string& virtual_path, mode_t mode) {
+    string leaf;
+    ScopedFd parent(openParent(virtual_path, leaf));
+    if (!parent.valid()) {
+        if (errno == EBUSY) {
+            errno = EEXIST;
+        }
+        return false;
+    }
+    return ::mkdirat(parent.get(), leaf.c_str(), mode) == 0;
+}
+
+bool Sandbox::removeDirectory(const string& virtual_path) {
+    string leaf;
+    ScopedFd parent(openParent(virtual_path, leaf));
+    if (!parent.valid()) {
+        return false;
+    }
+    return ::unlinkat(parent.get(), leaf.c_str(), AT_REMOVEDIR) == 0;
+}
+
+bool Sandbox::removeFile(const string& virtual_path) {
+    string leaf;
+    ScopedFd parent(openParent(virtual_path, leaf));
+    if (!parent.valid()) {
+        return false;
+    }
+    return ::unlinkat(parent.get(), leaf.c_str(), 0) == 0;
+}
+
+bool Sandbox::renamePath(const string& from_virtual, const string& to_virtual) {
+    string from_leaf;
+    string to_leaf;
+    ScopedFd from_parent(openParent(from_virtual, from_leaf));
+    if (!from_parent.valid()) {
+        return false;
+    }
+    ScopedFd to_parent(openParent(to_virtual, to_leaf));
+    if (!to_parent.valid()) {
+        return false;
+    }
+    return ::renameat(from_parent.get(), from_leaf.c_str(), to_parent.get(), to_leaf.c_str()) == 0;
+}
+
+bool Sandbox::linkPath(const string& from_virtual, const string& to_virtual) {
+    string from_leaf;
+    string to_leaf;
+    ScopedFd from_parent(openParent(from_virtual, from_leaf));
+    if (!from_parent.valid()) {
+        return false;
+    }
+    ScopedFd to_parent(openParent(to_virtual, to_leaf));
+    if (!to_parent.valid()) {
+        return false;
+    }
+    // No AT_SYMLINK_FOLLOW: a symlink is linked as itself, never resolved outside the root
+    return ::linkat(from_parent.get(), from_leaf.c_str(), to_parent.get(), to_leaf.c_str(), 0) == 0;
+}
+
+#endif
+
+int Sandbox::openPath(const string& virtual_path, int flags, mode_t mode) {
+    return openBeneath(toRelative(virtual_path), flags, mode);
+}
+
+bool Sandbox::isOpen() {
+    return root_fd >= 0;
+}
+
+int Sandbox::getRootFd() {
+    return root_fd;
+}
+
+bool Sandbox::usesOpenat2() {
+    return openat2_supported;
+}
+
+bool Sandbox::isEscapeError(int error) {
+    return error == EXDEV || error == ELOOP;
+}
+
+bool Sandbox::writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+string Sandbox::siblingTempPath(const string& virtual_path, const char* tag) {
+    // Distinguishes temp files of concurrent writers in one process
+    static std::atomic<unsigned long> counter(0);
+    string parent = PathUtils::getParentPath(virtual_path);
+    return (parent == "/" ? "" : parent) + "/." + PathUtils::getFilename(virtual_path) + tag +
+           std::to_string(getpid()) + "." + std::to_string(counter.fetch_add(1));
+}
+
+int64_t Sandbox::mtimeNanoseconds(const struct stat& info) {
+#if defined(__APPLE__)
+    return static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(_WIN32)
+    return static_cast<int64_t>(info.st_mtime) * 1000000000;
+#else
+    return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+}
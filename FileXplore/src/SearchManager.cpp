@@ -0,0 +1,526 @@
+#include "../include/SearchManager.h"
+#include "../include/FileManager.h"
+#include "../include/TreeWalker.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/Session.h"
+#include "../include/Logger.h"
+#include <algorithm>
+#include <regex>
+#include <thread>
+#include <cstring>
+#include <cctype>
+#include <sys/stat.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <immintrin.h>
+    #define FX_HAVE_AVX2_SCAN 1
+#else
+    #define FX_HAVE_AVX2_SCAN 0
+#endif
+
+using namespace std;
+
+// Static member definitions
+mutex SearchManager::jobs_mutex;
+unordered_map<string, shared_ptr<SearchManager::Job>> SearchManager::jobs;
+
+// A file whose first block holds a NUL byte is binary
+static const size_t BINARY_SNIFF_LENGTH = 8192;
+
+// Matches kept per web search job
+static const size_t MAX_JOB_MATCHES = 10000;
+
+static inline unsigned char foldCase(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<unsigned char>(c | 0x20) : c;
+}
+
+/**
+ * LiteralFinder - Finds a fixed string, optionally ignoring ASCII case
+ * The needle is stored folded to lowercase when ignoring case.
+ */
+class LiteralFinder {
+public:
+    LiteralFinder() : ignore_case_(false) {}
+
+    LiteralFinder(const string& needle, bool ignore_case) : needle_(needle), ignore_case_(ignore_case) {
+        if (ignore_case_) {
+            transform(needle_.begin(), needle_.end(), needle_.begin(), [](char c) {
+                return static_cast<char>(foldCase(static_cast<unsigned char>(c)));
+            });
+        }
+    }
+
+    bool empty() const { return needle_.empty(); }
+
+    // First occurrence in [begin, end), or nullptr
+    const char* find(const char* begin, const char* end) const;
+
+private:
+    string needle_;
+    bool ignore_case_;
+
+    bool matchesAt(const char* at) const {
+        if (!ignore_case_) {
+            return memcmp(at, needle_.data(), needle_.size()) == 0;
+        }
+        for (size_t i = 0; i < needle_.size(); ++i) {
+            if (foldCase(static_cast<unsigned char>(at[i])) != static_cast<unsigned char>(needle_[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const char* findScalar(const char* begin, const char* end) const;
+#if FX_HAVE_AVX2_SCAN
+    const char* findAvx2(const char* begin, const char* end) const;
+#endif
+};
+
+static bool detectAvx2() {
+#if FX_HAVE_AVX2_SCAN
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+static const bool cpu_has_avx2 = detectAvx2();
+
+const char* LiteralFinder::findScalar(const char* begin, const char* end) const {
+    size_t k = needle_.size();
+    if (static_cast<size_t>(end - begin) < k) {
+        return nullptr;
+    }
+    const char* last_start = end - k;
+    unsigned char first = static_cast<unsigned char>(needle_[0]);
+    bool fold_first = ignore_case_ && first >= 'a' && first <= 'z';
+
+    for (const char* p = begin; p <= last_start;) {
+        if (!fold_first) {
+            // memchr is vectorized by the C library
+            p = static_cast<const char*>(memchr(p, first, static_cast<size_t>(last_start - p) + 1));
+            if (!p) {
+                return nullptr;
+            }
+        } else if (foldCase(static_cast<unsigned char>(*p)) != first) {
+            ++p;
+            continue;
+        }
+        if (matchesAt(p)) {
+            return p;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+#if FX_HAVE_AVX2_SCAN
+// Compare 32 candidate positions at once on the needle's first and last byte, then verify
+// the survivors (the needle's two ends rarely both match by chance, so few need verifying)
+__attribute__((target("avx2")))
+const char* LiteralFinder::findAvx2(const char* begin, const char* end) const {
+    size_t k = needle_.size();
+    size_t n = static_cast<size_t>(end - begin);
+    if (n < k) {
+        return nullptr;
+    }
+
+    unsigned char first = static_cast<unsigned char>(needle_[0]);
+    unsigned char last = static_cast<unsigned char>(needle_[k - 1]);
+    // OR-ing in 0x20 folds letters to lowercase; other bytes may fold into false candidates,
+    // which the verification rejects
+    const __m256i first_bytes = _mm256_set1_epi8(static_cast<char>(first));
+    const __m256i last_bytes = _mm256_set1_epi8(static_cast<char>(last));
+    const __m256i fold_first = _mm256_set1_epi8(ignore_case_ && first >= 'a' && first <= 'z' ? 0x20 : 0);
+    const __m256i fold_last = _mm256_set1_epi8(ignore_case_ && last >= 'a' && last <= 'z' ? 0x20 : 0);
+
+    size_t i = 0;
+    for (; i + k - 1 + 32 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + i));
+        __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin + i + k - 1));
+        block_first = _mm256_or_si256(block_first, fold_first);
+        block_last = _mm256_or_si256(block_last, fold_last);
+        __m256i hits = _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_bytes),
+                                        _mm256_cmpeq_epi8(block_last, last_bytes));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        while (mask != 0) {
+            const char* candidate = begin + i + static_cast<size_t>(__builtin_ctz(mask));
+            if (matchesAt(candidate)) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(begin + i, end);
+}
+#endif
+
+const char* LiteralFinder::find(const char* begin, const char* end) const {
+#if FX_HAVE_AVX2_SCAN
+    if (cpu_has_avx2) {
+        return findAvx2(begin, end);
+    }
+#endif
+    return findScalar(begin, end);
+}
+
+// Pattern compiled for scanning: a literal, or a regex with an optional literal prefilter
+struct Matcher {
+    bool use_regex = false;
+    LiteralFinder literal;
+    regex expression;
+};
+
+static bool hasRegexSyntax(const string& pattern) {
+    return pattern.find_first_of(".^$|?*+()[]{}\\") != string::npos;
+}
+
+// Longest run of characters every match of an ECMAScript pattern must contain ("" if unsure)
+static string requiredLiteral(const string& pattern) {
+    string best;
+    string run;
+    auto endRun = [&]() {
+        if (run.size() > best.size()) {
+            best = run;
+        }
+        run.clear();
+    };
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '|') {
+            // Alternatives: no single literal is required
+            return "";
+        }
+        if (c == '\\') {
+            if (i + 1 >= pattern.size()) {
+                return "";
+            }
+            char next = pattern[++i];
+            if (isalnum(static_cast<unsigned char>(next))) {
+                endRun();            // \d, \w, \b, \n ...: a class or an assertion
+            } else {
+                run += next;         // Escaped punctuation is itself
+            }
+            continue;
+        }
+        if (c == '[' || c == '(') {
+            // Classes and groups (possibly optional) end the run; skip to their close
+            endRun();
+            char close = (c == '[') ? ']' : ')';
+            int depth = 1;
+            for (++i; i < pattern.size() && depth > 0; ++i) {
+                if (pattern[i] == '\\') {
+                    ++i;
+                } else if (c == '(' && pattern[i] == '(') {
+                    ++depth;
+                } else if (pattern[i] == close) {
+                    --depth;
+                }
+            }
+            --i;
+            continue;
+        }
+        if (c == '*' || c == '?' || c == '{') {
+            // The preceding character may be absent
+            if (!run.empty()) {
+                run.pop_back();
+            }
+            endRun();
+            if (c == '{') {
+                size_t close = pattern.find('}', i);
+                i = (close == string::npos) ? pattern.size() : close;
+            }
+            continue;
+        }
+        if (c == '+' || c == '.' || c == '^' || c == '$' || c == ')' || c == ']' || c == '}') {
+            endRun();
+            continue;
+        }
+        run += c;
+    }
+    endRun();
+    return best;
+}
+
+// Line containing position at, within [begin, end)
+static const char* lineStart(const char* begin, const char* at) {
+#if defined(__GLIBC__)
+    const char* newline = static_cast<const char*>(memrchr(begin, '\n', static_cast<size_t>(at - begin)));
+    return newline ? newline + 1 : begin;
+#else
+    while (at > begin && at[-1] != '\n') {
+        --at;
+    }
+    return at;
+#endif
+}
+
+static const char* lineEnd(const char* at, const char* end) {
+    const char* newline = static_cast<const char*>(memchr(at, '\n', static_cast<size_t>(end - at)));
+    return newline ? newline : end;
+}
+
+// Report every matching line of data; on_line returns false to stop. Lines too
+// long to hand to the regex are counted in long_lines instead.
+static void scanBuffer(const char* begin, const char* end, const Matcher& matcher, uint64_t& long_lines,
+                       const function<bool(const char*, const char*, uint64_t)>& on_line) {
+    // Lines are only counted up to a match, so files without one cost no counting
+    const char* counted = begin;
+    uint64_t line_number = 1;
+    auto report = [&](const char* start, const char* stop) {
+        line_number += static_cast<uint64_t>(count(counted, start, '\n'));
+        counted = start;
+        return on_line(start, stop, line_number);
+    };
+
+    const char* position = begin;
+    while (position < end) {
+        const char* start;
+        const char* stop;
+        if (!matcher.literal.empty()) {
+            const char* hit = matcher.literal.find(position, end);
+            if (!hit) {
+                return;
+            }
+            start = lineStart(position, hit);
+            stop = lineEnd(hit, end);
+        } else {
+            start = position;
+            stop = lineEnd(position, end);
+        }
+        // Drop a Windows line ending from what the regex and the report see
+        const char* text_end = (stop > start && stop[-1] == '\r') ? stop - 1 : stop;
+        bool matched = true;
+        if (matcher.use_regex) {
+            if (static_cast<size_t>(text_end - start) > SearchManager::MAX_REGEX_LINE_LENGTH) {
+                long_lines++;
+                matched = false;
+            } else {
+                matched = regex_search(start, text_end, matcher.expression);
+            }
+        }
+        if (matched) {
+            if (!report(start, text_end)) {
+                return;
+            }
+        }
+        position = stop + 1;
+    }
+}
+
+SearchManager::Summary SearchManager::search(const string& virtual_path, const Options& options,
+                                             const MatchCallback& on_match) {
+    Summary summary;
+    if (options.pattern.empty()) {
+        summary.error = "Error: Empty search pattern";
+        return summary;
+    }
+
+    Matcher matcher;
+    if (hasRegexSyntax(options.pattern)) {
+        try {
+            auto flags = regex::ECMAScript | regex::optimize;
+            if (options.ignore_case) {
+                flags |= regex::icase;
+            }
+            matcher.expression = regex(options.pattern, flags);
+        } catch (const regex_error& e) {
+            summary.error = "Error: Invalid pattern: " + string(e.what());
+            return summary;
+        }
+        matcher.use_regex = true;
+        matcher.literal = LiteralFinder(requiredLiteral(options.pattern), options.ignore_case);
+    } else {
+        matcher.literal = LiteralFinder(options.pattern, options.ignore_case);
+    }
+
+    // FileXplore's bookkeeping directories are not there as far as clients can tell
+    struct stat info;
+    if (PathUtils::isReservedPath(virtual_path) || !Sandbox::statPath(virtual_path, info)) {
+        summary.error = "Error: Path does not exist: " + virtual_path;
+        return summary;
+    }
+
+    mutex report_mutex;
+    atomic<bool> stopped(false);
+    atomic<uint64_t> files_scanned(0);
+    atomic<uint64_t> files_matched(0);
+    atomic<uint64_t> binary_skipped(0);
+    atomic<uint64_t> long_lines_skipped(0);
+    atomic<uint64_t> bytes_scanned(0);
+    uint64_t matches = 0;
+
+    auto scanFile = [&](const string& path) {
+        if (stopped) {
+            return;
+        }
+        FileManager::MappedFile file = FileManager::mapFile(path, FileManager::AccessPattern::Sequential);
+        if (!file.isOpen()) {
+            return;
+        }
+        files_scanned++;
+        bytes_scanned += file.size();
+        const char* begin = file.data();
+        const char* end = begin + file.size();
+        if (file.size() == 0) {
+            return;
+        }
+        if (memchr(begin, '\0', min(file.size(), BINARY_SNIFF_LENGTH))) {
+            binary_skipped++;
+            return;
+        }
+
+        bool file_matched = false;
+        uint64_t long_lines = 0;
+        scanBuffer(begin, end, matcher, long_lines, [&](const char* start, const char* stop, uint64_t line_number) {
+            Match match;
+            match.path = path;
+            match.line_number = line_number;
+            match.line.assign(start, min(static_cast<size_t>(stop - start), MAX_LINE_LENGTH));
+
+            lock_guard<mutex> lock(report_mutex);
+            if (stopped) {
+                return false;
+            }
+            if (!file_matched) {
+                file_matched = true;
+                files_matched++;
+            }
+            matches++;
+            if (!on_match(match) || (options.max_matches > 0 && matches >= options.max_matches)) {
+                stopped = true;
+                return false;
+            }
+            return true;
+        });
+        long_lines_skipped += long_lines;
+    };
+
+    if ((info.st_mode & S_IFMT) == S_IFREG) {
+        scanFile(virtual_path);
+    } else if ((info.st_mode & S_IFMT) == S_IFDIR) {
+        TreeWalker::Options walk_options;
+        walk_options.max_depth = options.recursive ? -1 : 1;
+        walk_options.threads = options.threads;
+        // FileXplore's own bookkeeping directories are not user content
+        walk_options.filter = [](const TreeWalker::WalkEntry& entry) {
+            return !PathUtils::isReservedPath(entry.path);
+        };
+        bool walked = TreeWalker::walk(virtual_path, walk_options, [&](const TreeWalker::WalkEntry& entry) {
+            if (entry.info.type == DirManager::EntryType::File) {
+                scanFile(entry.path);
+            }
+        });
+        if (!walked) {
+            summary.error = "Error: Cannot read directory: " + virtual_path;
+            return summary;
+        }
+    } else {
+        summary.error = "Error: Not a file or directory: " + virtual_path;
+        return summary;
+    }
+
+    summary.files_scanned = files_scanned;
+    summary.files_matched = files_matched;
+    summary.binary_skipped = binary_skipped;
+    summary.long_lines_skipped = long_lines_skipped;
+    summary.bytes_scanned = bytes_scanned;
+    summary.matches = matches;
+    summary.truncated = stopped;
+    FX_LOG_DEBUG("Search for '" << options.pattern << "' in " << virtual_path << ": " << matches << " matches, "
+                 << summary.files_scanned << " files, " << summary.bytes_scanned << " bytes");
+    return summary;
+}
+
+bool SearchManager::usesAvx2() {
+    return cpu_has_avx2;
+}
+
+string SearchManager::startJob(const string& virtual_path, const Options& options) {
+    expireJobs();
+
+    auto job = make_shared<Job>();
+    job->last_access = time(nullptr);
+    string job_id = SessionManager::generateToken();
+    {
+        lock_guard<mutex> lock(jobs_mutex);
+        jobs[job_id] = job;
+    }
+
+    Options job_options = options;
+    if (job_options.max_matches == 0 || job_options.max_matches > MAX_JOB_MATCHES) {
+        job_options.max_matches = MAX_JOB_MATCHES;
+    }
+    thread([job, virtual_path, job_options]() {
+        Summary summary = search(virtual_path, job_options, [&job](const Match& match) {
+            lock_guard<mutex> lock(job->mutex);
+            if (job->cancelled) {
+                return false;
+            }
+            job->matches.push_back(match);
+            return true;
+        });
+        lock_guard<mutex> lock(job->mutex);
+        job->summary = summary;
+        job->done = true;
+    }).detach();
+    return job_id;
+}
+
+bool SearchManager::getJobResults(const string& job_id, size_t from, vector<Match>& matches, Summary& summary,
+                                  bool& done) {
+    shared_ptr<Job> job;
+    {
+        lock_guard<mutex> lock(jobs_mutex);
+        auto it = jobs.find(job_id);
+        if (it == jobs.end()) {
+            return false;
+        }
+        job = it->second;
+    }
+
+    lock_guard<mutex> lock(job->mutex);
+    job->last_access = time(nullptr);
+    if (from < job->matches.size()) {
+        matches.assign(job->matches.begin() + static_cast<ptrdiff_t>(from), job->matches.end());
+    }
+    summary = job->summary;
+    done = job->done;
+    if (!done) {
+        summary.matches = job->matches.size();
+    }
+    return true;
+}
+
+bool SearchManager::cancelJob(const string& job_id) {
+    lock_guard<mutex> lock(jobs_mutex);
+    auto it = jobs.find(job_id);
+    if (it == jobs.end()) {
+        return false;
+    }
+    it->second->cancelled = true;
+    jobs.erase(it);
+    return true;
+}
+
+void SearchManager::expireJobs() {
+    time_t now = time(nullptr);
+    lock_guard<mutex> lock(jobs_mutex);
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        bool idle;
+        {
+            lock_guard<mutex> job_lock(it->second->mutex);
+            idle = now - it->second->last_access > JOB_IDLE_TIMEOUT;
+        }
+        if (idle) {
+            it->second->cancelled = true;
+            it = jobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
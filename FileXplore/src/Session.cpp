@@ -0,0 +1,168 @@
+#include "../include/Session.h"
+#include "../include/PathUtils.h"
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <cerrno>
+#include <cstdint>
+
+#if defined(__linux__)
+    #include <sys/random.h>
+#endif
+
+using namespace std;
+
+// Static member definitions
+shared_mutex SessionManager::mutex;
+unordered_map<string, shared_ptr<Session>> SessionManager::sessions;
+
+// Sessions idle longer than this are reclaimed when new ones are created
+static const chrono::seconds SESSION_IDLE_LIMIT(60 * 60);
+
+Session::Session(const string& id)
+    : id_(id), current_path_("/"), last_used_(chrono::steady_clock::now()) {}
+
+const string& Session::getId() const {
+    return id_;
+}
+
+string Session::getCurrentPath() const {
+    lock_guard<std::mutex> lock(mutex_);
+    return current_path_;
+}
+
+bool Session::setCurrentPath(const string& path) {
+    string resolved = resolvePath(path);
+
+    // isDirectory resolves beneath the root, so it doubles as the safety check
+    if (PathUtils::isReservedPath(resolved) || !PathUtils::isDirectory(resolved)) {
+        return false;
+    }
+
+    lock_guard<std::mutex> lock(mutex_);
+    current_path_ = resolved;
+    return true;
+}
+
+string Session::resolvePath(const string& path) const {
+    return PathUtils::resolvePath(path, getCurrentPath());
+}
+
+HistoryManager& Session::getHistory() {
+    return history_;
+}
+
+const HistoryManager& Session::getHistory() const {
+    return history_;
+}
+
+string Session::getSetting(const string& key, const string& default_value) const {
+    lock_guard<std::mutex> lock(mutex_);
+    auto it = settings_.find(key);
+    return (it != settings_.end()) ? it->second : default_value;
+}
+
+void Session::setSetting(const string& key, const string& value) {
+    lock_guard<std::mutex> lock(mutex_);
+    settings_[key] = value;
+}
+
+map<string, string> Session::getSettings() const {
+    lock_guard<std::mutex> lock(mutex_);
+    return settings_;
+}
+
+void Session::setSettings(const map<string, string>& settings) {
+    lock_guard<std::mutex> lock(mutex_);
+    settings_ = settings;
+}
+
+void Session::touch() {
+    lock_guard<std::mutex> lock(mutex_);
+    last_used_ = chrono::steady_clock::now();
+}
+
+chrono::steady_clock::time_point Session::getLastUsed() const {
+    lock_guard<std::mutex> lock(mutex_);
+    return last_used_;
+}
+
+shared_ptr<Session> SessionManager::acquire(const string& token, bool& created) {
+    created = false;
+    if (!token.empty()) {
+        shared_ptr<Session> existing = find(token);
+        if (existing) {
+            existing->touch();
+            return existing;
+        }
+    }
+
+    expireIdle(SESSION_IDLE_LIMIT);
+
+    auto session = make_shared<Session>(generateToken());
+    {
+        unique_lock<shared_mutex> lock(mutex);
+        sessions[session->getId()] = session;
+    }
+    created = true;
+    return session;
+}
+
+shared_ptr<Session> SessionManager::find(const string& token) {
+    shared_lock<shared_mutex> lock(mutex);
+    auto it = sessions.find(token);
+    return (it != sessions.end()) ? it->second : nullptr;
+}
+
+size_t SessionManager::getSessionCount() {
+    shared_lock<shared_mutex> lock(mutex);
+    return sessions.size();
+}
+
+void SessionManager::expireIdle(chrono::seconds max_idle) {
+    auto now = chrono::steady_clock::now();
+    unique_lock<shared_mutex> lock(mutex);
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        if (now - it->second->getLastUsed() > max_idle) {
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+string SessionManager::generateToken() {
+    // 128 bits straight from the OS generator, hex encoded; a seeded PRNG would hold only
+    // as many bits as its seed
+    uint8_t bytes[16];
+    size_t filled = 0;
+#if defined(__linux__)
+    while (filled < sizeof(bytes)) {
+        ssize_t n = getrandom(bytes + filled, sizeof(bytes) - filled, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        filled += static_cast<size_t>(n);
+    }
+#endif
+    if (filled < sizeof(bytes)) {
+        // random_device yields 32 bits a call
+        random_device device;
+        for (size_t i = 0; i < sizeof(bytes); i += 4) {
+            uint32_t value = device();
+            for (size_t b = 0; b < 4; ++b) {
+                bytes[i + b] = static_cast<uint8_t>(value >> (8 * b));
+            }
+        }
+    }
+
+    ostringstream token;
+    token << hex << setfill('0');
+    for (uint8_t byte : bytes) {
+        token << setw(2) << static_cast<unsigned>(byte);
+    }
+    return token.str();
+}
@@ -0,0 +1,136 @@
+#include "../include/Sha256.h"
+#include <algorithm>
+#include <cstring>
+
+static const std::uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline std::uint32_t rotateRight(std::uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+Sha256::Sha256() : block_length_(0), total_length_(0) {
+    static const std::uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    std::memcpy(state_, initial, sizeof(state_));
+}
+
+void Sha256::transform(const std::uint8_t* block) {
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<std::uint32_t>(block[i * 4]) << 24) |
+               (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8) |
+               static_cast<std::uint32_t>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        std::uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        std::uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    std::uint32_t a = state_[0], b = state_[1], c = state_[2], d = state_[3];
+    std::uint32_t e = state_[4], f = state_[5], g = state_[6], h = state_[7];
+    for (int i = 0; i < 64; ++i) {
+        std::uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+        std::uint32_t choose = (e & f) ^ (~e & g);
+        std::uint32_t t1 = h + s1 + choose + ROUND_CONSTANTS[i] + w[i];
+        std::uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+        std::uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        std::uint32_t t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+void Sha256::update(const void* data, std::size_t length) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    total_length_ += length;
+
+    // Top up a partial block first, then hash whole blocks straight from the input
+    if (block_length_ > 0) {
+        std::size_t take = std::min(length, sizeof(block_) - block_length_);
+        std::memcpy(block_ + block_length_, bytes, take);
+        block_length_ += take;
+        bytes += take;
+        length -= take;
+        if (block_length_ < sizeof(block_)) {
+            return;
+        }
+        transform(block_);
+        block_length_ = 0;
+    }
+    while (length >= sizeof(block_)) {
+        transform(bytes);
+        bytes += sizeof(block_);
+        length -= sizeof(block_);
+    }
+    if (length > 0) {
+        std::memcpy(block_, bytes, length);
+        block_length_ = length;
+    }
+}
+
+void Sha256::finish(std::uint8_t digest[DIGEST_SIZE]) {
+    std::uint64_t bit_length = total_length_ * 8;
+
+    // 0x80, zeros up to 56 mod 64, then the message length in bits (big-endian)
+    static const std::uint8_t padding[64] = { 0x80 };
+    std::size_t pad = (block_length_ < 56) ? 56 - block_length_ : 120 - block_length_;
+    update(padding, pad);
+    std::uint8_t length_bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        length_bytes[i] = static_cast<std::uint8_t>(bit_length >> (56 - 8 * i));
+    }
+    update(length_bytes, sizeof(length_bytes));
+
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = static_cast<std::uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<std::uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<std::uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<std::uint8_t>(state_[i]);
+    }
+}
+
+std::string Sha256::hexDigest() {
+    static const char hex[] = "0123456789abcdef";
+    std::uint8_t digest[DIGEST_SIZE];
+    finish(digest);
+
+    std::string result;
+    result.reserve(DIGEST_SIZE * 2);
+    for (std::uint8_t byte : digest) {
+        result += hex[byte >> 4];
+        result += hex[byte & 0x0f];
+    }
+    return result;
+}
+
+std::string Sha256::hash(std::string_view data) {
+    Sha256 hasher;
+    hasher.update(data);
+    return hasher.hexDigest();
+}
@@ -0,0 +1,629 @@
+#include "../include/SnapshotManager.h"
+#include "../include/TreeWalker.h"
+#include "../include/FileManager.h"
+#include "../include/FileIndex.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/MetadataCache.h"
+#include "../include/Logger.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+using namespace std;
+
+// Static member definitions
+const char* const SnapshotManager::SNAPSHOT_DIR = "/.fxsnap";
+atomic<bool> SnapshotManager::present(false);
+mutex SnapshotManager::snapshot_mutex;
+shared_mutex SnapshotManager::link_mutex;
+
+using ItemList = vector<pair<string, SnapshotManager::Item>>;
+using ItemRef = const pair<string, SnapshotManager::Item>*;
+
+static const size_t MAX_NAME_LENGTH = 64;
+
+static char typeCode(DirManager::EntryType type) {
+    switch (type) {
+        case DirManager::EntryType::Directory: return 'd';
+        case DirManager::EntryType::Symlink:   return 'l';
+        default:                               return 'f';
+    }
+}
+
+static DirManager::EntryType typeFromCode(char code) {
+    switch (code) {
+        case 'd': return DirManager::EntryType::Directory;
+        case 'l': return DirManager::EntryType::Symlink;
+        default:  return DirManager::EntryType::File;
+    }
+}
+
+// Paths may hold anything but NUL; the manifest is line based, so escape \ and newlines
+static void appendEscaped(string& out, const string& path) {
+    for (char c : path) {
+        if (c == '\\') {
+            out += "\\\\";
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+}
+
+static string unescape(string_view text) {
+    string path;
+    path.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            path += (text[++i] == 'n') ? '\n' : text[i];
+        } else {
+            path += text[i];
+        }
+    }
+    return path;
+}
+
+// Check whether path is scope or lies beneath it
+static bool inScope(const string& path, const string& scope) {
+    if (scope == "/") {
+        return true;
+    }
+    return path.compare(0, scope.size(), scope) == 0 && (path.size() == scope.size() || path[scope.size()] == '/');
+}
+
+// Give to (which must not exist) the inode of from, or a copy of it where a file cannot be linked
+static bool linkOrCopy(const string& from, const string& to, const SnapshotManager::Item& item) {
+    if (Sandbox::linkPath(from, to)) {
+        return true;
+    }
+    if (errno == EEXIST || errno == ENOENT || item.type != DirManager::EntryType::File) {
+        return false;
+    }
+    ScopedFd source(Sandbox::openPath(from, O_RDONLY));
+    ScopedFd copy(source.valid() ? Sandbox::openPath(to, O_WRONLY | O_CREAT | O_EXCL, item.mode & 07777) : -1);
+    if (!copy.valid()) {
+        return false;
+    }
+    if (!FileManager::copyContents(source.get(), copy.get(), item.size)) {
+        Sandbox::removeFile(to);
+        return false;
+    }
+    return true;
+}
+
+// Walk two path-sorted lists together; visit gets null for a side that lacks the path
+static void mergeItems(const ItemList& then, const ItemList& now, const function<void(ItemRef, ItemRef)>& visit) {
+    size_t i = 0;
+    size_t j = 0;
+    while (i < then.size() || j < now.size()) {
+        if (j == now.size() || (i < then.size() && then[i].first < now[j].first)) {
+            visit(&then[i++], nullptr);
+        } else if (i == then.size() || now[j].first < then[i].first) {
+            visit(nullptr, &now[j++]);
+        } else {
+            visit(&then[i++], &now[j++]);
+        }
+    }
+}
+
+// Check whether the tree still holds what the snapshot recorded (for files: the same inode, unchanged)
+static bool sameItem(const SnapshotManager::Item& then, const SnapshotManager::Item& now) {
+    if (then.type != now.type) {
+        return false;
+    }
+    if (then.type == DirManager::EntryType::Directory) {
+        return (then.mode & 07777) == (now.mode & 07777);
+    }
+    return then.inode == now.inode && then.size == now.size && then.mtime == now.mtime;
+}
+
+void SnapshotManager::initialize() {
+    struct stat info;
+    present = Sandbox::statPath(SNAPSHOT_DIR, info) && (info.st_mode & S_IFMT) == S_IFDIR;
+    if (!present) {
+        return;
+    }
+
+    // A snapshot interrupted before its manifest was written is not restorable
+    vector<string> incomplete;
+    DirManager::DirIterator it(SNAPSHOT_DIR);
+    DirManager::DirEntry entry;
+    while (it.isOpen() && it.next(entry)) {
+        if (entry.type == DirManager::EntryType::Directory &&
+            !Sandbox::statPath(snapshotPath(entry.name) + "/manifest", info)) {
+            incomplete.push_back(entry.name);
+        }
+    }
+    for (const auto& name : incomplete) {
+        FX_LOG_WARN("Removing incomplete snapshot " << name);
+        removeTree(snapshotPath(name));
+    }
+}
+
+bool SnapshotManager::hasSnapshots() {
+    return present.load();
+}
+
+bool SnapshotManager::isValidName(const string& name) {
+    if (name.empty() || name.size() > MAX_NAME_LENGTH || name[0] == '.') {
+        return false;
+    }
+    for (char c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '_' && c != '-') {
+            return false;
+        }
+    }
+    return true;
+}
+
+shared_lock<shared_mutex> SnapshotManager::holdLinks() {
+    return shared_lock<shared_mutex>(link_mutex);
+}
+
+string SnapshotManager::create(const string& requested_name, Info& info) {
+    lock_guard<mutex> lock(snapshot_mutex);
+    auto start = chrono::steady_clock::now();
+
+    string name = requested_name;
+    if (name.empty()) {
+        time_t now = time(nullptr);
+        char stamp[32];
+        tm local_tm;
+#ifdef _WIN32
+        localtime_s(&local_tm, &now);
+#else
+        localtime_r(&now, &local_tm);
+#endif
+        strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local_tm);
+        name = stamp;
+    }
+    if (!isValidName(name)) {
+        return "Error: Invalid snapshot name (letters, digits, '.', '_' and '-', up to 64): " + name;
+    }
+
+    if (!Sandbox::makeDirectory(SNAPSHOT_DIR, 0755) && errno != EEXIST) {
+        return "Error: Cannot create snapshot directory (" + string(strerror(errno)) + ")";
+    }
+    // From here on writers treat shared inodes as shared
+    present = true;
+    string base = snapshotPath(name);
+    if (!Sandbox::makeDirectory(base, 0755)) {
+        int error = errno;
+        MetadataCache::invalidateTree(SNAPSHOT_DIR);
+        if (error == EEXIST) {
+            return "Error: Snapshot already exists: " + name;
+        }
+        return "Error: Cannot create snapshot " + name + " (" + strerror(error) + ")";
+    }
+    string tree = base + "/tree";
+    Sandbox::makeDirectory(tree, 0755);
+
+    // In-place writers wait until every file is linked, so none writes through a link made after its check
+    unique_lock<shared_mutex> links(link_mutex);
+    vector<TreeWalker::WalkEntry> entries;
+    TreeWalker::Options options;
+    options.filter = [](const TreeWalker::WalkEntry& entry) { return !PathUtils::isReservedPath(entry.path); };
+    TreeWalker::walkOrdered("/", options, entries);
+
+    // Directories first, in pre-order so parents precede children; the manifest keeps the real modes
+    string error;
+    vector<size_t> leaves;
+    info = Info();
+    info.name = name;
+    info.created = time(nullptr);
+    for (size_t i = 0; i < entries.size() && error.empty(); ++i) {
+        const auto& entry = entries[i];
+        if (entry.info.type == DirManager::EntryType::Directory) {
+            if (!Sandbox::makeDirectory(tree + entry.path, 0755)) {
+                error = "Error: Cannot create snapshot directory " + entry.path + " (" + strerror(errno) + ")";
+            }
+            info.directories++;
+        } else if (entry.info.type == DirManager::EntryType::File ||
+                   entry.info.type == DirManager::EntryType::Symlink) {
+            leaves.push_back(i);
+        }
+    }
+
+    // One link per file: the cost is in the directory updates, so spread them over a few threads
+    vector<char> vanished(entries.size(), 0);
+    if (error.empty()) {
+        atomic<size_t> next(0);
+        atomic<bool> failed(false);
+        mutex error_mutex;
+        auto worker = [&]() {
+            for (size_t n = next++; n < leaves.size() && !failed; n = next++) {
+                const auto& entry = entries[leaves[n]];
+                Item item{entry.info.type, entry.info.mode, entry.info.size, entry.info.mtime,
+                          entry.info.inode};
+                if (linkOrCopy(entry.path, tree + entry.path, item)) {
+                    continue;
+                }
+                int code = errno;
+                if (code == ENOENT) {
+                    // Removed since the walk, so not part of the snapshot
+                    vanished[leaves[n]] = 1;
+                } else {
+                    lock_guard<mutex> error_lock(error_mutex);
+                    error = "Error: Cannot snapshot " + entry.path + " (" + strerror(code) + ")";
+                    failed = true;
+                }
+            }
+        };
+        size_t thread_count = min<size_t>(max(1u, thread::hardware_concurrency()), 8);
+        thread_count = min(thread_count, leaves.size() / 256 + 1);
+        vector<thread> threads;
+        for (size_t t = 1; t < thread_count; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    // The manifest goes last: its presence marks the snapshot complete
+    if (error.empty()) {
+        string lines;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const auto& entry = entries[i];
+            if (entry.info.type == DirManager::EntryType::Other || vanished[i]) {
+                continue;
+            }
+            if (entry.info.type != DirManager::EntryType::Directory) {
+                info.files++;
+            }
+            if (entry.info.type == DirManager::EntryType::File) {
+                info.bytes += static_cast<uint64_t>(entry.info.size);
+            }
+            char line[128];
+            snprintf(line, sizeof(line), "%c %o %lld %lld %llu ", typeCode(entry.info.type),
+                     static_cast<unsigned>(entry.info.mode & 07777), entry.info.size,
+                     static_cast<long long>(entry.info.mtime), static_cast<unsigned long long>(entry.info.inode));
+            lines += line;
+            appendEscaped(lines, entry.path);
+            lines += '\n';
+        }
+        string manifest = "FXSNAP " + to_string(FORMAT_VERSION) + " " + to_string(info.created) + " " +
+                          to_string(info.files) + " " + to_string(info.directories) + " " +
+                          to_string(info.bytes) + "\n" + lines;
+
+        string temp_path = base + "/manifest.tmp";
+        ScopedFd fd(Sandbox::openPath(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (!fd.valid() || !Sandbox::writeAll(fd.get(), manifest.data(), manifest.size()) ||
+            !Sandbox::renamePath(temp_path, base + "/manifest")) {
+            error = "Error: Cannot write snapshot manifest (" + string(strerror(errno)) + ")";
+        }
+    }
+
+    if (!error.empty()) {
+        removeTree(base);
+        MetadataCache::invalidateTree(SNAPSHOT_DIR);
+        return error;
+    }
+    MetadataCache::invalidateTree(SNAPSHOT_DIR);
+    double elapsed_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    FX_LOG_DEBUG("Snapshot " << name << ": " << info.files << " files linked in " << elapsed_ms << " ms");
+    return "";
+}
+
+string SnapshotManager::list(vector<Info>& snapshots) {
+    snapshots.clear();
+    if (!present) {
+        return "";
+    }
+
+    DirManager::DirIterator it(SNAPSHOT_DIR);
+    DirManager::DirEntry entry;
+    while (it.isOpen() && it.next(entry)) {
+        Info info;
+        if (entry.type == DirManager::EntryType::Directory &&
+            readManifest(entry.name, "/", info, nullptr).empty()) {
+            snapshots.push_back(info);
+        }
+    }
+    sort(snapshots.begin(), snapshots.end(), [](const Info& a, const Info& b) {
+        return a.created != b.created ? a.created < b.created : a.name < b.name;
+    });
+    return "";
+}
+
+string SnapshotManager::restore(const string& name, const string& scope, RestoreStats& stats) {
+    lock_guard<mutex> lock(snapshot_mutex);
+    stats = RestoreStats();
+    if (PathUtils::isReservedPath(scope)) {
+        return "Error: Cannot restore " + scope;
+    }
+
+    Info info;
+    ItemList then;
+    string error = readManifest(name, scope, info, &then);
+    if (!error.empty()) {
+        return error;
+    }
+    if (then.empty() && scope != "/") {
+        return "Error: Path not in snapshot " + name + ": " + scope;
+    }
+    ItemList now;
+    scanTree(scope, now);
+
+    // Entries the snapshot lacks (or holds as another type) go first, children before parents
+    vector<string> extras;
+    vector<ItemRef> directories;
+    vector<ItemRef> leaves;
+    mergeItems(then, now, [&](ItemRef was, ItemRef is) {
+        if (is && (!was || was->second.type != is->second.type)) {
+            extras.push_back(is->first);
+        }
+        if (!was) {
+            return;
+        }
+        if (is && sameItem(was->second, is->second)) {
+            stats.unchanged += was->second.type != DirManager::EntryType::Directory;
+        } else if (was->second.type == DirManager::EntryType::Directory) {
+            directories.push_back(was);
+        } else {
+            leaves.push_back(was);
+        }
+    });
+
+    string last_top;
+    for (auto it = extras.rbegin(); it != extras.rend(); ++it) {
+        struct stat current;
+        bool is_directory = Sandbox::statPath(*it, current) && (current.st_mode & S_IFMT) == S_IFDIR;
+        if (is_directory ? Sandbox::removeDirectory(*it) : Sandbox::removeFile(*it)) {
+            stats.removed++;
+        }
+    }
+    for (const auto& path : extras) {
+        // Dropping the topmost removed path drops everything beneath it from the index
+        if (last_top.empty() || !inScope(path, last_top)) {
+            FileIndex::update(path);
+            last_top = path;
+        }
+    }
+
+    string tree = snapshotPath(name) + "/tree";
+    for (ItemRef item : directories) {
+        if (Sandbox::makeDirectory(item->first, item->second.mode & 07777)) {
+            stats.directories++;
+        }
+#ifndef _WIN32
+        // An existing directory whose mode changed
+        else if (errno == EEXIST) {
+            ScopedFd dir(Sandbox::openPath(item->first, O_RDONLY | O_DIRECTORY));
+            if (dir.valid()) {
+                fchmod(dir.get(), item->second.mode & 07777);
+            }
+        }
+#endif
+    }
+
+    // Changed files get the snapshot's inode back under a temp name, then replace the current one
+    unique_lock<shared_mutex> links(link_mutex);
+    for (ItemRef item : leaves) {
+        const string& path = item->first;
+        string temp_path = Sandbox::siblingTempPath(path, ".fxsnap.");
+        if (!linkOrCopy(tree + path, temp_path, item->second)) {
+            error = "Error: Cannot restore " + path + " (" + strerror(errno) + ")";
+            break;
+        }
+        if (!Sandbox::renamePath(temp_path, path)) {
+            error = "Error: Cannot restore " + path + " (" + strerror(errno) + ")";
+            Sandbox::removeFile(temp_path);
+            break;
+        }
+        stats.restored++;
+    }
+    links.unlock();
+
+    MetadataCache::invalidateTree(scope);
+    if (scope == "/") {
+        FileIndex::rebuild();
+    } else {
+        FileIndex::update(scope, true);
+    }
+    FX_LOG_DEBUG("Restored " << scope << " from snapshot " << name << ": " << stats.restored << " relinked, "
+                 << stats.unchanged << " unchanged, " << stats.removed << " removed");
+    return error;
+}
+
+string SnapshotManager::diff(const string& name, const string& scope, vector<Change>& changes) {
+    changes.clear();
+    Info info;
+    ItemList then;
+    string error = readManifest(name, scope, info, &then);
+    if (!error.empty()) {
+        return error;
+    }
+    ItemList now;
+    scanTree(scope, now);
+
+    mergeItems(then, now, [&](ItemRef was, ItemRef is) {
+        if (!is) {
+            changes.push_back({'D', was->first});
+        } else if (!was) {
+            changes.push_back({'A', is->first});
+        } else if (!sameItem(was->second, is->second)) {
+            changes.push_back({'M', is->first});
+        }
+    });
+    return "";
+}
+
+string SnapshotManager::remove(const string& name) {
+    lock_guard<mutex> lock(snapshot_mutex);
+    struct stat info;
+    if (!isValidName(name) || !Sandbox::statPath(snapshotPath(name) + "/manifest", info)) {
+        return "Error: No such snapshot: " + name;
+    }
+
+    // Without its manifest the snapshot counts as incomplete, should the removal be interrupted
+    Sandbox::removeFile(snapshotPath(name) + "/manifest");
+    removeTree(snapshotPath(name));
+
+    // The last snapshot gone: files no longer share inodes with one
+    if (Sandbox::removeDirectory(SNAPSHOT_DIR)) {
+        present = false;
+    }
+    MetadataCache::invalidateTree(SNAPSHOT_DIR);
+    return "";
+}
+
+string SnapshotManager::snapshotPath(const string& name) {
+    return string(SNAPSHOT_DIR) + "/" + name;
+}
+
+string SnapshotManager::readManifest(const string& name, const string& scope, Info& info, ItemList* items) {
+    if (!isValidName(name)) {
+        return "Error: No such snapshot: " + name;
+    }
+    // Clients cannot name the snapshot directory, so the manifest is opened here directly
+    ScopedFd fd(Sandbox::openPath(snapshotPath(name) + "/manifest", O_RDONLY));
+    if (!fd.valid()) {
+        return "Error: No such snapshot: " + name;
+    }
+    FileManager::MappedFile file = FileManager::mapFile(fd.get());
+    if (!file.isOpen()) {
+        return "Error: No such snapshot: " + name;
+    }
+    string_view text = file.view();
+
+    size_t line_end = text.find('\n');
+    string header(text.substr(0, line_end));
+    int version = 0;
+    long long created = 0;
+    unsigned long long files = 0;
+    unsigned long long directories = 0;
+    unsigned long long bytes = 0;
+    if (line_end == string_view::npos ||
+        sscanf(header.c_str(), "FXSNAP %d %lld %llu %llu %llu", &version, &created, &files, &directories,
+               &bytes) != 5 || version != FORMAT_VERSION) {
+        return "Error: Damaged snapshot manifest: " + name;
+    }
+    info.name = name;
+    info.created = static_cast<time_t>(created);
+    info.files = files;
+    info.directories = directories;
+    info.bytes = bytes;
+    if (!items) {
+        return "";
+    }
+
+    // "<type> <mode> <size> <mtime> <inode> <path>"; the path is the rest of the line
+    items->clear();
+    size_t pos = line_end + 1;
+    while (pos < text.size()) {
+        line_end = text.find('\n', pos);
+        if (line_end == string_view::npos) {
+            line_end = text.size();
+        }
+        string line(text.substr(pos, line_end - pos));
+        pos = line_end + 1;
+
+        char* cursor = &line[0];
+        char* end = cursor + line.size();
+        if (line.size() < 2) {
+            return "Error: Damaged snapshot manifest: " + name;
+        }
+        Item item;
+        item.type = typeFromCode(cursor[0]);
+        item.mode = static_cast<mode_t>(strtoul(cursor + 1, &cursor, 8));
+        item.size = strtoll(cursor, &cursor, 10);
+        item.mtime = static_cast<time_t>(strtoll(cursor, &cursor, 10));
+        item.inode = strtoull(cursor, &cursor, 10);
+        if (cursor >= end || *cursor != ' ') {
+            return "Error: Damaged snapshot manifest: " + name;
+        }
+        string path = unescape(string_view(cursor + 1, static_cast<size_t>(end - cursor - 1)));
+        if (inScope(path, scope)) {
+            items->emplace_back(move(path), item);
+        }
+    }
+    sort(items->begin(), items->end(), [](const pair<string, Item>& a, const pair<string, Item>& b) {
+        return a.first < b.first;
+    });
+    return "";
+}
+
+void SnapshotManager::scanTree(const string& scope, ItemList& items) {
+    items.clear();
+    auto add = [&items](const string& path, const DirManager::DirEntry& entry) {
+        if (entry.type != DirManager::EntryType::Other) {
+            items.push_back({path, Item{entry.type, entry.mode, entry.size, entry.mtime, entry.inode}});
+        }
+    };
+
+    if (scope != "/") {
+        // The scope itself, not following it should it be a symlink
+        DirManager::DirEntry self;
+        struct stat info;
+#ifndef _WIN32
+        string leaf;
+        ScopedFd parent(Sandbox::openParent(scope, leaf));
+        if (!parent.valid() || fstatat(parent.get(), leaf.c_str(), &info, AT_SYMLINK_NOFOLLOW) != 0) {
+            return;
+        }
+#else
+        if (!Sandbox::statPath(scope, info)) {
+            return;
+        }
+#endif
+        switch (info.st_mode & S_IFMT) {
+            case S_IFREG: self.type = DirManager::EntryType::File; break;
+            case S_IFDIR: self.type = DirManager::EntryType::Directory; break;
+#ifdef S_IFLNK
+            case S_IFLNK: self.type = DirManager::EntryType::Symlink; break;
+#endif
+            default: self.type = DirManager::EntryType::Other; break;
+        }
+        self.size = static_cast<long long>(info.st_size);
+        self.mtime = info.st_mtime;
+        self.mode = info.st_mode;
+        self.inode = static_cast<uint64_t>(info.st_ino);
+        add(scope, self);
+        if (self.type != DirManager::EntryType::Directory) {
+            return;
+        }
+    }
+
+    vector<TreeWalker::WalkEntry> entries;
+    TreeWalker::Options options;
+    options.filter = [](const TreeWalker::WalkEntry& entry) { return !PathUtils::isReservedPath(entry.path); };
+    TreeWalker::walkOrdered(scope, options, entries);
+    for (const auto& entry : entries) {
+        add(entry.path, entry.info);
+    }
+    sort(items.begin(), items.end(), [](const pair<string, Item>& a, const pair<string, Item>& b) {
+        return a.first < b.first;
+    });
+}
+
+void SnapshotManager::removeTree(const string& virtual_path) {
+    vector<TreeWalker::WalkEntry> entries;
+    TreeWalker::walkOrdered(virtual_path, TreeWalker::Options(), entries);
+
+    // Pre-order lists a directory before its contents, so backwards empties it before removing it
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        if (it->info.type == DirManager::EntryType::Directory) {
+            Sandbox::removeDirectory(it->path);
+        } else {
+            Sandbox::removeFile(it->path);
+        }
+    }
+    Sandbox::removeDirectory(virtual_path);
+    MetadataCache::invalidateTree(virtual_path);
+}
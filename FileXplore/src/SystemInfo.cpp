@@ -3,6 +3,7 @@
 #include <iomanip>
 #include <fstream>
 #include <iostream>
+#include <atomic>
 using std::string;
 using std::cout;
 using std::cerr;
@@ -16,13 +17,14 @@ using std::setprecision;
 using std::ios;
 #include "../include/SystemInfo.h"
 #include "../include/PathUtils.h"
+#include "../include/Session.h"
+#include "../include/TreeWalker.h"
 
 #ifdef _WIN32
     #include <windows.h>
     #include <direct.h>
 #else
     #include <sys/statvfs.h>
-    #include <dirent.h>
     #include <sys/stat.h>
     #include <unistd.h>
 #endif
@@ -35,15 +37,15 @@ SystemInfo::DiskUsage SystemInfo::getDiskUsage() {
         return usage;
     }
     
-    if (PathUtils::pathExists(vfs_root) && PathUtils::isDirectory(vfs_root)) {
-        calculateDirectoryStats(vfs_root, usage);
-        usage.formatted_size = formatBytes(usage.total_size_bytes);
+    if (PathUtils::isDirectory("/")) {
+        calculateDirectoryStats("/", usage);
     }
+    usage.formatted_size = formatBytes(usage.total_size_bytes);
     
     return usage;
 }
 
-void SystemInfo::displayDiskUsage() {
+void SystemInfo::displayDiskUsage(const Session& session) {
     DiskUsage usage = getDiskUsage();
     
     cout << string(60, '=') << endl;
@@ -53,7 +55,7 @@ void SystemInfo::displayDiskUsage() {
     cout << left << setw(20) << "VFS Root:" 
               << PathUtils::getVFSRoot() << endl;
     cout << left << setw(20) << "Current Directory:" 
-              << PathUtils::getCurrentVirtualPath() << endl;
+              << session.getCurrentPath() << endl;
     
     cout << string(60, '-') << endl;
     
@@ -89,76 +91,34 @@ string SystemInfo::formatBytes(size_t bytes) {
     return oss.str();
 }
 
-string SystemInfo::getVFSInfo() {
+string SystemInfo::getVFSInfo(const Session& session) {
     ostringstream info;
     DiskUsage usage = getDiskUsage();
     
     info << "VFS Root: " << PathUtils::getVFSRoot() << "\n";
-    info << "Current Directory: " << PathUtils::getCurrentVirtualPath() << "\n";
+    info << "Current Directory: " << session.getCurrentPath() << "\n";
     info << "Files: " << usage.total_files << ", Directories: " << usage.total_directories;
     info << ", Size: " << usage.formatted_size;
     
     return info.str();
 }
 
-void SystemInfo::calculateDirectoryStats(const string& path, DiskUsage& usage) {
-    if (!PathUtils::pathExists(path) || !PathUtils::isDirectory(path)) {
-        return;
-    }
-    
-    // Use DirManager to list directory contents
-    string virtual_path = "/"; // Convert to virtual path if needed
-    vector<string> entries;
-    
-#ifdef _WIN32
-    WIN32_FIND_DATA findFileData;
-    string searchPath = path + "\\*";
-    HANDLE hFind = FindFirstFile(searchPath.c_str(), &findFileData);
-    
-    if (hFind != INVALID_HANDLE_VALUE) {
-        do {
-            string filename = findFileData.cFileName;
-            if (filename != "." && filename != "..") {
-                string fullPath = path + "\\" + filename;
-                if (PathUtils::isDirectory(fullPath)) {
-                    usage.total_directories++;
-                    calculateDirectoryStats(fullPath, usage);
-                } else if (PathUtils::isFile(fullPath)) {
-                    usage.total_files++;
-                    // Get file size using ifstream
-                    ifstream file(fullPath, ios::binary | ios::ate);
-                    if (file.is_open()) {
-                        usage.total_size_bytes += file.tellg();
-                        file.close();
-                    }
-                }
-            }
-        } while (FindNextFile(hFind, &findFileData) != 0);
-        FindClose(hFind);
-    }
-#else
-    DIR* dir = opendir(path.c_str());
-    if (dir != nullptr) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            string filename = entry->d_name;
-            if (filename != "." && filename != "..") {
-                string fullPath = path + "/" + filename;
-                if (PathUtils::isDirectory(fullPath)) {
-                    usage.total_directories++;
-                    calculateDirectoryStats(fullPath, usage);
-                } else if (PathUtils::isFile(fullPath)) {
-                    usage.total_files++;
-                    // Get file size using ifstream
-                    ifstream file(fullPath, ios::binary | ios::ate);
-                    if (file.is_open()) {
-                        usage.total_size_bytes += file.tellg();
-                        file.close();
-                    }
-                }
-            }
+void SystemInfo::calculateDirectoryStats(const string& virtual_path, DiskUsage& usage) {
+    // Workers visit entries concurrently, so tally into atomics first
+    std::atomic<size_t> files(0);
+    std::atomic<size_t> directories(0);
+    std::atomic<size_t> bytes(0);
+    
+    TreeWalker::walk(virtual_path, TreeWalker::Options(), [&](const TreeWalker::WalkEntry& entry) {
+        if (entry.info.type == DirManager::EntryType::Directory) {
+            directories.fetch_add(1, std::memory_order_relaxed);
+        } else if (entry.info.type == DirManager::EntryType::File) {
+            files.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(static_cast<size_t>(entry.info.size), std::memory_order_relaxed);
         }
-        closedir(dir);
-    }
-#endif
-}
\ No newline at end of file
+    });
+    
+    usage.total_files += files.load();
+    usage.total_directories += directories.load();
+    usage.total_size_bytes += bytes.load();
+}
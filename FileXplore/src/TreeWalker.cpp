@@ -0,0 +1,202 @@
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+using std::string;
+using std::vector;
+#include "../include/TreeWalker.h"
+#include "../include/PathUtils.h"
+
+struct TreeWalker::Node {
+    WalkEntry entry;
+    vector<std::unique_ptr<Node>> children;
+};
+
+// Idle workers sleep at most this long before re-checking for stealable work
+static const std::chrono::microseconds IDLE_WAIT(500);
+
+bool TreeWalker::walk(const string& virtual_root, const Options& options,
+                      const std::function<void(const WalkEntry&)>& visit) {
+    return run(virtual_root, options, &visit, nullptr);
+}
+
+bool TreeWalker::walkOrdered(const string& virtual_root, const Options& options, vector<WalkEntry>& entries) {
+    Node root;
+    if (!run(virtual_root, options, nullptr, &root)) {
+        return false;
+    }
+    flatten(root, entries);
+    return true;
+}
+
+bool TreeWalker::run(const string& virtual_root, const Options& options,
+                     const std::function<void(const WalkEntry&)>* visit, Node* root) {
+    // A directory waiting to be read; node is set only for ordered walks
+    struct WalkTask {
+        string path;
+        int depth;
+        Node* node;
+    };
+
+    // Per-worker deque: the owner works LIFO at the back, thieves take FIFO from the front
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<WalkTask> tasks;
+    };
+
+    string resolved = PathUtils::resolvePath(virtual_root);
+    if (!PathUtils::isDirectory(resolved)) {
+        return false;
+    }
+
+    size_t thread_count = options.threads;
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    vector<std::unique_ptr<WorkQueue>> queues;
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    // pending counts queued plus in-progress directories; the walk ends at zero
+    std::atomic<size_t> pending(1);
+    std::atomic<size_t> queued(1);
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    queues[0]->tasks.push_back(WalkTask{resolved, 0, root});
+
+    auto pushTask = [&](size_t worker, WalkTask task) {
+        pending.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+            queues[worker]->tasks.push_back(std::move(task));
+        }
+        queued.fetch_add(1);
+        idle_cv.notify_one();
+    };
+
+    auto takeTask = [&](size_t worker, WalkTask& task) {
+        // Own queue first, newest task
+        {
+            std::lock_guard<std::mutex> lock(queues[worker]->mutex);
+            if (!queues[worker]->tasks.empty()) {
+                task = std::move(queues[worker]->tasks.back());
+                queues[worker]->tasks.pop_back();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        // Then steal the oldest task (usually the biggest subtree) from a neighbour
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkQueue& victim = *queues[(worker + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    auto processTask = [&](size_t worker, const WalkTask& task) {
+        DirManager::DirIterator it(task.path);
+        if (!it.isOpen()) {
+            return;
+        }
+
+        Node* node = task.node;
+        DirManager::DirEntry info;
+        while (it.next(info)) {
+            WalkEntry entry;
+            entry.path = (task.path == "/") ? "/" + info.name : task.path + "/" + info.name;
+            entry.info = std::move(info);
+            entry.depth = task.depth + 1;
+
+            if (options.filter && !options.filter(entry)) {
+                continue;
+            }
+            if (visit != nullptr) {
+                (*visit)(entry);
+            }
+
+            bool descend = entry.info.type == DirManager::EntryType::Directory &&
+                           (options.max_depth < 0 || entry.depth < options.max_depth);
+            Node* child = nullptr;
+            if (node != nullptr) {
+                node->children.push_back(std::make_unique<Node>());
+                child = node->children.back().get();
+                child->entry = entry;
+            }
+            if (descend) {
+                pushTask(worker, WalkTask{entry.path, entry.depth, child});
+            }
+        }
+
+        if (node != nullptr && !node->children.empty()) {
+            // Children are only touched by this worker, so sorting here is race free
+            std::sort(node->children.begin(), node->children.end(),
+                      [](const std::unique_ptr<Node>& a, const std::unique_ptr<Node>& b) {
+                          return a->entry.info.name < b->entry.info.name;
+                      });
+            node->children.back()->entry.last_sibling = true;
+        }
+    };
+
+    auto workerLoop = [&](size_t worker) {
+        WalkTask task;
+        while (true) {
+            if (takeTask(worker, task)) {
+                processTask(worker, task);
+                if (pending.fetch_sub(1) == 1) {
+                    idle_cv.notify_all();
+                }
+                continue;
+            }
+            if (pending.load() == 0) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            idle_cv.wait_for(lock, IDLE_WAIT, [&]() {
+                return queued.load() > 0 || pending.load() == 0;
+            });
+        }
+    };
+
+    // The calling thread is worker 0
+    vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(workerLoop, i);
+    }
+    workerLoop(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return true;
+}
+
+void TreeWalker::flatten(Node& root, vector<WalkEntry>& entries) {
+    // Explicit stack: no recursion limit on deep trees
+    vector<std::pair<Node*, size_t>> stack;
+    stack.emplace_back(&root, 0);
+    while (!stack.empty()) {
+        Node* node = stack.back().first;
+        size_t index = stack.back().second;
+        if (index == node->children.size()) {
+            stack.pop_back();
+            continue;
+        }
+        stack.back().second++;
+        Node* child = node->children[index].get();
+        entries.push_back(std::move(child->entry));
+        stack.emplace_back(child, 0);
+    }
+}
@@ -0,0 +1,325 @@
+#include "../include/UploadManager.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/Session.h"
+#include "../include/DirManager.h"
+#include "../include/MetadataCache.h"
+#include "../include/FileIndex.h"
+#include "../include/FileManager.h"
+#include "../include/GroupCommit.h"
+#include "../include/BlobStore.h"
+#include "../include/Logger.h"
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+using namespace std;
+
+// Static member definitions
+const char* const UploadManager::UPLOAD_DIR = "/.fxupload";
+mutex UploadManager::uploads_mutex;
+unordered_map<string, shared_ptr<UploadManager::Upload>> UploadManager::uploads;
+
+// Write the whole buffer at offset, retrying on short writes and EINTR
+static bool writeAllAt(int fd, const char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+    return true;
+}
+
+void UploadManager::initialize() {
+    // The directory is reserved, so it is listed directly rather than through listDirectoryEx
+    DirManager::DirIterator it(UPLOAD_DIR);
+    DirManager::DirEntry entry;
+    if (!it.isOpen()) {
+        return;
+    }
+    while (it.next(entry)) {
+        if (entry.type == DirManager::EntryType::File) {
+            Sandbox::removeFile(string(UPLOAD_DIR) + "/" + entry.name);
+        }
+    }
+    MetadataCache::invalidateTree(UPLOAD_DIR);
+    removeUploadDirIfIdle();
+}
+
+string UploadManager::begin(const string& owner, const string& virtual_target, long long expected_size,
+                            Status& status, const string& content_hash) {
+    expireIdle();
+
+    if (virtual_target.empty() || virtual_target == "/" || PathUtils::isReservedPath(virtual_target)) {
+        return "Error: Invalid upload target: " + virtual_target;
+    }
+    if (!PathUtils::isDirectory(PathUtils::getParentPath(virtual_target))) {
+        return "Error: Parent directory does not exist: " + PathUtils::getParentPath(virtual_target);
+    }
+    if (PathUtils::isDirectory(virtual_target)) {
+        return "Error: Target is a directory: " + virtual_target;
+    }
+
+    // Content the store already holds is linked, not transferred
+    if (!content_hash.empty() && expected_size >= 0 && BlobStore::isEnabled() &&
+        BlobStore::contains(content_hash, expected_size)) {
+        bool durable = FileManager::getDefaultDurability() == FileManager::Durability::Durable;
+        string error = BlobStore::linkBlob(content_hash, virtual_target, durable);
+        if (error.empty()) {
+            FileIndex::update(virtual_target);
+            status = Status();
+            status.target = virtual_target;
+            status.received = static_cast<uint64_t>(expected_size);
+            status.expected_size = expected_size;
+            status.last_activity = time(nullptr);
+            status.complete = true;
+            FX_LOG_DEBUG("Upload to " << virtual_target << " satisfied from blob " << content_hash);
+            return "";
+        }
+        // The blob vanished (garbage collected) in between: fall back to a transfer
+        FX_LOG_DEBUG("Blob " << content_hash << " not linked: " << error);
+    }
+
+    auto upload = make_shared<Upload>();
+    upload->owner = owner;
+    upload->status.id = SessionManager::generateToken();
+    upload->status.target = virtual_target;
+    upload->status.expected_size = expected_size < 0 ? -1 : expected_size;
+    upload->status.last_activity = time(nullptr);
+    upload->temp_path = string(UPLOAD_DIR) + "/" + upload->status.id + ".part";
+
+    // The directory is only removed while no upload is registered, so it stays put from here
+    // until this one is
+    {
+        lock_guard<mutex> lock(uploads_mutex);
+        if (Sandbox::makeDirectory(UPLOAD_DIR, 0700)) {
+            MetadataCache::invalidateTree(UPLOAD_DIR);
+        } else if (errno != EEXIST) {
+            return "Error: Cannot create upload directory (" + string(strerror(errno)) + ")";
+        }
+        ScopedFd fd(Sandbox::openPath(upload->temp_path, O_WRONLY | O_CREAT | O_EXCL, 0600));
+        if (!fd.valid()) {
+            return "Error: Cannot create upload file (" + string(strerror(errno)) + ")";
+        }
+        uploads[upload->status.id] = upload;
+    }
+    FX_LOG_DEBUG("Upload " << upload->status.id << " started for " << virtual_target);
+
+    status = upload->status;
+    return "";
+}
+
+string UploadManager::writeChunk(const string& upload_id, const string& owner, uint64_t offset, const char* data,
+                                 size_t length, Status& status) {
+    shared_ptr<Upload> upload = find(upload_id, owner);
+    if (!upload) {
+        return "Error: Unknown upload: " + upload_id;
+    }
+
+    lock_guard<mutex> lock(upload->mutex);
+    if (upload->closed) {
+        return "Error: Unknown upload: " + upload_id;
+    }
+    status = upload->status;
+
+    // Re-sending acknowledged bytes is harmless; a gap would leave a hole in the file
+    if (offset > upload->status.received) {
+        return "Error: Offset " + to_string(offset) + " is past the acknowledged offset " +
+               to_string(upload->status.received);
+    }
+    if (length > MAX_CHUNK_SIZE) {
+        return "Error: Chunk larger than " + to_string(MAX_CHUNK_SIZE) + " bytes";
+    }
+    if (upload->status.expected_size >= 0 &&
+        offset + length > static_cast<uint64_t>(upload->status.expected_size)) {
+        return "Error: Chunk extends past the declared size " + to_string(upload->status.expected_size);
+    }
+
+    ScopedFd fd(Sandbox::openPath(upload->temp_path, O_WRONLY));
+    if (!fd.valid() || !writeAllAt(fd.get(), data, length, offset)) {
+        return "Error: Failed to write upload chunk (" + string(strerror(errno)) + ")";
+    }
+
+    upload->status.received = max<uint64_t>(upload->status.received, offset + length);
+    upload->status.last_activity = time(nullptr);
+    status = upload->status;
+    return "";
+}
+
+bool UploadManager::getStatus(const string& upload_id, const string& owner, Status& status) {
+    shared_ptr<Upload> upload = find(upload_id, owner);
+    if (!upload) {
+        return false;
+    }
+    lock_guard<mutex> lock(upload->mutex);
+    if (upload->closed) {
+        return false;
+    }
+    status = upload->status;
+    return true;
+}
+
+string UploadManager::finalize(const string& upload_id, const string& owner, Status& status) {
+    shared_ptr<Upload> upload = find(upload_id, owner);
+    if (!upload) {
+        return "Error: Unknown upload: " + upload_id;
+    }
+
+    lock_guard<mutex> lock(upload->mutex);
+    if (upload->closed) {
+        return "Error: Unknown upload: " + upload_id;
+    }
+    status = upload->status;
+
+    if (upload->status.expected_size >= 0 &&
+        upload->status.received != static_cast<uint64_t>(upload->status.expected_size)) {
+        return "Error: Upload incomplete: " + to_string(upload->status.received) + " of " +
+               to_string(upload->status.expected_size) + " bytes";
+    }
+
+    // In durable mode the data reaches disk before the rename publishes it
+    const string& target = upload->status.target;
+    bool durable = FileManager::getDefaultDurability() == FileManager::Durability::Durable;
+    if (BlobStore::isEnabled()) {
+        // The store names the temp file by its hash (or drops it for a stored copy) and links the target
+        bool deduplicated = false;
+        string error = BlobStore::adoptFile(upload->temp_path, target, durable, deduplicated);
+        MetadataCache::invalidateTree(upload->temp_path);
+        if (!error.empty()) {
+            discard(upload_id, *upload);
+            removeUploadDirIfIdle();
+            return error;
+        }
+        FX_LOG_DEBUG("Upload " << upload_id << " stored " << (deduplicated ? "as a link to an existing blob" : "as a new blob"));
+        FileIndex::update(target);
+        upload->closed = true;
+        {
+            lock_guard<mutex> registry_lock(uploads_mutex);
+            uploads.erase(upload_id);
+        }
+        removeUploadDirIfIdle();
+        return "";
+    }
+    {
+        ScopedFd fd(Sandbox::openPath(upload->temp_path, O_WRONLY));
+        if (!fd.valid()) {
+            return "Error: Failed to publish upload: " + target + " (" + strerror(errno) + ")";
+        }
+#ifndef _WIN32
+        // The temp file is private; the published one keeps the mode of the file it replaces
+        struct stat existing;
+        bool replaces = Sandbox::statPath(target, existing) && (existing.st_mode & S_IFMT) == S_IFREG;
+        if (fchmod(fd.get(), replaces ? (existing.st_mode & 07777) : 0644) != 0) {
+            return "Error: Failed to publish upload: " + target + " (" + strerror(errno) + ")";
+        }
+#endif
+        if (durable && !GroupCommit::sync(fd.get())) {
+            return "Error: Failed to sync upload: " + target;
+        }
+    }
+
+    // renameat replaces the target in one step: readers never see a partial file
+    if (!Sandbox::renamePath(upload->temp_path, target)) {
+        int error = errno;
+        if (error == ENOENT) {
+            return "Error: Parent directory does not exist: " + PathUtils::getParentPath(target);
+        }
+        if (error == EISDIR) {
+            return "Error: Target is a directory: " + target;
+        }
+        return "Error: Failed to publish upload: " + target + " (" + strerror(error) + ")";
+    }
+    MetadataCache::invalidateTree(target);
+    MetadataCache::invalidateTree(upload->temp_path);
+    FileIndex::update(target);
+#ifndef _WIN32
+    if (durable) {
+        ScopedFd dir(Sandbox::openPath(PathUtils::getParentPath(target), O_RDONLY | O_DIRECTORY));
+        if (!dir.valid() || !GroupCommit::sync(dir.get())) {
+            FX_LOG_WARN("Directory sync failed after publishing upload " << upload_id << " at " << target);
+        }
+    }
+#endif
+
+    upload->closed = true;
+    {
+        lock_guard<mutex> registry_lock(uploads_mutex);
+        uploads.erase(upload_id);
+    }
+    removeUploadDirIfIdle();
+    FX_LOG_DEBUG("Upload " << upload_id << " published " << upload->status.received << " bytes at " << target);
+    return "";
+}
+
+string UploadManager::abort(const string& upload_id, const string& owner) {
+    shared_ptr<Upload> upload = find(upload_id, owner);
+    if (!upload) {
+        return "Error: Unknown upload: " + upload_id;
+    }
+
+    lock_guard<mutex> lock(upload->mutex);
+    if (upload->closed) {
+        return "Error: Unknown upload: " + upload_id;
+    }
+    discard(upload_id, *upload);
+    removeUploadDirIfIdle();
+    return "";
+}
+
+shared_ptr<UploadManager::Upload> UploadManager::find(const string& upload_id, const string& owner) {
+    lock_guard<mutex> lock(uploads_mutex);
+    auto it = uploads.find(upload_id);
+    // owner is fixed at begin(), so it can be compared without the upload's lock
+    return (it != uploads.end() && it->second->owner == owner) ? it->second : nullptr;
+}
+
+void UploadManager::discard(const string& upload_id, Upload& upload) {
+    upload.closed = true;
+    Sandbox::removeFile(upload.temp_path);
+    MetadataCache::invalidateTree(upload.temp_path);
+    lock_guard<mutex> lock(uploads_mutex);
+    uploads.erase(upload_id);
+}
+
+void UploadManager::removeUploadDirIfIdle() {
+    // Fails harmlessly while expired or stray files are still inside
+    lock_guard<mutex> lock(uploads_mutex);
+    if (uploads.empty() && Sandbox::removeDirectory(UPLOAD_DIR)) {
+        MetadataCache::invalidateTree(UPLOAD_DIR);
+    }
+}
+
+void UploadManager::expireIdle() {
+    vector<pair<string, shared_ptr<Upload>>> idle;
+    time_t now = time(nullptr);
+    {
+        lock_guard<mutex> lock(uploads_mutex);
+        for (const auto& entry : uploads) {
+            // Reading last_activity unlocked is only a hint; it is re-checked below
+            idle.push_back(entry);
+        }
+    }
+    for (auto& entry : idle) {
+        lock_guard<mutex> lock(entry.second->mutex);
+        if (!entry.second->closed && now - entry.second->status.last_activity > IDLE_TIMEOUT) {
+            FX_LOG_INFO("Upload " << entry.first << " expired after " << IDLE_TIMEOUT << "s idle");
+            discard(entry.first, *entry.second);
+        }
+    }
+}
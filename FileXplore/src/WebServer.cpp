@@ -4,16 +4,228 @@
 #include "../include/FileManager.h"
 #include "../include/DirManager.h"
 #include "../include/HistoryManager.h"
+#include "../include/Session.h"
+#include "../include/MetadataCache.h"
 #include "../include/SystemInfo.h"
 #include "../include/CompressionManager.h"
+#include "../include/ZipArchive.h"
+#include "../include/Logger.h"
+#include "../include/Sandbox.h"
+#include "../include/UploadManager.h"
+#include "../include/IoEngine.h"
+#include "../include/BlobStore.h"
+#include "../include/SearchManager.h"
+#include "../include/FileIndex.h"
+#include "../include/ChecksumManager.h"
+#include "../include/AppendWriter.h"
 #include <sstream>
 #include <fstream>
+#include <iomanip>
+#include <ctime>
+#include <cstdlib>
+#include <algorithm>
 #include <filesystem>
+#include <memory>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
+// Format a Unix timestamp as ISO 8601 UTC
+static std::string formatTimestamp(std::time_t time) {
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &time);
+#else
+    gmtime_r(&time, &utc);
+#endif
+    std::stringstream ss;
+    ss << std::put_time(&utc, "%Y-%m-%dT%H:%M:%SZ");
+    return ss.str();
+}
+
+// Upper bound on entries per paged listing response (bounds memory per request)
+static const size_t MAX_PAGE_LIMIT = 5000;
+
+// File previews read this much when no length is given, and never more than the maximum
+static const size_t DEFAULT_PREVIEW_LENGTH = 64 * 1024;
+static const size_t MAX_PREVIEW_LENGTH = 16 * 1024 * 1024;
+
+// Bodies larger than this are written in 16 KiB chunks instead of one copy
+static const size_t RESPONSE_STREAM_THRESHOLD = 64 * 1024;
+
+// Format a Unix timestamp as an HTTP date (Last-Modified)
+static std::string formatHttpDate(std::time_t time) {
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &time);
+#else
+    gmtime_r(&time, &utc);
+#endif
+    // Fixed English names: strftime's %a/%b follow the locale
+    static const char* days[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+    static const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                   "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+                  days[utc.tm_wday], utc.tm_mday, months[utc.tm_mon], utc.tm_year + 1900,
+                  utc.tm_hour, utc.tm_min, utc.tm_sec);
+    return buffer;
+}
+
+// Strong validator from inode, size and nanosecond mtime
+static std::string makeETag(const struct stat& info) {
+    std::ostringstream tag;
+    tag << '"' << std::hex << static_cast<unsigned long long>(info.st_ino) << '-'
+        << static_cast<unsigned long long>(info.st_size) << '-'
+#if defined(__linux__)
+        << static_cast<unsigned long long>(info.st_mtim.tv_sec) << '.'
+        << static_cast<unsigned long long>(info.st_mtim.tv_nsec)
+#else
+        << static_cast<unsigned long long>(info.st_mtime)
+#endif
+        << '"';
+    return tag.str();
+}
+
+// Parse a single "bytes=first-last" range; false means serve the whole file
+// (no header, several ranges, or bad syntax). unsatisfiable is set for ranges past the end.
+static bool parseByteRange(const std::string& header, uint64_t size, uint64_t& first, uint64_t& last,
+                           bool& unsatisfiable) {
+    unsatisfiable = false;
+    const std::string prefix = "bytes=";
+    if (header.compare(0, prefix.size(), prefix) != 0 || header.find(',') != std::string::npos) {
+        return false;
+    }
+    std::string spec = header.substr(prefix.size());
+    size_t dash = spec.find('-');
+    if (dash == std::string::npos) {
+        return false;
+    }
+    std::string first_text = spec.substr(0, dash);
+    std::string last_text = spec.substr(dash + 1);
+    auto isNumber = [](const std::string& text) {
+        return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+    };
+
+    if (first_text.empty()) {
+        // Suffix range: the last N bytes
+        if (!isNumber(last_text)) {
+            return false;
+        }
+        uint64_t suffix = std::strtoull(last_text.c_str(), nullptr, 10);
+        if (suffix == 0 || size == 0) {
+            unsatisfiable = true;
+            return true;
+        }
+        first = size - std::min(suffix, size);
+        last = size - 1;
+        return true;
+    }
+
+    if (!isNumber(first_text) || (!last_text.empty() && !isNumber(last_text))) {
+        return false;
+    }
+    first = std::strtoull(first_text.c_str(), nullptr, 10);
+    last = last_text.empty() ? size - 1 : std::strtoull(last_text.c_str(), nullptr, 10);
+    if (first >= size) {
+        unsatisfiable = true;
+        return true;
+    }
+    if (last < first) {
+        return false;
+    }
+    last = std::min(last, size - 1);
+    return true;
+}
+
+// Offset of an upload chunk: "?offset=N", else the first byte of "Content-Range: bytes N-M/T"
+static bool parseUploadOffset(const crow::request& req, uint64_t& offset) {
+    auto isNumber = [](const std::string& text) {
+        return !text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return c >= '0' && c <= '9'; });
+    };
+    const char* offset_param = req.url_params.get("offset");
+    if (offset_param != nullptr) {
+        if (!isNumber(offset_param)) {
+            return false;
+        }
+        offset = std::strtoull(offset_param, nullptr, 10);
+        return true;
+    }
+
+    std::string range = req.get_header_value("Content-Range");
+    const std::string prefix = "bytes ";
+    if (range.empty()) {
+        offset = 0;
+        return true;
+    }
+    if (range.compare(0, prefix.size(), prefix) != 0) {
+        return false;
+    }
+    std::string first_text = range.substr(prefix.size(), range.find('-') - prefix.size());
+    if (!isNumber(first_text)) {
+        return false;
+    }
+    offset = std::strtoull(first_text.c_str(), nullptr, 10);
+    return true;
+}
+
+static json uploadStatusToJSON(const UploadManager::Status& status) {
+    json upload_obj;
+    upload_obj["uploadId"] = status.id;
+    upload_obj["path"] = status.target;
+    upload_obj["offset"] = status.received;
+    upload_obj["size"] = status.expected_size;
+    upload_obj["chunkSize"] = UploadManager::MAX_CHUNK_SIZE;
+    upload_obj["complete"] = status.complete;
+    return upload_obj;
+}
+
+// Matches from index from onward plus the job's progress, for /api/search
+static json searchResultsToJSON(const std::string& search_id, size_t from, const std::vector<SearchManager::Match>& matches,
+                                const SearchManager::Summary& summary, bool done) {
+    json matches_array = json::array();
+    for (const auto& match : matches) {
+        json match_obj;
+        match_obj["path"] = match.path;
+        match_obj["line"] = match.line_number;
+        match_obj["text"] = match.line;
+        matches_array.push_back(match_obj);
+    }
+
+    json search_obj;
+    search_obj["searchId"] = search_id;
+    search_obj["from"] = from;
+    search_obj["next"] = from + matches.size();
+    search_obj["matches"] = matches_array;
+    search_obj["done"] = done;
+    search_obj["filesScanned"] = summary.files_scanned;
+    search_obj["filesMatched"] = summary.files_matched;
+    search_obj["binarySkipped"] = summary.binary_skipped;
+    search_obj["longLinesSkipped"] = summary.long_lines_skipped;
+    search_obj["bytesScanned"] = summary.bytes_scanned;
+    search_obj["truncated"] = summary.truncated;
+    return search_obj;
+}
+
+static json fileInfoToJSON(const WebServer::FileInfo& file) {
+    json file_obj;
+    file_obj["name"] = file.name;
+    file_obj["type"] = file.type;
+    file_obj["size"] = file.size;
+    file_obj["modified"] = file.modified;
+    file_obj["permissions"] = file.permissions;
+    return file_obj;
+}
+
 // URL decode function
 std::string urlDecode(const std::string& str) {
     std::string result;
@@ -39,8 +251,45 @@ std::string urlDecode(const std::string& str) {
     return result;
 }
 
+// Name of the cookie carrying the session token
+static const char* SESSION_COOKIE = "fx_session";
+
+// Extract a cookie value from a Cookie header ("a=1; b=2")
+static std::string findCookie(const std::string& header, const std::string& name) {
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t end = header.find(';', pos);
+        if (end == std::string::npos) {
+            end = header.size();
+        }
+        size_t start = header.find_first_not_of(' ', pos);
+        size_t eq = header.find('=', start);
+        if (start < end && eq < end && header.compare(start, eq - start, name) == 0) {
+            return header.substr(eq + 1, end - eq - 1);
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+void SessionMiddleware::before_handle(crow::request& req, [[maybe_unused]] crow::response& res, context& ctx) {
+    std::string token = req.get_header_value("X-Session-Token");
+    if (token.empty()) {
+        token = findCookie(req.get_header_value("Cookie"), SESSION_COOKIE);
+    }
+    ctx.session = SessionManager::acquire(token, ctx.created);
+}
+
+void SessionMiddleware::after_handle([[maybe_unused]] crow::request& req, crow::response& res, context& ctx) {
+    if (ctx.session && ctx.created) {
+        res.add_header("Set-Cookie", std::string(SESSION_COOKIE) + "=" + ctx.session->getId() +
+                                     "; Path=/; HttpOnly; SameSite=Strict");
+        res.add_header("X-Session-Token", ctx.session->getId());
+    }
+}
+
 WebServer::WebServer(int port) : port_(port), running_(false) {
-    app_ = std::make_unique<crow::SimpleApp>();
+    app_ = std::make_unique<crow::App<SessionMiddleware>>();
 }
 
 WebServer::~WebServer() {
@@ -54,10 +303,11 @@ bool WebServer::start() {
 
     try {
         setupRoutes();
+        UploadManager::initialize();
 
         // Start server in a separate thread
         server_thread_ = std::make_unique<std::thread>([this]() {
-            app_->port(port_).multithreaded().run();
+            app_->port(port_).stream_threshold(RESPONSE_STREAM_THRESHOLD).multithreaded().run();
         });
 
         running_ = true;
@@ -99,14 +349,56 @@ void WebServer::setupRoutes() {
         return handleFileSystem(req);
     });
 
-    CROW_ROUTE((*app_), "/api/file/<string>").methods("GET"_method)([this](const crow::request& req, const std::string& path) {
-        return handleFileContent(req, path);
+    CROW_ROUTE((*app_), "/api/file/<string>").methods("GET"_method)([this](const crow::request& req, crow::response& res, const std::string& path) {
+        // offset/length request a preview, read on the I/O engine without holding this worker
+        if (req.url_params.get("offset") || req.url_params.get("length")) {
+            handleFileRange(req, res, path);
+            return;
+        }
+        res = handleFileContent(req, path);
+        res.end();
     });
 
     CROW_ROUTE((*app_), "/api/file/<string>").methods("POST"_method)([this](const crow::request& req, const std::string& path) {
         return handleFileUpload(req, path);
     });
 
+    CROW_ROUTE((*app_), "/api/append/<string>").methods("POST"_method)([this](const crow::request& req, const std::string& path) {
+        return handleAppend(req, path);
+    });
+
+    CROW_ROUTE((*app_), "/api/upload").methods("POST"_method)([this](const crow::request& req) {
+        return handleUploadBegin(req);
+    });
+
+    CROW_ROUTE((*app_), "/api/upload/<string>").methods("GET"_method, "PUT"_method, "DELETE"_method)([this](const crow::request& req, const std::string& upload_id) {
+        return handleUpload(req, upload_id);
+    });
+
+    CROW_ROUTE((*app_), "/api/upload/<string>/finalize").methods("POST"_method)([this](const crow::request& req, const std::string& upload_id) {
+        return handleUploadFinalize(req, upload_id);
+    });
+
+    CROW_ROUTE((*app_), "/api/search").methods("GET"_method)([this](const crow::request& req) {
+        return handleSearch(req);
+    });
+
+    CROW_ROUTE((*app_), "/api/search/<string>").methods("GET"_method, "DELETE"_method)([this](const crow::request& req, const std::string& search_id) {
+        return handleSearchResults(req, search_id);
+    });
+
+    CROW_ROUTE((*app_), "/api/locate").methods("GET"_method)([this](const crow::request& req) {
+        return handleLocate(req);
+    });
+
+    CROW_ROUTE((*app_), "/api/checksum").methods("GET"_method)([this](const crow::request& req) {
+        return handleChecksum(req);
+    });
+
+    CROW_ROUTE((*app_), "/api/download/<string>").methods("GET"_method)([this](const crow::request& req, const std::string& path) {
+        return handleDownload(req, path);
+    });
+
     CROW_ROUTE((*app_), "/api/history").methods("GET"_method)([this](const crow::request& req) {
         return handleHistory(req);
     });
@@ -115,6 +407,10 @@ void WebServer::setupRoutes() {
         return handleSystemInfo(req);
     });
 
+    CROW_ROUTE((*app_), "/api/loglevel").methods("GET"_method, "POST"_method)([this](const crow::request& req) {
+        return handleLogLevel(req);
+    });
+
     CROW_ROUTE((*app_), "/api/compress").methods("POST"_method)([this](const crow::request& req) {
         return handleCompress(req);
     });
@@ -123,12 +419,20 @@ void WebServer::setupRoutes() {
         return handleDecompress(req);
     });
 
+    CROW_ROUTE((*app_), "/api/zip").methods("GET"_method)([this](const crow::request& req) {
+        return handleZipList(req);
+    });
+
+    CROW_ROUTE((*app_), "/api/zip/entry").methods("GET"_method)([this](const crow::request& req) {
+        return handleZipEntry(req);
+    });
+
     // Static file serving
-    CROW_ROUTE((*app_), "/").methods("GET"_method)([this](const crow::request& req) {
+    CROW_ROUTE((*app_), "/").methods("GET"_method)([this]() {
         return handleStaticFile("index.html");
     });
 
-    CROW_ROUTE((*app_), "/<string>").methods("GET"_method)([this](const crow::request& req, const std::string& filename) {
+    CROW_ROUTE((*app_), "/<string>").methods("GET"_method)([this](const std::string& filename) {
         return handleStaticFile(filename);
     });
 }
@@ -141,7 +445,7 @@ crow::response WebServer::handleCommand(const crow::request& req) {
         std::vector<std::string> args = request_data["args"];
 
         // Execute command using existing CommandParser
-        ApiResponse response = executeCommandAPI(command, args);
+        ApiResponse response = executeCommandAPI(getSession(req), command, args);
 
         // Create JSON response
         json response_json;
@@ -173,7 +477,12 @@ crow::response WebServer::handleFileSystem(const crow::request& req) {
             path = "/";
         }
         
-        FileSystemData fs_data = getFileSystemData(path);
+        // limit/cursor/format switch to the paged, directory-order listing
+        if (req.url_params.get("limit") || req.url_params.get("cursor") || req.url_params.get("format")) {
+            return handleFileSystemPage(req, path);
+        }
+        
+        FileSystemData fs_data = getFileSystemData(getSession(req), path);
 
         json response_json;
         response_json["success"] = true;
@@ -201,7 +510,7 @@ crow::response WebServer::handleFileSystem(const crow::request& req) {
 crow::response WebServer::handleFileContent(const crow::request& req, const std::string& path) {
     try {
         // Decode URL-encoded path (Crow doesn't automatically decode route parameters)
-        std::string decoded_path = urlDecode(path);
+        std::string decoded_path = getSession(req).resolvePath(urlDecode(path));
         
         // Check if file exists first
         bool exists = FileManager::fileExists(decoded_path);
@@ -217,11 +526,12 @@ crow::response WebServer::handleFileContent(const crow::request& req, const std:
             return res;
         }
 
-        // Read file content
-        std::string content = FileManager::readFile(decoded_path);
+        // Whole file: copied once from the mapping into the JSON string
+        FileManager::MappedFile file = FileManager::mapFile(decoded_path);
+        std::string content = file.isOpen() ? std::string(file.view()) : file.getError();
 
-        // Check if readFile returned an error message (starts with "Error:")
-        if (content.find("Error:") == 0) {
+        // Check if the read failed (message starts with "Error:")
+        if (!file.isOpen()) {
             json error_json;
             error_json["success"] = false;
             error_json["message"] = content;  // Use the error message from FileManager
@@ -256,12 +566,148 @@ crow::response WebServer::handleFileContent(const crow::request& req, const std:
     }
 }
 
+void WebServer::handleFileRange(const crow::request& req, crow::response& res, const std::string& path) {
+    std::string virtual_path = getSession(req).resolvePath(urlDecode(path));
+    const char* offset_param = req.url_params.get("offset");
+    const char* length_param = req.url_params.get("length");
+    long long offset = offset_param ? std::strtoll(offset_param, nullptr, 10) : 0;
+    size_t length = length_param ? static_cast<size_t>(std::strtoull(length_param, nullptr, 10))
+                                 : DEFAULT_PREVIEW_LENGTH;
+    length = std::min(length, MAX_PREVIEW_LENGTH);
+
+    // Only the requested range is read; the response is finished back on this connection's thread
+    FileManager::readRangeAsync(virtual_path, offset, length, [this, &res, offset](FileManager::ReadResult& read) {
+        auto result = std::make_shared<FileManager::ReadResult>(std::move(read));
+        res.dispatch([this, &res, offset, result]() {
+            if (!result->error.empty()) {
+                json error_json;
+                error_json["success"] = false;
+                error_json["message"] = result->error;
+                error_json["data"] = "";
+
+                bool missing = result->error.find("Error: File does not exist") == 0;
+                res = crow::response(missing ? 404 : 400, error_json.dump());
+                addCorsHeaders(res);
+                res.end();
+                return;
+            }
+
+            json response_json;
+            response_json["success"] = true;
+            response_json["message"] = "File range retrieved";
+            response_json["data"] = result->data;
+            response_json["offset"] = offset;
+            response_json["fileSize"] = result->file_size;
+            // truncated: the range is not the whole file, so it must not be saved back as-is
+            response_json["truncated"] =
+                offset > 0 || offset + static_cast<long long>(result->data.size()) < result->file_size;
+
+            // A range can end inside a UTF-8 sequence; replace it instead of failing the dump
+            res = crow::response(response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+            res.add_header("Content-Type", "application/json");
+            addCorsHeaders(res);
+            res.end();
+        });
+    });
+}
+
+crow::response WebServer::handleDownload(const crow::request& req, const std::string& path) {
+    std::string virtual_path = getSession(req).resolvePath(urlDecode(path));
+
+    auto errorResponse = [this](int code, const std::string& message) {
+        json error_json;
+        error_json["success"] = false;
+        error_json["message"] = message;
+        error_json["data"] = "";
+
+        crow::response res(code, error_json.dump());
+        addCorsHeaders(res);
+        return res;
+    };
+
+    // Opened beneath the sandbox root; the transfer reads this descriptor, never the path again
+    int raw_fd = PathUtils::isReservedPath(virtual_path) ? -1 : Sandbox::openPath(virtual_path, O_RDONLY);
+    if (raw_fd < 0) {
+        return errorResponse(404, "File not found: " + virtual_path);
+    }
+    std::shared_ptr<int> fd(new int(raw_fd), [](int* descriptor) {
+        ::close(*descriptor);
+        delete descriptor;
+    });
+
+    struct stat info;
+    if (fstat(*fd, &info) != 0 || (info.st_mode & S_IFMT) != S_IFREG) {
+        return errorResponse(404, "Not a file: " + virtual_path);
+    }
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    std::string etag = makeETag(info);
+    std::string last_modified = formatHttpDate(info.st_mtime);
+
+    crow::response res;
+    res.add_header("ETag", etag);
+    res.add_header("Last-Modified", last_modified);
+    res.add_header("Accept-Ranges", "bytes");
+    addCorsHeaders(res);
+
+    std::string if_none_match = req.get_header_value("If-None-Match");
+    if (!if_none_match.empty() && (if_none_match == "*" || if_none_match.find(etag) != std::string::npos)) {
+        res.code = 304;
+        return res;
+    }
+
+    std::string name = PathUtils::getFilename(virtual_path);
+    std::replace(name.begin(), name.end(), '"', '_');
+    std::replace(name.begin(), name.end(), '\\', '_');
+    res.add_header("Content-Type", "application/octet-stream");
+    res.add_header("Content-Disposition", "attachment; filename=\"" + name + "\"");
+
+    // If-Range: resume only if the file is still the one the client started with
+    std::string range = req.get_header_value("Range");
+    std::string if_range = req.get_header_value("If-Range");
+    if (!if_range.empty() && if_range != etag && if_range != last_modified) {
+        range.clear();
+    }
+
+    uint64_t first = 0;
+    uint64_t last = size == 0 ? 0 : size - 1;
+    bool unsatisfiable = false;
+    if (!range.empty() && parseByteRange(range, size, first, last, unsatisfiable)) {
+        if (unsatisfiable) {
+            res.code = 416;
+            res.add_header("Content-Range", "bytes */" + std::to_string(size));
+            return res;
+        }
+        res.code = 206;
+        res.add_header("Content-Range", "bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                                        "/" + std::to_string(size));
+        res.set_static_file_descriptor(fd, first, last - first + 1);
+        return res;
+    }
+
+    // Streamed from the descriptor (sendfile on Linux): memory use does not grow with the file
+    res.code = 200;
+    res.set_static_file_descriptor(fd, 0, size);
+    return res;
+}
+
 crow::response WebServer::handleFileUpload(const crow::request& req, const std::string& path) {
     try {
         // Decode URL-encoded path
-        std::string decoded_path = urlDecode(path);
-        std::string content = req.body;
-        std::string result = FileManager::writeFile(decoded_path, content);
+        std::string decoded_path = getSession(req).resolvePath(urlDecode(path));
+        // Small single-request writes; large files go through /api/upload in chunks
+        FileManager::Durability durability = FileManager::getDefaultDurability();
+        const char* durability_param = req.url_params.get("durability");
+        if (durability_param != nullptr && !FileManager::parseDurability(durability_param, durability)) {
+            json error_json;
+            error_json["success"] = false;
+            error_json["message"] = "Unknown durability (expected none, atomic or durable)";
+            error_json["data"] = "";
+
+            crow::response res(400, error_json.dump());
+            addCorsHeaders(res);
+            return res;
+        }
+        std::string result = FileManager::writeFile(decoded_path, req.body, durability);
 
         if (result.find("Error:") == 0) {
             json error_json;
@@ -295,9 +741,322 @@ crow::response WebServer::handleFileUpload(const crow::request& req, const std::
     }
 }
 
+crow::response WebServer::handleAppend(const crow::request& req, const std::string& path) {
+    // The raw body is appended as is; concurrent appends to one file share a writev
+    std::string result = FileManager::appendFile(getSession(req).resolvePath(urlDecode(path)), req.body);
+
+    json response_json;
+    if (result.find("Error:") == 0) {
+        response_json["success"] = false;
+        response_json["message"] = result;
+        response_json["data"] = "";
+
+        crow::response res(400, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    response_json["success"] = true;
+    response_json["message"] = result;
+    response_json["data"] = {{"bytes", req.body.size()}};
+
+    crow::response res(response_json.dump());
+    addCorsHeaders(res);
+    return res;
+}
+
+crow::response WebServer::handleSearch(const crow::request& req) {
+    // GET ?q=pattern&path=dir&recursive=1&ignoreCase=1&max=N starts a job; its first matches come back at once
+    auto flag = [&req](const char* name) {
+        const char* value = req.url_params.get(name);
+        return value != nullptr && (std::string(value) == "1" || std::string(value) == "true");
+    };
+
+    SearchManager::Options options;
+    options.pattern = req.url_params.get("q") ? std::string(req.url_params.get("q")) : "";
+    options.recursive = flag("recursive");
+    options.ignore_case = flag("ignoreCase");
+    if (const char* max_param = req.url_params.get("max")) {
+        options.max_matches = static_cast<size_t>(std::strtoull(max_param, nullptr, 10));
+    }
+    std::string path = req.url_params.get("path") ? std::string(req.url_params.get("path")) : ".";
+
+    if (options.pattern.empty()) {
+        json error_json;
+        error_json["success"] = false;
+        error_json["message"] = "Error: Missing search pattern (q)";
+        error_json["data"] = "";
+
+        crow::response res(400, error_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    std::string search_id = SearchManager::startJob(getSession(req).resolvePath(path), options);
+    return handleSearchResults(req, search_id);
+}
+
+crow::response WebServer::handleSearchResults(const crow::request& req, const std::string& search_id) {
+    json response_json;
+
+    if (req.method == crow::HTTPMethod::Delete) {
+        bool cancelled = SearchManager::cancelJob(search_id);
+        response_json["success"] = cancelled;
+        response_json["message"] = cancelled ? "Search cancelled: " + search_id : "Error: Unknown search: " + search_id;
+        response_json["data"] = "";
+
+        crow::response res(cancelled ? 200 : 404, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    // ?from=N: matches already collected by the client are not sent again
+    size_t from = 0;
+    if (const char* from_param = req.url_params.get("from")) {
+        from = static_cast<size_t>(std::strtoull(from_param, nullptr, 10));
+    }
+
+    std::vector<SearchManager::Match> matches;
+    SearchManager::Summary summary;
+    bool done = false;
+    if (!SearchManager::getJobResults(search_id, from, matches, summary, done)) {
+        response_json["success"] = false;
+        response_json["message"] = "Error: Unknown search: " + search_id;
+        response_json["data"] = "";
+
+        crow::response res(404, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    bool failed = !summary.error.empty();
+    response_json["success"] = !failed;
+    response_json["message"] = failed ? summary.error : (done ? "Search complete" : "Search running");
+    response_json["data"] = searchResultsToJSON(search_id, from, matches, summary, done);
+
+    // Lines come from arbitrary files, so invalid UTF-8 is replaced rather than failing the dump
+    crow::response res(failed ? 400 : 200, response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+    addCorsHeaders(res);
+    return res;
+}
+
+crow::response WebServer::handleLocate(const crow::request& req) {
+    // GET ?q=text&limit=N: files and directories whose name contains text, best matches first
+    std::string query = req.url_params.get("q") ? std::string(req.url_params.get("q")) : "";
+    size_t limit = 50;
+    if (const char* limit_param = req.url_params.get("limit")) {
+        limit = static_cast<size_t>(std::strtoull(limit_param, nullptr, 10));
+        limit = std::max<size_t>(1, std::min(limit, MAX_PAGE_LIMIT));
+    }
+
+    json response_json;
+    FileIndex::Stats stats = FileIndex::getStats();
+    if (query.empty() || !stats.ready) {
+        response_json["success"] = false;
+        response_json["message"] = query.empty() ? "Error: Missing search text (q)" : "Error: File index is still being built";
+        response_json["data"] = "";
+
+        crow::response res(query.empty() ? 400 : 503, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    std::vector<FileIndex::Result> results;
+    size_t total = FileIndex::locate(query, limit, results);
+    json results_array = json::array();
+    for (const auto& result : results) {
+        results_array.push_back({{"path", result.path}, {"type", result.is_directory ? "directory" : "file"}});
+    }
+
+    response_json["success"] = true;
+    response_json["message"] = std::to_string(total) + " matches";
+    response_json["data"] = {
+        {"results", results_array},
+        {"total", total},
+        {"indexed", stats.entries},
+        {"building", stats.building}
+    };
+
+    crow::response res(response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+    addCorsHeaders(res);
+    return res;
+}
+
+crow::response WebServer::handleChecksum(const crow::request& req) {
+    // GET ?path=p&algo=sha256&recursive=1&max=N: digests computed (or cached) on the server
+    ChecksumManager::Options options;
+    options.recursive = req.url_params.get("recursive") != nullptr &&
+                        (std::string(req.url_params.get("recursive")) == "1" ||
+                         std::string(req.url_params.get("recursive")) == "true");
+    options.max_files = MAX_PAGE_LIMIT;
+    if (const char* max_param = req.url_params.get("max")) {
+        options.max_files = std::max<size_t>(1, std::min(static_cast<size_t>(std::strtoull(max_param, nullptr, 10)),
+                                                         MAX_PAGE_LIMIT));
+    }
+    const char* algo = req.url_params.get("algo");
+    std::string path = req.url_params.get("path") ? std::string(req.url_params.get("path")) : ".";
+
+    json response_json;
+    if (algo != nullptr && !ChecksumManager::parseAlgorithm(algo, options.algorithm)) {
+        response_json["success"] = false;
+        response_json["message"] = "Error: Unknown algorithm (crc32, crc32c, xxh64 or sha256): " + std::string(algo);
+        response_json["data"] = "";
+
+        crow::response res(400, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    std::vector<ChecksumManager::Result> results;
+    ChecksumManager::Summary summary = ChecksumManager::checksum(getSession(req).resolvePath(path), options,
+        [&results](const ChecksumManager::Result& result) {
+            results.push_back(result);
+            return true;
+        });
+    if (!summary.error.empty()) {
+        response_json["success"] = false;
+        response_json["message"] = summary.error;
+        response_json["data"] = "";
+
+        crow::response res(404, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    std::sort(results.begin(), results.end(), [](const ChecksumManager::Result& a, const ChecksumManager::Result& b) {
+        return a.path < b.path;
+    });
+    json files = json::array();
+    for (const auto& result : results) {
+        files.push_back({{"path", result.path}, {"digest", result.digest}, {"size", result.size},
+                         {"cached", result.cached}});
+    }
+
+    response_json["success"] = true;
+    response_json["message"] = std::to_string(summary.files) + " files";
+    response_json["data"] = {
+        {"algorithm", ChecksumManager::algorithmName(options.algorithm)},
+        {"files", files},
+        {"cacheHits", summary.cache_hits},
+        {"bytesHashed", summary.bytes_hashed},
+        {"errors", summary.errors},
+        {"truncated", summary.truncated}
+    };
+
+    crow::response res(response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+    addCorsHeaders(res);
+    return res;
+}
+
+crow::response WebServer::handleUploadBegin(const crow::request& req) {
+    try {
+        // POST {"path": "...", "size": N}; size is optional but lets finalize verify completeness
+        json request_data = json::parse(req.body);
+        Session& session = getSession(req);
+        std::string target = session.resolvePath(request_data.value("path", ""));
+        long long expected_size = request_data.value("size", -1LL);
+        // sha256 (optional): content the blob store already holds is linked without a transfer
+        std::string content_hash = request_data.value("sha256", "");
+
+        UploadManager::Status status;
+        std::string result = UploadManager::begin(session.getId(), target, expected_size, status, content_hash);
+        if (!result.empty()) {
+            json error_json;
+            error_json["success"] = false;
+            error_json["message"] = result;
+            error_json["data"] = "";
+
+            crow::response res(400, error_json.dump());
+            addCorsHeaders(res);
+            return res;
+        }
+
+        json response_json;
+        response_json["success"] = true;
+        response_json["message"] = (status.complete ? "Upload linked from stored content: " : "Upload started: ") +
+                                   status.target;
+        response_json["data"] = uploadStatusToJSON(status);
+
+        crow::response res(status.complete ? 200 : 201, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+
+    } catch (const std::exception& e) {
+        json error_json;
+        error_json["success"] = false;
+        error_json["message"] = "Invalid request format: " + std::string(e.what());
+        error_json["data"] = "";
+
+        crow::response res(400, error_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+}
+
+crow::response WebServer::handleUpload(const crow::request& req, const std::string& upload_id) {
+    // Uploads answer only to the session that began them
+    const std::string& owner = getSession(req).getId();
+    UploadManager::Status status;
+    std::string result;
+    int error_code = 400;
+
+    if (req.method == crow::HTTPMethod::Delete) {
+        result = UploadManager::abort(upload_id, owner);
+        error_code = 404;
+    } else if (req.method == crow::HTTPMethod::Get) {
+        if (!UploadManager::getStatus(upload_id, owner, status)) {
+            result = "Error: Unknown upload: " + upload_id;
+            error_code = 404;
+        }
+    } else {
+        // PUT: the body is one chunk, written straight from the request buffer
+        uint64_t offset = 0;
+        if (!parseUploadOffset(req, offset)) {
+            result = "Error: Invalid chunk offset";
+        } else {
+            result = UploadManager::writeChunk(upload_id, owner, offset, req.body.data(), req.body.size(), status);
+            if (!result.empty()) {
+                if (!UploadManager::getStatus(upload_id, owner, status)) {
+                    error_code = 404;
+                } else if (req.body.size() > UploadManager::MAX_CHUNK_SIZE) {
+                    error_code = 413;
+                } else if (offset > status.received) {
+                    // The client resumes from data.offset
+                    error_code = 409;
+                }
+            }
+        }
+    }
+
+    json response_json;
+    response_json["success"] = result.empty();
+    response_json["message"] = result.empty() ? "Upload " + upload_id : result;
+    response_json["data"] = status.id.empty() ? json("") : uploadStatusToJSON(status);
+
+    crow::response res(result.empty() ? 200 : error_code, response_json.dump());
+    addCorsHeaders(res);
+    return res;
+}
+
+crow::response WebServer::handleUploadFinalize(const crow::request& req, const std::string& upload_id) {
+    const std::string& owner = getSession(req).getId();
+    UploadManager::Status status;
+    std::string result = UploadManager::finalize(upload_id, owner, status);
+    int error_code = UploadManager::getStatus(upload_id, owner, status) ? 409 : 404;
+
+    json response_json;
+    response_json["success"] = result.empty();
+    response_json["message"] = result.empty() ? "File uploaded: " + status.target : result;
+    response_json["data"] = status.id.empty() ? json("") : uploadStatusToJSON(status);
+
+    crow::response res(result.empty() ? 200 : error_code, response_json.dump());
+    addCorsHeaders(res);
+    return res;
+}
+
 crow::response WebServer::handleHistory(const crow::request& req) {
     try {
-        std::vector<std::string> history = HistoryManager::getHistory();
+        std::vector<std::string> history = getSession(req).getHistory().getHistory();
 
         json response_json;
         response_json["success"] = true;
@@ -326,16 +1085,10 @@ crow::response WebServer::handleSystemInfo(const crow::request& req) {
         std::string vfs_root = PathUtils::getVFSRoot();
         fs::space_info space = fs::space(vfs_root);
 
-        // Get file count
-        size_t file_count = 0;
-        size_t dir_count = 0;
-        for (const auto& entry : fs::recursive_directory_iterator(vfs_root)) {
-            if (entry.is_regular_file()) {
-                file_count++;
-            } else if (entry.is_directory()) {
-                dir_count++;
-            }
-        }
+        // Get file count (parallel walk, same numbers as df)
+        SystemInfo::DiskUsage usage = SystemInfo::getDiskUsage();
+        size_t file_count = usage.total_files;
+        size_t dir_count = usage.total_directories;
 
         json system_data;
         system_data["disk_usage"] = {
@@ -346,8 +1099,37 @@ crow::response WebServer::handleSystemInfo(const crow::request& req) {
         };
         system_data["file_count"] = file_count;
         system_data["directory_count"] = dir_count;
-        system_data["current_path"] = PathUtils::getCurrentVirtualPath();
+        system_data["current_path"] = getSession(req).getCurrentPath();
         system_data["vfs_root"] = vfs_root;
+        system_data["io_engine"] = IoEngine::backendName(IoEngine::getBackend());
+        system_data["dedup"] = BlobStore::isEnabled();
+
+        MetadataCache::Stats cache = MetadataCache::getStats();
+        system_data["cache"] = {
+            {"enabled", cache.enabled},
+            {"hits", cache.hits},
+            {"misses", cache.misses},
+            {"entries", cache.entries},
+            {"watches", cache.watches}
+        };
+
+        AppendWriter::Stats appends = AppendWriter::getStats();
+        system_data["append"] = {
+            {"appends", appends.appends},
+            {"batches", appends.batches},
+            {"bytes", appends.bytes},
+            {"opens", appends.opens},
+            {"openFiles", appends.open_files}
+        };
+
+        FileIndex::Stats file_index = FileIndex::getStats();
+        system_data["index"] = {
+            {"ready", file_index.ready},
+            {"building", file_index.building},
+            {"entries", file_index.entries},
+            {"memoryBytes", file_index.memory_bytes},
+            {"lastBuildMs", file_index.last_build_ms}
+        };
 
         json response_json;
         response_json["success"] = true;
@@ -370,11 +1152,61 @@ crow::response WebServer::handleSystemInfo(const crow::request& req) {
     }
 }
 
+crow::response WebServer::handleLogLevel(const crow::request& req) {
+    try {
+        // POST {"level": "debug"} changes the process-wide level; GET only reports it
+        if (req.method == crow::HTTPMethod::Post) {
+            json request_data = json::parse(req.body);
+            LogLevel level;
+            if (!Logger::parseLevel(request_data.value("level", ""), level)) {
+                json error_json;
+                error_json["success"] = false;
+                error_json["message"] = "Unknown log level (expected trace, debug, info, warn, error or off)";
+                error_json["data"] = "";
+
+                crow::response res(400, error_json.dump());
+                addCorsHeaders(res);
+                return res;
+            }
+            Logger::setLevel(level);
+            FX_LOG_INFO("Log level set to " << Logger::levelName(level) << " via API");
+        }
+
+        json log_data;
+        log_data["level"] = Logger::levelName(Logger::getLevel());
+        log_data["compiled"] = Logger::levelName(Logger::getCompiledLevel());
+        log_data["dropped"] = Logger::getDropped();
+
+        json response_json;
+        response_json["success"] = true;
+        response_json["message"] = "Log level: " + Logger::levelName(Logger::getLevel());
+        response_json["data"] = log_data;
+
+        crow::response res(response_json.dump());
+        addCorsHeaders(res);
+        return res;
+
+    } catch (const std::exception& e) {
+        json error_json;
+        error_json["success"] = false;
+        error_json["message"] = "Invalid request format: " + std::string(e.what());
+        error_json["data"] = "";
+
+        crow::response res(400, error_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+}
+
 crow::response WebServer::handleCompress(const crow::request& req) {
     try {
         json request_data = json::parse(req.body);
-        std::string zipPath = request_data["zipPath"];
+        Session& session = getSession(req);
+        std::string zipPath = session.resolvePath(request_data["zipPath"].get<std::string>());
         std::vector<std::string> paths = request_data["paths"];
+        for (auto& path : paths) {
+            path = session.resolvePath(path);
+        }
 
         if (paths.empty()) {
             json error_json;
@@ -387,11 +1219,44 @@ crow::response WebServer::handleCompress(const crow::request& req) {
             return res;
         }
 
-        if (CompressionManager::compressToZip(zipPath, paths)) {
+        // Optional "threads": compression threads (default: all cores)
+        CompressionManager::Options options;
+        if (request_data.contains("threads") && request_data["threads"].is_number_unsigned()) {
+            options.threads = request_data["threads"].get<size_t>();
+        }
+        // Optional "profile": auto (default), fast, best or store
+        std::string profile = request_data.value("profile", "auto");
+        if (profile == "fast") {
+            options.profile = CompressionManager::Profile::Fast;
+        } else if (profile == "best") {
+            options.profile = CompressionManager::Profile::Best;
+        } else if (profile == "store") {
+            options.profile = CompressionManager::Profile::Store;
+        } else if (profile != "auto") {
+            json error_json;
+            error_json["success"] = false;
+            error_json["message"] = "Unknown compression profile: " + profile;
+            error_json["data"] = "";
+
+            crow::response res(400, error_json.dump());
+            addCorsHeaders(res);
+            return res;
+        }
+
+        CompressionManager::PackStats stats;
+        if (CompressionManager::compressToZip(zipPath, paths, options, stats)) {
             json response_json;
             response_json["success"] = true;
             response_json["message"] = "Files compressed successfully";
-            response_json["data"] = "";
+            response_json["data"] = {
+                {"entries", stats.entries},
+                {"stored", stats.stored},
+                {"bytesIn", stats.bytes_in},
+                {"bytesOut", stats.bytes_out},
+                {"storedBytes", stats.stored_bytes},
+                {"deflateCpuMs", stats.deflate_cpu_ns / 1000000},
+                {"savedCpuMs", stats.saved_cpu_ns / 1000000}
+            };
 
             crow::response res(response_json.dump());
             addCorsHeaders(res);
@@ -422,8 +1287,9 @@ crow::response WebServer::handleCompress(const crow::request& req) {
 crow::response WebServer::handleDecompress(const crow::request& req) {
     try {
         json request_data = json::parse(req.body);
-        std::string zipPath = request_data["zipPath"];
-        std::string destDir = request_data.value("destDir", ".");
+        Session& session = getSession(req);
+        std::string zipPath = session.resolvePath(request_data["zipPath"].get<std::string>());
+        std::string destDir = session.resolvePath(request_data.value("destDir", "."));
 
         if (!CompressionManager::isZipFile(zipPath)) {
             json error_json;
@@ -436,10 +1302,19 @@ crow::response WebServer::handleDecompress(const crow::request& req) {
             return res;
         }
 
-        if (CompressionManager::decompressFromZip(zipPath, destDir)) {
+        // An optional "entry" extracts just that entry
+        std::string entry = request_data.value("entry", "");
+        // Optional "threads": extraction threads (default: all cores)
+        CompressionManager::Options options;
+        if (request_data.contains("threads") && request_data["threads"].is_number_unsigned()) {
+            options.threads = request_data["threads"].get<size_t>();
+        }
+        bool extracted = entry.empty() ? CompressionManager::decompressFromZip(zipPath, destDir, options)
+                                       : CompressionManager::extractFromZip(zipPath, entry, destDir);
+        if (extracted) {
             json response_json;
             response_json["success"] = true;
-            response_json["message"] = "Zip file extracted successfully";
+            response_json["message"] = entry.empty() ? "Zip file extracted successfully" : "Zip entry extracted successfully";
             response_json["data"] = "";
 
             crow::response res(response_json.dump());
@@ -468,6 +1343,124 @@ crow::response WebServer::handleDecompress(const crow::request& req) {
     }
 }
 
+crow::response WebServer::handleZipList(const crow::request& req) {
+    // GET ?path=archive.zip&offset=N&limit=M: one page of the central directory, no entry data read
+    std::string path = req.url_params.get("path") ? std::string(req.url_params.get("path")) : "";
+    size_t offset = 0;
+    size_t limit = MAX_PAGE_LIMIT;
+    if (const char* offset_param = req.url_params.get("offset")) {
+        offset = static_cast<size_t>(std::strtoull(offset_param, nullptr, 10));
+    }
+    if (const char* limit_param = req.url_params.get("limit")) {
+        limit = static_cast<size_t>(std::strtoull(limit_param, nullptr, 10));
+        limit = std::max<size_t>(1, std::min(limit, MAX_PAGE_LIMIT));
+    }
+
+    std::string error = path.empty() ? "Error: Missing archive path (path)" : "";
+    std::shared_ptr<const ZipArchive> archive;
+    if (error.empty()) {
+        archive = ZipArchive::open(getSession(req).resolvePath(path), error);
+    }
+    json response_json;
+    if (!archive) {
+        response_json["success"] = false;
+        response_json["message"] = error;
+        response_json["data"] = "";
+
+        crow::response res(error.find("Error: File does not exist") == 0 ? 404 : 400, response_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    const auto& entries = archive->entries();
+    json entries_array = json::array();
+    for (size_t i = std::min(offset, entries.size()); i < entries.size() && entries_array.size() < limit; ++i) {
+        entries_array.push_back({
+            {"name", entries[i].name},
+            {"size", entries[i].uncompressed_size},
+            {"compressedSize", entries[i].compressed_size},
+            {"method", entries[i].compression == 0 ? "store" : "deflate"}
+        });
+    }
+
+    response_json["success"] = true;
+    response_json["message"] = std::to_string(entries.size()) + " entries";
+    response_json["data"] = {
+        {"entries", entries_array},
+        {"offset", offset},
+        {"total", entries.size()}
+    };
+
+    crow::response res(response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+    addCorsHeaders(res);
+    return res;
+}
+
+crow::response WebServer::handleZipEntry(const crow::request& req) {
+    // GET ?path=archive.zip&entry=name&length=N: the first N bytes of one entry, inflated on the fly
+    std::string path = req.url_params.get("path") ? std::string(req.url_params.get("path")) : "";
+    std::string name = req.url_params.get("entry") ? std::string(req.url_params.get("entry")) : "";
+    size_t length = DEFAULT_PREVIEW_LENGTH;
+    if (const char* length_param = req.url_params.get("length")) {
+        length = std::min(static_cast<size_t>(std::strtoull(length_param, nullptr, 10)), MAX_PREVIEW_LENGTH);
+    }
+
+    std::string error = (path.empty() || name.empty()) ? "Error: Missing archive path or entry" : "";
+    std::shared_ptr<const ZipArchive> archive;
+    const ZipArchive::Entry* entry = nullptr;
+    if (error.empty()) {
+        archive = ZipArchive::open(getSession(req).resolvePath(path), error);
+    }
+    if (archive) {
+        entry = archive->find(name);
+        if (!entry) {
+            error = "Error: No such entry in archive: " + name;
+        }
+    }
+
+    std::string data;
+    if (entry) {
+        ZipArchive::EntryReader reader = archive->openEntry(*entry);
+        data.resize(static_cast<size_t>(std::min<uint64_t>(length, entry->uncompressed_size)));
+        size_t filled = 0;
+        while (reader.isOpen() && filled < data.size()) {
+            long long count = reader.read(&data[filled], data.size() - filled);
+            if (count <= 0) {
+                break;
+            }
+            filled += static_cast<size_t>(count);
+        }
+        if (filled < data.size()) {
+            error = reader.getError().empty() ? "Error: Corrupt zip entry: " + entry->name : reader.getError();
+        }
+    }
+
+    json response_json;
+    if (!error.empty()) {
+        response_json["success"] = false;
+        response_json["message"] = error;
+        response_json["data"] = "";
+
+        bool missing = error.find("Error: File does not exist") == 0 || error.find("Error: No such entry") == 0;
+        crow::response res(missing ? 404 : 400, response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+        addCorsHeaders(res);
+        return res;
+    }
+
+    response_json["success"] = true;
+    response_json["message"] = "Zip entry retrieved";
+    response_json["data"] = data;
+    response_json["entry"] = entry->name;
+    response_json["fileSize"] = entry->uncompressed_size;
+    response_json["truncated"] = data.size() < entry->uncompressed_size;
+
+    // A preview can end inside a UTF-8 sequence; replace it instead of failing the dump
+    crow::response res(response_json.dump(-1, ' ', false, json::error_handler_t::replace));
+    res.add_header("Content-Type", "application/json");
+    addCorsHeaders(res);
+    return res;
+}
+
 crow::response WebServer::handleStaticFile(const std::string& filename) {
     try {
         std::string requested_path = filename;
@@ -504,13 +1497,7 @@ std::string WebServer::generateJSON(const FileSystemData& data) {
 
     json files = json::array();
     for (const auto& file : data.files) {
-        json file_obj;
-        file_obj["name"] = file.name;
-        file_obj["type"] = file.type;
-        file_obj["size"] = file.size;
-        file_obj["modified"] = file.modified;
-        file_obj["permissions"] = file.permissions;
-        files.push_back(file_obj);
+        files.push_back(fileInfoToJSON(file));
     }
     j["files"] = files;
 
@@ -549,7 +1536,127 @@ std::string WebServer::getMimeType(const std::string& filepath) {
     return "application/octet-stream";
 }
 
-WebServer::ApiResponse WebServer::executeCommandAPI(const std::string& command, const std::vector<std::string>& args) {
+crow::response WebServer::handleFileSystemPage(const crow::request& req, const std::string& path) {
+    Session& session = getSession(req);
+    std::string virtual_path = session.resolvePath(path);
+
+    size_t limit = MAX_PAGE_LIMIT;
+    if (const char* limit_param = req.url_params.get("limit")) {
+        limit = static_cast<size_t>(std::strtoull(limit_param, nullptr, 10));
+        limit = std::max<size_t>(1, std::min(limit, MAX_PAGE_LIMIT));
+    }
+    // Cursors are 64-bit cookies; passed as decimal strings so JavaScript keeps them exact
+    uint64_t cursor = 0;
+    if (const char* cursor_param = req.url_params.get("cursor")) {
+        cursor = std::strtoull(cursor_param, nullptr, 10);
+    }
+    bool ndjson = req.url_params.get("format") && std::string(req.url_params.get("format")) == "ndjson";
+
+    // Reserved directories are only listed by their owners
+    DirManager::DirIterator it(virtual_path, cursor);
+    if (!it.isOpen() || PathUtils::isReservedPath(virtual_path)) {
+        json error_json;
+        error_json["success"] = false;
+        error_json["message"] = "Directory not found: " + virtual_path;
+        error_json["data"] = "";
+
+        crow::response res(404, error_json.dump());
+        addCorsHeaders(res);
+        return res;
+    }
+
+    std::string parent_path = (virtual_path == "/") ? "" : PathUtils::getParentPath(virtual_path);
+    json files = json::array();
+    std::string body;
+
+    if (ndjson) {
+        // Header line, one line per entry, trailer line with the resume cursor
+        json header;
+        header["currentPath"] = virtual_path;
+        header["parentPath"] = parent_path;
+        body += header.dump();
+        body += '\n';
+    }
+
+    DirManager::DirEntry entry;
+    size_t count = 0;
+    while (count < limit && it.next(entry)) {
+        if (ndjson) {
+            body += fileInfoToJSON(makeFileInfo(virtual_path, entry)).dump();
+            body += '\n';
+        } else {
+            files.push_back(fileInfoToJSON(makeFileInfo(virtual_path, entry)));
+        }
+        ++count;
+    }
+    bool done = !it.hasNext();
+    std::string next_cursor = done ? "" : std::to_string(it.getCursor());
+
+    if (ndjson) {
+        json trailer;
+        trailer["nextCursor"] = next_cursor;
+        trailer["done"] = done;
+        body += trailer.dump();
+        body += '\n';
+
+        crow::response res(std::move(body));
+        res.set_header("Content-Type", "application/x-ndjson");
+        addCorsHeaders(res);
+        return res;
+    }
+
+    json page;
+    page["currentPath"] = virtual_path;
+    page["parentPath"] = parent_path;
+    page["files"] = std::move(files);
+    page["nextCursor"] = next_cursor;
+    page["done"] = done;
+
+    json response_json;
+    response_json["success"] = true;
+    response_json["message"] = "File system page retrieved";
+    response_json["data"] = std::move(page);
+
+    crow::response res(response_json.dump());
+    addCorsHeaders(res);
+    return res;
+}
+
+WebServer::FileInfo WebServer::makeFileInfo(const std::string& dir_path, const DirManager::DirEntry& entry) {
+    FileInfo file_info;
+    file_info.name = entry.name;
+
+    DirManager::EntryType type = entry.type;
+    long long size = entry.size;
+    if (type == DirManager::EntryType::Symlink) {
+        // Links inside the sandbox are followed everywhere else, so show the target
+        std::string entry_path = (dir_path == "/") ? "/" + entry.name : dir_path + "/" + entry.name;
+        struct stat target;
+        if (MetadataCache::statPath(entry_path, target)) {
+            type = ((target.st_mode & S_IFMT) == S_IFDIR) ? DirManager::EntryType::Directory
+                                                           : DirManager::EntryType::File;
+            size = static_cast<long long>(target.st_size);
+        }
+    }
+
+    if (type == DirManager::EntryType::Directory) {
+        file_info.type = "directory";
+        file_info.size = 0;
+    } else {
+        file_info.type = "file";
+        file_info.size = static_cast<size_t>(size);
+    }
+
+    file_info.modified = formatTimestamp(entry.mtime);
+    file_info.permissions = DirManager::formatPermissions(entry.mode);
+    return file_info;
+}
+
+Session& WebServer::getSession(const crow::request& req) {
+    return *app_->get_context<SessionMiddleware>(req).session;
+}
+
+WebServer::ApiResponse WebServer::executeCommandAPI(Session& session, const std::string& command, const std::vector<std::string>& args) {
     // Build command string for existing CommandParser
     std::string full_command = command;
     for (const auto& arg : args) {
@@ -557,20 +1664,20 @@ WebServer::ApiResponse WebServer::executeCommandAPI(const std::string& command,
     }
 
     // Execute using existing CommandParser
-    CommandParser::CommandResult result = CommandParser::executeCommand(full_command);
+    CommandParser::CommandResult result = CommandParser::executeCommand(session, full_command);
 
     if (result.success) {
         // For commands that return data (ls, pwd, etc.), capture output
         std::string data = "";
         if (command == "ls" || command == "tree") {
             // Get file system data for these commands
-            FileSystemData fs_data = getFileSystemData(args.empty() ? "." : args[0]);
+            FileSystemData fs_data = getFileSystemData(session, args.empty() ? "." : args[0]);
             data = generateJSON(fs_data);
         } else if (command == "pwd") {
-            data = "\"" + PathUtils::getCurrentVirtualPath() + "\"";
+            data = "\"" + session.getCurrentPath() + "\"";
         } else if (command == "read") {
             if (!args.empty()) {
-                std::string content = FileManager::readFile(args[0]);
+                std::string content = FileManager::readFile(session.resolvePath(args[0]));
                 data = "\"" + content + "\"";
             }
         }
@@ -581,74 +1688,19 @@ WebServer::ApiResponse WebServer::executeCommandAPI(const std::string& command,
     }
 }
 
-WebServer::FileSystemData WebServer::getFileSystemData(const std::string& path) {
+WebServer::FileSystemData WebServer::getFileSystemData(const Session& session, const std::string& path) {
     FileSystemData data;
 
-    // Normalize path: convert "/" or empty to "." for internal use, but keep "/" for virtual path representation
-    std::string virtual_path = (path == "/" || path.empty()) ? "/" : path;
-    std::string list_path = (path == "/" || path.empty()) ? "." : path;
+    // Relative paths (including ".") are relative to the session's directory
+    std::string virtual_path = session.resolvePath(path);
+    data.currentPath = virtual_path;
+    data.parentPath = (virtual_path == "/") ? "" : PathUtils::getParentPath(virtual_path);
 
-    // Get current and parent paths using the virtual path
-    std::string real_path = PathUtils::resolveVirtualPath(list_path);
-    data.currentPath = virtual_path;  // Return "/" for root, not "."
-
-    fs::path parent_path = fs::path(real_path).parent_path();
-    if (parent_path >= fs::path(PathUtils::getVFSRoot())) {
-        data.parentPath = PathUtils::getVirtualPath(parent_path.string());
-    } else {
-        data.parentPath = "";
-    }
-
-    // List directory contents using the normalized path
-    std::vector<std::string> entries = DirManager::listDirectory(list_path);
+    // One pass yields name, type, size, mtime and mode for every entry
+    std::vector<DirManager::DirEntry> entries = DirManager::listDirectoryEx(virtual_path);
+    data.files.reserve(entries.size());
     for (const auto& entry : entries) {
-        try {
-            FileInfo file_info;
-            file_info.name = entry;
-
-            // Build full virtual path for the entry
-            std::string entry_virtual_path;
-            if (virtual_path == "/") {
-                entry_virtual_path = "/" + entry;
-            } else {
-                entry_virtual_path = virtual_path + "/" + entry;
-            }
-
-            std::string entry_real_path = PathUtils::resolveVirtualPath(entry_virtual_path);
-
-            if (fs::is_directory(entry_real_path)) {
-                file_info.type = "directory";
-                file_info.size = 0;
-            } else {
-                file_info.type = "file";
-                // Use the full virtual path for getFileSize
-                try {
-                    file_info.size = FileManager::getFileSize(entry_virtual_path);
-                } catch (...) {
-                    file_info.size = 0;  // Default to 0 if size cannot be determined
-                }
-            }
-
-            // Get modification time
-            try {
-                auto ftime = fs::last_write_time(entry_real_path);
-                auto sctp = std::chrono::time_point_cast<std::chrono::system_clock::duration>(
-                    ftime - fs::file_time_type::clock::now() + std::chrono::system_clock::now());
-                std::time_t cftime = std::chrono::system_clock::to_time_t(sctp);
-                std::stringstream ss;
-                ss << std::put_time(std::localtime(&cftime), "%Y-%m-%dT%H:%M:%SZ");
-                file_info.modified = ss.str();
-            } catch (...) {
-                file_info.modified = "";  // Default to empty if time cannot be determined
-            }
-
-            file_info.permissions = "rw-r--r--";  // Simplified permissions
-
-            data.files.push_back(file_info);
-        } catch (const std::exception& e) {
-            // Skip this entry if there's an error, but continue with others
-            std::cerr << "Warning: Error processing file entry '" << entry << "': " << e.what() << std::endl;
-        }
+        data.files.push_back(makeFileInfo(virtual_path, entry));
     }
 
     return data;
@@ -657,5 +1709,6 @@ WebServer::FileSystemData WebServer::getFileSystemData(const std::string& path)
 void WebServer::addCorsHeaders(crow::response& res) {
     res.add_header("Access-Control-Allow-Origin", "*");
     res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
-    res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
+    res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization, X-Session-Token");
+    res.add_header("Access-Control-Expose-Headers", "X-Session-Token, Content-Range, Accept-Ranges, ETag");
 }
\ No newline at end of file
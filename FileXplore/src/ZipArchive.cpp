@@ -0,0 +1,385 @@
+#include "../include/ZipArchive.h"
+#include "../include/PathUtils.h"
+#include "../include/Sandbox.h"
+#include "../include/Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+#include <zlib.h>
+
+using namespace std;
+
+// Record signatures
+static const uint32_t LOCAL_HEADER_SIG = 0x04034b50;
+static const uint32_t CENTRAL_HEADER_SIG = 0x02014b50;
+static const uint32_t EOCD_SIG = 0x06054b50;
+static const uint32_t ZIP64_EOCD_SIG = 0x06064b50;
+static const uint32_t ZIP64_LOCATOR_SIG = 0x07064b50;
+
+// Fixed record sizes
+static const size_t LOCAL_HEADER_SIZE = 30;
+static const size_t CENTRAL_HEADER_SIZE = 46;
+static const size_t EOCD_SIZE = 22;
+static const size_t ZIP64_EOCD_SIZE = 56;
+static const size_t ZIP64_LOCATOR_SIZE = 20;
+
+// The EOCD ends the archive, followed by a comment of at most 64 KiB
+static const size_t EOCD_SEARCH = EOCD_SIZE + 0xFFFF;
+
+static const uint32_t ZIP64_MARKER_32 = 0xFFFFFFFF;
+static const uint16_t ZIP64_MARKER_16 = 0xFFFF;
+static const uint16_t ZIP64_EXTRA_TAG = 0x0001;
+
+// zlib counts in 32 bits; larger reads and entries are fed to it in pieces
+static const size_t INFLATE_PIECE = size_t(1) << 30;
+
+// Static member definitions
+mutex ZipArchive::cache_mutex;
+list<ZipArchive::CacheSlot> ZipArchive::cache;
+
+// Little-endian fields at an offset the caller has bounds-checked
+static uint16_t load16(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>(b[0] | (b[1] << 8));
+}
+
+static uint32_t load32(const char* p) {
+    return static_cast<uint32_t>(load16(p)) | (static_cast<uint32_t>(load16(p + 2)) << 16);
+}
+
+static uint64_t load64(const char* p) {
+    return static_cast<uint64_t>(load32(p)) | (static_cast<uint64_t>(load32(p + 4)) << 32);
+}
+
+shared_ptr<const ZipArchive> ZipArchive::open(const string& virtual_path, string& error) {
+    string resolved = PathUtils::resolvePath(virtual_path);
+
+    // Stat before mapping: if the file changes in between, the next open parses it again
+    struct stat info;
+    if (!Sandbox::statPath(resolved, info)) {
+        error = "Error: File does not exist: " + virtual_path;
+        return nullptr;
+    }
+    uint64_t inode = static_cast<uint64_t>(info.st_ino);
+    int64_t size = static_cast<int64_t>(info.st_size);
+    int64_t mtime_ns = Sandbox::mtimeNanoseconds(info);
+    {
+        lock_guard<mutex> lock(cache_mutex);
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->path == resolved) {
+                if (it->inode == inode && it->size == size && it->mtime_ns == mtime_ns) {
+                    cache.splice(cache.begin(), cache, it);
+                    return it->archive;
+                }
+                cache.erase(it);
+                break;
+            }
+        }
+    }
+
+    shared_ptr<ZipArchive> archive(new ZipArchive());
+    archive->mapping_ = FileManager::mapFile(resolved, FileManager::AccessPattern::Random);
+    if (!archive->mapping_.isOpen()) {
+        error = archive->mapping_.getError();
+        return nullptr;
+    }
+    error = archive->parse(virtual_path);
+    if (!error.empty()) {
+        return nullptr;
+    }
+    FX_LOG_DEBUG("Indexed " << archive->entries_.size() << " zip entries of " << resolved);
+
+    lock_guard<mutex> lock(cache_mutex);
+    cache.push_front({resolved, inode, size, mtime_ns, archive});
+    if (cache.size() > MAX_CACHED_ARCHIVES) {
+        cache.pop_back();
+    }
+    return archive;
+}
+
+void ZipArchive::clearCache() {
+    lock_guard<mutex> lock(cache_mutex);
+    cache.clear();
+}
+
+const ZipArchive::Entry* ZipArchive::find(const string& name) const {
+    auto it = index_.find(name);
+    if (it == index_.end() && !name.empty()) {
+        // FileXplore names entries with a leading '/', other tools without one
+        string other = (name[0] == '/') ? name.substr(1) : "/" + name;
+        it = index_.find(other);
+    }
+    return (it == index_.end()) ? nullptr : &entries_[it->second];
+}
+
+string ZipArchive::parse(const string& virtual_path) {
+    const char* base = mapping_.data();
+    uint64_t size = mapping_.size();
+    string invalid = "Error: Invalid zip file format: " + virtual_path;
+    if (size < EOCD_SIZE) {
+        return invalid;
+    }
+
+    // The EOCD is the last record; one backward scan over the mapped tail finds it
+    uint64_t tail = min<uint64_t>(size, EOCD_SEARCH);
+    mapping_.advise(static_cast<size_t>(size - tail), static_cast<size_t>(tail), FileManager::AccessPattern::WillNeed);
+    uint64_t eocd = size - EOCD_SIZE;
+    while (load32(base + eocd) != EOCD_SIG) {
+        if (eocd == size - tail) {
+            return invalid;
+        }
+        --eocd;
+    }
+    uint64_t count = load16(base + eocd + 10);
+    uint64_t directory_size = load32(base + eocd + 12);
+    uint64_t directory_offset = load32(base + eocd + 16);
+
+    // The ZIP64 locator sits right before the EOCD and points at the ZIP64 EOCD
+    if (eocd >= ZIP64_LOCATOR_SIZE && load32(base + eocd - ZIP64_LOCATOR_SIZE) == ZIP64_LOCATOR_SIG) {
+        // The record must fit whole before the locator; checked before any of it is read
+        uint64_t locator = eocd - ZIP64_LOCATOR_SIZE;
+        uint64_t record = load64(base + locator + 8);
+        if (locator < ZIP64_EOCD_SIZE || record > locator - ZIP64_EOCD_SIZE ||
+            load32(base + record) != ZIP64_EOCD_SIG) {
+            return invalid;
+        }
+        count = load64(base + record + 32);
+        directory_size = load64(base + record + 40);
+        directory_offset = load64(base + record + 48);
+    } else if (count == ZIP64_MARKER_16 || directory_offset == ZIP64_MARKER_32) {
+        return invalid;
+    }
+    if (directory_offset > size || directory_size > size - directory_offset) {
+        return invalid;
+    }
+
+    // Each record is at least CENTRAL_HEADER_SIZE bytes, which bounds a bogus count
+    mapping_.advise(static_cast<size_t>(directory_offset), static_cast<size_t>(directory_size),
+                    FileManager::AccessPattern::Sequential);
+    entries_.reserve(static_cast<size_t>(min<uint64_t>(count, directory_size / CENTRAL_HEADER_SIZE)));
+    uint64_t pos = directory_offset;
+    uint64_t end = directory_offset + directory_size;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (end - pos < CENTRAL_HEADER_SIZE || load32(base + pos) != CENTRAL_HEADER_SIG) {
+            return invalid;
+        }
+        const char* header = base + pos;
+        uint16_t name_length = load16(header + 28);
+        uint16_t extra_length = load16(header + 30);
+        uint16_t comment_length = load16(header + 32);
+        uint64_t record_size = CENTRAL_HEADER_SIZE + name_length + extra_length + comment_length;
+        if (end - pos < record_size) {
+            return invalid;
+        }
+
+        Entry entry;
+        entry.compression = load16(header + 10);
+        entry.crc32 = load32(header + 16);
+        entry.compressed_size = load32(header + 20);
+        entry.uncompressed_size = load32(header + 24);
+        entry.local_header_offset = load32(header + 42);
+        entry.name.assign(header + CENTRAL_HEADER_SIZE, name_length);
+
+        // The ZIP64 extra field holds the values whose 32-bit fields are saturated, in order
+        const char* extra = header + CENTRAL_HEADER_SIZE + name_length;
+        size_t field = 0;
+        while (field + 4 <= extra_length) {
+            uint16_t tag = load16(extra + field);
+            size_t field_size = min<size_t>(load16(extra + field + 2), extra_length - field - 4);
+            if (tag == ZIP64_EXTRA_TAG) {
+                size_t value_pos = field + 4;
+                for (uint64_t* value : {&entry.uncompressed_size, &entry.compressed_size,
+                                        &entry.local_header_offset}) {
+                    if (*value == ZIP64_MARKER_32 && value_pos + 8 <= field + 4 + field_size) {
+                        *value = load64(extra + value_pos);
+                        value_pos += 8;
+                    }
+                }
+            }
+            field += 4 + field_size;
+        }
+
+        entries_.push_back(std::move(entry));
+        pos += record_size;
+    }
+
+    // The names are keyed by view, so the index is built once the vector stops moving
+    index_.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        index_.emplace(entries_[i].name, i);
+    }
+    return "";
+}
+
+ZipArchive::EntryReader ZipArchive::openEntry(const Entry& entry) const {
+    EntryReader reader;
+    reader.entry_ = &entry;
+    const char* base = mapping_.data();
+    uint64_t size = mapping_.size();
+
+    // The local header's own name and extra lengths may differ from the central record's
+    uint64_t header = entry.local_header_offset;
+    if (header > size || size - header < LOCAL_HEADER_SIZE || load32(base + header) != LOCAL_HEADER_SIG) {
+        reader.error_ = "Error: Corrupt zip entry: " + entry.name;
+        return reader;
+    }
+    uint64_t data = header + LOCAL_HEADER_SIZE + load16(base + header + 26) + load16(base + header + 28);
+    if (data > size || entry.compressed_size > size - data) {
+        reader.error_ = "Error: Truncated zip entry: " + entry.name;
+        return reader;
+    }
+
+    if (entry.compression == 8) {
+        reader.stream_.reset(new z_stream());
+        if (inflateInit2(reader.stream_.get(), -MAX_WBITS) != Z_OK) {
+            reader.stream_.reset();
+            reader.error_ = "Error: Failed to start decompression: " + entry.name;
+            return reader;
+        }
+    } else if (entry.compression != 0) {
+        reader.error_ = "Error: Unsupported compression method for: " + entry.name;
+        return reader;
+    }
+
+    mapping_.advise(static_cast<size_t>(data), static_cast<size_t>(entry.compressed_size),
+                    FileManager::AccessPattern::Sequential);
+    reader.data_ = base + data;
+    reader.archive_ = shared_from_this();
+    return reader;
+}
+
+string ZipArchive::safeEntryPath(const string& name) {
+    string path = name;
+    replace(path.begin(), path.end(), '\\', '/');
+    if (path.size() >= 2 && path[1] == ':') {
+        return "";  // Drive letter
+    }
+
+    // Keep the real components; a leading '/' is how FileXplore names every entry
+    string safe;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find('/', start);
+        if (end == string::npos) {
+            end = path.size();
+        }
+        string part = path.substr(start, end - start);
+        if (part == "..") {
+            return "";
+        }
+        if (!part.empty() && part != ".") {
+            if (!safe.empty()) {
+                safe += '/';
+            }
+            safe += part;
+        }
+        start = end + 1;
+    }
+    return safe;
+}
+
+ZipArchive::EntryReader::EntryReader()
+    : entry_(nullptr), data_(nullptr), consumed_(0), produced_(0), crc_(0), finished_(false) {}
+
+ZipArchive::EntryReader::~EntryReader() {
+    if (stream_) {
+        inflateEnd(stream_.get());
+    }
+}
+
+ZipArchive::EntryReader::EntryReader(EntryReader&& other) noexcept
+    : archive_(std::move(other.archive_)), entry_(other.entry_), data_(other.data_),
+      consumed_(other.consumed_), produced_(other.produced_), crc_(other.crc_),
+      stream_(std::move(other.stream_)), finished_(other.finished_), error_(std::move(other.error_)) {}
+
+ZipArchive::EntryReader& ZipArchive::EntryReader::operator=(EntryReader&& other) noexcept {
+    if (this != &other) {
+        if (stream_) {
+            inflateEnd(stream_.get());
+        }
+        archive_ = std::move(other.archive_);
+        entry_ = other.entry_;
+        data_ = other.data_;
+        consumed_ = other.consumed_;
+        produced_ = other.produced_;
+        crc_ = other.crc_;
+        stream_ = std::move(other.stream_);
+        finished_ = other.finished_;
+        error_ = std::move(other.error_);
+    }
+    return *this;
+}
+
+bool ZipArchive::EntryReader::isOpen() const {
+    return archive_ != nullptr;
+}
+
+const string& ZipArchive::EntryReader::getError() const {
+    return error_;
+}
+
+long long ZipArchive::EntryReader::read(char* buffer, size_t capacity) {
+    if (!isOpen() || !error_.empty()) {
+        return -1;
+    }
+    if (finished_ || capacity == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    if (!stream_) {
+        // Stored: the data is the entry
+        count = static_cast<size_t>(min<uint64_t>(capacity, entry_->compressed_size - consumed_));
+        memcpy(buffer, data_ + consumed_, count);
+        consumed_ += count;
+    } else {
+        // Inflate until the buffer is full or the stream ends
+        int ret = Z_OK;
+        while (count < capacity && ret != Z_STREAM_END) {
+            z_stream& zs = *stream_;
+            zs.next_in = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data_ + consumed_));
+            zs.avail_in = static_cast<uInt>(min<uint64_t>(INFLATE_PIECE, entry_->compressed_size - consumed_));
+            zs.next_out = reinterpret_cast<Bytef*>(buffer + count);
+            zs.avail_out = static_cast<uInt>(min(INFLATE_PIECE, capacity - count));
+            uInt in_before = zs.avail_in;
+            uInt out_before = zs.avail_out;
+            ret = inflate(&zs, Z_NO_FLUSH);
+            consumed_ += in_before - zs.avail_in;
+            count += out_before - zs.avail_out;
+            if (ret == Z_BUF_ERROR || (ret == Z_OK && in_before == zs.avail_in && out_before == zs.avail_out)) {
+                // No progress: the input ran out before the stream ended
+                error_ = "Error: Corrupt zip entry: " + entry_->name;
+                return -1;
+            }
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                error_ = "Error: Corrupt zip entry: " + entry_->name;
+                return -1;
+            }
+        }
+        if (ret == Z_STREAM_END) {
+            finished_ = true;
+        }
+    }
+
+    crc_ = static_cast<uint32_t>(crc32_z(crc_, reinterpret_cast<const Bytef*>(buffer), count));
+    produced_ += count;
+    if (produced_ > entry_->uncompressed_size) {
+        error_ = "Error: Corrupt zip entry: " + entry_->name;
+        return -1;
+    }
+    if (!stream_ && consumed_ == entry_->compressed_size) {
+        finished_ = true;
+    }
+    if (finished_ && finish() < 0) {
+        return -1;
+    }
+    return static_cast<long long>(count);
+}
+
+long long ZipArchive::EntryReader::finish() {
+    if (produced_ != entry_->uncompressed_size || crc_ != entry_->crc32) {
+        error_ = "Error: Checksum mismatch in zip entry: " + entry_->name;
+        return -1;
+    }
+    return 0;
+}
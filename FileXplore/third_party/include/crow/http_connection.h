@@ -14,6 +14,16 @@
 #include <chrono>
 #include <memory>
 #include <vector>
+#include <cerrno>
+#include <type_traits>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 #include "crow/http_parser_merged.h"
 #include "crow/common.h"
@@ -197,6 +207,17 @@ namespace crow
                     res.complete_request_handler_ = [self] {
                         self->complete_request();
                     };
+                    // FileXplore: always queued, so it runs after handle() below has returned;
+                    // weak, since res (owned by this connection) stores it
+                    std::weak_ptr<Connection> weak_self = self;
+                    res.dispatch_handler_ = [weak_self](std::function<void()> fn) {
+                        if (auto conn = weak_self.lock())
+                        {
+                            asio::post(conn->adaptor_.get_io_context(), [conn, fn = std::move(fn)] {
+                                fn();
+                            });
+                        }
+                    };
                     need_to_call_after_handlers_ = true;
                     handler_->handle(req_, res, routing_handle_result_);
                     if (add_keep_alive_)
@@ -276,6 +297,7 @@ namespace crow
         {
             res.complete_request_handler_ = nullptr;
             res.is_alive_helper_ = nullptr;
+            res.dispatch_handler_ = nullptr;
 
             if (!adaptor_.is_open())
             {
@@ -290,7 +312,27 @@ namespace crow
         {
             asio::write(adaptor_.socket(), buffers_);
 
-            if (res.file_info.statResult == 0)
+            if (res.file_info.fd)
+            {
+                // FileXplore: a large transfer can outlast the request deadline
+                cancel_deadline_timer();
+#ifdef __linux__
+                if (std::is_same<Adaptor, SocketAdaptor>::value)
+                {
+                    // Own a reference: res.clear() would otherwise close the file mid-transfer
+                    static_file_ = res.file_info.fd;
+                    static_position_ = static_cast<off_t>(res.file_info.offset);
+                    static_remaining_ = res.file_info.length;
+                    sending_file_ = true;
+                    send_static_descriptor();
+                    return;
+                }
+#endif
+                // A short transfer leaves the client with a bad Content-Length, so drop the connection
+                if (!write_static_descriptor())
+                    close_connection_ = true;
+            }
+            else if (res.file_info.statResult == 0)
             {
                 std::ifstream is(res.file_info.path.c_str(), std::ios::in | std::ios::binary);
                 std::vector<asio::const_buffer> buffers{1};
@@ -303,6 +345,12 @@ namespace crow
                     is.read(buf, sizeof(buf));
                 }
             }
+            finish_static();
+        }
+
+        /// FileXplore: end a static response once its body is out, then go back to reading if a request waits on it.
+        void finish_static()
+        {
             if (close_connection_)
             {
                 adaptor_.shutdown_readwrite();
@@ -314,6 +362,100 @@ namespace crow
             res.clear();
             buffers_.clear();
             parser_.clear();
+
+            if (need_to_start_read_after_complete_ && adaptor_.is_open())
+            {
+                need_to_start_read_after_complete_ = false;
+                start_deadline();
+                do_read();
+            }
+        }
+
+#ifdef __linux__
+        /// FileXplore: sendfile as much as the socket takes (no copy through user space), then let the
+        /// io_context wait for it to drain, so a slow client never holds up the other connections.
+        void send_static_descriptor()
+        {
+            int sock = adaptor_.raw_socket().native_handle();
+            while (static_remaining_ > 0)
+            {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(static_remaining_, 1u << 30));
+                ssize_t sent = ::sendfile(sock, *static_file_, &static_position_, chunk);
+                if (sent > 0)
+                {
+                    static_remaining_ -= static_cast<uint64_t>(sent);
+                    continue;
+                }
+                if (sent < 0 && errno == EINTR)
+                    continue;
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    // A client that takes nothing for a whole deadline is dropped
+                    start_deadline();
+                    auto self = this->shared_from_this();
+                    adaptor_.raw_socket().async_wait(asio::socket_base::wait_write, [self](const error_code& ec) {
+                        self->cancel_deadline_timer();
+                        if (ec)
+                        {
+                            CROW_LOG_DEBUG << self << " sendfile wait failed with " << self->static_remaining_ << " bytes left";
+                            self->end_static_descriptor(false);
+                            return;
+                        }
+                        self->send_static_descriptor();
+                    });
+                    return;
+                }
+                // Error, or the file shrank (sent == 0)
+                CROW_LOG_DEBUG << this << " sendfile stopped with " << static_remaining_ << " bytes left";
+                end_static_descriptor(false);
+                return;
+            }
+            end_static_descriptor(true);
+        }
+
+        void end_static_descriptor(bool complete)
+        {
+            static_file_.reset();
+            sending_file_ = false;
+            // A short transfer leaves the client with a bad Content-Length, so drop the connection
+            if (!complete)
+                close_connection_ = true;
+            finish_static();
+        }
+#endif
+
+        /// FileXplore: send a descriptor range through a buffer, where sendfile is not available.
+        bool write_static_descriptor()
+        {
+            // Own a reference: res.clear() in do_write_sync would otherwise close the file mid-transfer
+            std::shared_ptr<int> file = res.file_info.fd;
+            uint64_t offset = res.file_info.offset;
+            uint64_t remaining = res.file_info.length;
+
+            std::vector<asio::const_buffer> buffers{1};
+            char buf[16384];
+            while (remaining > 0)
+            {
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, sizeof(buf)));
+#ifdef _WIN32
+                _lseeki64(*file, static_cast<__int64>(offset), SEEK_SET);
+                int got = _read(*file, buf, static_cast<unsigned int>(chunk));
+#else
+                ssize_t got = ::pread(*file, buf, chunk, static_cast<off_t>(offset));
+                if (got < 0 && errno == EINTR)
+                    continue;
+#endif
+                if (got <= 0)
+                    return false;
+                buffers[0] = asio::buffer(buf, static_cast<size_t>(got));
+                error_code ec;
+                asio::write(adaptor_.socket(), buffers, ec);
+                if (ec)
+                    return false;
+                offset += static_cast<uint64_t>(got);
+                remaining -= static_cast<uint64_t>(got);
+            }
+            return true;
         }
 
         void do_write_general()
@@ -393,14 +535,14 @@ namespace crow
                       self->parser_.done();
                       // adaptor will close after write
                   }
-                  else if (!self->need_to_call_after_handlers_)
+                  else if (!self->need_to_call_after_handlers_ && !self->sending_file_)
                   {
                       self->start_deadline();
                       self->do_read();
                   }
                   else
                   {
-                      // res will be completed later by user
+                      // res will be completed later by user (or its file is still being sent)
                       self->need_to_start_read_after_complete_ = true;
                   }
               });
@@ -510,6 +652,12 @@ namespace crow
         bool need_to_call_after_handlers_{};
         bool need_to_start_read_after_complete_{};
         bool add_keep_alive_{};
+        bool sending_file_{};
+
+        // FileXplore: the file range a static response still has to send
+        std::shared_ptr<int> static_file_;
+        off_t static_position_{};
+        uint64_t static_remaining_{};
 
         std::tuple<Middlewares...>* middlewares_;
         detail::context<Middlewares...> ctx_;
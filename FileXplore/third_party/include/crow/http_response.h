@@ -10,6 +10,8 @@
 #define _CRT_INTERNAL_NONSTDC_NAMES 1
 #endif
 #include <sys/stat.h>
+#include <memory>
+#include <cstdint>
 #if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
 #define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
 #endif
@@ -242,6 +244,16 @@ namespace crow
             body += body_part;
         }
 
+        /// FileXplore: run fn on the thread that owns this connection, after the handler has returned.
+        /// A handler that completes asynchronously fills in and end()s the response from fn.
+        void dispatch(std::function<void()> fn)
+        {
+            if (dispatch_handler_)
+                dispatch_handler_(std::move(fn));
+            else
+                fn();
+        }
+
         /// Set the response completion flag and call the handler (to send the response).
         void end()
         {
@@ -250,8 +262,11 @@ namespace crow
                 completed_ = true;
                 if (skip_body)
                 {
-                    set_header("Content-Length", std::to_string(body.size()));
+                    // FileXplore: a static file's Content-Length stays, and HEAD never sends the file
+                    if (!is_static_type())
+                        set_header("Content-Length", std::to_string(body.size()));
                     body = "";
+                    file_info = static_file_info{};
                     manual_length_header = true;
                 }
                 if (complete_request_handler_)
@@ -279,7 +294,7 @@ namespace crow
         /// Check whether the response has a static file defined.
         bool is_static_type()
         {
-            return file_info.path.size();
+            return file_info.path.size() || file_info.fd;
         }
 
         /// This constains metadata (coming from the `stat` command) related to any static files associated with this response.
@@ -291,8 +306,30 @@ namespace crow
             std::string path = "";
             struct stat statbuf;
             int statResult;
+
+            // FileXplore: send [offset, offset + length) of an already-open descriptor instead of path
+            std::shared_ptr<int> fd;
+            uint64_t offset = 0;
+            uint64_t length = 0;
         };
 
+        /// Return a byte range of an open file descriptor as the response body (the code and other headers are up to the caller).
+
+        ///
+        /// The descriptor is shared so it stays open until the transfer ends; its deleter closes it.
+        void set_static_file_descriptor(std::shared_ptr<int> fd, uint64_t offset, uint64_t length)
+        {
+            file_info = static_file_info{};
+            file_info.fd = std::move(fd);
+            file_info.offset = offset;
+            file_info.length = length;
+            file_info.statResult = 0;
+#ifdef CROW_ENABLE_COMPRESSION
+            compressed = false;
+#endif
+            set_header("Content-Length", std::to_string(length));
+        }
+
         /// Return a static file as the response body, the content_type may be specified explicitly.
         void set_static_file_info(std::string path, std::string content_type = "")
         {
@@ -449,6 +486,7 @@ namespace crow
         bool completed_{};
         std::function<void()> complete_request_handler_;
         std::function<bool()> is_alive_helper_;
+        std::function<void(std::function<void()>)> dispatch_handler_;
         static_file_info file_info;
     };
 } // namespace crow
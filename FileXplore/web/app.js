@@ -12,6 +12,13 @@ class FileXploreApp {
         this.currentPreviewPath = null;  // Track which file is being previewed
         this.navigationHistory = ['/'];  // Track navigation history
         this.navigationHistoryIndex = 0;  // Current position in history
+        this.pageSize = 1000;  // Entries per /api/filesystem page
+        this.previewLength = 64 * 1024;  // Bytes fetched for a file preview
+        this.uploadChunkSize = 4 * 1024 * 1024;  // Bytes per upload request
+        this.uploadRetries = 5;  // Consecutive failed chunks before an upload gives up
+        this.uploadHashLimit = 64 * 1024 * 1024;  // Largest file hashed to skip uploading stored content
+        this.dedupEnabled = false;  // Server stores content once (reported by /api/system)
+        this.listingLoadId = 0;  // Incremented on every directory load
 
         this.init();
     }
@@ -162,17 +169,25 @@ class FileXploreApp {
     }
 
     async loadFileSystem(path = this.currentPath) {
+        // A newer navigation cancels the remaining pages of this one
+        const loadId = ++this.listingLoadId;
+
         try {
             this.showLoading(true);
-            const response = await this.apiRequest('/api/filesystem', 'GET', null, { path });
+            const response = await this.apiRequest('/api/filesystem', 'GET', null, { path, limit: this.pageSize });
 
             if (response.success) {
-                const data = JSON.parse(response.data);
+                const data = response.data;
                 this.currentPath = data.currentPath;
                 this.updateBreadcrumb(data.currentPath, data.parentPath);
                 this.renderFileList(data.files);
                 this.updateCommandPrompt();
                 this.updateNavigationButtons();
+                this.showLoading(false);
+
+                if (!data.done) {
+                    await this.loadRemainingPages(loadId, data.currentPath, data.files, data.nextCursor);
+                }
             } else {
                 throw new Error(response.message);
             }
@@ -184,6 +199,28 @@ class FileXploreApp {
         }
     }
 
+    async loadRemainingPages(loadId, path, files, cursor) {
+        const fileList = document.getElementById('file-list');
+
+        while (cursor) {
+            const response = await this.apiRequest('/api/filesystem', 'GET', null, { path, limit: this.pageSize, cursor });
+            if (loadId !== this.listingLoadId) {
+                return;
+            }
+            if (!response.success) {
+                throw new Error(response.message);
+            }
+
+            const page = response.data;
+            files.push(...page.files);
+            this.sortFiles(page.files).forEach(file => fileList.appendChild(this.createFileItem(file)));
+            cursor = page.done ? null : page.nextCursor;
+        }
+
+        // Pages arrive in directory order; put the whole listing in sort order once
+        this.renderFileList(files);
+    }
+
     async loadSystemInfo() {
         try {
             const response = await this.apiRequest('/api/system');
@@ -197,6 +234,7 @@ class FileXploreApp {
     }
 
     updateSystemInfo(data) {
+        this.dedupEnabled = !!data.dedup;
         const diskUsage = data.disk_usage;
         const usagePercent = ((diskUsage.used / diskUsage.total) * 100).toFixed(1);
 
@@ -509,10 +547,12 @@ class FileXploreApp {
 
     async openFile(path) {
         try {
-            const response = await this.apiRequest(`/api/file/${encodeURIComponent(path)}`);
+            // Only the first previewLength bytes are read, however large the file is
+            const response = await this.apiRequest(`/api/file/${encodeURIComponent(path)}`, 'GET', null,
+                { length: this.previewLength });
 
             if (response.success) {
-                this.showFilePreview(path, response.data);
+                this.showFilePreview(path, response.data, response.truncated ? response.fileSize : null);
             } else {
                 throw new Error(response.message);
             }
@@ -522,19 +562,24 @@ class FileXploreApp {
         }
     }
 
-    showFilePreview(path, content) {
+    showFilePreview(path, content, truncatedSize = null) {
         const modal = document.getElementById('file-preview-modal');
         const title = document.getElementById('preview-title');
         const contentTextarea = document.getElementById('file-preview-content');
         const saveBtn = document.getElementById('preview-save-btn');
 
         this.currentPreviewPath = path;  // Store the current file path
-        title.textContent = `Edit: ${path.split('/').pop()}`;
         contentTextarea.value = content;
 
-        // Make sure save button is visible
+        // A partial preview is read-only: saving it would cut the file short
+        const partial = truncatedSize !== null;
+        title.textContent = partial
+            ? `View: ${path.split('/').pop()} (first ${this.formatFileSize(content.length)} of ${this.formatFileSize(truncatedSize)})`
+            : `Edit: ${path.split('/').pop()}`;
+        contentTextarea.readOnly = partial;
+
         if (saveBtn) {
-            saveBtn.style.display = 'flex';
+            saveBtn.style.display = partial ? 'none' : 'flex';
         }
 
         modal.style.display = 'flex';
@@ -720,7 +765,8 @@ class FileXploreApp {
 
     downloadFile(path) {
         const link = document.createElement('a');
-        link.href = `/api/file/${encodeURIComponent(path)}`;
+        // Raw bytes with Range support; /api/file returns JSON for the preview
+        link.href = `/api/download/${encodeURIComponent(path)}`;
         link.download = path.split('/').pop();
         document.body.appendChild(link);
         link.click();
@@ -798,49 +844,74 @@ class FileXploreApp {
 
     async uploadFile(file) {
         const path = this.currentPath === '/' ? `/${file.name}` : `${this.currentPath}/${file.name}`;
+        let uploadId = null;
 
         try {
             this.showStatus(`Uploading ${file.name}...`, 'info');
-            
-            // Read file content (handle both text and binary files)
-            const content = await this.readFileAsText(file);
-            
-            // Send file content as plain text, not JSON
-            const url = `/api/file/${encodeURIComponent(path)}`;
-            const response = await fetch(url, {
-                method: 'POST',
-                headers: {
-                    'Content-Type': 'text/plain',
-                },
-                body: content
-            });
-
-            const result = await response.json();
 
-            if (!response.ok) {
-                throw new Error(result.message || `HTTP ${response.status}`);
+            // With deduplicated storage, content the server already holds is linked instead of sent
+            const request = { path, size: file.size };
+            if (this.dedupEnabled && window.crypto && crypto.subtle && file.size <= this.uploadHashLimit) {
+                request.sha256 = await this.hashFile(file);
             }
 
-            if (result.success) {
-                this.showStatus(`Uploaded ${file.name} successfully`, 'success');
+            // Chunks are sent as raw bytes into a server-side temp file, published by finalize
+            const begin = await this.apiRequest('/api/upload', 'POST', request);
+            if (begin.data.complete) {
+                this.showStatus(`Uploaded ${file.name} successfully (content already stored)`, 'success');
                 await this.loadFileSystem();
-            } else {
-                throw new Error(result.message);
+                return;
             }
+            uploadId = begin.data.uploadId;
+            const chunkSize = Math.min(this.uploadChunkSize, begin.data.chunkSize);
+            let offset = 0;
+            let retries = 0;
+
+            while (offset < file.size) {
+                const chunk = file.slice(offset, offset + chunkSize);
+                try {
+                    const response = await fetch(`/api/upload/${uploadId}?offset=${offset}`, {
+                        method: 'PUT',
+                        headers: { 'Content-Type': 'application/octet-stream' },
+                        body: chunk
+                    });
+                    const result = await response.json();
+                    if (!response.ok && response.status !== 409) {
+                        throw new Error(result.message || `HTTP ${response.status}`);
+                    }
+                    // 409 also reports the acknowledged offset to continue from
+                    offset = result.data.offset;
+                    retries = 0;
+                } catch (error) {
+                    if (++retries > this.uploadRetries) {
+                        throw error;
+                    }
+                    // Resume from whatever the server acknowledged before the failure
+                    const status = await this.apiRequest(`/api/upload/${uploadId}`);
+                    offset = status.data.offset;
+                }
+
+                const percent = file.size ? Math.floor(offset * 100 / file.size) : 100;
+                this.showStatus(`Uploading ${file.name}... ${percent}%`, 'info');
+            }
+
+            await this.apiRequest(`/api/upload/${uploadId}/finalize`, 'POST');
+            uploadId = null;
+            this.showStatus(`Uploaded ${file.name} successfully`, 'success');
+            await this.loadFileSystem();
         } catch (error) {
+            if (uploadId) {
+                fetch(`/api/upload/${uploadId}`, { method: 'DELETE' }).catch(() => {});
+            }
             this.showStatus(`Failed to upload ${file.name}: ${error.message}`, 'error');
             console.error('Error uploading file:', error);
         }
     }
 
-    readFileAsText(file) {
-        return new Promise((resolve, reject) => {
-            const reader = new FileReader();
-            reader.onload = () => resolve(reader.result);
-            reader.onerror = reject;
-            // Try to read as text first, fallback to binary if needed
-            reader.readAsText(file);
-        });
+    // SHA-256 of a file as lowercase hex
+    async hashFile(file) {
+        const digest = await crypto.subtle.digest('SHA-256', await file.arrayBuffer());
+        return Array.from(new Uint8Array(digest), byte => byte.toString(16).padStart(2, '0')).join('');
     }
 
     showCompressDialog() {
@@ -940,19 +1011,20 @@ class FileXploreApp {
         }
     }
 
-    searchFiles() {
-        const query = document.getElementById('search-input').value.toLowerCase();
+    async searchFiles() {
+        const query = document.getElementById('search-input').value;
 
         if (!query) {
             this.loadFileSystem();
             return;
         }
 
+        // The current folder is filtered at once; the filename index then answers for the whole tree
         const allItems = Array.from(document.querySelectorAll('.file-item'));
 
         allItems.forEach(item => {
             const name = item.dataset.name.toLowerCase();
-            if (name.includes(query)) {
+            if (name.includes(query.toLowerCase())) {
                 item.style.display = '';
             } else {
                 item.style.display = 'none';
@@ -961,6 +1033,42 @@ class FileXploreApp {
 
         const visibleCount = allItems.filter(item => item.style.display !== 'none').length;
         this.showStatus(`Found ${visibleCount} items matching "${query}"`, 'success');
+
+        try {
+            const response = await this.apiRequest('/api/locate', 'GET', null, { q: query, limit: 200 });
+            if (document.getElementById('search-input').value === query) {
+                this.renderLocateResults(query, response.data);
+            }
+        } catch (error) {
+            // Typically the index is still being built: the folder filter stands
+            console.error('Error locating files:', error);
+        }
+    }
+
+    renderLocateResults(query, data) {
+        const fileList = document.getElementById('file-list');
+        const emptyState = document.getElementById('empty-state');
+
+        if (data.results.length === 0) {
+            fileList.style.display = 'none';
+            emptyState.style.display = 'flex';
+        } else {
+            fileList.style.display = 'block';
+            emptyState.style.display = 'none';
+        }
+
+        // Best matches first, as ranked by the server; the details line shows the containing folder
+        fileList.innerHTML = '';
+        data.results.forEach(result => {
+            const slash = result.path.lastIndexOf('/');
+            const item = this.createFileItem({ name: result.path.substring(slash + 1), type: result.type, size: 0 });
+            item.dataset.path = result.path;
+            item.querySelector('.file-details').textContent = result.path.substring(0, slash) || '/';
+            fileList.appendChild(item);
+        });
+
+        const shown = data.results.length < data.total ? ` (showing ${data.results.length})` : '';
+        this.showStatus(`Found ${data.total} items matching "${query}" in all folders${shown}`, 'success');
     }
 
     refreshFileList() {